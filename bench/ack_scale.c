@@ -0,0 +1,296 @@
+// bench/ack_scale.c
+// Saturating ACK-throughput client: T threads, each driving C pipelined
+// connections with a window of W outstanding MSGs. A share of the MSGs can be
+// direct messages to other connected users, which exercises cross-shard
+// delivery on the server. ACK round-trip latency is recorded per MSG, into
+// one histogram per worker merged at the end; range ACKs count for every
+// msg_id they cover.
+// Build:
+//   make ack-scale
+// Run (or `make scaletest`, which sweeps server shard counts for you):
+//   ./ack-scale 127.0.0.1 9000 [threads] [conns_per_thread] [window] [secs] [dm_pct]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+#include "dbin/types.h"
+#include "dbin/protocol.h"
+#include "dbin/dbin.h"
+#include "dbin/codec.h"
+#include "dbin/batch.h"
+#include "dbin/stream.h"
+#include "dbin/ack.h"
+#include "dbin/hist.h"
+
+#define WINDOW_MAX   1024      // send timestamps are kept per msg_id modulo this
+#define LAT_SUB_BITS 8         // round trips to within 0.4%
+
+typedef struct {
+    int fd;
+    u32 user_id;
+    u16 next_id;
+    int outstanding;
+    dbin_stream_t in;
+    u8 inbuf[16384];
+    u64 sent_ns[WINDOW_MAX];
+} bconn_t;
+
+typedef struct {
+    int id;
+    int nconns;
+    int window;
+    int dm_pct;
+    int total_users;
+    u64 deadline;
+    bconn_t *conns;
+    u64 acks;      // msg_ids acknowledged
+    u64 ack_bytes; // wire bytes of ACK frames, length prefixes included
+    u64 dms_in;
+    u32 rng;
+    dbin_hist_t lat; // ACK round trips, ns
+    u64 *lat_counts;
+} worker_t;
+
+static const char *g_ip;
+static int g_port;
+
+static u64 now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+}
+
+static u32 xorshift(u32 *s) {
+    u32 x = *s;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *s = x;
+}
+
+static int connect_to(const char *ip, int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    addr.sin_addr.s_addr = inet_addr(ip);
+
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    int yes = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+    return fd;
+}
+
+static int send_all(int fd, const u8 *buf, usize len) {
+    while (len > 0) {
+        ssize_t n = send(fd, buf, (size_t)len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return 1;
+        }
+        buf += (usize)n;
+        len -= (usize)n;
+    }
+    return 0;
+}
+
+// Top the connection's window back up with one send.
+static int refill(worker_t *w, bconn_t *c) {
+    static const u8 payload[] = "scale test payload";
+    dbin_msg_t m[64];
+    int k = 0;
+    u64 now = now_ns();
+
+    while (c->outstanding < w->window && k < 64) {
+        dbin_msg_t *x = &m[k++];
+        memset(x, 0, sizeof(*x));
+        x->magic = (u16)DBIN_MAGIC;
+        x->version = (u8)DBIN_VERSION;
+        x->type = (u8)DBIN_TYPE_MSG;
+        x->valid = 1;
+        x->user_id = c->user_id;
+        x->msg_id = c->next_id++;
+        c->sent_ns[x->msg_id % WINDOW_MAX] = now;
+        x->msg_len = (u16)(sizeof(payload) - 1);
+        x->msg = payload;
+
+        if (w->dm_pct > 0 && (int)(xorshift(&w->rng) % 100) < w->dm_pct) {
+            x->is_room = 0;
+            x->route = 1 + xorshift(&w->rng) % (u32)w->total_users;
+        } else {
+            x->is_room = 1;
+            x->route = 77;
+        }
+        c->outstanding++;
+    }
+    if (k == 0) return 0;
+
+    u8 buf[64 * 48];
+    dbin_arena_t a;
+    usize done = 0;
+    dbin_arena_init(&a, buf, (usize)sizeof(buf));
+    if (dbin_encode_batch(m, (usize)k, &a, 0, &done) != DBIN_OK) return 1;
+    return send_all(c->fd, a.buf, a.len);
+}
+
+// The server acknowledges in order, so the covered ids are the oldest
+// outstanding ones; their send times are still in sent_ns.
+static void on_ack(worker_t *w, bconn_t *c, const dbin_msg_t *m, usize frame_len) {
+    u64 now = now_ns();
+    int n = 0;
+    for (int i = c->outstanding; i > 0; i--) {
+        u16 id = (u16)(c->next_id - i);
+        if (!dbin_ack_covers(m, id)) continue;
+        dbin_hist_record(&w->lat, now - c->sent_ns[id % WINDOW_MAX]);
+        n++;
+    }
+    c->outstanding -= n;
+    w->acks += (u64)n;
+    w->ack_bytes += DBIN_LEN_PREFIX_BYTES + frame_len;
+}
+
+static void *worker_main(void *arg) {
+    worker_t *w = (worker_t*)arg;
+    int epfd = epoll_create1(0);
+    struct epoll_event evs[128];
+
+    for (int i = 0; i < w->nconns; i++) {
+        bconn_t *c = &w->conns[i];
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.ptr = c;
+        epoll_ctl(epfd, EPOLL_CTL_ADD, c->fd, &ev);
+        if (refill(w, c)) return NULL;
+    }
+
+    while (now_ns() < w->deadline) {
+        int n = epoll_wait(epfd, evs, 128, 10);
+        for (int i = 0; i < n; i++) {
+            bconn_t *c = (bconn_t*)evs[i].data.ptr;
+            usize avail = 0;
+            u8 *dst = dbin_stream_wbuf(&c->in, &avail);
+            ssize_t r = recv(c->fd, dst, (size_t)avail, MSG_DONTWAIT);
+            if (r <= 0) continue;
+            dbin_stream_commit(&c->in, (usize)r);
+
+            dbin_msg_t m;
+            int rc;
+            while ((rc = dbin_stream_next(&c->in, &m, 0)) != DBIN_ERR_AGAIN) {
+                if (rc != DBIN_OK) break;
+                if (m.type == DBIN_TYPE_ACK || m.type == DBIN_TYPE_ACK_RANGE) {
+                    on_ack(w, c, &m, c->in.frame_len);
+                } else if (m.type == DBIN_TYPE_MSG) {
+                    w->dms_in++;
+                }
+            }
+            if (refill(w, c)) break;
+        }
+    }
+    close(epfd);
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3 || argc > 8) {
+        fprintf(stderr, "usage: %s <ip> <port> [threads] [conns_per_thread] [window] [secs] [dm_pct]\n", argv[0]);
+        return 1;
+    }
+    g_ip = argv[1];
+    g_port = atoi(argv[2]);
+    int threads = (argc > 3) ? atoi(argv[3]) : 4;
+    int per = (argc > 4) ? atoi(argv[4]) : 16;
+    int window = (argc > 5) ? atoi(argv[5]) : 32;
+    int secs = (argc > 6) ? atoi(argv[6]) : 5;
+    int dm_pct = (argc > 7) ? atoi(argv[7]) : 0;
+    if (threads < 1) threads = 1;
+    if (per < 1) per = 1;
+    if (window < 1) window = 1;
+    if (window > WINDOW_MAX) window = WINDOW_MAX;
+    if (secs < 1) secs = 1;
+
+    worker_t *ws = (worker_t*)calloc((size_t)threads, sizeof(*ws));
+    if (!ws) return 1;
+
+    // Connect everyone first so DMs find their recipients online.
+    u32 next_user = 1;
+    for (int t = 0; t < threads; t++) {
+        worker_t *w = &ws[t];
+        w->id = t;
+        w->nconns = per;
+        w->window = window;
+        w->dm_pct = dm_pct;
+        w->total_users = threads * per;
+        w->rng = 0x9E3779B9u ^ (u32)(t + 1);
+        w->conns = (bconn_t*)calloc((size_t)per, sizeof(bconn_t));
+        w->lat_counts = (u64*)malloc(DBIN_HIST_BUCKETS(LAT_SUB_BITS) * sizeof(u64));
+        if (!w->conns || !w->lat_counts) return 1;
+        dbin_hist_init(&w->lat, LAT_SUB_BITS, w->lat_counts, DBIN_HIST_BUCKETS(LAT_SUB_BITS));
+
+        for (int i = 0; i < per; i++) {
+            bconn_t *c = &w->conns[i];
+            c->fd = connect_to(g_ip, g_port);
+            if (c->fd < 0) {
+                perror("connect");
+                return 1;
+            }
+            c->user_id = next_user++;
+            c->next_id = 1;
+            dbin_stream_init(&c->in, c->inbuf, (usize)sizeof(c->inbuf));
+        }
+    }
+
+    pthread_t *tids = (pthread_t*)calloc((size_t)threads, sizeof(pthread_t));
+    if (!tids) return 1;
+
+    u64 t0 = now_ns();
+    u64 deadline = t0 + (u64)secs * 1000000000ull;
+    for (int t = 0; t < threads; t++) {
+        ws[t].deadline = deadline;
+        pthread_create(&tids[t], NULL, worker_main, &ws[t]);
+    }
+
+    u64 acks = 0, ack_bytes = 0, dms = 0;
+    for (int t = 0; t < threads; t++) {
+        pthread_join(tids[t], NULL);
+        acks += ws[t].acks;
+        ack_bytes += ws[t].ack_bytes;
+        dms += ws[t].dms_in;
+    }
+    double el = (double)(now_ns() - t0) / 1e9;
+
+    // Workers' histograms merge into the first.
+    dbin_hist_t *lat = &ws[0].lat;
+    for (int t = 1; t < threads; t++) dbin_hist_merge(lat, &ws[t].lat);
+    double p50 = (double)dbin_hist_percentile(lat, 50.0) / 1e3;
+    double p99 = (double)dbin_hist_percentile(lat, 99.0) / 1e3;
+    double p999 = (double)dbin_hist_percentile(lat, 99.9) / 1e3;
+
+    printf("client_threads=%d conns=%d window=%d dm_pct=%d  acks/s=%.0f  ack_B/msg=%.2f  dm_delivered/s=%.0f  p50_us=%.1f  p99_us=%.1f  p99.9_us=%.1f\n",
+           threads, threads * per, window, dm_pct, (double)acks / el, acks ? (double)ack_bytes / (double)acks : 0.0,
+           (double)dms / el, p50, p99, p999);
+
+    for (int t = 0; t < threads; t++) {
+        for (int i = 0; i < per; i++) close(ws[t].conns[i].fd);
+        free(ws[t].conns);
+        free(ws[t].lat_counts);
+    }
+    free(tids);
+    free(ws);
+    return 0;
+}
@@ -0,0 +1,228 @@
+// bench/batch_check.c
+// Cross-check and timing of dbin_decode_batch's implementations (scalar,
+// SSSE3, AVX2). The same frames, random valid ones and corrupted copies
+// (flipped header bits, truncated lengths, missing frames), are decoded by
+// each implementation this CPU can run, whole and in batches of 1..19 so
+// every tail path is hit, and every field of every entry is compared with
+// dbin_decode of that frame alone. Prints the implementation picked by
+// default, then per implementation the mismatches and ns per frame.
+// Exits non-zero on any mismatch.
+// Build:
+//   make batch-check
+// Run (or `make batchcheck`):
+//   ./batch-check [frames]
+
+#include "dbin/batch.h"
+#include "dbin/codec.h"
+#include "dbin/protocol.h"
+#include "dbin/schema.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_PAYLOAD 256
+#define SLOT        (DBIN_HEADER_V1_BYTES + MAX_PAYLOAD)
+#define REPS        200
+
+static const char *const impls[] = { "scalar", "ssse3", "avx2" };
+
+typedef struct soa_buf {
+    u32 *user_id, *route;
+    u16 *msg_id, *msg_len;
+    u8  *type, *is_room, *reserved, *err;
+    const u8 **payload;
+    dbin_batch_t b;
+} soa_buf_t;
+
+static u64 now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+}
+
+static u32 xorshift(u32 *s) {
+    u32 x = *s;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *s = x;
+}
+
+static int soa_alloc(soa_buf_t *s, usize n) {
+    s->user_id  = (u32*)malloc(n * sizeof(u32));
+    s->route    = (u32*)malloc(n * sizeof(u32));
+    s->msg_id   = (u16*)malloc(n * sizeof(u16));
+    s->msg_len  = (u16*)malloc(n * sizeof(u16));
+    s->type     = (u8*)malloc(n);
+    s->is_room  = (u8*)malloc(n);
+    s->reserved = (u8*)malloc(n);
+    s->err      = (u8*)malloc(n);
+    s->payload  = (const u8**)malloc(n * sizeof(*s->payload));
+    s->b = (dbin_batch_t){ s->user_id, s->route, s->msg_id, s->msg_len, s->type,
+                           s->is_room, s->reserved, s->payload, s->err };
+    return s->user_id && s->route && s->msg_id && s->msg_len && s->type &&
+           s->is_room && s->reserved && s->err && s->payload;
+}
+
+static void soa_free(soa_buf_t *s) {
+    free(s->user_id);
+    free(s->route);
+    free(s->msg_id);
+    free(s->msg_len);
+    free(s->type);
+    free(s->is_room);
+    free(s->reserved);
+    free(s->err);
+    free(s->payload);
+}
+
+// A random frame that passes dbin_validate, written to `out`.
+static usize random_frame(u32 *rng, const u8 *text, u8 *out) {
+    for (;;) {
+        dbin_msg_t m;
+        memset(&m, 0, sizeof(m));
+        m.magic = (u16)DBIN_MAGIC;
+        m.version = (u8)DBIN_VERSION;
+        m.type = (u8)(xorshift(rng) % 7); // envelopes need a body; ENV is covered by bit flips
+        m.valid = 1;
+        m.is_room = (_Bool)(xorshift(rng) & 1);
+        m.user_id = xorshift(rng) & 0xFFFFF;
+        m.route = xorshift(rng) & 0xFFFFF;
+        m.msg_id = (u16)xorshift(rng);
+        m.msg_len = (u16)(xorshift(rng) % (MAX_PAYLOAD + 1));
+        if (m.type != DBIN_TYPE_MSG && (xorshift(rng) & 1)) m.msg_len = 0;
+        if (m.type == DBIN_TYPE_MSG && m.msg_len > 0) m.reserved = (u8)(xorshift(rng) % 3);
+        m.msg = text;
+
+        usize len = 0;
+        if (dbin_encode(&m, out, SLOT, &len) == DBIN_OK) return len;
+    }
+}
+
+// Damage frame i in place: header bit flips, a shorter length, or no frame.
+static void corrupt(u32 *rng, const u8 **frames, usize *lens, u8 *slot, usize i) {
+    switch (xorshift(rng) % 4) {
+    case 0:
+    case 1: {
+        int flips = 1 + (int)(xorshift(rng) % 3);
+        for (int k = 0; k < flips; k++) {
+            u32 bit = xorshift(rng) % (DBIN_HEADER_V1_BYTES * 8);
+            slot[bit / 8] ^= (u8)(0x80u >> (bit % 8));
+        }
+        break;
+    }
+    case 2:
+        lens[i] = xorshift(rng) % (lens[i] + 1);
+        break;
+    default:
+        frames[i] = 0;
+        lens[i] = xorshift(rng) % 16;
+        break;
+    }
+}
+
+// Entries [0, n) of `s` against dbin_decode of each frame; returns mismatches.
+static usize compare(const u8 *const *frames, const usize *lens, usize n, const soa_buf_t *s, const char *impl) {
+    usize bad = 0;
+    for (usize i = 0; i < n; i++) {
+        dbin_msg_t m;
+        memset(&m, 0, sizeof(m));
+        int rc = frames[i] ? dbin_decode(frames[i], lens[i], &m) : DBIN_ERR_PARAM;
+        const u8 *payload = (rc == DBIN_OK) ? m.msg : 0;
+
+        if (s->err[i] != (u8)rc || s->user_id[i] != m.user_id || s->route[i] != m.route ||
+            s->msg_id[i] != m.msg_id || s->msg_len[i] != m.msg_len || s->type[i] != m.type ||
+            s->is_room[i] != (u8)m.is_room || s->reserved[i] != m.reserved || s->payload[i] != payload) {
+            if (bad++ < 5) {
+                fprintf(stderr, "%s: frame %zu (len %zu): err %u want %d, user %u/%u route %u/%u "
+                        "id %u/%u len %u/%u type %u/%u room %u/%u res %u/%u payload %s\n",
+                        impl, i, lens[i], s->err[i], rc, s->user_id[i], m.user_id, s->route[i], m.route,
+                        s->msg_id[i], m.msg_id, s->msg_len[i], m.msg_len, s->type[i], m.type,
+                        s->is_room[i], m.is_room, s->reserved[i], m.reserved,
+                        s->payload[i] == payload ? "ok" : "differs");
+            }
+        }
+    }
+    return bad;
+}
+
+int main(int argc, char **argv) {
+    usize n = (argc > 1) ? (usize)strtoul(argv[1], 0, 10) : 8191;
+    if (n < 2) n = 2;
+
+    u8 *store = (u8*)malloc(n * SLOT);
+    const u8 **frames = (const u8**)malloc(n * sizeof(*frames));
+    usize *lens = (usize*)malloc(n * sizeof(*lens));
+    u8 text[MAX_PAYLOAD];
+    soa_buf_t s;
+    if (!store || !frames || !lens || !soa_alloc(&s, n)) return 1;
+
+    // First half valid, second half corrupted, then shuffled so each SIMD
+    // group mixes both.
+    u32 rng = 0x2545F491u;
+    for (usize i = 0; i < sizeof(text); i++) text[i] = (u8)('a' + xorshift(&rng) % 26);
+    for (usize i = 0; i < n; i++) {
+        u8 *slot = store + i * SLOT;
+        frames[i] = slot;
+        lens[i] = random_frame(&rng, text, slot);
+        if (i >= n / 2) corrupt(&rng, frames, lens, slot, i);
+    }
+    for (usize i = n - 1; i > 0; i--) {
+        usize j = xorshift(&rng) % (i + 1);
+        const u8 *f = frames[i];
+        usize l = lens[i];
+        frames[i] = frames[j];
+        lens[i] = lens[j];
+        frames[j] = f;
+        lens[j] = l;
+    }
+
+    usize ok = 0;
+    for (usize i = 0; i < n; i++) {
+        dbin_msg_t m;
+        if (frames[i] && dbin_decode(frames[i], lens[i], &m) == DBIN_OK) ok++;
+    }
+
+    printf("batch-check: %zu frames (%zu decode cleanly), default implementation: %s\n",
+           n, ok, dbin_decode_batch_impl());
+    printf("%-8s %10s %10s %12s\n", "impl", "whole", "chunked", "ns/frame");
+
+    usize total_bad = 0;
+    for (usize k = 0; k < sizeof(impls) / sizeof(impls[0]); k++) {
+        if (dbin_decode_batch_use(impls[k]) != DBIN_OK) {
+            printf("%-8s %10s\n", impls[k], "skipped (not supported on this CPU)");
+            continue;
+        }
+
+        memset(s.err, 0xFF, n);
+        if (dbin_decode_batch(frames, lens, n, &s.b) != DBIN_OK) return 1;
+        usize bad_whole = compare(frames, lens, n, &s, impls[k]);
+
+        memset(s.err, 0xFF, n);
+        for (usize i = 0, c = 1; i < n; i += c, c = c % 19 + 1) {
+            usize m = (n - i < c) ? n - i : c;
+            dbin_batch_t b = { s.user_id + i, s.route + i, s.msg_id + i, s.msg_len + i, s.type + i,
+                               s.is_room + i, s.reserved + i, s.payload + i, s.err + i };
+            if (dbin_decode_batch(frames + i, lens + i, m, &b) != DBIN_OK) return 1;
+        }
+        usize bad_chunk = compare(frames, lens, n, &s, impls[k]);
+
+        u64 t0 = now_ns();
+        for (int r = 0; r < REPS; r++) dbin_decode_batch(frames, lens, n, &s.b);
+        double ns = (double)(now_ns() - t0) / ((double)REPS * (double)n);
+
+        printf("%-8s %10zu %10zu %12.2f\n", impls[k], bad_whole, bad_chunk, ns);
+        total_bad += bad_whole + bad_chunk;
+    }
+    dbin_decode_batch_use(0);
+
+    printf("%s\n", total_bad ? "MISMATCH" : "all implementations match dbin_decode");
+
+    soa_free(&s);
+    free(lens);
+    free(frames);
+    free(store);
+    return total_bad ? 1 : 0;
+}
@@ -0,0 +1,415 @@
+// bench/cap_replay.c
+// Replays frame captures (dbin-server ... <capture_prefix>, see
+// dbin/capture.h) against a server. The files are mmap'd and merged by
+// capture time; every captured connection gets its own socket, opened at its
+// first frame, and its frames go out in their captured order.
+//
+// Pacing: -x 1 keeps the original inter-arrival times, -x 4 plays four times
+// faster, -x 0 sends as fast as the server takes it. -s skips to a time
+// offset through each file's index; -d stops after that much capture time.
+// Build:
+//   make cap-replay
+// Run:
+//   ./cap-replay [-x speed] [-s start_secs] [-d secs] <ip> <port> capture.dcap...
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+#include "dbin/types.h"
+#include "dbin/protocol.h"
+#include "dbin/dbin.h"
+#include "dbin/codec.h"
+#include "dbin/stream.h"
+#include "dbin/capture.h"
+#include "dbin/hist.h"
+
+#define MAX_FILES    64
+#define OUT_CAP      (32 * 1024)
+#define IN_CAP       DBIN_STREAM_MIN_CAP
+#define LAT_SUB_BITS 7
+#define DRAIN_NS     1000000000ull // after the last frame, how long to keep reading
+
+typedef struct {
+    u32  conn_id;
+    int  fd;
+    int  want_out;
+    int  dirty;      // on the flush list
+    usize out_off;
+    usize out_len;
+    dbin_stream_t in;
+    u8   out[OUT_CAP];
+    u8   inbuf[IN_CAP];
+} rconn_t;
+
+// conn_id -> rconn_t (open addressing, linear probing, grows at half full).
+typedef struct {
+    u32      *keys;  // conn_id + 1; 0 = empty
+    rconn_t **vals;
+    usize     cap;
+    usize     len;
+} cmap_t;
+
+typedef struct {
+    dbin_cap_reader_t r;
+    dbin_cap_rec_t    head;   // next record of this file
+    int               live;   // head is valid
+    const u8         *map;
+    usize             len;
+} cfile_t;
+
+static const char *g_ip;
+static int g_port;
+static int g_epfd;
+static u64 g_in_frames;
+static u64 g_out_bytes;
+static rconn_t **g_dirty;   // connections with frames queued since the last flush_all
+static usize g_ndirty, g_dirty_cap;
+
+static u64 now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+}
+
+static int connect_to(const char *ip, int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    addr.sin_addr.s_addr = inet_addr(ip);
+
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    int yes = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    return fd;
+}
+
+static usize cm_slot(u32 key, usize cap) {
+    return (usize)(key * 0x9E3779B1u) & (cap - 1);
+}
+
+static int cm_grow(cmap_t *m) {
+    usize ncap = m->cap ? m->cap * 2 : 1024;
+    u32 *nk = (u32*)calloc(ncap, sizeof(*nk));
+    rconn_t **nv = (rconn_t**)calloc(ncap, sizeof(*nv));
+    if (!nk || !nv) {
+        free(nk);
+        free(nv);
+        return 1;
+    }
+    for (usize i = 0; i < m->cap; i++) {
+        if (!m->keys[i]) continue;
+        usize j = cm_slot(m->keys[i], ncap);
+        while (nk[j]) j = (j + 1) & (ncap - 1);
+        nk[j] = m->keys[i];
+        nv[j] = m->vals[i];
+    }
+    free(m->keys);
+    free(m->vals);
+    m->keys = nk;
+    m->vals = nv;
+    m->cap = ncap;
+    return 0;
+}
+
+// The connection replaying `conn_id`, connected on first use.
+static rconn_t *cm_get(cmap_t *m, u32 conn_id) {
+    if ((m->len + 1) * 2 > m->cap && cm_grow(m)) return 0;
+    u32 key = conn_id + 1;
+    usize i = cm_slot(key, m->cap);
+    while (m->keys[i]) {
+        if (m->keys[i] == key) return m->vals[i];
+        i = (i + 1) & (m->cap - 1);
+    }
+
+    rconn_t *c = (rconn_t*)calloc(1, sizeof(*c));
+    if (!c) return 0;
+    c->conn_id = conn_id;
+    c->fd = connect_to(g_ip, g_port);
+    if (c->fd < 0) {
+        free(c);
+        return 0;
+    }
+    dbin_stream_init(&c->in, c->inbuf, IN_CAP);
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = c;
+    epoll_ctl(g_epfd, EPOLL_CTL_ADD, c->fd, &ev);
+
+    m->keys[i] = key;
+    m->vals[i] = c;
+    m->len++;
+    return c;
+}
+
+static void set_out(rconn_t *c, int on) {
+    if (c->want_out == on) return;
+    struct epoll_event ev;
+    ev.events = EPOLLIN | (on ? EPOLLOUT : 0);
+    ev.data.ptr = c;
+    epoll_ctl(g_epfd, EPOLL_CTL_MOD, c->fd, &ev);
+    c->want_out = on;
+}
+
+static int flush_conn(rconn_t *c) {
+    while (c->out_off < c->out_len) {
+        ssize_t n = send(c->fd, c->out + c->out_off, c->out_len - c->out_off, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                set_out(c, 1);
+                return 0;
+            }
+            return 1;
+        }
+        c->out_off += (usize)n;
+        g_out_bytes += (u64)n;
+    }
+    c->out_off = c->out_len = 0;
+    set_out(c, 0);
+    return 0;
+}
+
+// Replies are only counted; reading them keeps the server from stalling on us.
+static void read_conn(rconn_t *c) {
+    for (;;) {
+        usize avail = 0;
+        u8 *dst = dbin_stream_wbuf(&c->in, &avail);
+        ssize_t r = recv(c->fd, dst, (size_t)avail, MSG_DONTWAIT);
+        if (r <= 0) return;
+        dbin_stream_commit(&c->in, (usize)r);
+
+        dbin_msg_t m;
+        int rc;
+        while ((rc = dbin_stream_next(&c->in, &m, 0)) != DBIN_ERR_AGAIN) {
+            if (c->in.err) {
+                dbin_stream_reset(&c->in);
+                break;
+            }
+            g_in_frames++;
+        }
+        if ((usize)r < avail) return;
+    }
+}
+
+// Handle socket events for up to `wait_ns`.
+static void poll_events(u64 wait_ns) {
+    struct epoll_event evs[256];
+    struct timespec ts = { (time_t)(wait_ns / 1000000000ull), (long)(wait_ns % 1000000000ull) };
+    int n = epoll_pwait2(g_epfd, evs, 256, &ts, NULL);
+    if (n < 0 && errno == ENOSYS) n = epoll_wait(g_epfd, evs, 256, (int)((wait_ns + 999999) / 1000000));
+
+    for (int i = 0; i < n; i++) {
+        rconn_t *c = (rconn_t*)evs[i].data.ptr;
+        if (evs[i].events & EPOLLIN) read_conn(c);
+        if (evs[i].events & EPOLLOUT) flush_conn(c);
+    }
+}
+
+// Queue one prefixed frame, waiting for room if the connection is backed up.
+static int queue_frame(rconn_t *c, const u8 *frame, usize len) {
+    while (OUT_CAP - c->out_len < DBIN_LEN_PREFIX_BYTES + len) {
+        if (flush_conn(c)) return 1;
+        if (OUT_CAP - c->out_len >= DBIN_LEN_PREFIX_BYTES + len) break;
+        poll_events(1000000);
+    }
+    u8 *p = c->out + c->out_len;
+    p[0] = (u8)(len >> 8);
+    p[1] = (u8)len;
+    memcpy(p + DBIN_LEN_PREFIX_BYTES, frame, len);
+    c->out_len += DBIN_LEN_PREFIX_BYTES + len;
+
+    if (!c->dirty) {
+        if (g_ndirty == g_dirty_cap) {
+            usize ncap = g_dirty_cap ? g_dirty_cap * 2 : 256;
+            rconn_t **nd = (rconn_t**)realloc(g_dirty, ncap * sizeof(*nd));
+            if (!nd) return 1;
+            g_dirty = nd;
+            g_dirty_cap = ncap;
+        }
+        g_dirty[g_ndirty++] = c;
+        c->dirty = 1;
+    }
+    return 0;
+}
+
+// Whatever does not go out now is sent on EPOLLOUT.
+static void flush_all(void) {
+    for (usize i = 0; i < g_ndirty; i++) {
+        g_dirty[i]->dirty = 0;
+        flush_conn(g_dirty[i]);
+    }
+    g_ndirty = 0;
+}
+
+static void advance(cfile_t *f, u64 stop_ns) {
+    int rc = dbin_cap_next(&f->r, &f->head);
+    f->live = rc == DBIN_OK && f->head.ts_ns < stop_ns;
+    if (rc != DBIN_OK && rc != DBIN_ERR_AGAIN) fprintf(stderr, "capture truncated mid-record\n");
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-x speed] [-s start_secs] [-d secs] <ip> <port> capture.dcap...\n", prog);
+}
+
+int main(int argc, char **argv) {
+    double speed = 1.0, start_s = 0.0, dur_s = 0.0;
+    int i = 1;
+    for (; i + 1 < argc && argv[i][0] == '-' && argv[i][1] && !argv[i][2]; i += 2) {
+        switch (argv[i][1]) {
+            case 'x': speed = atof(argv[i + 1]); break;
+            case 's': start_s = atof(argv[i + 1]); break;
+            case 'd': dur_s = atof(argv[i + 1]); break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (argc - i < 3 || argc - i - 2 > MAX_FILES || speed < 0 || start_s < 0 || dur_s < 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    g_ip = argv[i];
+    g_port = atoi(argv[i + 1]);
+    int nfiles = argc - i - 2;
+    char **paths = argv + i + 2;
+
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    u64 start_ns = (u64)(start_s * 1e9);
+    u64 stop_ns = dur_s > 0 ? start_ns + (u64)(dur_s * 1e9) : ~0ull;
+
+    static cfile_t files[MAX_FILES];
+    for (int k = 0; k < nfiles; k++) {
+        cfile_t *f = &files[k];
+        int fd = open(paths[k], O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0) {
+            perror(paths[k]);
+            return 1;
+        }
+        f->len = (usize)st.st_size;
+        f->map = (const u8*)mmap(NULL, f->len, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (f->map == MAP_FAILED) {
+            perror(paths[k]);
+            return 1;
+        }
+        madvise((void*)f->map, f->len, MADV_SEQUENTIAL);
+
+        int rc = dbin_cap_open(&f->r, f->map, f->len);
+        if (rc == DBIN_OK) rc = dbin_cap_seek(&f->r, start_ns);
+        if (rc != DBIN_OK) {
+            fprintf(stderr, "%s: not a readable capture (error %d)\n", paths[k], rc);
+            return 1;
+        }
+        if (!f->r.nindex) fprintf(stderr, "%s: no index (capture not closed cleanly), reading it all\n", paths[k]);
+        advance(f, stop_ns);
+    }
+
+    g_epfd = epoll_create1(0);
+    cmap_t conns;
+    memset(&conns, 0, sizeof(conns));
+
+    // How late each paced frame went out against its scaled capture time.
+    static u64 slip_counts[DBIN_HIST_BUCKETS(LAT_SUB_BITS)];
+    dbin_hist_t slip;
+    dbin_hist_init(&slip, LAT_SUB_BITS, slip_counts, DBIN_HIST_BUCKETS(LAT_SUB_BITS));
+
+    u64 frames = 0, first_ts = ~0ull, last_ts = 0;
+    u64 t0 = now_ns();
+    for (;;) {
+        // Oldest head across files; the handful of files makes a scan cheaper than a heap.
+        cfile_t *f = 0;
+        for (int k = 0; k < nfiles; k++) {
+            if (files[k].live && (!f || files[k].head.ts_ns < f->head.ts_ns)) f = &files[k];
+        }
+        if (!f) break;
+        dbin_cap_rec_t *rec = &f->head;
+        if (first_ts == ~0ull) first_ts = rec->ts_ns;
+        last_ts = rec->ts_ns;
+
+        if (speed > 0) {
+            u64 due = t0 + (u64)((double)(rec->ts_ns - first_ts) / speed);
+            u64 now = now_ns();
+            if (due > now) {
+                flush_all();
+                while ((now = now_ns()) < due) poll_events(due - now);
+            }
+            dbin_hist_record(&slip, now - due);
+        }
+
+        rconn_t *c = cm_get(&conns, rec->conn_id);
+        if (!c) {
+            perror("connect");
+            return 1;
+        }
+        if (queue_frame(c, rec->frame, rec->frame_len)) {
+            fprintf(stderr, "send failed on capture connection %u\n", rec->conn_id);
+            return 1;
+        }
+        frames++;
+        if (speed == 0 && (frames & 63) == 0) {
+            flush_all();
+            poll_events(0);
+        }
+        advance(f, stop_ns);
+    }
+    flush_all();
+    u64 sent_ns = now_ns() - t0;
+
+    // Let the last replies come back, and any backed-up output drain.
+    u64 drain_end = now_ns() + DRAIN_NS;
+    for (u64 before = ~0ull; now_ns() < drain_end && before != g_in_frames;) {
+        before = g_in_frames;
+        poll_events(100000000ull);
+    }
+
+    double el = (double)sent_ns / 1e9;
+    double span = frames ? (double)(last_ts - first_ts) / 1e9 : 0.0;
+    printf("replayed %llu frames over %zu connections from %d file(s): %.3f s of capture in %.3f s\n",
+           (unsigned long long)frames, conns.len, nfiles, span, el);
+    printf("frames/s=%.0f out_MB/s=%.1f frames_back=%llu\n", el > 0 ? (double)frames / el : 0.0,
+           el > 0 ? (double)g_out_bytes / el / 1e6 : 0.0, (unsigned long long)g_in_frames);
+    if (speed > 0) {
+        printf("pacing x%.2f, slip_us p50=%.1f p99=%.1f max=%.1f\n", speed,
+               (double)dbin_hist_percentile(&slip, 50.0) / 1e3, (double)dbin_hist_percentile(&slip, 99.0) / 1e3,
+               (double)slip.max / 1e3);
+    }
+
+    for (usize k = 0; k < conns.cap; k++) {
+        if (!conns.keys[k]) continue;
+        close(conns.vals[k]->fd);
+        free(conns.vals[k]);
+    }
+    free(conns.keys);
+    free(conns.vals);
+    free(g_dirty);
+    for (int k = 0; k < nfiles; k++) munmap((void*)files[k].map, files[k].len);
+    close(g_epfd);
+    return 0;
+}
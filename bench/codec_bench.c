@@ -0,0 +1,388 @@
+// bench/codec_bench.c
+// ns/op and bytes/op of dbin_encode, dbin_decode and dbin_validate against
+// a minimal JSON encoding of the same messages (json_msg.c), for payloads of
+// 0..4095 bytes and a chat-like mix. Each row is a warmed-up op timed over
+// repeated trials; the median, fastest trial and spread are reported.
+// Build:
+//   make codec-bench
+// Run (or `make bench`, which also writes build/codec-bench.csv):
+//   ./codec-bench [-o results.csv] [-r revision] [-t trials] [-c capture.dcap]
+// With -c, a "capture" row times the MSG frames of a server capture (see
+// dbin/capture.h) instead of synthetic traffic only.
+
+#include "json_msg.h"
+
+#include "dbin/types.h"
+#include "dbin/protocol.h"
+#include "dbin/dbin.h"
+#include "dbin/codec.h"
+#include "dbin/capture.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NMSG          1024       // distinct messages per workload, cycled through
+#define TRIAL_NS      20000000ull // target length of one trial
+#define TRIALS        11
+#define TRIALS_MAX    101
+#define MIX           -1         // payload size: chat-like mix instead of a fixed size
+#define CAPTURE       -2         // payloads and fields from a capture file
+
+enum { OP_ENCODE, OP_DECODE, OP_VALIDATE, NOPS };
+enum { FMT_DBIN, FMT_JSON, NFMTS };
+
+static const char *const op_names[NOPS] = { "encode", "decode", "validate" };
+static const char *const fmt_names[NFMTS] = { "dbin", "json" };
+
+typedef struct workload {
+    int        size;        // payload bytes, or MIX
+    dbin_msg_t msgs[NMSG];
+    u8        *payloads;    // backing bytes for msgs[i].msg
+    u8        *frames;      // dbin encodings, back to back
+    usize      frame_off[NMSG];
+    usize      frame_len[NMSG];
+    char      *json;        // JSON encodings, back to back
+    usize      json_off[NMSG];
+    usize      json_len[NMSG];
+    double     dbin_bytes;  // mean encoded size
+    double     json_bytes;
+} workload_t;
+
+static volatile u64 g_sink;
+
+static u64 now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+}
+
+static u32 xorshift(u32 *s) {
+    u32 x = *s;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *s = x;
+}
+
+// Chat-like payload sizes: mostly short lines, a long tail up to the limit.
+static int mix_size(u32 *rng) {
+    u32 r = xorshift(rng) % 100;
+    if (r < 55) return (int)(xorshift(rng) % 33);            // 0..32
+    if (r < 85) return 33 + (int)(xorshift(rng) % 96);       // 33..128
+    if (r < 97) return 129 + (int)(xorshift(rng) % 896);     // 129..1024
+    return 1025 + (int)(xorshift(rng) % (DBIN_MAX_MSG_LEN - 1024));
+}
+
+// Text: mostly letters and spaces, some punctuation JSON must escape, and
+// two-byte UTF-8 (é) now and then.
+static void fill_text(u8 *p, int n, u32 *rng) {
+    static const char letters[] = "etaoinshrdlucmfwypvbgkqjxz      ETAOIN,.!?0123456789";
+    int i = 0;
+    while (i < n) {
+        u32 r = xorshift(rng) % 1000;
+        if (r < 6) {
+            p[i++] = "\"\\\n"[r % 3];
+        } else if (r < 40 && i + 1 < n) {
+            p[i++] = 0xC3;
+            p[i++] = 0xA9;
+        } else {
+            p[i++] = (u8)letters[xorshift(rng) % (sizeof(letters) - 1)];
+        }
+    }
+}
+
+// Encode msgs[0..NMSG) both ways; payloads are already in place.
+static int workload_encode(workload_t *w, usize total) {
+    w->frames = (u8*)malloc(total + (usize)NMSG * 12);
+    w->json = (char*)malloc(total * 6 + (usize)NMSG * 128);
+    if (!w->frames || !w->json) return 1;
+
+    usize foff = 0, joff = 0;
+    for (int i = 0; i < NMSG; i++) {
+        const dbin_msg_t *m = &w->msgs[i];
+        usize n = 0;
+        if (dbin_encode(m, w->frames + foff, DBIN_MAX_FRAME_LEN, &n) != DBIN_OK) return 1;
+        w->frame_off[i] = foff;
+        w->frame_len[i] = n;
+        foff += n;
+
+        n = json_msg_encode(m, w->json + joff, (usize)m->msg_len * 6 + 128);
+        if (n == 0) return 1;
+        w->json_off[i] = joff;
+        w->json_len[i] = n;
+        joff += n;
+    }
+    w->dbin_bytes = (double)foff / NMSG;
+    w->json_bytes = (double)joff / NMSG;
+    return 0;
+}
+
+static int workload_init(workload_t *w, int size, u32 seed) {
+    memset(w, 0, sizeof(*w));
+    w->size = size;
+    u32 rng = seed;
+
+    int sizes[NMSG];
+    usize total = 0;
+    for (int i = 0; i < NMSG; i++) {
+        sizes[i] = size == MIX ? mix_size(&rng) : size;
+        total += (usize)sizes[i];
+    }
+
+    w->payloads = (u8*)malloc(total + 1);
+    if (!w->payloads) return 1;
+
+    usize poff = 0;
+    u32 msg_id = xorshift(&rng);
+    for (int i = 0; i < NMSG; i++) {
+        dbin_msg_t *m = &w->msgs[i];
+        u8 *p = w->payloads + poff;
+        fill_text(p, sizes[i], &rng);
+        poff += (usize)sizes[i];
+
+        // Senders and DM recipients across the 20-bit id space; rooms are
+        // few and popular.
+        m->magic = (u16)DBIN_MAGIC;
+        m->version = (u8)DBIN_VERSION;
+        m->type = (u8)DBIN_TYPE_MSG;
+        m->valid = 1;
+        m->is_room = xorshift(&rng) % 100 < 70;
+        m->user_id = xorshift(&rng) & 0xFFFFF;
+        m->route = m->is_room ? xorshift(&rng) % 512 : (xorshift(&rng) & 0xFFFFF);
+        m->msg_id = (u16)(msg_id + (u32)i);
+        m->msg_len = (u16)sizes[i];
+        m->msg = p;
+    }
+    return workload_encode(w, total);
+}
+
+// The first NMSG valid MSG frames of a capture file (dbin/capture.h), cycled
+// if it holds fewer.
+static int workload_capture(workload_t *w, const char *path) {
+    memset(w, 0, sizeof(*w));
+    w->size = MIX;
+
+    FILE *f = fopen(path, "rb");
+    if (!f) return 1;
+    fseek(f, 0, SEEK_END);
+    long flen = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    u8 *buf = (u8*)malloc(flen > 0 ? (usize)flen : 1);
+    int ok = buf && flen > 0 && fread(buf, 1, (size_t)flen, f) == (size_t)flen;
+    fclose(f);
+
+    dbin_cap_reader_t r;
+    if (!ok || dbin_cap_open(&r, buf, (usize)flen) != DBIN_OK) {
+        free(buf);
+        return 1;
+    }
+    int n = 0;
+    dbin_cap_rec_t rec;
+    while (n < NMSG && dbin_cap_next(&r, &rec) == DBIN_OK) {
+        dbin_msg_t *m = &w->msgs[n];
+        if (dbin_decode(rec.frame, rec.frame_len, m) == DBIN_OK && m->type == DBIN_TYPE_MSG) n++;
+    }
+    if (n == 0) {
+        free(buf);
+        return 1;
+    }
+    for (int i = n; i < NMSG; i++) w->msgs[i] = w->msgs[i % n];
+
+    // Payloads still point into the file buffer, which the workload keeps.
+    usize total = 0;
+    for (int i = 0; i < NMSG; i++) total += w->msgs[i].msg_len;
+    w->payloads = buf;
+    return workload_encode(w, total);
+}
+
+static void workload_free(workload_t *w) {
+    free(w->payloads);
+    free(w->frames);
+    free(w->json);
+}
+
+static int same_msg(const dbin_msg_t *a, const dbin_msg_t *b) {
+    return a->type == b->type && a->valid == b->valid && a->is_room == b->is_room &&
+           a->user_id == b->user_id && a->route == b->route && a->msg_id == b->msg_id &&
+           a->msg_len == b->msg_len && (a->msg_len == 0 || memcmp(a->msg, b->msg, a->msg_len) == 0);
+}
+
+// Both decoders must give back every message they were handed.
+static int workload_check(const workload_t *w) {
+    static u8 scratch[DBIN_MAX_MSG_LEN];
+    for (int i = 0; i < NMSG; i++) {
+        dbin_msg_t d;
+        if (dbin_decode(w->frames + w->frame_off[i], w->frame_len[i], &d) != DBIN_OK) return 1;
+        if (!same_msg(&w->msgs[i], &d)) return 1;
+        if (json_msg_decode(w->json + w->json_off[i], w->json_len[i], &d, scratch, sizeof(scratch))) return 1;
+        if (!same_msg(&w->msgs[i], &d)) return 1;
+    }
+    return 0;
+}
+
+// Run `ops` operations; returns elapsed ns.
+static u64 run(const workload_t *w, int op, int fmt, u64 ops) {
+    static u8 out[DBIN_MAX_FRAME_LEN];
+    static char jout[DBIN_MAX_MSG_LEN * 6 + 128];
+    static u8 scratch[DBIN_MAX_MSG_LEN];
+    u64 sink = 0;
+    u64 t0 = now_ns();
+
+    if (fmt == FMT_DBIN && op == OP_ENCODE) {
+        for (u64 k = 0; k < ops; k++) {
+            usize n = 0;
+            dbin_encode(&w->msgs[k % NMSG], out, sizeof(out), &n);
+            sink += n + out[0];
+        }
+    } else if (fmt == FMT_DBIN && op == OP_DECODE) {
+        for (u64 k = 0; k < ops; k++) {
+            usize i = (usize)(k % NMSG);
+            dbin_msg_t d;
+            dbin_decode(w->frames + w->frame_off[i], w->frame_len[i], &d);
+            sink += d.user_id + d.msg_len;
+        }
+    } else if (fmt == FMT_DBIN && op == OP_VALIDATE) {
+        for (u64 k = 0; k < ops; k++) sink += (u64)dbin_validate(&w->msgs[k % NMSG]) + 1;
+    } else if (fmt == FMT_JSON && op == OP_ENCODE) {
+        for (u64 k = 0; k < ops; k++) {
+            usize n = json_msg_encode(&w->msgs[k % NMSG], jout, sizeof(jout));
+            sink += n + (u8)jout[n / 2];
+        }
+    } else if (fmt == FMT_JSON && op == OP_DECODE) {
+        for (u64 k = 0; k < ops; k++) {
+            usize i = (usize)(k % NMSG);
+            dbin_msg_t d;
+            json_msg_decode(w->json + w->json_off[i], w->json_len[i], &d, scratch, sizeof(scratch));
+            sink += d.user_id + d.msg_len;
+        }
+    }
+
+    u64 el = now_ns() - t0;
+    g_sink += sink;
+    return el;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+typedef struct result {
+    double median, min, mean, stddev;
+    u64    ops;
+} result_t;
+
+static result_t measure(const workload_t *w, int op, int fmt, int trials) {
+    // Warmup doubles as calibration: grow the op count until a run takes
+    // most of a trial, then run one untimed trial.
+    u64 ops = 64;
+    for (;;) {
+        u64 el = run(w, op, fmt, ops);
+        if (el >= TRIAL_NS / 2 || ops >= (1ull << 32)) break;
+        ops *= 2;
+    }
+    run(w, op, fmt, ops);
+
+    double ns[TRIALS_MAX];
+    double sum = 0;
+    for (int t = 0; t < trials; t++) {
+        ns[t] = (double)run(w, op, fmt, ops) / (double)ops;
+        sum += ns[t];
+    }
+    result_t r;
+    r.ops = ops;
+    r.mean = sum / trials;
+    double var = 0;
+    for (int t = 0; t < trials; t++) var += (ns[t] - r.mean) * (ns[t] - r.mean);
+    r.stddev = trials > 1 ? sqrt(var / (trials - 1)) : 0.0;
+    qsort(ns, (size_t)trials, sizeof(double), cmp_double);
+    r.median = ns[trials / 2];
+    r.min = ns[0];
+    return r;
+}
+
+int main(int argc, char **argv) {
+    const char *csv_path = 0;
+    const char *rev = "";
+    const char *capture = 0;
+    int trials = TRIALS;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-o") && i + 1 < argc) csv_path = argv[++i];
+        else if (!strcmp(argv[i], "-r") && i + 1 < argc) rev = argv[++i];
+        else if (!strcmp(argv[i], "-t") && i + 1 < argc) trials = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-c") && i + 1 < argc) capture = argv[++i];
+        else {
+            fprintf(stderr, "usage: %s [-o results.csv] [-r revision] [-t trials] [-c capture.dcap]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (trials < 1) trials = 1;
+    if (trials > TRIALS_MAX) trials = TRIALS_MAX;
+
+    FILE *csv = 0;
+    if (csv_path) {
+        csv = fopen(csv_path, "w");
+        if (!csv) {
+            perror(csv_path);
+            return 1;
+        }
+        fprintf(csv, "rev,payload,op,format,bytes_per_op,ns_median,ns_min,ns_mean,ns_stddev,trials,ops_per_trial\n");
+    }
+
+    int sizes[] = { 0, 16, 64, 256, 1024, DBIN_MAX_MSG_LEN, MIX, CAPTURE };
+    usize nrows = sizeof(sizes) / sizeof(sizes[0]) - (capture ? 0 : 1);
+    static workload_t w;
+
+    printf("%d trials of ~%llu ms per row; ns/op is the median trial, +- the standard deviation in %%\n\n",
+           trials, (unsigned long long)(TRIAL_NS / 1000000));
+    printf("%8s %-9s %-5s %9s %11s %11s %7s %9s\n",
+           "payload", "op", "fmt", "bytes/op", "ns/op", "min_ns/op", "+-%", "vs_dbin");
+
+    for (usize s = 0; s < nrows; s++) {
+        int rc = sizes[s] == CAPTURE ? workload_capture(&w, capture) : workload_init(&w, sizes[s], 0x9E3779B9u + (u32)s);
+        if (rc || workload_check(&w)) {
+            if (sizes[s] == CAPTURE) fprintf(stderr, "%s: no MSG frames read\n", capture);
+            else fprintf(stderr, "workload setup failed for payload %d\n", sizes[s]);
+            return 1;
+        }
+        char label[16];
+        if (sizes[s] == CAPTURE) snprintf(label, sizeof(label), "capture");
+        else if (sizes[s] == MIX) snprintf(label, sizeof(label), "mix");
+        else snprintf(label, sizeof(label), "%d", sizes[s]);
+
+        for (int op = 0; op < NOPS; op++) {
+            double dbin_ns = 0;
+            for (int fmt = 0; fmt < NFMTS; fmt++) {
+                // JSON has no separate validation step; its parser is the check.
+                if (fmt == FMT_JSON && op == OP_VALIDATE) continue;
+
+                result_t r = measure(&w, op, fmt, trials);
+                double bytes = fmt == FMT_DBIN ? w.dbin_bytes : w.json_bytes;
+                if (op == OP_VALIDATE) bytes = 0;
+                if (fmt == FMT_DBIN) dbin_ns = r.median;
+
+                char ratio[16] = "";
+                if (fmt == FMT_JSON && dbin_ns > 0) snprintf(ratio, sizeof(ratio), "%.1fx", r.median / dbin_ns);
+                printf("%8s %-9s %-5s %9.1f %11.1f %11.1f %7.1f %9s\n", label, op_names[op], fmt_names[fmt],
+                       bytes, r.median, r.min, r.mean > 0 ? 100.0 * r.stddev / r.mean : 0.0, ratio);
+                fflush(stdout);
+
+                if (csv) {
+                    fprintf(csv, "%s,%s,%s,%s,%.1f,%.2f,%.2f,%.2f,%.3f,%d,%llu\n", rev, label, op_names[op],
+                            fmt_names[fmt], bytes, r.median, r.min, r.mean, r.stddev, trials,
+                            (unsigned long long)r.ops);
+                }
+            }
+        }
+        workload_free(&w);
+    }
+
+    if (csv) {
+        fclose(csv);
+        printf("\nCSV written to %s\n", csv_path);
+    }
+    return 0;
+}
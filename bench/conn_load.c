@@ -0,0 +1,226 @@
+// bench/conn_load.c
+// Opens an increasing number of mostly idle loopback connections against a
+// running server and reports the server's CPU use at a fixed message rate.
+// Build:
+//   make conn-load
+// Run (or `make loadtest`, which starts the server for you):
+//   ./conn-load 127.0.0.1 9000 <server_pid> [max_conns] [msgs_per_sec] [secs_per_step]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+#include "dbin/types.h"
+#include "dbin/protocol.h"
+#include "dbin/dbin.h"
+#include "dbin/codec.h"
+#include "dbin/batch.h"
+
+#define ACK_WIRE_BYTES (DBIN_LEN_PREFIX_BYTES + 12)
+
+static u64 now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+}
+
+// utime + stime of `pid`, in seconds.
+static double proc_cpu_s(int pid) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+    FILE *f = fopen(path, "r");
+    if (!f) return -1.0;
+
+    char buf[1024];
+    size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+    fclose(f);
+    buf[n] = 0;
+
+    // Fields after the parenthesised command name; utime/stime are 14 and 15.
+    char *p = strrchr(buf, ')');
+    if (!p) return -1.0;
+    unsigned long utime = 0, stime = 0;
+    if (sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime) != 2) return -1.0;
+    return (double)(utime + stime) / (double)sysconf(_SC_CLK_TCK);
+}
+
+static long proc_rss_kb(int pid) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/status", pid);
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+
+    char line[256];
+    long kb = -1;
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "VmRSS: %ld kB", &kb) == 1) break;
+    }
+    fclose(f);
+    return kb;
+}
+
+static int connect_to(const char *ip, int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    addr.sin_addr.s_addr = inet_addr(ip);
+
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    int yes = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+    return fd;
+}
+
+// Read everything available on ready sockets; returns ACK bytes received.
+static u64 drain_acks(int epfd, u8 *buf, usize cap, int timeout_ms) {
+    struct epoll_event evs[256];
+    u64 bytes = 0;
+
+    int n = epoll_wait(epfd, evs, 256, timeout_ms);
+    for (int i = 0; i < n; i++) {
+        int fd = evs[i].data.fd;
+        for (;;) {
+            ssize_t r = recv(fd, buf, (size_t)cap, MSG_DONTWAIT);
+            if (r > 0) {
+                bytes += (u64)r;
+                continue;
+            }
+            break;
+        }
+    }
+    return bytes;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 4 || argc > 7) {
+        fprintf(stderr, "usage: %s <ip> <port> <server_pid> [max_conns] [msgs_per_sec] [secs_per_step]\n", argv[0]);
+        return 1;
+    }
+    const char *ip = argv[1];
+    int port = atoi(argv[2]);
+    int spid = atoi(argv[3]);
+    int max_conns = (argc > 4) ? atoi(argv[4]) : 10000;
+    int rate = (argc > 5) ? atoi(argv[5]) : 20000;
+    int secs = (argc > 6) ? atoi(argv[6]) : 3;
+    if (max_conns < 1) max_conns = 1;
+    if (max_conns > 0xFFFFF) max_conns = 0xFFFFF; // one user_id each
+    if (rate < 1) rate = 1;
+    if (secs < 1) secs = 1;
+
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    int *fds = (int*)malloc((size_t)max_conns * sizeof(int));
+    u16 *next_id = (u16*)calloc((size_t)max_conns, sizeof(u16));
+    int epfd = epoll_create1(0);
+    if (!fds || !next_id || epfd < 0) {
+        fprintf(stderr, "setup failed\n");
+        return 1;
+    }
+
+    // Connection i sends as user i + 1 with its own msg_id counter, kept
+    // across steps, so the server never drops a send as a retransmit.
+    const u8 payload[] = "hello from an idle-heavy room";
+    dbin_msg_t m;
+    memset(&m, 0, sizeof(m));
+    m.magic = (u16)DBIN_MAGIC;
+    m.version = (u8)DBIN_VERSION;
+    m.type = (u8)DBIN_TYPE_MSG;
+    m.valid = 1;
+    m.is_room = 1;
+    m.route = 77;
+    m.msg_len = (u16)(sizeof(payload) - 1);
+    m.msg = payload;
+
+    u8 frame[64];
+    dbin_arena_t a;
+    usize done = 0;
+    dbin_arena_init(&a, frame, (usize)sizeof(frame));
+
+    static u8 rbuf[65536];
+    static const int steps[] = { 100, 1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000 };
+
+    printf("%8s %10s %10s %12s %12s %10s\n", "conns", "sent/s", "acks/s", "server_cpu%", "us/msg", "rss_kb");
+
+    int open = 0;
+    for (usize s = 0; s < sizeof(steps) / sizeof(steps[0]); s++) {
+        int target = steps[s] < max_conns ? steps[s] : max_conns;
+
+        while (open < target) {
+            int fd = connect_to(ip, port);
+            if (fd < 0) {
+                perror("connect");
+                goto out;
+            }
+            struct epoll_event ev;
+            ev.events = EPOLLIN;
+            ev.data.fd = fd;
+            epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+            fds[open++] = fd;
+        }
+
+        // Let the server settle after the connect burst.
+        drain_acks(epfd, rbuf, sizeof(rbuf), 100);
+
+        double cpu0 = proc_cpu_s(spid);
+        u64 t0 = now_ns();
+        u64 end = t0 + (u64)secs * 1000000000ull;
+        u64 sent = 0, ack_bytes = 0;
+        int cursor = 0;
+
+        // Fixed aggregate rate, spread round-robin: most connections stay idle.
+        while (now_ns() < end) {
+            u64 due = (now_ns() - t0) * (u64)rate / 1000000000ull;
+            while (sent < due) {
+                // A send dropped on a full socket still counts, so the schedule holds.
+                m.user_id = (u32)cursor + 1;
+                m.msg_id = next_id[cursor]++;
+                dbin_arena_reset(&a);
+                if (dbin_encode_batch(&m, 1, &a, 0, &done) != DBIN_OK) goto out;
+                (void)send(fds[cursor], a.buf, (size_t)a.len, MSG_DONTWAIT);
+                sent++;
+                cursor = (cursor + 1) % open;
+            }
+            ack_bytes += drain_acks(epfd, rbuf, sizeof(rbuf), 1);
+        }
+        ack_bytes += drain_acks(epfd, rbuf, sizeof(rbuf), 50);
+
+        double el = (double)(now_ns() - t0) / 1e9;
+        double cpu = proc_cpu_s(spid) - cpu0;
+        u64 acks = ack_bytes / ACK_WIRE_BYTES;
+
+        printf("%8d %10.0f %10.0f %12.1f %12.2f %10ld\n",
+               open, (double)sent / el, (double)acks / el,
+               100.0 * cpu / el, acks ? cpu * 1e6 / (double)acks : 0.0, proc_rss_kb(spid));
+        fflush(stdout);
+
+        if (target == max_conns) break;
+    }
+
+out:
+    for (int i = 0; i < open; i++) close(fds[i]);
+    free(fds);
+    free(next_id);
+    close(epfd);
+    return 0;
+}
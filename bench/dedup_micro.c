@@ -0,0 +1,199 @@
+// bench/dedup_micro.c
+// Retransmit storms against the server's msg_id windows (dbin/dedup.h),
+// without sockets: the server's frame handler linked against the null
+// transport (null_transport.c). A sender sends bursts of 32 new messages to
+// a 1000-member room, then repeats each burst as if its ACKs were lost.
+// Reports frames queued per distinct message and server ns per received
+// frame with deduplication off and on, then the cost of one window check
+// with 1M users sending. Last, a self-check: one user's frames handled on
+// two shards, one lagging far behind the other and then both at once, must
+// all get through, while real repeats are still caught. Exits non-zero if
+// not.
+// Build:
+//   make dedup-micro
+// Run (or `make dedupbench`):
+//   ./dedup-micro [messages]
+
+#include "../server/server.h"
+
+#include "dbin/protocol.h"
+#include "dbin/codec.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define ROOM_ID  7
+#define MEMBERS  1000
+#define BURST    32
+#define USERS    (1u << 20)
+#define CHECKS   (20u * 1000u * 1000u)
+#define REORDER  100000u // ids per shard in the cross-shard check
+#define LAG      100u    // how many ids the late shard trails by: twice the window
+
+static u64 now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+}
+
+static u32 xorshift(u32 *s) {
+    u32 x = *s;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *s = x;
+}
+
+static dbin_msg_t make_msg(u32 user_id, u16 msg_id) {
+    static const u8 payload[] = "did anyone get my last message?";
+    dbin_msg_t m;
+    memset(&m, 0, sizeof(m));
+    m.magic = (u16)DBIN_MAGIC;
+    m.version = (u8)DBIN_VERSION;
+    m.type = (u8)DBIN_TYPE_MSG;
+    m.valid = 1;
+    m.is_room = 1;
+    m.user_id = user_id;
+    m.route = ROOM_ID;
+    m.msg_id = msg_id;
+    m.msg_len = (u16)(sizeof(payload) - 1);
+    m.msg = payload;
+    return m;
+}
+
+// Each burst sent 1 + `repeats` times, one tick per copy. Returns server ns
+// per received frame; *out_per_msg is frames queued per distinct message.
+static double storm(reactor_t *r, conn_t *sender, u32 user_id, u32 msgs, int repeats, double *out_per_msg) {
+    u8 frame[DBIN_MAX_FRAME_LEN];
+    u64 out0 = r->frames_out, frames = 0;
+    u64 t0 = now_ns();
+    for (u32 b = 0; b < msgs; b += BURST) {
+        for (int k = 0; k <= repeats; k++) {
+            for (u32 i = b; i < b + BURST && i < msgs; i++) {
+                dbin_msg_t m = make_msg(user_id, (u16)(i + 1));
+                usize len;
+                dbin_encode(&m, frame, sizeof(frame), &len);
+                server_handle_frame(r, sender, &m, frame, len);
+                frames++;
+            }
+            reactor_end_tick(r);
+        }
+    }
+    double ns = (double)(now_ns() - t0) / (double)frames;
+    *out_per_msg = (double)(r->frames_out - out0) / (double)msgs;
+    return ns;
+}
+
+typedef struct half {
+    reactor_t *r;
+    u32 user_id;
+    u16 first; // this shard handles first, first + 2, ...
+} half_t;
+
+static void *send_half(void *arg) {
+    half_t *h = (half_t*)arg;
+    for (u32 i = 0; i < REORDER; i++) server_seen(h->r, h->user_id, (u16)(h->first + 2 * i));
+    return NULL;
+}
+
+// One user's even msg_ids handled on shard 0 and odd ones on shard 1, as
+// during a reconnect or with connections on several shards. None is a
+// repeat, however late. Returns the number of checks that failed.
+static int reorder_check(server_t *s, u32 user_id) {
+    reactor_t *a = &s->shards[0], *b = &s->shards[1];
+    atomic_store(&s->seen[user_id], 0);
+    atomic_store(&s->seen[user_id + 1], 0);
+    u64 dups = a->dups + b->dups;
+    int failed = 0;
+
+    // Shard 1 trails by LAG frames, so its ids fall behind the window.
+    for (u32 i = 0; i < REORDER + LAG; i++) {
+        if (i < REORDER) server_seen(a, user_id, (u16)(2 * i + 2));
+        if (i >= LAG) server_seen(b, user_id, (u16)(2 * (i - LAG) + 1));
+    }
+    u64 lost = a->dups + b->dups - dups;
+    printf("\ncross-shard, one shard %u ids behind: %llu of %u frames dropped as repeats\n", 2 * LAG,
+           (unsigned long long)lost, 2 * REORDER);
+    failed += lost != 0;
+
+    // Retransmits of the newest ids, inside the window, are still repeats.
+    dups = a->dups + b->dups;
+    for (u16 k = 0; k < DBIN_DEDUP_WINDOW / 2; k++) server_seen(b, user_id, (u16)(2 * REORDER - 2 * k));
+    u64 caught = a->dups + b->dups - dups;
+    printf("cross-shard, %d retransmits of recent ids: %llu caught\n", DBIN_DEDUP_WINDOW / 2,
+           (unsigned long long)caught);
+    failed += caught != DBIN_DEDUP_WINDOW / 2;
+
+    // Both shards at once: the CAS keeps every id, whatever the interleaving.
+    dups = a->dups + b->dups;
+    half_t h[2] = { { a, user_id + 1, 2 }, { b, user_id + 1, 1 } };
+    pthread_t t;
+    if (pthread_create(&t, NULL, send_half, &h[1]) != 0) return failed + 1;
+    send_half(&h[0]);
+    pthread_join(t, NULL);
+    lost = a->dups + b->dups - dups;
+    printf("cross-shard, both shards at once: %llu of %u frames dropped as repeats\n",
+           (unsigned long long)lost, 2 * REORDER);
+    failed += lost != 0;
+
+    printf("%s\n", failed ? "FAILED" : "ok");
+    return failed;
+}
+
+int main(int argc, char **argv) {
+    u32 msgs = argc > 1 ? (u32)atol(argv[1]) : 20000;
+    if (msgs == 0 || msgs > 60000) return 2; // one run of msg_ids, no wrap
+
+    server_t srv;
+    if (server_init(&srv, "127.0.0.1", 0, 2, 0)) {
+        fprintf(stderr, "server_init failed\n");
+        return 1;
+    }
+    reactor_t *r = &srv.shards[0];
+
+    conn_t *sender = conn_open(r, -1);
+    if (!sender) return 1;
+    for (u32 i = 0; i < MEMBERS; i++) {
+        conn_t *c = conn_open(r, -1);
+        if (!c || room_join(r, c, ROOM_ID)) return 1;
+    }
+
+    printf("%u messages to a %u-member room in bursts of %d, each burst repeated\n\n", msgs, MEMBERS, BURST);
+    printf("%8s %16s %16s %12s %12s\n", "repeats", "out/msg (off)", "out/msg (on)", "ns/frm off", "ns/frm on");
+    u32 user = 100;
+    for (int repeats = 0; repeats <= 3; repeats++) {
+        double off_out, on_out;
+        srv.dedup = 0;
+        double off = storm(r, sender, user++, msgs, repeats, &off_out);
+        srv.dedup = 1;
+        double on = storm(r, sender, user++, msgs, repeats, &on_out);
+        printf("%8d %16.1f %16.1f %12.1f %12.1f\n", repeats, off_out, on_out, off, on);
+        fflush(stdout);
+    }
+
+    // One window per user, touched in random order: the table no longer
+    // fits in cache, as with many users sending at once.
+    u32 seed = 0x6b43a9b5u;
+    u16 *next = (u16*)calloc(USERS, sizeof(*next));
+    if (!next) return 1;
+    u64 dups = r->dups;
+    u64 t0 = now_ns();
+    for (u32 k = 0; k < CHECKS; k++) {
+        u32 u = xorshift(&seed) & (USERS - 1);
+        // One send in eight repeats the previous msg_id.
+        u16 id = (xorshift(&seed) & 7) ? ++next[u] : next[u];
+        server_seen(r, u, id);
+    }
+    double check = (double)(now_ns() - t0) / CHECKS;
+    printf("\nwindow check, %u users: %.1f ns, %.1f%% duplicates, table %.1f MiB (%zu B per user)\n", USERS, check,
+           100.0 * (double)(r->dups - dups) / CHECKS, (double)USERS * sizeof(dbin_dedup_t) / (1 << 20),
+           sizeof(dbin_dedup_t));
+
+    free(next);
+    int failed = reorder_check(&srv, USERS - 2);
+    server_destroy(&srv);
+    return failed ? 1 : 0;
+}
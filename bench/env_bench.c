@@ -0,0 +1,180 @@
+// bench/env_bench.c
+// Envelopes (DBIN_TYPE_ENV) against one frame per message for small-message
+// bursts: typing indicators and presence updates from one user, with
+// consecutive msg_ids, to one room or spread over a few direct recipients.
+// For each burst size: wire bytes per message (length prefix included), the
+// part of that which is not payload, and encode + decode time per message.
+// Build:
+//   make env-bench
+// Run (or `make envbench`):
+//   ./env-bench [bursts]
+
+#include "dbin/protocol.h"
+#include "dbin/codec.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_BURST 64
+#define BUF_BYTES (MAX_BURST * (DBIN_LEN_PREFIX_BYTES + DBIN_MAX_FRAME_LEN))
+
+static const char *const payloads[] = {
+    "t", "typing", "stopped", "online", "away", "idle", "busy", "offline", "read:1842", "seen",
+};
+#define NPAYLOADS (sizeof(payloads) / sizeof(payloads[0]))
+
+static volatile u64 g_sink;
+
+static u64 now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+}
+
+static u32 xorshift(u32 *s) {
+    u32 x = *s;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *s = x;
+}
+
+// One burst of k messages. routes > 1: direct messages to that many users.
+static void make_burst(dbin_msg_t *m, int k, u32 routes, u16 first_id, u32 *seed) {
+    for (int i = 0; i < k; i++) {
+        const char *p = payloads[xorshift(seed) % NPAYLOADS];
+        memset(&m[i], 0, sizeof(m[i]));
+        m[i].magic = DBIN_MAGIC;
+        m[i].version = DBIN_VERSION;
+        m[i].type = DBIN_TYPE_MSG;
+        m[i].valid = 1;
+        m[i].is_room = routes == 1;
+        m[i].user_id = 4242;
+        m[i].route = routes == 1 ? 77 : 1000 + xorshift(seed) % routes;
+        m[i].msg_id = (u16)(first_id + i);
+        m[i].msg_len = (u16)strlen(p);
+        m[i].msg = (const u8*)p;
+    }
+}
+
+// Frame every message on its own; returns wire bytes.
+static usize plain_burst(const dbin_msg_t *m, int k, u8 *buf) {
+    usize off = 0;
+    for (int i = 0; i < k; i++) {
+        usize len;
+        dbin_encode(&m[i], buf + off + DBIN_LEN_PREFIX_BYTES, DBIN_MAX_FRAME_LEN, &len);
+        buf[off] = (u8)(len >> 8);
+        buf[off + 1] = (u8)len;
+        off += DBIN_LEN_PREFIX_BYTES + len;
+    }
+    u64 sum = 0;
+    for (usize p = 0; p < off;) {
+        dbin_msg_t d;
+        usize len = ((usize)buf[p] << 8) | buf[p + 1];
+        p += DBIN_LEN_PREFIX_BYTES;
+        if (dbin_decode(buf + p, len, &d) != DBIN_OK) abort();
+        sum += d.msg_len;
+        p += len;
+    }
+    g_sink += sum;
+    return off;
+}
+
+// The same burst in as few envelopes as it takes; returns wire bytes.
+static usize env_burst(const dbin_msg_t *m, int k, u8 *buf) {
+    usize off = 0, done = 0;
+    while (done < (usize)k) {
+        usize len, n;
+        if (dbin_encode_env(m + done, (usize)k - done, buf + off + DBIN_LEN_PREFIX_BYTES, DBIN_MAX_FRAME_LEN,
+                            &len, &n) != DBIN_OK) {
+            abort();
+        }
+        buf[off] = (u8)(len >> 8);
+        buf[off + 1] = (u8)len;
+        off += DBIN_LEN_PREFIX_BYTES + len;
+        done += n;
+    }
+    u64 sum = 0;
+    for (usize p = 0; p < off;) {
+        dbin_msg_t out[MAX_BURST];
+        usize len = ((usize)buf[p] << 8) | buf[p + 1], n;
+        p += DBIN_LEN_PREFIX_BYTES;
+        if (dbin_decode_env(buf + p, len, out, MAX_BURST, &n) != DBIN_OK) abort();
+        for (usize i = 0; i < n; i++) sum += out[i].msg_len;
+        p += len;
+    }
+    g_sink += sum;
+    return off;
+}
+
+// Check that every message survives the envelope unchanged.
+static int check(const dbin_msg_t *m, int k, u8 *buf) {
+    usize done = 0;
+    while (done < (usize)k) {
+        dbin_msg_t out[MAX_BURST];
+        usize len, n, got;
+        if (dbin_encode_env(m + done, (usize)k - done, buf, BUF_BYTES, &len, &n) != DBIN_OK) return 0;
+        if (dbin_decode_env(buf, len, out, MAX_BURST, &got) != DBIN_OK || got != n) return 0;
+        for (usize i = 0; i < n; i++) {
+            const dbin_msg_t *a = &m[done + i], *b = &out[i];
+            if (a->user_id != b->user_id || a->route != b->route || a->msg_id != b->msg_id ||
+                a->is_room != b->is_room || a->type != b->type || a->msg_len != b->msg_len ||
+                memcmp(a->msg, b->msg, a->msg_len) != 0) {
+                return 0;
+            }
+        }
+        done += n;
+    }
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    int bursts = argc > 1 ? atoi(argv[1]) : 20000;
+    if (bursts <= 0) return 2;
+
+    static const int sizes[] = { 1, 2, 4, 8, 16, 64 };
+    static const u32 spreads[] = { 1, 4 };
+    u8 *buf = (u8*)malloc(BUF_BYTES);
+    dbin_msg_t *msgs = (dbin_msg_t*)malloc(sizeof(dbin_msg_t) * MAX_BURST * (usize)bursts);
+    if (!buf || !msgs) return 1;
+
+    printf("%d bursts per row; bytes/msg include the length prefix, hdr = bytes/msg that are not payload\n\n",
+           bursts);
+    printf("%-6s %5s %10s %10s %8s %8s %9s %9s\n", "dest", "burst", "plain_B", "env_B", "plain_hdr", "env_hdr",
+           "plain_ns", "env_ns");
+
+    for (usize s = 0; s < sizeof(spreads) / sizeof(spreads[0]); s++) {
+        for (usize z = 0; z < sizeof(sizes) / sizeof(sizes[0]); z++) {
+            int k = sizes[z];
+            u32 seed = 0x9e3779b9u;
+            u64 pay = 0;
+            for (int b = 0; b < bursts; b++) {
+                make_burst(msgs + (usize)b * k, k, spreads[s], (u16)(b * k), &seed);
+                for (int i = 0; i < k; i++) pay += msgs[(usize)b * k + i].msg_len;
+            }
+            for (int b = 0; b < bursts; b++) {
+                if (!check(msgs + (usize)b * k, k, buf)) {
+                    fprintf(stderr, "round trip failed (burst %d of %d)\n", b, k);
+                    return 1;
+                }
+            }
+
+            u64 plain_b = 0, env_b = 0;
+            u64 t0 = now_ns();
+            for (int b = 0; b < bursts; b++) plain_b += plain_burst(msgs + (usize)b * k, k, buf);
+            u64 t1 = now_ns();
+            for (int b = 0; b < bursts; b++) env_b += env_burst(msgs + (usize)b * k, k, buf);
+            u64 t2 = now_ns();
+
+            double n = (double)bursts * k;
+            printf("%-6s %5d %10.2f %10.2f %8.2f %8.2f %9.1f %9.1f\n", spreads[s] == 1 ? "room" : "4 DMs", k,
+                   (double)plain_b / n, (double)env_b / n, (double)(plain_b - pay) / n,
+                   (double)(env_b - pay) / n, (double)(t1 - t0) / n, (double)(t2 - t1) / n);
+        }
+    }
+    free(msgs);
+    free(buf);
+    return 0;
+}
@@ -0,0 +1,118 @@
+// bench/fanout_micro.c
+// Server-side cost of room fan-out without sockets: the server's connection,
+// room and shard code linked against the null transport (null_transport.c).
+// Compares encode-once shared buffers with a per-member copy of the frame.
+// Build:
+//   make fanout-micro
+// Run (or `make fanoutbench`):
+//   ./fanout-micro [payload_bytes] [members...]
+
+#include "../server/server.h"
+
+#include "dbin/protocol.h"
+#include "dbin/codec.h"
+#include "dbin/batch.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define ROOM_ID        7
+#define MSGS_PER_TICK  16
+#define DELIVERIES     (8u * 1000u * 1000u) // per measurement, spread over messages
+
+// ---- bench ----
+
+static u64 now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+}
+
+// ns per delivery of `msgs` messages to the room, MSGS_PER_TICK per tick.
+static double run(reactor_t *r, conn_t **conns, u32 members, const u8 *frame, usize len,
+                  u32 msgs, int shared) {
+    conn_t *sender = conns[members];
+    u64 t0 = now_ns();
+
+    for (u32 k = 0; k < msgs; k++) {
+        if (shared) {
+            room_fanout(r, ROOM_ID, frame, len, sender);
+        } else {
+            for (u32 i = 0; i < members; i++) conn_queue_frame(r, conns[i], frame, len);
+        }
+        if ((k + 1) % MSGS_PER_TICK == 0 || k + 1 == msgs) reactor_end_tick(r);
+    }
+    return (double)(now_ns() - t0) / ((double)msgs * (double)members);
+}
+
+int main(int argc, char **argv) {
+    int plen = (argc > 1) ? atoi(argv[1]) : 32;
+    if (plen < 0) plen = 0;
+    if (plen > DBIN_MAX_MSG_LEN) plen = DBIN_MAX_MSG_LEN;
+
+    static const u32 default_sizes[] = { 10, 1000, 50000 };
+    u32 nsizes = (argc > 2) ? (u32)(argc - 2) : 3;
+
+    server_t srv;
+    if (server_init(&srv, "127.0.0.1", 0, 1, 0)) {
+        fprintf(stderr, "server_init failed\n");
+        return 1;
+    }
+    reactor_t *r = &srv.shards[0];
+
+    u8 *payload = (u8*)malloc((size_t)plen + 1);
+    if (!payload) return 1;
+    memset(payload, 'r', (size_t)plen);
+
+    dbin_msg_t m;
+    memset(&m, 0, sizeof(m));
+    m.magic = (u16)DBIN_MAGIC;
+    m.version = (u8)DBIN_VERSION;
+    m.type = (u8)DBIN_TYPE_MSG;
+    m.valid = 1;
+    m.is_room = 1;
+    m.user_id = 1;
+    m.route = ROOM_ID;
+    m.msg_len = (u16)plen;
+    m.msg = payload;
+
+    u8 frame[DBIN_MAX_FRAME_LEN];
+    usize len = 0;
+    if (dbin_encode(&m, frame, sizeof(frame), &len) != DBIN_OK) return 1;
+
+    printf("payload=%d bytes, %d messages per tick\n", plen, MSGS_PER_TICK);
+    printf("%8s %16s %16s %8s\n", "members", "shared_ns/dlv", "copy_ns/dlv", "speedup");
+
+    for (u32 s = 0; s < nsizes; s++) {
+        u32 members = (argc > 2) ? (u32)atoi(argv[2 + s]) : default_sizes[s];
+        if (members < 1) continue;
+
+        // Members plus one sender, which is not a member.
+        conn_t **conns = (conn_t**)malloc(((size_t)members + 1) * sizeof(*conns));
+        if (!conns) return 1;
+        for (u32 i = 0; i <= members; i++) {
+            conns[i] = conn_open(r, -1);
+            if (!conns[i]) return 1;
+            if (i < members && room_join(r, conns[i], ROOM_ID)) return 1;
+        }
+
+        u32 msgs = DELIVERIES / members;
+        if (msgs < MSGS_PER_TICK) msgs = MSGS_PER_TICK;
+
+        run(r, conns, members, frame, len, msgs / 4 + 1, 1); // warm the buffer pools
+        double shared = run(r, conns, members, frame, len, msgs, 1);
+        double copy = run(r, conns, members, frame, len, msgs, 0);
+        printf("%8u %16.1f %16.1f %7.2fx\n", members, shared, copy, copy / shared);
+        fflush(stdout);
+
+        for (u32 i = 0; i <= members; i++) conn_close(r, conns[i]);
+        reactor_end_tick(r);
+        free(conns);
+    }
+
+    free(payload);
+    server_destroy(&srv);
+    return 0;
+}
@@ -0,0 +1,223 @@
+// bench/frag_bench.c
+// Large payloads through the stream codec, 16 KiB to 16 MiB: protocol
+// fragments (dbin/frag.h) reassembled into a preallocated buffer or consumed
+// as they arrive, against the application-level workaround of plain MSG
+// chunks appended to a growing buffer and copied out when complete.
+// Each transfer is written into a 64 KiB "socket" buffer (the sender's one
+// copy, as writev would make), fed to a dbin_stream receiver in 16 KiB
+// reads, and checked against the source. Reports throughput and the
+// receiver's peak payload memory.
+// Build:
+//   make frag-bench
+// Run (or `make fragbench`):
+//   ./frag-bench [min_MiB_per_row]
+
+#include "dbin/codec.h"
+#include "dbin/frag.h"
+#include "dbin/protocol.h"
+#include "dbin/stream.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define WIRE_BYTES  (64u * 1024u)
+#define READ_BYTES  (16u * 1024u)
+#define STREAM_CAP  (64u * 1024u)
+#define MAX_TOTAL   (16u << 20)
+
+enum { MODE_DST, MODE_STREAM, MODE_APP, NMODES };
+static const char *const mode_names[NMODES] = { "frag->dst", "frag stream", "app concat" };
+
+typedef struct rx {
+    dbin_stream_t s;
+    dbin_frag_rx_t fr;
+    int mode;
+    u8 *dst;        // MODE_DST: preallocated; MODE_APP: the growing buffer
+    usize cap, len;
+    usize peak;     // payload bytes held at once
+    const u8 *src;  // MODE_STREAM: what each fragment is compared against
+    int bad;
+    u8 *done;       // the complete payload
+    usize done_len;
+} rx_t;
+
+static u64 now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+}
+
+static void on_frame(rx_t *r, const dbin_msg_t *m) {
+    if (r->mode == MODE_APP) {
+        // The workaround: append, double when full, copy out at the end.
+        if (r->len + m->msg_len > r->cap) {
+            r->cap = r->cap ? r->cap * 2 : 4096;
+            r->dst = (u8*)realloc(r->dst, r->cap);
+            if (r->cap > r->peak) r->peak = r->cap;
+        }
+        memcpy(r->dst + r->len, m->msg, m->msg_len);
+        r->len += m->msg_len;
+        return;
+    }
+
+    dbin_frag_t f;
+    if (dbin_frag_rx_push(&r->fr, m, &f) != DBIN_OK) {
+        fprintf(stderr, "fragment rejected\n");
+        exit(1);
+    }
+    if (r->mode == MODE_DST) {
+        if (f.first) {
+            r->dst = (u8*)malloc(f.total);
+            if (f.total > r->peak) r->peak = f.total;
+            dbin_frag_rx_set_dst(&r->fr, &f, r->dst);
+        }
+        if (f.last) {
+            r->done = r->dst;
+            r->done_len = f.total;
+        }
+    } else {
+        // The consumer reads each fragment once, in place.
+        r->bad |= memcmp(f.data, r->src + f.offset, f.len) != 0;
+        if (f.last) r->done_len = f.total;
+    }
+}
+
+static void rx_read(rx_t *r, const u8 *p, usize n) {
+    while (n) {
+        usize k = dbin_stream_feed(&r->s, p, n);
+        p += k;
+        n -= k;
+        dbin_msg_t m;
+        int rc;
+        while ((rc = dbin_stream_next(&r->s, &m, 0)) == DBIN_OK) on_frame(r, &m);
+        if (rc != DBIN_ERR_AGAIN) {
+            fprintf(stderr, "stream error %d\n", rc);
+            exit(1);
+        }
+    }
+}
+
+static void wire_flush(rx_t *r, const u8 *wire, usize len) {
+    for (usize o = 0; o < len; o += READ_BYTES) rx_read(r, wire + o, len - o < READ_BYTES ? len - o : READ_BYTES);
+}
+
+static void put_prefix(u8 *p, usize len) {
+    p[0] = (u8)(len >> 8);
+    p[1] = (u8)len;
+}
+
+// One transfer of src[0..total) from sender to r.
+static void transfer(rx_t *r, const dbin_msg_t *tmpl, const u8 *src, usize total, u8 *wire) {
+    usize w = 0;
+    if (r->mode == MODE_APP) {
+        dbin_msg_t m = *tmpl;
+        for (usize off = 0; off < total; off += DBIN_MAX_MSG_LEN) {
+            m.msg = src + off;
+            m.msg_len = (u16)(total - off < DBIN_MAX_MSG_LEN ? total - off : DBIN_MAX_MSG_LEN);
+            if (w + DBIN_LEN_PREFIX_BYTES + DBIN_MAX_FRAME_LEN > WIRE_BYTES) {
+                wire_flush(r, wire, w);
+                w = 0;
+            }
+            usize len;
+            dbin_encode(&m, wire + w + DBIN_LEN_PREFIX_BYTES, DBIN_MAX_FRAME_LEN, &len);
+            put_prefix(wire + w, len);
+            w += DBIN_LEN_PREFIX_BYTES + len;
+            m.msg_id++;
+        }
+        wire_flush(r, wire, w);
+        // Complete: the application copies the payload out of its buffer.
+        r->done = (u8*)malloc(r->len);
+        memcpy(r->done, r->dst, r->len);
+        r->done_len = r->len;
+        if (r->cap + r->len > r->peak) r->peak = r->cap + r->len;
+        free(r->dst);
+        r->dst = 0;
+        r->cap = r->len = 0;
+        return;
+    }
+
+    dbin_frag_tx_t t;
+    dbin_frag_tx_init(&t, tmpl, src, total, 0);
+    while (!dbin_frag_tx_done(&t)) {
+        if (w + DBIN_LEN_PREFIX_BYTES + DBIN_MAX_FRAME_LEN > WIRE_BYTES) {
+            wire_flush(r, wire, w);
+            w = 0;
+        }
+        // The two pieces writev would send, without staging the data.
+        const u8 *data;
+        usize n;
+        dbin_frag_tx_next(&t, wire + w + DBIN_LEN_PREFIX_BYTES, &data, &n);
+        put_prefix(wire + w, DBIN_FRAG_HEAD_BYTES + n);
+        memcpy(wire + w + DBIN_LEN_PREFIX_BYTES + DBIN_FRAG_HEAD_BYTES, data, n);
+        w += DBIN_LEN_PREFIX_BYTES + DBIN_FRAG_HEAD_BYTES + n;
+    }
+    wire_flush(r, wire, w);
+}
+
+int main(int argc, char **argv) {
+    double min_mib = argc > 1 ? atof(argv[1]) : 256;
+    if (min_mib <= 0) return 2;
+
+    static const usize sizes[] = { 16u << 10, 256u << 10, 1u << 20, 16u << 20 };
+    u8 *src = (u8*)malloc(MAX_TOTAL);
+    u8 *wire = (u8*)malloc(WIRE_BYTES);
+    u8 *sbuf = (u8*)malloc(STREAM_CAP);
+    if (!src || !wire || !sbuf) return 1;
+    u32 x = 0x1234567u;
+    for (usize i = 0; i < MAX_TOTAL; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        src[i] = (u8)x;
+    }
+
+    dbin_msg_t tmpl;
+    memset(&tmpl, 0, sizeof(tmpl));
+    tmpl.magic = DBIN_MAGIC;
+    tmpl.version = DBIN_VERSION;
+    tmpl.type = DBIN_TYPE_MSG;
+    tmpl.valid = 1;
+    tmpl.user_id = 7;
+    tmpl.route = 9;
+
+    printf("%.0f MiB or more per row; peak = receiver payload memory per transfer\n\n", min_mib);
+    printf("%8s %-12s %8s %10s %12s\n", "size", "receiver", "frames", "MiB/s", "peak_KiB");
+    for (usize z = 0; z < sizeof(sizes) / sizeof(sizes[0]); z++) {
+        usize total = sizes[z];
+        u64 reps = (u64)(min_mib * (1 << 20) / (double)total);
+        if (reps < 3) reps = 3;
+        for (int mode = 0; mode < NMODES; mode++) {
+            rx_t r;
+            memset(&r, 0, sizeof(r));
+            r.mode = mode;
+            dbin_stream_init(&r.s, sbuf, STREAM_CAP);
+            dbin_frag_rx_init(&r.fr, MAX_TOTAL);
+            r.src = src;
+
+            u64 ns = 0;
+            for (u64 k = 0; k < reps; k++) {
+                u64 t0 = now_ns();
+                transfer(&r, &tmpl, src, total, wire);
+                ns += now_ns() - t0;
+                int ok = r.done_len == total &&
+                         (mode == MODE_STREAM ? !r.bad : memcmp(r.done, src, total) == 0);
+                if (!ok) {
+                    fprintf(stderr, "%s: payload of %zu bytes did not arrive intact\n", mode_names[mode], total);
+                    return 1;
+                }
+                free(r.done);
+                r.done = 0;
+                r.done_len = 0;
+            }
+            usize per = mode == MODE_APP ? DBIN_MAX_MSG_LEN : DBIN_FRAG_MAX_DATA;
+            printf("%7zuK %-12s %8zu %10.0f %12zu\n", total >> 10, mode_names[mode], (total + per - 1) / per,
+                   (double)total * reps / (1 << 20) / ((double)ns / 1e9), r.peak >> 10);
+        }
+    }
+    free(sbuf);
+    free(wire);
+    free(src);
+    return 0;
+}
@@ -0,0 +1,252 @@
+// bench/history_bench.c
+// Room history store (server/history.c): append throughput under each fsync
+// policy, recovery time on reopen, catch-up read latency, and size-based
+// retention. Runs in a scratch directory that is removed afterwards.
+// Build:
+//   make history-bench
+// Run (or `make historybench`):
+//   ./history-bench [-r rooms] [-n messages] [-d dir]
+
+#include "../server/history.h"
+
+#include "dbin/protocol.h"
+#include "dbin/codec.h"
+#include "dbin/hist.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define NFRAMES      256
+#define LAT_SUB_BITS 7
+#define CATCHUP      100  // messages per catch-up read
+#define READS        20000
+
+static u8    g_frames[NFRAMES][DBIN_MAX_FRAME_LEN];
+static usize g_lens[NFRAMES];
+static usize g_bytes; // sum of g_lens
+static u64   g_counts[DBIN_HIST_BUCKETS(LAT_SUB_BITS)];
+
+static u64 now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+}
+
+static u32 xorshift(u32 *s) {
+    u32 x = *s;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *s = x;
+}
+
+static void rm_store(const char *dir) {
+    DIR *d = opendir(dir);
+    if (!d) return;
+    struct dirent *e;
+    char path[4200];
+    while ((e = readdir(d)) != 0) {
+        if (strstr(e->d_name, ".seg")) {
+            snprintf(path, sizeof(path), "%s/%s", dir, e->d_name);
+            unlink(path);
+        }
+    }
+    closedir(d);
+    rmdir(dir);
+}
+
+// Chat-sized room messages, 16..256 bytes of text, encoded once.
+static void make_frames(void) {
+    u32 seed = 0x1234567u;
+    for (int i = 0; i < NFRAMES; i++) {
+        static u8 text[256];
+        u16 len = (u16)(16 + xorshift(&seed) % 241);
+        for (u16 k = 0; k < len; k++) text[k] = (u8)("room history "[(i + k) % 13]);
+        dbin_msg_t m;
+        memset(&m, 0, sizeof(m));
+        m.magic = (u16)DBIN_MAGIC;
+        m.version = (u8)DBIN_VERSION;
+        m.type = DBIN_TYPE_MSG;
+        m.valid = 1;
+        m.is_room = 1;
+        m.user_id = 1 + (u32)i;
+        m.msg_id = (u16)i;
+        m.msg_len = len;
+        m.msg = text;
+        dbin_encode(&m, g_frames[i], sizeof(g_frames[i]), &g_lens[i]);
+        g_bytes += g_lens[i];
+    }
+}
+
+static void print_hist(const char *name, const dbin_hist_t *h) {
+    printf("  %-14s p50 %8llu  p99 %8llu  p99.9 %8llu  max %9llu ns\n", name,
+           (unsigned long long)dbin_hist_percentile(h, 50.0),
+           (unsigned long long)dbin_hist_percentile(h, 99.0),
+           (unsigned long long)dbin_hist_percentile(h, 99.9),
+           (unsigned long long)h->max);
+}
+
+static int append_run(const char *dir, const char *name, const history_cfg_t *cfg,
+                      u32 rooms, u32 n, int keep) {
+    history_t h;
+    if (history_open(&h, dir, cfg)) {
+        perror("history_open");
+        return 1;
+    }
+    dbin_hist_t lat;
+    dbin_hist_init(&lat, LAT_SUB_BITS, g_counts, DBIN_HIST_BUCKETS(LAT_SUB_BITS));
+
+    u32 seed = 0x9e3779b9u;
+    u64 bytes = 0;
+    u64 t0 = now_ns(), t = t0;
+    for (u32 i = 0; i < n; i++) {
+        u32 f = i % NFRAMES;
+        if (history_append(&h, xorshift(&seed) % rooms, g_frames[f], g_lens[f], t, 0)) {
+            perror("history_append");
+            history_close(&h);
+            return 1;
+        }
+        u64 t1 = now_ns();
+        dbin_hist_record(&lat, t1 - t);
+        t = t1;
+        bytes += g_lens[f];
+        if ((i & 255) == 255) history_tick(&h, t);
+    }
+    history_sync(&h);
+    double secs = (double)(now_ns() - t0) / 1e9;
+
+    printf("%-22s %9.0f msg/s %8.1f MB/s  %6llu syncs  %3u segs\n", name, n / secs,
+           bytes / secs / 1e6, (unsigned long long)h.syncs, h.nsegs);
+    print_hist("append", &lat);
+    history_close(&h);
+    if (!keep) rm_store(dir);
+    return 0;
+}
+
+static int catchup_run(const char *dir, const history_cfg_t *cfg, u32 rooms) {
+    history_t h;
+    u64 t0 = now_ns();
+    if (history_open(&h, dir, cfg)) {
+        perror("history_open");
+        return 1;
+    }
+    printf("reopen: %u segments, %zu rooms recovered in %.1f ms\n", h.nsegs, h.nrooms,
+           (double)(now_ns() - t0) / 1e6);
+
+    static dbin_msg_t out[CATCHUP];
+    static u64 seqs[CATCHUP];
+    dbin_hist_t lat;
+    u64 got = 0;
+    u32 seed = 0x2545f491u;
+
+    // The latest CATCHUP messages of a room (a client back after a short
+    // absence), then the same number from the oldest kept.
+    for (int from_start = 0; from_start < 2; from_start++) {
+        dbin_hist_init(&lat, LAT_SUB_BITS, g_counts, DBIN_HIST_BUCKETS(LAT_SUB_BITS));
+        for (u32 i = 0; i < READS; i++) {
+            u32 room = xorshift(&seed) % rooms;
+            u64 next = history_next_seq(&h, room);
+            u64 from = (from_start || next <= CATCHUP) ? 1 : next - CATCHUP;
+            u64 t = now_ns();
+            usize n = history_read(&h, room, from, out, seqs, CATCHUP);
+            dbin_hist_record(&lat, now_ns() - t);
+            for (usize k = 0; k < n; k++) got += out[k].msg_len;
+        }
+        print_hist(from_start ? "read oldest" : "read latest", &lat);
+    }
+    if (got == 0) printf("(no messages read)\n");
+    history_close(&h);
+    return 0;
+}
+
+static int retention_run(const char *dir) {
+    history_cfg_t cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.seg_bytes = 1u << 20;
+    cfg.max_bytes = 4u << 20;
+
+    history_t h;
+    if (history_open(&h, dir, &cfg)) {
+        perror("history_open");
+        return 1;
+    }
+    u64 t = now_ns();
+    u32 n = (u32)((16u << 20) / (g_bytes / NFRAMES));
+    for (u32 i = 0; i < n; i++) {
+        u32 f = i % NFRAMES;
+        if (history_append(&h, i % 8, g_frames[f], g_lens[f], t + i, 0)) {
+            perror("history_append");
+            break;
+        }
+    }
+    dbin_msg_t m;
+    u64 first = 0;
+    history_read(&h, 0, 1, &m, &first, 1);
+    printf("retention: max 4 MiB of 1 MiB segments, 16 MiB appended: %u live, %llu dropped, "
+           "room 0 keeps seq %llu..%llu\n", h.nsegs, (unsigned long long)h.segs_dropped,
+           (unsigned long long)first, (unsigned long long)(history_next_seq(&h, 0) - 1));
+    history_close(&h);
+    rm_store(dir);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    u32 rooms = 1000, n = 2000000;
+    const char *base = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "r:n:d:")) != -1) {
+        switch (opt) {
+            case 'r': rooms = (u32)atoi(optarg); break;
+            case 'n': n = (u32)atoi(optarg); break;
+            case 'd': base = optarg; break;
+            default:
+                fprintf(stderr, "usage: %s [-r rooms] [-n messages] [-d dir]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (rooms == 0 || n == 0) return 2;
+
+    char tmpl[] = "/tmp/dbin-history.XXXXXX";
+    char root[4096];
+    if (base) {
+        snprintf(root, sizeof(root), "%s", base);
+    } else if (mkdtemp(tmpl)) {
+        snprintf(root, sizeof(root), "%s", tmpl);
+    } else {
+        perror("mkdtemp");
+        return 1;
+    }
+    char dir[4200];
+    snprintf(dir, sizeof(dir), "%s/h", root);
+
+    make_frames();
+    printf("%u messages over %u rooms, %zu bytes per frame on average, in %s\n", n, rooms,
+           g_bytes / NFRAMES, root);
+
+    history_cfg_t cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    int rc = 0;
+
+    cfg.sync = HISTORY_SYNC_BYTES;
+    cfg.sync_arg = 1u << 20;
+    rc |= append_run(dir, "sync every 1 MiB", &cfg, rooms, n, 0);
+    cfg.sync = HISTORY_SYNC_INTERVAL;
+    cfg.sync_arg = 10000000;
+    rc |= append_run(dir, "sync every 10 ms", &cfg, rooms, n, 0);
+    // One msync per message is far slower; a smaller run says as much.
+    cfg.sync = HISTORY_SYNC_EVERY;
+    rc |= append_run(dir, "sync every append", &cfg, rooms, n / 100 ? n / 100 : 1, 0);
+    cfg.sync = HISTORY_SYNC_NONE;
+    rc |= append_run(dir, "no sync", &cfg, rooms, n, 1);
+
+    rc |= catchup_run(dir, &cfg, rooms);
+    rm_store(dir);
+    rc |= retention_run(dir);
+
+    if (!base) rmdir(root);
+    return rc;
+}
@@ -0,0 +1,148 @@
+// bench/iov_bench.c
+// Sending frames whose payload the caller already holds: dbin_encode into a
+// send buffer (payload copied) against dbin_frame_iov + writev (payload sent
+// from where it lies), one frame per call and 32 per call, over a Unix
+// stream socketpair drained by a second thread. Reports sender CPU time per
+// frame, so the reader's share of the CPU does not count.
+// Build:
+//   make iov-bench
+// Run (or `make iovbench`):
+//   ./iov-bench [frames]
+
+#include "dbin/codec.h"
+#include "dbin/iov.h"
+#include "dbin/protocol.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#define BATCH     32
+#define NPAYLOADS 64 // distinct payload buffers, cycled, so sends do not all hit one cache line
+
+static u64 cpu_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+}
+
+static void *drain(void *arg) {
+    int fd = *(int*)arg;
+    static u8 buf[1 << 16];
+    while (read(fd, buf, sizeof(buf)) > 0) {}
+    return NULL;
+}
+
+static int write_all(int fd, struct iovec *iov, int n) {
+    while (n > 0) {
+        ssize_t k = writev(fd, iov, n);
+        if (k < 0) return -1;
+        while (n > 0 && (usize)k >= iov->iov_len) {
+            k -= (ssize_t)iov->iov_len;
+            iov++;
+            n--;
+        }
+        if (n > 0) {
+            iov->iov_base = (u8*)iov->iov_base + k;
+            iov->iov_len -= (usize)k;
+        }
+    }
+    return 0;
+}
+
+// ns of sender CPU per frame.
+static double run(int fd, dbin_msg_t *msgs, u8 **pay, int len, int batch, int iov_mode, u64 frames) {
+    static u8 out[BATCH * (DBIN_LEN_PREFIX_BYTES + DBIN_MAX_FRAME_LEN)];
+    static u8 heads[BATCH][DBIN_FRAME_HEAD_BYTES];
+    struct iovec iov[2 * BATCH];
+
+    u64 t0 = cpu_ns();
+    for (u64 f = 0; f < frames; f += (u64)batch) {
+        int n = 0;
+        usize w = 0;
+        for (int i = 0; i < batch; i++) {
+            dbin_msg_t *m = &msgs[i];
+            m->msg = pay[(f + (u64)i) % NPAYLOADS];
+            m->msg_len = (u16)len;
+            m->msg_id = (u16)(f + (u64)i);
+            if (iov_mode) {
+                int k;
+                dbin_frame_iov(m, heads[i], iov + n, &k);
+                n += k;
+            } else {
+                usize k;
+                dbin_encode(m, out + w + DBIN_LEN_PREFIX_BYTES, DBIN_MAX_FRAME_LEN, &k);
+                out[w] = (u8)(k >> 8);
+                out[w + 1] = (u8)k;
+                w += DBIN_LEN_PREFIX_BYTES + k;
+            }
+        }
+        if (!iov_mode) {
+            iov[0].iov_base = out;
+            iov[0].iov_len = w;
+            n = 1;
+        }
+        if (write_all(fd, iov, n)) return -1;
+    }
+    return (double)(cpu_ns() - t0) / (double)frames;
+}
+
+int main(int argc, char **argv) {
+    u64 frames = argc > 1 ? (u64)atol(argv[1]) : 200000;
+    if (frames == 0) return 2;
+    frames = (frames + BATCH - 1) / BATCH * BATCH;
+
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv)) {
+        perror("socketpair");
+        return 1;
+    }
+    int sndbuf = 1 << 20;
+    setsockopt(sv[0], SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+    pthread_t th;
+    pthread_create(&th, NULL, drain, &sv[1]);
+
+    u8 *pay[NPAYLOADS];
+    for (int i = 0; i < NPAYLOADS; i++) {
+        pay[i] = (u8*)malloc(DBIN_MAX_MSG_LEN);
+        memset(pay[i], 'a' + i % 26, DBIN_MAX_MSG_LEN);
+    }
+    dbin_msg_t msgs[BATCH];
+    memset(msgs, 0, sizeof(msgs));
+    for (int i = 0; i < BATCH; i++) {
+        msgs[i].magic = DBIN_MAGIC;
+        msgs[i].version = DBIN_VERSION;
+        msgs[i].type = DBIN_TYPE_MSG;
+        msgs[i].valid = 1;
+        msgs[i].user_id = 11;
+        msgs[i].route = 12;
+    }
+
+    static const int sizes[] = { 64, 512, 1024, 4095 };
+    static const int batches[] = { 1, BATCH };
+    printf("%llu frames per row; sender CPU ns per frame\n\n", (unsigned long long)frames);
+    printf("%7s %6s %10s %10s %8s\n", "payload", "batch", "encode", "iov", "saved");
+    for (usize b = 0; b < sizeof(batches) / sizeof(batches[0]); b++) {
+        for (usize s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+            run(sv[0], msgs, pay, sizes[s], batches[b], 0, frames / 10); // warm-up
+            double enc = run(sv[0], msgs, pay, sizes[s], batches[b], 0, frames);
+            double iov = run(sv[0], msgs, pay, sizes[s], batches[b], 1, frames);
+            if (enc < 0 || iov < 0) {
+                perror("writev");
+                return 1;
+            }
+            printf("%7d %6d %10.1f %10.1f %7.1f%%\n", sizes[s], batches[b], enc, iov, 100.0 * (enc - iov) / enc);
+        }
+    }
+
+    close(sv[0]);
+    pthread_join(th, NULL);
+    close(sv[1]);
+    for (int i = 0; i < NPAYLOADS; i++) free(pay[i]);
+    return 0;
+}
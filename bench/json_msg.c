@@ -0,0 +1,247 @@
+// bench/json_msg.c
+// Minimal JSON codec for dbin_msg_t; see json_msg.h.
+
+#include "json_msg.h"
+
+#include "dbin/protocol.h"
+
+#include <string.h>
+
+// ---- encoder ----
+
+static char *put_str(char *w, const char *s) {
+    usize n = strlen(s);
+    memcpy(w, s, n);
+    return w + n;
+}
+
+static char *put_u32(char *w, u32 v) {
+    char tmp[10];
+    int n = 0;
+    do {
+        tmp[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    while (n) *w++ = tmp[--n];
+    return w;
+}
+
+usize json_msg_encode(const dbin_msg_t *m, char *out, usize cap) {
+    // Worst case: every payload byte as \u00XX, plus the fixed keys and numbers.
+    if (cap < 128 + (usize)m->msg_len * 6) return 0;
+    static const char hex[] = "0123456789abcdef";
+
+    char *w = out;
+    w = put_str(w, "{\"type\":");
+    w = put_u32(w, m->type);
+    w = put_str(w, ",\"valid\":");
+    w = put_u32(w, m->valid);
+    w = put_str(w, ",\"is_room\":");
+    w = put_u32(w, m->is_room);
+    w = put_str(w, ",\"user_id\":");
+    w = put_u32(w, m->user_id);
+    w = put_str(w, ",\"route\":");
+    w = put_u32(w, m->route);
+    w = put_str(w, ",\"msg_id\":");
+    w = put_u32(w, m->msg_id);
+    w = put_str(w, ",\"msg\":\"");
+
+    const u8 *p = m->msg, *end = m->msg + m->msg_len;
+    while (p < end) {
+        // Copy the run of bytes that need no escaping in one go.
+        const u8 *run = p;
+        while (p < end && *p >= 0x20 && *p != '"' && *p != '\\') p++;
+        memcpy(w, run, (usize)(p - run));
+        w += p - run;
+        if (p == end) break;
+
+        u8 c = *p++;
+        switch (c) {
+            case '"':  *w++ = '\\'; *w++ = '"';  break;
+            case '\\': *w++ = '\\'; *w++ = '\\'; break;
+            case '\n': *w++ = '\\'; *w++ = 'n';  break;
+            case '\r': *w++ = '\\'; *w++ = 'r';  break;
+            case '\t': *w++ = '\\'; *w++ = 't';  break;
+            default:
+                w = put_str(w, "\\u00");
+                *w++ = hex[c >> 4];
+                *w++ = hex[c & 15];
+        }
+    }
+    w = put_str(w, "\"}");
+    return (usize)(w - out);
+}
+
+// ---- parser ----
+
+typedef struct {
+    const char *p;
+    const char *end;
+} cur_t;
+
+static void skip_ws(cur_t *c) {
+    while (c->p < c->end && (*c->p == ' ' || *c->p == '\t' || *c->p == '\n' || *c->p == '\r')) c->p++;
+}
+
+static int expect(cur_t *c, char ch) {
+    skip_ws(c);
+    if (c->p >= c->end || *c->p != ch) return 1;
+    c->p++;
+    return 0;
+}
+
+static int parse_u32(cur_t *c, u32 *out) {
+    skip_ws(c);
+    const char *s = c->p;
+    u64 v = 0;
+    while (c->p < c->end && *c->p >= '0' && *c->p <= '9') {
+        v = v * 10 + (u64)(*c->p - '0');
+        if (v > 0xFFFFFFFFull) return 1;
+        c->p++;
+    }
+    if (c->p == s) return 1;
+    *out = (u32)v;
+    return 0;
+}
+
+static int hex4(const char *p, u32 *out) {
+    u32 v = 0;
+    for (int i = 0; i < 4; i++) {
+        char ch = p[i];
+        v <<= 4;
+        if (ch >= '0' && ch <= '9') v |= (u32)(ch - '0');
+        else if (ch >= 'a' && ch <= 'f') v |= (u32)(ch - 'a' + 10);
+        else if (ch >= 'A' && ch <= 'F') v |= (u32)(ch - 'A' + 10);
+        else return 1;
+    }
+    *out = v;
+    return 0;
+}
+
+// Key names are short and unescaped in this schema.
+static int parse_key(cur_t *c, const char **k, usize *klen) {
+    if (expect(c, '"')) return 1;
+    const char *s = c->p;
+    while (c->p < c->end && *c->p != '"') {
+        if (*c->p == '\\') return 1;
+        c->p++;
+    }
+    if (c->p >= c->end) return 1;
+    *k = s;
+    *klen = (usize)(c->p - s);
+    c->p++;
+    return expect(c, ':');
+}
+
+static int parse_str(cur_t *c, dbin_msg_t *m, u8 *scratch, usize scratch_cap) {
+    if (expect(c, '"')) return 1;
+    const char *s = c->p;
+    while (c->p < c->end && *c->p != '"' && *c->p != '\\') c->p++;
+    if (c->p >= c->end) return 1;
+
+    // No escapes: the payload is the raw bytes between the quotes.
+    if (*c->p == '"') {
+        usize n = (usize)(c->p - s);
+        if (n > DBIN_MAX_MSG_LEN) return 1;
+        m->msg = (const u8*)s;
+        m->msg_len = (u16)n;
+        c->p++;
+        return 0;
+    }
+
+    usize n = (usize)(c->p - s);
+    if (n > scratch_cap) return 1;
+    memcpy(scratch, s, n);
+    while (c->p < c->end && *c->p != '"') {
+        if (*c->p != '\\') {
+            const char *run = c->p;
+            while (c->p < c->end && *c->p != '"' && *c->p != '\\') c->p++;
+            usize k = (usize)(c->p - run);
+            if (n + k > scratch_cap) return 1;
+            memcpy(scratch + n, run, k);
+            n += k;
+            continue;
+        }
+
+        u8 buf[3];
+        usize k = 1;
+        if (c->end - c->p < 2) return 1;
+        char e = c->p[1];
+        c->p += 2;
+        switch (e) {
+            case '"':  buf[0] = '"';  break;
+            case '\\': buf[0] = '\\'; break;
+            case '/':  buf[0] = '/';  break;
+            case 'b':  buf[0] = '\b'; break;
+            case 'f':  buf[0] = '\f'; break;
+            case 'n':  buf[0] = '\n'; break;
+            case 'r':  buf[0] = '\r'; break;
+            case 't':  buf[0] = '\t'; break;
+            case 'u': {
+                // Basic Multilingual Plane only; enough for this schema.
+                u32 cp;
+                if (c->end - c->p < 4 || hex4(c->p, &cp)) return 1;
+                c->p += 4;
+                if (cp < 0x80) {
+                    buf[0] = (u8)cp;
+                } else if (cp < 0x800) {
+                    buf[0] = (u8)(0xC0 | (cp >> 6));
+                    buf[1] = (u8)(0x80 | (cp & 0x3F));
+                    k = 2;
+                } else {
+                    buf[0] = (u8)(0xE0 | (cp >> 12));
+                    buf[1] = (u8)(0x80 | ((cp >> 6) & 0x3F));
+                    buf[2] = (u8)(0x80 | (cp & 0x3F));
+                    k = 3;
+                }
+                break;
+            }
+            default: return 1;
+        }
+        if (n + k > scratch_cap) return 1;
+        memcpy(scratch + n, buf, k);
+        n += k;
+    }
+    if (c->p >= c->end || n > DBIN_MAX_MSG_LEN) return 1;
+    c->p++;
+    m->msg = scratch;
+    m->msg_len = (u16)n;
+    return 0;
+}
+
+#define KEY_IS(k, n, lit) ((n) == sizeof(lit) - 1 && memcmp((k), (lit), sizeof(lit) - 1) == 0)
+
+int json_msg_decode(const char *in, usize len, dbin_msg_t *m, u8 *scratch, usize scratch_cap) {
+    cur_t c = { in, in + len };
+    memset(m, 0, sizeof(*m));
+    m->magic = (u16)DBIN_MAGIC;
+    m->version = (u8)DBIN_VERSION;
+
+    if (expect(&c, '{')) return 1;
+    for (;;) {
+        const char *k;
+        usize kn;
+        u32 v = 0;
+        if (parse_key(&c, &k, &kn)) return 1;
+
+        if (KEY_IS(k, kn, "msg")) {
+            if (parse_str(&c, m, scratch, scratch_cap)) return 1;
+        } else {
+            if (parse_u32(&c, &v)) return 1;
+            if (KEY_IS(k, kn, "type") && v <= 7) m->type = (u8)v;
+            else if (KEY_IS(k, kn, "valid") && v <= 1) m->valid = v != 0;
+            else if (KEY_IS(k, kn, "is_room") && v <= 1) m->is_room = v != 0;
+            else if (KEY_IS(k, kn, "user_id") && v <= 0xFFFFF) m->user_id = v;
+            else if (KEY_IS(k, kn, "route") && v <= 0xFFFFF) m->route = v;
+            else if (KEY_IS(k, kn, "msg_id") && v <= 0xFFFF) m->msg_id = (u16)v;
+            else return 1;
+        }
+
+        skip_ws(&c);
+        if (c.p < c.end && *c.p == ',') {
+            c.p++;
+            continue;
+        }
+        return expect(&c, '}');
+    }
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+// Minimal JSON encoding of a dBIN message, the baseline codec-bench
+// compares against. One flat object with the header fields dBIN carries
+// and the payload as a JSON string:
+//   {"type":0,"valid":1,"is_room":1,"user_id":1234,"route":77,"msg_id":9,"msg":"hi"}
+
+#include "dbin/types.h"
+#include "dbin/dbin.h"
+
+// Encode `m` into out[0..cap). Returns bytes written, 0 when it does not fit.
+usize json_msg_encode(const dbin_msg_t *m, char *out, usize cap);
+
+// Parse in[0..len) into *m. Keys may come in any order; unknown keys are
+// rejected. The payload is unescaped into scratch[0..scratch_cap) when it
+// contains escapes, otherwise m->msg points into `in`. Returns 0 on success.
+int   json_msg_decode(const char *in, usize len, dbin_msg_t *m, u8 *scratch, usize scratch_cap);
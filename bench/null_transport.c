@@ -0,0 +1,43 @@
+// bench/null_transport.c
+// Transport for in-process server benchmarks: no sockets, and a "kernel"
+// that accepts every queued byte at once.
+
+#include "../server/server.h"
+
+#include <string.h>
+
+const char *const transport_name = "null";
+
+int reactor_init(reactor_t *r, const char *ip, int port) {
+    (void)ip;
+    (void)port;
+    memset(r, 0, sizeof(*r));
+    r->epfd = r->lfd = r->evfd = -1;
+    r->cpu = -1;
+    return 0;
+}
+
+int reactor_run(reactor_t *r) {
+    (void)r;
+    return 0;
+}
+
+void reactor_destroy(reactor_t *r) {
+    reactor_free_buffers(r);
+}
+
+int transport_flush(reactor_t *r, conn_t *c) {
+    conn_out_consume(r, c, conn_out_pending(c));
+    return 0;
+}
+
+int transport_resume(reactor_t *r, conn_t *c) {
+    (void)r;
+    (void)c;
+    return 0;
+}
+
+void transport_close(reactor_t *r, conn_t *c) {
+    (void)r;
+    c->fd = -1;
+}
@@ -0,0 +1,633 @@
+// bench/open_load.c
+// Open-loop load generator: T threads drive C connections each and send MSG
+// frames on a fixed-rate schedule (constant or Poisson inter-arrival times),
+// whether or not the server keeps up. Latency is taken from each message's
+// intended send time, so a stalled server shows up as queueing delay in the
+// percentiles instead of as fewer samples (coordinated omission). The latency
+// from the actual send is reported alongside for comparison.
+//
+// Connections join one of R rooms; each message goes to a random room or, for
+// the DM share, to a random user. Payload sizes are fixed, uniform over a
+// range, or a chat-like mix. The full percentile spectrum of the intended-time
+// latency goes to stdout, or to the -H file.
+// Build:
+//   make open-load
+// Run (or `make openloadtest`, which starts a server and sweeps rates):
+//   ./open-load [-t threads] [-c conns_per_thread] [-r msgs_per_s] [-d secs]
+//               [-w warmup_secs] [-a poisson|const] [-m dm_pct] [-R rooms]
+//               [-s bytes|min-max|chat] [-H spectrum.hgrm] <ip> <port>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+#include "dbin/types.h"
+#include "dbin/protocol.h"
+#include "dbin/dbin.h"
+#include "dbin/codec.h"
+#include "dbin/batch.h"
+#include "dbin/stream.h"
+#include "dbin/ack.h"
+#include "dbin/hist.h"
+
+#define RING         4096      // scheduled, unacknowledged messages per connection
+#define OUT_CAP      (64 * 1024)
+#define IN_CAP       (64 * 1024)
+#define ROOM_BASE    1000
+#define LAT_SUB_BITS 8         // latencies to within 0.4%
+#define DRAIN_NS     2000000000ull // after the last send, how long to wait for ACKs
+
+enum { ARRIVE_POISSON, ARRIVE_CONST };
+enum { SIZE_FIXED, SIZE_UNIFORM, SIZE_CHAT };
+
+typedef struct {
+    int  fd;
+    int  want_out;   // EPOLLOUT armed
+    int  dirty;      // on the worker's flush list
+    u32  user_id;
+    u16  acked;      // oldest unacknowledged msg_id
+    u16  sent;       // next msg_id to write
+    u16  next_id;    // next msg_id to schedule
+    usize out_off;   // out[out_off..out_len) still to send
+    usize out_len;
+    dbin_stream_t in;
+    u64  intended[RING];
+    u64  actual[RING];
+    u8   out[OUT_CAP];
+    u8   inbuf[IN_CAP];
+} lconn_t;
+
+typedef struct {
+    int arrival;
+    int size_kind;
+    int size_a, size_b;
+    int dm_pct;
+    int rooms;
+    int total_users;
+    double rate;       // messages per second, whole run
+} config_t;
+
+typedef struct {
+    const config_t *cfg;
+    int nconns;
+    lconn_t *conns;
+    int *flush;        // dirty connection indices
+    int nflush;
+    u32 rng;
+    double gap_ns;     // mean inter-arrival time for this thread
+    u64 start;         // schedule begins
+    u64 record_from;   // warmup ends
+    u64 send_end;      // schedule ends
+
+    u64 scheduled;
+    u64 overrun;       // arrivals dropped because a connection's ring was full
+    u64 *late;         // intended times of recorded overruns, counted at the end
+    usize nlate, late_cap;
+    u64 sent;
+    u64 acked;
+    u64 unacked;       // still unacknowledged when the drain timed out
+    u64 delivered;     // room and DM frames received
+    u64 bytes_out;
+    dbin_hist_t lat;   // ACK time - intended send time, ns
+    dbin_hist_t svc;   // ACK time - actual send time, ns
+    u64 *lat_counts;
+    u64 *svc_counts;
+} worker_t;
+
+static u64 now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+}
+
+static u32 xorshift(u32 *s) {
+    u32 x = *s;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *s = x;
+}
+
+// Uniform in (0, 1].
+static double unit(u32 *rng) {
+    return ((double)xorshift(rng) + 1.0) / 4294967296.0;
+}
+
+static int connect_to(const char *ip, int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    addr.sin_addr.s_addr = inet_addr(ip);
+
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    int yes = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+    return fd;
+}
+
+static dbin_msg_t make_msg(u8 type, u32 user_id, u16 msg_id) {
+    dbin_msg_t m;
+    memset(&m, 0, sizeof(m));
+    m.magic = (u16)DBIN_MAGIC;
+    m.version = (u8)DBIN_VERSION;
+    m.type = type;
+    m.valid = 1;
+    m.user_id = user_id;
+    m.msg_id = msg_id;
+    return m;
+}
+
+// Join `room` with msg_id 0 and wait for the ACK, still blocking.
+static int join_room(lconn_t *c, u32 room) {
+    dbin_msg_t j = make_msg(DBIN_TYPE_JOIN, c->user_id, 0);
+    j.is_room = 1;
+    j.route = room;
+
+    u8 buf[64];
+    dbin_arena_t a;
+    usize done = 0;
+    dbin_arena_init(&a, buf, sizeof(buf));
+    if (dbin_encode_batch(&j, 1, &a, 0, &done) != DBIN_OK) return 1;
+    if (send(c->fd, a.buf, a.len, MSG_NOSIGNAL) != (ssize_t)a.len) return 1;
+
+    for (;;) {
+        dbin_msg_t m;
+        int rc = dbin_stream_next(&c->in, &m, 0);
+        if (rc == DBIN_OK && m.type == DBIN_TYPE_ACK && m.msg_id == 0) return 0;
+        if (rc == DBIN_OK) continue;
+        if (rc != DBIN_ERR_AGAIN) return 1;
+
+        usize avail = 0;
+        u8 *dst = dbin_stream_wbuf(&c->in, &avail);
+        ssize_t r = recv(c->fd, dst, (size_t)avail, 0);
+        if (r <= 0) return 1;
+        dbin_stream_commit(&c->in, (usize)r);
+    }
+}
+
+// Chat-like sizes: mostly short lines, a long tail up to the limit.
+static int chat_size(u32 *rng) {
+    u32 r = xorshift(rng) % 100;
+    if (r < 55) return (int)(xorshift(rng) % 33);
+    if (r < 85) return 33 + (int)(xorshift(rng) % 96);
+    if (r < 97) return 129 + (int)(xorshift(rng) % 896);
+    return 1025 + (int)(xorshift(rng) % (DBIN_MAX_MSG_LEN - 1024));
+}
+
+static int pick_size(worker_t *w) {
+    const config_t *cfg = w->cfg;
+    switch (cfg->size_kind) {
+        case SIZE_UNIFORM: return cfg->size_a + (int)(xorshift(&w->rng) % (u32)(cfg->size_b - cfg->size_a + 1));
+        case SIZE_CHAT:    return chat_size(&w->rng);
+        default:           return cfg->size_a;
+    }
+}
+
+static double next_gap(worker_t *w) {
+    if (w->cfg->arrival == ARRIVE_CONST) return w->gap_ns;
+    return -log(unit(&w->rng)) * w->gap_ns;
+}
+
+static void set_out(int epfd, lconn_t *c, int on) {
+    if (c->want_out == on) return;
+    struct epoll_event ev;
+    ev.events = EPOLLIN | (on ? EPOLLOUT : 0);
+    ev.data.ptr = c;
+    epoll_ctl(epfd, EPOLL_CTL_MOD, c->fd, &ev);
+    c->want_out = on;
+}
+
+// Write scheduled messages until none are left or the socket is full.
+static u8 g_text[DBIN_MAX_MSG_LEN]; // payload bytes, printable so captures look like chat
+
+static int flush_conn(worker_t *w, int epfd, lconn_t *c) {
+    for (;;) {
+        while (c->out_off < c->out_len) {
+            ssize_t n = send(c->fd, c->out + c->out_off, c->out_len - c->out_off, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    set_out(epfd, c, 1);
+                    return 0;
+                }
+                return 1;
+            }
+            c->out_off += (usize)n;
+            w->bytes_out += (u64)n;
+        }
+        c->out_off = c->out_len = 0;
+        if (c->sent == c->next_id) break;
+
+        // Encode the next scheduled messages, up to 64 or a full buffer.
+        dbin_msg_t m[64];
+        usize k = 0;
+        while (k < 64 && (u16)(c->sent + k) != c->next_id) {
+            dbin_msg_t *x = &m[k];
+            *x = make_msg(DBIN_TYPE_MSG, c->user_id, (u16)(c->sent + k));
+            x->msg_len = (u16)pick_size(w);
+            x->msg = g_text;
+            if (w->cfg->dm_pct > 0 && (int)(xorshift(&w->rng) % 100) < w->cfg->dm_pct) {
+                x->route = 1 + xorshift(&w->rng) % (u32)w->cfg->total_users;
+            } else {
+                x->is_room = 1;
+                x->route = ROOM_BASE + xorshift(&w->rng) % (u32)w->cfg->rooms;
+            }
+            k++;
+        }
+        dbin_arena_t a;
+        usize done = 0;
+        dbin_arena_init(&a, c->out, OUT_CAP);
+        int rc = dbin_encode_batch(m, k, &a, 0, &done);
+        if (rc != DBIN_OK && rc != DBIN_ERR_BUF) return 1;
+
+        u64 now = now_ns();
+        for (usize i = 0; i < done; i++) c->actual[(u16)(c->sent + i) % RING] = now;
+        c->sent = (u16)(c->sent + done);
+        c->out_len = a.len;
+        w->sent += done;
+    }
+    set_out(epfd, c, 0);
+    return 0;
+}
+
+// One arrival of the schedule: a message for a random connection, due at `t`.
+static void schedule(worker_t *w, u64 t) {
+    lconn_t *c = &w->conns[xorshift(&w->rng) % (u32)w->nconns];
+    w->scheduled++;
+    if ((u16)(c->next_id - c->acked) >= RING - 1) {
+        // Never sent, but still an arrival that waited the whole run.
+        if (t >= w->record_from) {
+            if (w->nlate == w->late_cap) {
+                usize ncap = w->late_cap ? w->late_cap * 2 : 4096;
+                u64 *nl = (u64*)realloc(w->late, ncap * sizeof(*nl));
+                if (!nl) abort();
+                w->late = nl;
+                w->late_cap = ncap;
+            }
+            w->late[w->nlate++] = t;
+        }
+        w->overrun++;
+        return;
+    }
+    c->intended[c->next_id % RING] = t;
+    c->next_id++;
+    if (!c->dirty) {
+        c->dirty = 1;
+        w->flush[w->nflush++] = (int)(c - w->conns);
+    }
+}
+
+// The server acknowledges each connection's messages in order, so an ACK
+// covers the oldest ones still outstanding.
+static void on_ack(worker_t *w, lconn_t *c, const dbin_msg_t *m) {
+    u64 now = now_ns();
+    while (c->acked != c->sent && dbin_ack_covers(m, c->acked)) {
+        u64 t = c->intended[c->acked % RING];
+        if (t >= w->record_from) {
+            dbin_hist_record(&w->lat, now - t);
+            dbin_hist_record(&w->svc, now - c->actual[c->acked % RING]);
+        }
+        c->acked++;
+        w->acked++;
+    }
+}
+
+static int read_conn(worker_t *w, lconn_t *c) {
+    for (;;) {
+        usize avail = 0;
+        u8 *dst = dbin_stream_wbuf(&c->in, &avail);
+        ssize_t r = recv(c->fd, dst, (size_t)avail, MSG_DONTWAIT);
+        if (r == 0) return 1;
+        if (r < 0) return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : 1;
+        dbin_stream_commit(&c->in, (usize)r);
+
+        dbin_msg_t m;
+        int rc;
+        while ((rc = dbin_stream_next(&c->in, &m, 0)) != DBIN_ERR_AGAIN) {
+            if (rc != DBIN_OK) {
+                if (c->in.err) return 1;
+                continue;
+            }
+            if (m.type == DBIN_TYPE_ACK || m.type == DBIN_TYPE_ACK_RANGE) on_ack(w, c, &m);
+            else if (m.type == DBIN_TYPE_MSG) w->delivered++;
+        }
+        if ((usize)r < avail) return 0;
+    }
+}
+
+static int all_acked(const worker_t *w) {
+    for (int i = 0; i < w->nconns; i++) {
+        if (w->conns[i].acked != w->conns[i].next_id) return 0;
+    }
+    return 1;
+}
+
+static void *worker_main(void *arg) {
+    worker_t *w = (worker_t*)arg;
+    int epfd = epoll_create1(0);
+    struct epoll_event evs[128];
+
+    for (int i = 0; i < w->nconns; i++) {
+        lconn_t *c = &w->conns[i];
+        fcntl(c->fd, F_SETFL, fcntl(c->fd, F_GETFL, 0) | O_NONBLOCK);
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.ptr = c;
+        epoll_ctl(epfd, EPOLL_CTL_ADD, c->fd, &ev);
+    }
+
+    double next = (double)w->start + next_gap(w);
+    u64 drain_end = w->send_end + DRAIN_NS;
+
+    for (;;) {
+        u64 now = now_ns();
+        int sending = now < w->send_end;
+        if (!sending && (now >= drain_end || all_acked(w))) break;
+
+        // Everything due by now goes out, however late: the backlog keeps
+        // its intended times.
+        while (sending && next <= (double)now) {
+            schedule(w, (u64)next);
+            next += next_gap(w);
+            if (next >= (double)w->send_end) sending = 0;
+        }
+        for (int i = 0; i < w->nflush; i++) {
+            lconn_t *c = &w->conns[w->flush[i]];
+            c->dirty = 0;
+            if (flush_conn(w, epfd, c)) goto out;
+        }
+        w->nflush = 0;
+
+        // Sleep until the next arrival is due, at most 10 ms.
+        u64 wake = sending ? (u64)next : now + 10000000ull;
+        now = now_ns();
+        u64 wait = wake > now ? wake - now : 0;
+        if (wait > 10000000ull) wait = 10000000ull;
+        struct timespec ts = { (time_t)(wait / 1000000000ull), (long)(wait % 1000000000ull) };
+        int n = epoll_pwait2(epfd, evs, 128, &ts, NULL);
+        if (n < 0 && errno == ENOSYS) n = epoll_wait(epfd, evs, 128, (int)((wait + 999999) / 1000000));
+
+        for (int i = 0; i < n; i++) {
+            lconn_t *c = (lconn_t*)evs[i].data.ptr;
+            if ((evs[i].events & EPOLLIN) && read_conn(w, c)) goto out;
+            if ((evs[i].events & EPOLLOUT) && flush_conn(w, epfd, c)) goto out;
+        }
+    }
+
+out:
+    // What never came back, or never went out, counts at the time we gave up on it.
+    {
+        u64 now = now_ns();
+        for (int i = 0; i < w->nconns; i++) {
+            lconn_t *c = &w->conns[i];
+            for (u16 id = c->acked; id != c->next_id; id++) {
+                u64 t = c->intended[id % RING];
+                if (t >= w->record_from) dbin_hist_record(&w->lat, now - t);
+                w->unacked++;
+            }
+        }
+        for (usize i = 0; i < w->nlate; i++) dbin_hist_record(&w->lat, now - w->late[i]);
+    }
+    close(epfd);
+    return NULL;
+}
+
+static void print_lat(const char *label, const dbin_hist_t *h) {
+    printf("%-22s p50=%.1f p90=%.1f p99=%.1f p99.9=%.1f p99.99=%.1f max=%.1f mean=%.1f\n", label,
+           (double)dbin_hist_percentile(h, 50.0) / 1e3, (double)dbin_hist_percentile(h, 90.0) / 1e3,
+           (double)dbin_hist_percentile(h, 99.0) / 1e3, (double)dbin_hist_percentile(h, 99.9) / 1e3,
+           (double)dbin_hist_percentile(h, 99.99) / 1e3, (double)h->max / 1e3, dbin_hist_mean(h) / 1e3);
+}
+
+// Percentile spectrum, five steps per halving of the remaining tail, in the
+// layout of HdrHistogram's .hgrm output.
+static void print_spectrum(FILE *f, const dbin_hist_t *h) {
+    fprintf(f, "%12s %14s %12s %14s\n", "Value(us)", "Percentile", "TotalCount", "1/(1-Percentile)");
+    for (int half = 0; half < 40; half++) {
+        double tail = ldexp(1.0, -half);
+        for (int step = 0; step < 5; step++) {
+            double q = 1.0 - tail * pow(0.5, step / 5.0);
+            u64 v = dbin_hist_percentile(h, q * 100.0);
+            u64 count = (u64)ceil(q * (double)h->total);
+            fprintf(f, "%12.3f %14.12f %12llu %14.2f\n", (double)v / 1e3, q, (unsigned long long)count,
+                   1.0 / (1.0 - q));
+            if (count >= h->total) goto done;
+        }
+    }
+done:
+    fprintf(f, "%12.3f %14.12f %12llu %14s\n", (double)h->max / 1e3, 1.0,
+           (unsigned long long)h->total, "inf");
+    fprintf(f, "#[Mean = %.3f, Max = %.3f, Total count = %llu]\n", dbin_hist_mean(h) / 1e3,
+           (double)h->max / 1e3, (unsigned long long)h->total);
+}
+
+static int parse_sizes(const char *s, config_t *cfg) {
+    if (!strcmp(s, "chat")) {
+        cfg->size_kind = SIZE_CHAT;
+        return 0;
+    }
+    int a = 0, b = 0;
+    if (sscanf(s, "%d-%d", &a, &b) == 2) cfg->size_kind = SIZE_UNIFORM;
+    else if (sscanf(s, "%d", &a) == 1) {
+        cfg->size_kind = SIZE_FIXED;
+        b = a;
+    } else {
+        return 1;
+    }
+    if (a < 0 || b < a || b > DBIN_MAX_MSG_LEN) return 1;
+    cfg->size_a = a;
+    cfg->size_b = b;
+    return 0;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-t threads] [-c conns_per_thread] [-r msgs_per_s] [-d secs] [-w warmup_secs]\n"
+                    "          [-a poisson|const] [-m dm_pct] [-R rooms] [-s bytes|min-max|chat] [-H spectrum.hgrm] <ip> <port>\n", prog);
+}
+
+int main(int argc, char **argv) {
+    config_t cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.arrival = ARRIVE_POISSON;
+    cfg.size_kind = SIZE_FIXED;
+    cfg.size_a = cfg.size_b = 32;
+    cfg.rooms = 16;
+    cfg.rate = 100000;
+    int threads = 4, per = 16, secs = 10, warmup = 1;
+    const char *ip = 0, *sizes = "32", *hgrm = 0;
+    int port = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        if (a[0] == '-' && a[1] && !a[2] && i + 1 < argc) {
+            const char *v = argv[++i];
+            switch (a[1]) {
+                case 't': threads = atoi(v); break;
+                case 'c': per = atoi(v); break;
+                case 'r': cfg.rate = atof(v); break;
+                case 'd': secs = atoi(v); break;
+                case 'w': warmup = atoi(v); break;
+                case 'm': cfg.dm_pct = atoi(v); break;
+                case 'R': cfg.rooms = atoi(v); break;
+                case 's': sizes = v; break;
+                case 'H': hgrm = v; break;
+                case 'a':
+                    if (!strcmp(v, "poisson")) cfg.arrival = ARRIVE_POISSON;
+                    else if (!strcmp(v, "const")) cfg.arrival = ARRIVE_CONST;
+                    else {
+                        usage(argv[0]);
+                        return 1;
+                    }
+                    break;
+                default:
+                    usage(argv[0]);
+                    return 1;
+            }
+        } else if (!ip) {
+            ip = a;
+        } else if (!port) {
+            port = atoi(a);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!ip || !port || parse_sizes(sizes, &cfg)) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (threads < 1) threads = 1;
+    if (per < 1) per = 1;
+    if (secs < 1) secs = 1;
+    if (warmup < 0 || warmup >= secs) warmup = 0;
+    if (cfg.rooms < 1) cfg.rooms = 1;
+    if (cfg.rate <= 0) cfg.rate = 1;
+    cfg.total_users = threads * per;
+
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    worker_t *ws = (worker_t*)calloc((size_t)threads, sizeof(*ws));
+    if (!ws) return 1;
+    for (int i = 0; i < DBIN_MAX_MSG_LEN; i++) g_text[i] = (u8)("open-loop load "[i % 15]);
+
+    // Connect and join rooms first, so room messages and DMs find their
+    // recipients from the first arrival on.
+    u32 next_user = 1;
+    for (int t = 0; t < threads; t++) {
+        worker_t *w = &ws[t];
+        w->cfg = &cfg;
+        w->nconns = per;
+        w->rng = 0x9E3779B9u ^ (u32)(t + 1);
+        w->gap_ns = 1e9 * threads / cfg.rate;
+        w->conns = (lconn_t*)calloc((size_t)per, sizeof(lconn_t));
+        w->flush = (int*)malloc((size_t)per * sizeof(int));
+        w->lat_counts = (u64*)malloc(DBIN_HIST_BUCKETS(LAT_SUB_BITS) * sizeof(u64));
+        w->svc_counts = (u64*)malloc(DBIN_HIST_BUCKETS(LAT_SUB_BITS) * sizeof(u64));
+        if (!w->conns || !w->flush || !w->lat_counts || !w->svc_counts) return 1;
+        dbin_hist_init(&w->lat, LAT_SUB_BITS, w->lat_counts, DBIN_HIST_BUCKETS(LAT_SUB_BITS));
+        dbin_hist_init(&w->svc, LAT_SUB_BITS, w->svc_counts, DBIN_HIST_BUCKETS(LAT_SUB_BITS));
+
+        for (int i = 0; i < per; i++) {
+            lconn_t *c = &w->conns[i];
+            c->fd = connect_to(ip, port);
+            if (c->fd < 0) {
+                perror("connect");
+                return 1;
+            }
+            c->user_id = next_user++;
+            c->acked = c->sent = c->next_id = 1;
+            dbin_stream_init(&c->in, c->inbuf, IN_CAP);
+            if (join_room(c, ROOM_BASE + (c->user_id % (u32)cfg.rooms))) {
+                fprintf(stderr, "join failed for user %u\n", c->user_id);
+                return 1;
+            }
+        }
+    }
+
+    pthread_t *tids = (pthread_t*)calloc((size_t)threads, sizeof(pthread_t));
+    if (!tids) return 1;
+
+    u64 t0 = now_ns() + 10000000ull;
+    for (int t = 0; t < threads; t++) {
+        ws[t].start = t0;
+        ws[t].record_from = t0 + (u64)warmup * 1000000000ull;
+        ws[t].send_end = t0 + (u64)secs * 1000000000ull;
+        pthread_create(&tids[t], NULL, worker_main, &ws[t]);
+    }
+
+    u64 scheduled = 0, overrun = 0, sent = 0, acked = 0, unacked = 0, delivered = 0, bytes_out = 0;
+    for (int t = 0; t < threads; t++) {
+        pthread_join(tids[t], NULL);
+        scheduled += ws[t].scheduled;
+        overrun += ws[t].overrun;
+        sent += ws[t].sent;
+        acked += ws[t].acked;
+        unacked += ws[t].unacked;
+        delivered += ws[t].delivered;
+        bytes_out += ws[t].bytes_out;
+    }
+    double el = (double)secs;
+
+    // Workers' histograms merge into the first.
+    dbin_hist_t *lat = &ws[0].lat, *svc = &ws[0].svc;
+    for (int t = 1; t < threads; t++) {
+        dbin_hist_merge(lat, &ws[t].lat);
+        dbin_hist_merge(svc, &ws[t].svc);
+    }
+
+    printf("open-load: %d threads x %d conns, %s %.0f msg/s for %d s (%d s warmup), dm %d%%, %d rooms, sizes %s\n",
+           threads, per, cfg.arrival == ARRIVE_POISSON ? "poisson" : "const", cfg.rate, secs, warmup,
+           cfg.dm_pct, cfg.rooms, sizes);
+    printf("scheduled/s=%.0f sent/s=%.0f acked/s=%.0f delivered/s=%.0f out_MB/s=%.1f overrun=%llu unacked=%llu\n",
+           (double)scheduled / el, (double)sent / el, (double)acked / el, (double)delivered / el,
+           (double)bytes_out / el / 1e6, (unsigned long long)overrun, (unsigned long long)unacked);
+    print_lat("latency_us (intended)", lat);
+    print_lat("latency_us (sent)", svc);
+    if (hgrm) {
+        FILE *f = fopen(hgrm, "w");
+        if (!f) {
+            perror(hgrm);
+        } else {
+            print_spectrum(f, lat);
+            fclose(f);
+        }
+    } else {
+        printf("\n");
+        print_spectrum(stdout, lat);
+    }
+
+    for (int t = 0; t < threads; t++) {
+        for (int i = 0; i < per; i++) close(ws[t].conns[i].fd);
+        free(ws[t].conns);
+        free(ws[t].flush);
+        free(ws[t].lat_counts);
+        free(ws[t].late);
+        free(ws[t].svc_counts);
+    }
+    free(tids);
+    free(ws);
+    return 0;
+}
@@ -0,0 +1,229 @@
+// bench/room_fanout.c
+// Room fan-out against a running server: M member connections join one room,
+// then a sender posts room messages one at a time. Each message is timed until
+// the last member has received it.
+// Build:
+//   make room-fanout
+// Run (or `make roomtest`, which starts the server and sweeps room sizes):
+//   ./room-fanout 127.0.0.1 9000 <server_pid> <members> [msgs] [payload_bytes]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+#include "dbin/types.h"
+#include "dbin/protocol.h"
+#include "dbin/dbin.h"
+#include "dbin/codec.h"
+#include "dbin/batch.h"
+#include "dbin/hist.h"
+
+#define ROOM_ID   4242
+#define SENDER_ID 1
+#define LAT_SUB_BITS 8
+
+static u64 now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+}
+
+// utime + stime of `pid`, in seconds.
+static double proc_cpu_s(int pid) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+    FILE *f = fopen(path, "r");
+    if (!f) return -1.0;
+
+    char buf[1024];
+    size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+    fclose(f);
+    buf[n] = 0;
+
+    char *p = strrchr(buf, ')');
+    if (!p) return -1.0;
+    unsigned long utime = 0, stime = 0;
+    if (sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime) != 2) return -1.0;
+    return (double)(utime + stime) / (double)sysconf(_SC_CLK_TCK);
+}
+
+static int connect_to(const char *ip, int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    addr.sin_addr.s_addr = inet_addr(ip);
+
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    int yes = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+    return fd;
+}
+
+static usize encode_one(const dbin_msg_t *m, u8 *buf, usize cap) {
+    dbin_arena_t a;
+    usize done = 0;
+    dbin_arena_init(&a, buf, cap);
+    if (dbin_encode_batch(m, 1, &a, 0, &done) != DBIN_OK) return 0;
+    return a.len;
+}
+
+static dbin_msg_t make_msg(u8 type, u32 user_id, u16 msg_id) {
+    dbin_msg_t m;
+    memset(&m, 0, sizeof(m));
+    m.magic = (u16)DBIN_MAGIC;
+    m.version = (u8)DBIN_VERSION;
+    m.type = type;
+    m.valid = 1;
+    m.is_room = 1;
+    m.user_id = user_id;
+    m.route = ROOM_ID;
+    m.msg_id = msg_id;
+    return m;
+}
+
+// Read ready member sockets until `want` more bytes have arrived in total.
+static int wait_bytes(int epfd, u64 want, u8 *buf, usize cap) {
+    struct epoll_event evs[512];
+    u64 got = 0;
+    u64 deadline = now_ns() + 10ull * 1000000000ull;
+
+    while (got < want) {
+        if (now_ns() > deadline) return 1;
+        int n = epoll_wait(epfd, evs, 512, 100);
+        for (int i = 0; i < n; i++) {
+            for (;;) {
+                ssize_t r = recv(evs[i].data.fd, buf, (size_t)cap, MSG_DONTWAIT);
+                if (r <= 0) break;
+                got += (u64)r;
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 5 || argc > 7) {
+        fprintf(stderr, "usage: %s <ip> <port> <server_pid> <members> [msgs] [payload_bytes]\n", argv[0]);
+        return 1;
+    }
+    const char *ip = argv[1];
+    int port = atoi(argv[2]);
+    int spid = atoi(argv[3]);
+    int members = atoi(argv[4]);
+    int msgs = (argc > 5) ? atoi(argv[5]) : 200;
+    int plen = (argc > 6) ? atoi(argv[6]) : 32;
+    if (members < 1) members = 1;
+    if (msgs < 1) msgs = 1;
+    if (plen < 0) plen = 0;
+    if (plen > DBIN_MAX_MSG_LEN) plen = DBIN_MAX_MSG_LEN;
+
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    int *fds = (int*)malloc((size_t)members * sizeof(int));
+    static u64 lat_counts[DBIN_HIST_BUCKETS(LAT_SUB_BITS)];
+    dbin_hist_t lat;
+    dbin_hist_init(&lat, LAT_SUB_BITS, lat_counts, DBIN_HIST_BUCKETS(LAT_SUB_BITS));
+    u8 *payload = (u8*)malloc((size_t)plen + 1);
+    int epfd = epoll_create1(0);
+    if (!fds || !payload || epfd < 0) {
+        fprintf(stderr, "setup failed\n");
+        return 1;
+    }
+    memset(payload, 'r', (size_t)plen);
+
+    static u8 rbuf[1 << 16];
+    u8 frame[DBIN_LEN_PREFIX_BYTES + DBIN_MAX_FRAME_LEN];
+    const u64 ack_wire = DBIN_LEN_PREFIX_BYTES + 12;
+
+    // Members join; wait for every JOIN's ACK before measuring.
+    for (int i = 0; i < members; i++) {
+        fds[i] = connect_to(ip, port);
+        if (fds[i] < 0) {
+            perror("connect");
+            return 1;
+        }
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.fd = fds[i];
+        epoll_ctl(epfd, EPOLL_CTL_ADD, fds[i], &ev);
+
+        dbin_msg_t j = make_msg(DBIN_TYPE_JOIN, (u32)(SENDER_ID + 1 + i), 1);
+        usize n = encode_one(&j, frame, sizeof(frame));
+        if (send(fds[i], frame, n, MSG_NOSIGNAL) != (ssize_t)n) {
+            perror("send");
+            return 1;
+        }
+    }
+    if (wait_bytes(epfd, (u64)members * ack_wire, rbuf, sizeof(rbuf))) {
+        fprintf(stderr, "timed out waiting for JOIN acks\n");
+        return 1;
+    }
+
+    int sfd = connect_to(ip, port);
+    if (sfd < 0) {
+        perror("connect");
+        return 1;
+    }
+
+    dbin_msg_t m = make_msg(DBIN_TYPE_MSG, SENDER_ID, 0);
+    m.msg_len = (u16)plen;
+    m.msg = payload;
+    u64 wire = 0;
+
+    double cpu0 = proc_cpu_s(spid);
+    u64 t0 = now_ns();
+    for (int k = 0; k < msgs; k++) {
+        m.msg_id = (u16)(k + 1);
+        usize n = encode_one(&m, frame, sizeof(frame));
+        wire = n;
+
+        u64 s = now_ns();
+        if (send(sfd, frame, n, MSG_NOSIGNAL) != (ssize_t)n) {
+            perror("send");
+            return 1;
+        }
+        if (wait_bytes(epfd, (u64)members * wire, rbuf, sizeof(rbuf))) {
+            fprintf(stderr, "timed out after %d messages\n", k);
+            return 1;
+        }
+        dbin_hist_record(&lat, now_ns() - s);
+
+        // The sender's ACKs pile up harmlessly; drain them now and then.
+        while (recv(sfd, rbuf, sizeof(rbuf), MSG_DONTWAIT) > 0) {}
+    }
+    double el = (double)(now_ns() - t0) / 1e9;
+    double cpu = proc_cpu_s(spid) - cpu0;
+
+    double deliveries = (double)members * (double)msgs;
+    printf("%8d %10.0f %12.1f %12.1f %14.3f\n",
+           members, deliveries / el,
+           (double)dbin_hist_percentile(&lat, 50.0) / 1e3, (double)dbin_hist_percentile(&lat, 99.0) / 1e3,
+           cpu * 1e9 / deliveries);
+
+    close(sfd);
+    for (int i = 0; i < members; i++) close(fds[i]);
+    close(epfd);
+    free(fds);
+    free(payload);
+    return 0;
+}
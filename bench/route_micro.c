@@ -0,0 +1,213 @@
+// bench/route_micro.c
+// Direct-message routing without sockets: the server's routing table, shard
+// queues and connection code linked against the null transport
+// (null_transport.c). N users are online on shard 0; lookups and DM forwards
+// use random user_ids, locally and from shard 1. A linear-probing hash map
+// over the same users is timed alongside as the hashed baseline.
+// Build:
+//   make route-micro
+// Run (or `make routebench`):
+//   ./route-micro [online...]
+
+#include "../server/server.h"
+
+#include "dbin/protocol.h"
+#include "dbin/codec.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define KEYS          (1u << 20) // random user_ids per pass
+#define LOOKUP_PASSES 8
+#define DM_PER_TICK   64
+
+static u64 now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+}
+
+static u32 xorshift(u32 *s) {
+    u32 x = *s;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *s = x;
+}
+
+// ---- hashed baseline: user_id + 1 -> conn, load factor <= 1/2 ----
+
+typedef struct hmap {
+    u32     *keys;
+    conn_t **vals;
+    usize    cap;
+} hmap_t;
+
+static usize hm_slot(u32 key, usize cap) {
+    return (usize)(key * 0x9E3779B1u) & (cap - 1);
+}
+
+static int hm_init(hmap_t *m, usize n) {
+    m->cap = 64;
+    while (m->cap < n * 2) m->cap *= 2;
+    m->keys = (u32*)calloc(m->cap, sizeof(*m->keys));
+    m->vals = (conn_t**)calloc(m->cap, sizeof(*m->vals));
+    return !m->keys || !m->vals;
+}
+
+static void hm_put(hmap_t *m, u32 user_id, conn_t *c) {
+    u32 key = user_id + 1;
+    usize i = hm_slot(key, m->cap);
+    while (m->keys[i] && m->keys[i] != key) i = (i + 1) & (m->cap - 1);
+    m->keys[i] = key;
+    m->vals[i] = c;
+}
+
+static conn_t *hm_get(const hmap_t *m, u32 user_id) {
+    u32 key = user_id + 1;
+    for (usize i = hm_slot(key, m->cap);; i = (i + 1) & (m->cap - 1)) {
+        if (m->keys[i] == key) return m->vals[i];
+        if (m->keys[i] == 0) return 0;
+    }
+}
+
+// ---- bench ----
+
+static double lookup_table(reactor_t *r, const hmap_t *hm, const u32 *keys, usize *found) {
+    (void)hm;
+    usize n = 0;
+    u64 t0 = now_ns();
+    for (u32 p = 0; p < LOOKUP_PASSES; p++) {
+        for (u32 i = 0; i < KEYS; i++) n += server_lookup_user(r, keys[i]) != 0;
+    }
+    *found = n;
+    return (double)(now_ns() - t0) / ((double)KEYS * LOOKUP_PASSES);
+}
+
+static double lookup_hash(reactor_t *r, const hmap_t *hm, const u32 *keys, usize *found) {
+    (void)r;
+    usize n = 0;
+    u64 t0 = now_ns();
+    for (u32 p = 0; p < LOOKUP_PASSES; p++) {
+        for (u32 i = 0; i < KEYS; i++) n += hm_get(hm, keys[i]) != 0;
+    }
+    *found = n;
+    return (double)(now_ns() - t0) / ((double)KEYS * LOOKUP_PASSES);
+}
+
+// ns per DM from `src` to users on shard 0, including the queue, the
+// cross-shard hop when src != 0, and the (null) send.
+static double forward(server_t *srv, int src, const u32 *keys, const u8 *frame, usize len) {
+    reactor_t *from = &srv->shards[src];
+    reactor_t *home = &srv->shards[0];
+    u64 t0 = now_ns();
+    for (u32 i = 0; i < KEYS; i++) {
+        server_route_user(from, keys[i], frame, len);
+        if ((i + 1) % DM_PER_TICK == 0) {
+            if (from != home) shard_drain_inbound(home);
+            reactor_end_tick(home);
+        }
+    }
+    if (from != home) shard_drain_inbound(home);
+    reactor_end_tick(home);
+    from->notify_mask = 0;
+    return (double)(now_ns() - t0) / (double)KEYS;
+}
+
+int main(int argc, char **argv) {
+    static const u32 default_sizes[] = { 1000, 65536, 1u << 20 };
+    u32 nsizes = (argc > 1) ? (u32)(argc - 1) : 3;
+
+    server_t srv;
+    if (server_init(&srv, "127.0.0.1", 0, 2, 0)) {
+        fprintf(stderr, "server_init failed\n");
+        return 1;
+    }
+    reactor_t *r = &srv.shards[0];
+
+    // Every user_id in random order; the first `online` of them connect.
+    u32 *perm = (u32*)malloc(SERVER_USER_SPACE * sizeof(*perm));
+    u32 *hit = (u32*)malloc(KEYS * sizeof(*hit));
+    u32 *any = (u32*)malloc(KEYS * sizeof(*any));
+    conn_t **conns = (conn_t**)malloc(SERVER_USER_SPACE * sizeof(*conns));
+    if (!perm || !hit || !any || !conns) return 1;
+    u32 rng = 0x2545F491u;
+    for (u32 i = 0; i < SERVER_USER_SPACE; i++) perm[i] = i;
+    for (u32 i = SERVER_USER_SPACE - 1; i > 0; i--) {
+        u32 j = xorshift(&rng) % (i + 1);
+        u32 t = perm[i];
+        perm[i] = perm[j];
+        perm[j] = t;
+    }
+
+    dbin_msg_t m;
+    memset(&m, 0, sizeof(m));
+    m.magic = (u16)DBIN_MAGIC;
+    m.version = (u8)DBIN_VERSION;
+    m.type = (u8)DBIN_TYPE_MSG;
+    m.valid = 1;
+    m.user_id = 1;
+    m.msg_len = 16;
+    m.msg = (const u8*)"route-micro-dm..";
+    u8 frame[DBIN_MAX_FRAME_LEN];
+    usize len = 0;
+    if (dbin_encode(&m, frame, sizeof(frame), &len) != DBIN_OK) return 1;
+
+    printf("routing table: %u entries x %zu B = %.1f MiB, preallocated\n",
+           SERVER_USER_SPACE, sizeof(route_t), (double)SERVER_USER_SPACE * sizeof(route_t) / (1 << 20));
+    printf("%8s %10s %10s %10s %10s %10s %10s %10s\n", "online", "index_KiB", "hash_KiB",
+           "table_ns", "hash_ns", "any_ns", "dm_ns", "dm_x_ns");
+
+    for (u32 s = 0; s < nsizes; s++) {
+        u32 online = (argc > 1) ? (u32)atoi(argv[1 + s]) : default_sizes[s];
+        if (online < 1) continue;
+        if (online > SERVER_USER_SPACE) online = SERVER_USER_SPACE;
+
+        hmap_t hm;
+        if (hm_init(&hm, online)) return 1;
+        for (u32 i = 0; i < online; i++) {
+            conns[i] = conn_open(r, -1);
+            if (!conns[i]) return 1;
+            server_bind_user(r, conns[i], perm[i]);
+            hm_put(&hm, perm[i], conns[i]);
+        }
+        for (u32 i = 0; i < KEYS; i++) {
+            hit[i] = perm[xorshift(&rng) % online];
+            any[i] = xorshift(&rng) % SERVER_USER_SPACE;
+        }
+
+        usize f_table = 0, f_hash = 0, f_any = 0;
+        lookup_table(r, &hm, hit, &f_table); // warm
+        double t_table = lookup_table(r, &hm, hit, &f_table);
+        double t_hash = lookup_hash(r, &hm, hit, &f_hash);
+        double t_any = lookup_table(r, &hm, any, &f_any);
+        if (f_table != f_hash || f_table != (usize)KEYS * LOOKUP_PASSES) {
+            fprintf(stderr, "lookup mismatch: table %zu, hash %zu\n", f_table, f_hash);
+            return 1;
+        }
+
+        double t_dm = forward(&srv, 0, hit, frame, len);
+        double t_dmx = forward(&srv, 1, hit, frame, len);
+
+        usize slots = server_route_footprint(&srv) - (usize)SERVER_USER_SPACE * sizeof(route_t);
+        usize hash = hm.cap * (sizeof(*hm.keys) + sizeof(*hm.vals));
+        printf("%8u %10.0f %10.0f %10.1f %10.1f %10.1f %10.1f %10.1f\n", online,
+               (double)slots / 1024.0, (double)hash / 1024.0,
+               t_table, t_hash, t_any, t_dm, t_dmx);
+        fflush(stdout);
+
+        for (u32 i = 0; i < online; i++) conn_close(r, conns[i]);
+        reactor_end_tick(r);
+        free(hm.keys);
+        free(hm.vals);
+    }
+
+    free(perm);
+    free(hit);
+    free(any);
+    free(conns);
+    server_destroy(&srv);
+    return 0;
+}
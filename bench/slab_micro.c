@@ -0,0 +1,179 @@
+// bench/slab_micro.c
+// Frame buffer allocation: the server's slab pool (server/slab.c) against
+// malloc/free. First one thread churning a window of live buffers with
+// dBIN-shaped sizes (header-only control frames, chat, the odd maximum
+// frame), then buffers allocated on one thread and freed on another, which
+// the pool returns to their owner in batches.
+// Build:
+//   make slab-micro
+// Run (or `make slabbench`):
+//   ./slab-micro [ops_millions] [window]
+
+#include "../server/slab.h"
+#include "../server/spsc.h"
+
+#include "dbin/protocol.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NSIZES    4096
+#define XQ_BYTES  (64u * 1024u)
+
+static u32 g_sizes[NSIZES];
+
+static u64 now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+}
+
+static u32 xorshift(u32 *s) {
+    u32 x = *s;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *s = x;
+}
+
+// Output buffer sizes (16-byte buffer header + length prefix + frame):
+// half ACK/PONG-sized, most of the rest chat, 1% maximum frames.
+static void make_sizes(void) {
+    u32 seed = 0x2468aceu;
+    for (int i = 0; i < NSIZES; i++) {
+        u32 r = xorshift(&seed) % 100;
+        u32 frame = 12;
+        if (r >= 50 && r < 99) frame = 12 + 16 + xorshift(&seed) % 241;
+        else if (r == 99) frame = DBIN_MAX_FRAME_LEN;
+        g_sizes[i] = 16 + DBIN_LEN_PREFIX_BYTES + frame;
+    }
+}
+
+static void *buf_alloc(slab_pool_t *p, usize n) {
+    return p ? slab_alloc(p, n) : malloc(n);
+}
+
+static void buf_free(slab_pool_t *p, void *b, usize n) {
+    if (p) slab_free(p, b, n);
+    else free(b);
+}
+
+// ns per free+alloc pair with `window` buffers live.
+static double churn(slab_pool_t *p, u32 window, u64 ops) {
+    void **live = (void**)calloc(window, sizeof(*live));
+    u32 *lens = (u32*)calloc(window, sizeof(*lens));
+    u32 seed = 0x13579bdu;
+    for (u32 i = 0; i < window; i++) {
+        lens[i] = g_sizes[i % NSIZES];
+        live[i] = buf_alloc(p, lens[i]);
+        memset(live[i], 1, 16);
+    }
+
+    u64 t0 = now_ns();
+    for (u64 k = 0; k < ops; k++) {
+        u32 i = xorshift(&seed) % window;
+        buf_free(p, live[i], lens[i]);
+        lens[i] = g_sizes[k % NSIZES];
+        live[i] = buf_alloc(p, lens[i]);
+        memset(live[i], 1, 16); // touch it, as an encoder would
+    }
+    double ns = (double)(now_ns() - t0) / (double)ops;
+
+    for (u32 i = 0; i < window; i++) buf_free(p, live[i], lens[i]);
+    free(live);
+    free(lens);
+    return ns;
+}
+
+// ---- cross-thread: allocate here, free there ----
+
+typedef struct xfer {
+    spsc_t q;
+    slab_pool_t *owner;  // 0 = malloc
+    slab_pool_t remote;  // the freeing thread's own pool
+    u64 ops;
+} xfer_t;
+
+static void *free_side(void *arg) {
+    xfer_t *x = (xfer_t*)arg;
+    slab_pool_t *mine = x->owner ? &x->remote : 0;
+    u64 done = 0;
+    while (done < x->ops) {
+        u32 len;
+        const u8 *data;
+        usize n;
+        if (!spsc_peek(&x->q, &len, &data, &n)) {
+            if (mine) slab_flush_remote(mine);
+            sched_yield(); // the other side may share this CPU
+            continue;
+        }
+        void *b;
+        memcpy(&b, data, sizeof(b));
+        spsc_pop(&x->q);
+        buf_free(mine, b, len);
+        done++;
+    }
+    if (mine) slab_flush_remote(mine);
+    return NULL;
+}
+
+static double cross(slab_pool_t *p, u64 ops, u64 *remote_in) {
+    xfer_t x;
+    memset(&x, 0, sizeof(x));
+    spsc_init(&x.q, XQ_BYTES);
+    slab_pool_init(&x.remote);
+    x.owner = p;
+    x.ops = ops;
+
+    pthread_t t;
+    pthread_create(&t, NULL, free_side, &x);
+    u64 t0 = now_ns();
+    for (u64 k = 0; k < ops; k++) {
+        u32 len = g_sizes[k % NSIZES];
+        void *b = buf_alloc(p, len);
+        memset(b, 1, 16);
+        while (spsc_push(&x.q, len, (const u8*)&b, sizeof(b)) != 0) sched_yield();
+    }
+    pthread_join(t, NULL);
+    double ns = (double)(now_ns() - t0) / (double)ops;
+
+    if (p) {
+        *remote_in = 0;
+        for (int i = 0; i < SLAB_CLASSES; i++) *remote_in += p->cls[i].remote_in;
+    }
+    slab_pool_destroy(&x.remote);
+    spsc_destroy(&x.q);
+    return ns;
+}
+
+int main(int argc, char **argv) {
+    u64 ops = (argc > 1 ? (u64)atoi(argv[1]) : 20) * 1000000ull;
+    u32 window = (argc > 2) ? (u32)atoi(argv[2]) : 16384;
+    if (ops == 0 || window == 0) return 2;
+    make_sizes();
+
+    static const u32 sizes[SLAB_CLASSES] = SLAB_CLASS_SIZES;
+    slab_pool_t pool;
+    slab_pool_init(&pool);
+
+    printf("%llu M ops, %u live buffers\n", (unsigned long long)(ops / 1000000), window);
+    double m = churn(0, window, ops);
+    double s = churn(&pool, window, ops);
+    printf("one thread    malloc %6.1f ns  slab %6.1f ns  (%.2fx)\n", m, s, m / s);
+
+    u64 remote_in = 0;
+    m = cross(0, ops, 0);
+    s = cross(&pool, ops, &remote_in);
+    printf("cross-thread  malloc %6.1f ns  slab %6.1f ns  (%.2fx), %llu blocks returned\n", m, s, m / s,
+           (unsigned long long)remote_in);
+
+    printf("pool: %.1f MiB of slabs, peak blocks", (double)slab_pool_bytes(&pool) / (1 << 20));
+    for (int k = 0; k < SLAB_CLASSES; k++) printf(" %u:%llu", sizes[k], (unsigned long long)pool.cls[k].peak);
+    printf("\n");
+    slab_pool_destroy(&pool);
+    return 0;
+}
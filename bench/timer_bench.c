@@ -0,0 +1,200 @@
+// bench/timer_bench.c
+// Heartbeat timers at scale: 1M connections, each with a deadline pushed
+// back by every frame it receives and a PING (and a new deadline) when it
+// passes. Simulates ticks of the server's event loop with frames spread
+// over the busy 7/8 of the connections; the rest stay silent, so their
+// timers keep firing. Compares
+//   wheel eager: server/wheel.c, wheel_arm on every frame
+//   wheel lazy:  the server's scheme, frames only stamp the connection and
+//                a timer that fires early moves to the new deadline
+//   heap:        binary min-heap with positions, sifted on every frame
+// Reports ns per frame, us per tick spent expiring, both together per
+// frame, and bytes per timer.
+// All three must send the same PINGs.
+// Build:
+//   make timer-bench
+// Run (or `make timerbench`):
+//   ./timer-bench [timers] [frames_per_timer]
+
+#include "../server/wheel.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define TICKS     1000 // 10 s of SERVER_TICK_MS ticks
+#define INTERVAL  300  // silence before a PING, in ticks
+
+typedef struct wconn {
+    wheel_timer_t t;
+    u32 base;           // last frame or PING (lazy)
+} wconn_t;
+
+typedef struct hconn {
+    u64 deadline;
+    u32 pos;            // index in the heap
+} hconn_t;
+
+typedef struct run {
+    double frame_ns;    // per frame
+    double expire_ns;   // per tick
+    double total_ns;    // everything, per frame
+    u64 pings;
+} run_t;
+
+static u64 now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+}
+
+static u32 xorshift(u32 *s) {
+    u32 x = *s;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *s = x;
+}
+
+// ---- wheel ----
+
+static u64 g_pings;
+static int g_lazy;
+
+static void on_fire(wheel_t *w, wheel_timer_t *t, void *arg) {
+    wconn_t *c = (wconn_t*)t;
+    u32 now = *(const u32*)arg;
+    if (!g_lazy || now - c->base >= INTERVAL) {
+        g_pings++;
+        c->base = now;
+    }
+    wheel_arm(w, t, (u64)c->base + INTERVAL);
+}
+
+static run_t run_wheel(u32 n, u64 frames, int lazy) {
+    wconn_t *c = (wconn_t*)calloc(n, sizeof(*c));
+    wheel_t *w = (wheel_t*)malloc(sizeof(*w));
+    if (!c || !w) exit(1);
+    wheel_init(w, 0);
+    for (u32 i = 0; i < n; i++) wheel_arm(w, &c[i].t, INTERVAL);
+    g_pings = 0;
+    g_lazy = lazy;
+
+    u32 busy = n - n / 8, seed = 0x2545F491u;
+    u64 per_tick = frames / TICKS, fns = 0, ens = 0;
+    for (u32 tick = 1; tick <= TICKS; tick++) {
+        u64 t0 = now_ns();
+        for (u64 f = 0; f < per_tick; f++) {
+            wconn_t *x = &c[xorshift(&seed) % busy];
+            x->base = tick;
+            if (!lazy) wheel_arm(w, &x->t, (u64)tick + INTERVAL);
+        }
+        u64 t1 = now_ns();
+        wheel_advance(w, tick, on_fire, &tick);
+        u64 t2 = now_ns();
+        fns += t1 - t0;
+        ens += t2 - t1;
+    }
+    run_t r = { (double)fns / (double)(per_tick * TICKS), (double)ens / TICKS,
+                (double)(fns + ens) / (double)(per_tick * TICKS), g_pings };
+    free(w);
+    free(c);
+    return r;
+}
+
+// ---- heap ----
+
+typedef struct heap {
+    hconn_t *c;
+    u32 *h;             // connection indexes, ordered by deadline
+    u32 n;
+} heap_t;
+
+static void heap_set(heap_t *hp, u32 pos, u32 id) {
+    hp->h[pos] = id;
+    hp->c[id].pos = pos;
+}
+
+static void sift_down(heap_t *hp, u32 pos) {
+    u32 id = hp->h[pos];
+    u64 d = hp->c[id].deadline;
+    for (;;) {
+        u32 l = 2 * pos + 1;
+        if (l >= hp->n) break;
+        u32 m = l;
+        if (l + 1 < hp->n && hp->c[hp->h[l + 1]].deadline < hp->c[hp->h[l]].deadline) m = l + 1;
+        if (hp->c[hp->h[m]].deadline >= d) break;
+        heap_set(hp, pos, hp->h[m]);
+        pos = m;
+    }
+    heap_set(hp, pos, id);
+}
+
+static run_t run_heap(u32 n, u64 frames) {
+    heap_t hp;
+    hp.c = (hconn_t*)calloc(n, sizeof(*hp.c));
+    hp.h = (u32*)malloc(n * sizeof(*hp.h));
+    if (!hp.c || !hp.h) exit(1);
+    hp.n = n;
+    for (u32 i = 0; i < n; i++) {
+        hp.c[i].deadline = INTERVAL;
+        heap_set(&hp, i, i);
+    }
+
+    u32 busy = n - n / 8, seed = 0x2545F491u;
+    u64 per_tick = frames / TICKS, fns = 0, ens = 0, pings = 0;
+    for (u32 tick = 1; tick <= TICKS; tick++) {
+        u64 t0 = now_ns();
+        for (u64 f = 0; f < per_tick; f++) {
+            u32 id = xorshift(&seed) % busy;
+            hp.c[id].deadline = (u64)tick + INTERVAL; // only ever later
+            sift_down(&hp, hp.c[id].pos);
+        }
+        u64 t1 = now_ns();
+        while (hp.c[hp.h[0]].deadline <= tick) {
+            pings++;
+            hp.c[hp.h[0]].deadline = (u64)tick + INTERVAL;
+            sift_down(&hp, 0);
+        }
+        u64 t2 = now_ns();
+        fns += t1 - t0;
+        ens += t2 - t1;
+    }
+    run_t r = { (double)fns / (double)(per_tick * TICKS), (double)ens / TICKS,
+                (double)(fns + ens) / (double)(per_tick * TICKS), pings };
+    free(hp.h);
+    free(hp.c);
+    return r;
+}
+
+static void row(const char *name, const run_t *r, usize bytes) {
+    printf("%-12s %10.1f %12.1f %10.1f %10llu %10zu\n", name, r->frame_ns, r->expire_ns / 1e3, r->total_ns,
+           (unsigned long long)r->pings, bytes);
+}
+
+int main(int argc, char **argv) {
+    u32 n = argc > 1 ? (u32)atol(argv[1]) : 1000000;
+    u32 fpt = argc > 2 ? (u32)atol(argv[2]) : 20;
+    if (n < 8 || fpt == 0) return 2;
+    u64 frames = (u64)n * fpt / TICKS * TICKS;
+
+    printf("%u timers, %llu frames over %d ticks, PING after %d ticks of silence\n\n", n,
+           (unsigned long long)frames, TICKS, INTERVAL);
+    printf("%-12s %10s %12s %10s %10s %10s\n", "timers", "ns/frame", "us/tick exp", "total_ns", "pings",
+           "B/timer");
+
+    run_t eager = run_wheel(n, frames, 0);
+    run_t lazy = run_wheel(n, frames, 1);
+    run_t heap = run_heap(n, frames);
+    usize wheel_b = sizeof(wconn_t) + sizeof(wheel_t) / n;
+    row("wheel eager", &eager, wheel_b);
+    row("wheel lazy", &lazy, wheel_b);
+    row("heap", &heap, sizeof(hconn_t) + sizeof(u32));
+
+    if (eager.pings != heap.pings || lazy.pings != heap.pings) {
+        fprintf(stderr, "PING counts differ\n");
+        return 1;
+    }
+    return 0;
+}
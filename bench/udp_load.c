@@ -0,0 +1,458 @@
+// bench/udp_load.c
+// The same closed-loop load over TCP and over UDP against a running server
+// started with -u (or -U): T threads, each driving C sockets, one user per
+// socket, with a window of W outstanding MSGs acknowledged by the server.
+// UDP is run three ways:
+//   udp-1    one frame per datagram, a window handed over with one sendmmsg
+//   udp      frames packed into datagrams of up to DBIN_DGRAM_MAX_BYTES
+//   udp-gso  packed, and each window sent as one UDP_SEGMENT train (the
+//            client also turns on UDP_GRO)
+// A window that goes unacknowledged for LOSS_MS counts as lost and is
+// replaced with new messages. Reports acknowledged msgs/s, datagrams (TCP:
+// sends) per second, lost messages, and server and client CPU ns per
+// message.
+// Build:
+//   make udp-load
+// Run (or `make udptest`, which starts the server for you):
+//   ./udp-load 127.0.0.1 9000 <server_pid> [threads] [socks_per_thread] [window] [secs]
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netinet/udp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "dbin/types.h"
+#include "dbin/protocol.h"
+#include "dbin/dbin.h"
+#include "dbin/codec.h"
+#include "dbin/batch.h"
+#include "dbin/stream.h"
+#include "dbin/ack.h"
+#include "dbin/dgram.h"
+#include "dbin/schema.h"
+
+#define WINDOW_MAX  256
+#define DGRAMS_MAX  WINDOW_MAX       // a window never needs more datagrams than messages
+#define RX_BATCH    16
+#define RX_SLOT     65536            // a GRO train fits
+#define LOSS_MS     200
+#define PAYLOAD     64
+
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+
+enum { MODE_TCP, MODE_UDP1, MODE_UDP, MODE_GSO, MODES };
+static const char *const mode_names[MODES] = { "tcp", "udp-1", "udp", "udp-gso" };
+
+typedef struct {
+    int fd;
+    u32 user_id;
+    u16 next_id;
+    int outstanding;
+    u64 last_ns;           // last send or ACK
+    dbin_stream_t in;      // TCP only
+    u8 inbuf[16384];
+} uconn_t;
+
+typedef struct {
+    int mode;
+    int nconns;
+    int window;
+    u64 deadline;
+    uconn_t *conns;
+    u8 *tx;                // DGRAMS_MAX datagrams of DBIN_DGRAM_MAX_BYTES
+    u8 *rx;                // RX_BATCH slots of RX_SLOT
+    u64 acks;
+    u64 lost;
+    u64 sends;             // datagrams, or TCP sends
+} worker_t;
+
+static const char *g_ip;
+static int g_port;
+
+static u64 now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+}
+
+// utime + stime of `pid`, in seconds.
+static double proc_cpu_s(int pid) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+    FILE *f = fopen(path, "r");
+    if (!f) return -1.0;
+
+    char buf[1024];
+    size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+    fclose(f);
+    buf[n] = 0;
+
+    // Fields after the parenthesised command name; utime/stime are 14 and 15.
+    char *p = strrchr(buf, ')');
+    if (!p) return -1.0;
+    unsigned long utime = 0, stime = 0;
+    if (sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime) != 2) return -1.0;
+    return (double)(utime + stime) / (double)sysconf(_SC_CLK_TCK);
+}
+
+static double self_cpu_s(void) {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return (double)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) +
+           (double)(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+static int connect_to(const char *ip, int port, int mode) {
+    int fd = socket(AF_INET, mode == MODE_TCP ? SOCK_STREAM : SOCK_DGRAM, 0);
+    if (fd < 0) return -1;
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    addr.sin_addr.s_addr = inet_addr(ip);
+
+    // A connected UDP socket: sends need no address and only the server's
+    // datagrams are received.
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    int yes = 1;
+    if (mode == MODE_TCP) setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+    if (mode == MODE_GSO) setsockopt(fd, SOL_UDP, UDP_GRO, &yes, sizeof(yes));
+    return fd;
+}
+
+static int send_all(int fd, const u8 *buf, usize len) {
+    while (len > 0) {
+        ssize_t n = send(fd, buf, (size_t)len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return 1;
+        }
+        buf += (usize)n;
+        len -= (usize)n;
+    }
+    return 0;
+}
+
+// UDP: `n` datagrams at w->tx, DBIN_DGRAM_MAX_BYTES apart and lens[i]
+// bytes long; udp-gso has padded all but the last to full size.
+static int send_dgrams(worker_t *w, uconn_t *c, int n, const usize *lens) {
+    if (w->mode == MODE_GSO && n > 1) {
+        char ctl[CMSG_SPACE(sizeof(u16))];
+        struct iovec iov = { w->tx, (size_t)(n - 1) * DBIN_DGRAM_MAX_BYTES + lens[n - 1] };
+        struct msghdr mh;
+        memset(&mh, 0, sizeof(mh));
+        mh.msg_iov = &iov;
+        mh.msg_iovlen = 1;
+        mh.msg_control = ctl;
+        mh.msg_controllen = sizeof(ctl);
+        struct cmsghdr *cm = CMSG_FIRSTHDR(&mh);
+        cm->cmsg_level = SOL_UDP;
+        cm->cmsg_type = UDP_SEGMENT;
+        cm->cmsg_len = CMSG_LEN(sizeof(u16));
+        u16 gso = DBIN_DGRAM_MAX_BYTES;
+        memcpy(CMSG_DATA(cm), &gso, sizeof(gso));
+        if (sendmsg(c->fd, &mh, 0) < 0) return errno == ENOBUFS || errno == EAGAIN ? 0 : 1;
+        w->sends += (u64)n;
+        return 0;
+    }
+
+    struct mmsghdr mm[DGRAMS_MAX];
+    struct iovec iov[DGRAMS_MAX];
+    memset(mm, 0, sizeof(mm[0]) * (size_t)n);
+    for (int i = 0; i < n; i++) {
+        iov[i].iov_base = w->tx + (usize)i * DBIN_DGRAM_MAX_BYTES;
+        iov[i].iov_len = lens[i];
+        mm[i].msg_hdr.msg_iov = &iov[i];
+        mm[i].msg_hdr.msg_iovlen = 1;
+    }
+    for (int done = 0; done < n;) {
+        int k = sendmmsg(c->fd, mm + done, (unsigned)(n - done), 0);
+        if (k < 0) {
+            if (errno == EINTR) continue;
+            if (errno == ENOBUFS || errno == EAGAIN) break; // lost, as on the wire
+            return 1;
+        }
+        done += k;
+        w->sends += (u64)k;
+    }
+    return 0;
+}
+
+// Top the socket's window back up.
+static int refill(worker_t *w, uconn_t *c) {
+    static const u8 payload[PAYLOAD] = "udp load payload";
+    dbin_msg_t m[WINDOW_MAX];
+    int k = 0;
+
+    while (c->outstanding < w->window) {
+        dbin_msg_t *x = &m[k++];
+        memset(x, 0, sizeof(*x));
+        x->magic = (u16)DBIN_MAGIC;
+        x->version = (u8)DBIN_VERSION;
+        x->type = (u8)DBIN_TYPE_MSG;
+        x->valid = 1;
+        x->is_room = 1;
+        x->route = 77;
+        x->user_id = c->user_id;
+        x->msg_id = c->next_id++;
+        x->msg_len = PAYLOAD;
+        x->msg = payload;
+        c->outstanding++;
+    }
+    if (k == 0) return 0;
+    c->last_ns = now_ns();
+
+    if (w->mode == MODE_TCP) {
+        u8 buf[WINDOW_MAX * (DBIN_LEN_PREFIX_BYTES + DBIN_HEADER_V1_BYTES + PAYLOAD)];
+        dbin_arena_t a;
+        usize done = 0;
+        dbin_arena_init(&a, buf, (usize)sizeof(buf));
+        if (dbin_encode_batch(m, (usize)k, &a, 0, &done) != DBIN_OK) return 1;
+        w->sends++;
+        return send_all(c->fd, a.buf, a.len);
+    }
+
+    usize lens[DGRAMS_MAX];
+    int n = 0;
+    lens[0] = 0;
+    for (int i = 0; i < k; i++) {
+        u8 *d = w->tx + (usize)n * DBIN_DGRAM_MAX_BYTES;
+        int full = w->mode == MODE_UDP1 || dbin_dgram_add(d, DBIN_DGRAM_MAX_BYTES, &lens[n], &m[i]) != DBIN_OK;
+        if (lens[n] > 0 && full) {
+            // Start the next datagram; a GSO train pads this one out.
+            if (w->mode == MODE_GSO) memset(d + lens[n], 0, DBIN_DGRAM_MAX_BYTES - lens[n]);
+            d += DBIN_DGRAM_MAX_BYTES;
+            lens[++n] = 0;
+        }
+        if (lens[n] == 0 && dbin_dgram_add(d, DBIN_DGRAM_MAX_BYTES, &lens[n], &m[i]) != DBIN_OK) return 1;
+    }
+    return send_dgrams(w, c, n + 1, lens);
+}
+
+// The server acknowledges in order, so the covered ids are the oldest
+// outstanding ones.
+static void on_ack(worker_t *w, uconn_t *c, const dbin_msg_t *m) {
+    int n = 0;
+    for (int i = c->outstanding; i > 0; i--) {
+        if (dbin_ack_covers(m, (u16)(c->next_id - i))) n++;
+    }
+    c->outstanding -= n;
+    c->last_ns = now_ns();
+    w->acks += (u64)n;
+}
+
+static void on_frame(worker_t *w, uconn_t *c, const dbin_msg_t *m) {
+    if (m->type == DBIN_TYPE_ACK || m->type == DBIN_TYPE_ACK_RANGE) on_ack(w, c, m);
+}
+
+static int read_tcp(worker_t *w, uconn_t *c) {
+    usize avail = 0;
+    u8 *dst = dbin_stream_wbuf(&c->in, &avail);
+    ssize_t r = recv(c->fd, dst, (size_t)avail, MSG_DONTWAIT);
+    if (r <= 0) return 0;
+    dbin_stream_commit(&c->in, (usize)r);
+
+    dbin_msg_t m;
+    int rc;
+    while ((rc = dbin_stream_next(&c->in, &m, 0)) != DBIN_ERR_AGAIN) {
+        if (rc != DBIN_OK) return 1;
+        on_frame(w, c, &m);
+    }
+    return 0;
+}
+
+static int gro_size(struct msghdr *mh) {
+    for (struct cmsghdr *cm = CMSG_FIRSTHDR(mh); cm; cm = CMSG_NXTHDR(mh, cm)) {
+        if (cm->cmsg_level == SOL_UDP && cm->cmsg_type == UDP_GRO) {
+            int sz;
+            memcpy(&sz, CMSG_DATA(cm), sizeof(sz));
+            return sz;
+        }
+    }
+    return 0;
+}
+
+static void read_udp(worker_t *w, uconn_t *c) {
+    struct mmsghdr mm[RX_BATCH];
+    struct iovec iov[RX_BATCH];
+    char ctl[RX_BATCH][CMSG_SPACE(sizeof(int))];
+    memset(mm, 0, sizeof(mm));
+    for (int i = 0; i < RX_BATCH; i++) {
+        iov[i].iov_base = w->rx + (usize)i * RX_SLOT;
+        iov[i].iov_len = RX_SLOT;
+        mm[i].msg_hdr.msg_iov = &iov[i];
+        mm[i].msg_hdr.msg_iovlen = 1;
+        mm[i].msg_hdr.msg_control = ctl[i];
+        mm[i].msg_hdr.msg_controllen = sizeof(ctl[i]);
+    }
+    int n = recvmmsg(c->fd, mm, RX_BATCH, MSG_DONTWAIT, 0);
+    for (int i = 0; i < n; i++) {
+        const u8 *d = (const u8*)iov[i].iov_base;
+        usize len = mm[i].msg_len;
+        usize seg = (usize)gro_size(&mm[i].msg_hdr);
+        if (seg == 0) seg = len;
+        for (usize base = 0; base < len; base += seg) {
+            usize dlen = len - base < seg ? len - base : seg;
+            usize off = 0, flen;
+            const u8 *f;
+            dbin_msg_t m;
+            int rc;
+            while ((rc = dbin_dgram_next(d + base, dlen, &off, &m, &f, &flen)) != DBIN_ERR_AGAIN) {
+                if (rc == DBIN_OK) on_frame(w, c, &m);
+            }
+        }
+    }
+}
+
+static void *worker_main(void *arg) {
+    worker_t *w = (worker_t*)arg;
+    int epfd = epoll_create1(0);
+    struct epoll_event evs[128];
+
+    for (int i = 0; i < w->nconns; i++) {
+        uconn_t *c = &w->conns[i];
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.ptr = c;
+        epoll_ctl(epfd, EPOLL_CTL_ADD, c->fd, &ev);
+        if (refill(w, c)) return NULL;
+    }
+
+    u64 check = now_ns();
+    for (;;) {
+        u64 now = now_ns();
+        if (now >= w->deadline) break;
+        int n = epoll_wait(epfd, evs, 128, 10);
+        for (int i = 0; i < n; i++) {
+            uconn_t *c = (uconn_t*)evs[i].data.ptr;
+            if (w->mode == MODE_TCP) {
+                if (read_tcp(w, c)) goto out;
+            } else {
+                read_udp(w, c);
+            }
+            if (refill(w, c)) goto out;
+        }
+
+        // Datagrams lost on the way, or their ACKs: give up on the window.
+        now = now_ns();
+        if (w->mode == MODE_TCP || now - check < 10000000ull) continue;
+        check = now;
+        for (int i = 0; i < w->nconns; i++) {
+            uconn_t *c = &w->conns[i];
+            if (c->outstanding == 0 || now - c->last_ns < LOSS_MS * 1000000ull) continue;
+            w->lost += (u64)c->outstanding;
+            c->outstanding = 0;
+            if (refill(w, c)) goto out;
+        }
+    }
+out:
+    close(epfd);
+    return NULL;
+}
+
+// One mode: fresh sockets and users, `secs` of load. Prints a row.
+static int run(int mode, int pid, int threads, int per, int window, int secs, u32 *next_user) {
+    worker_t *ws = (worker_t*)calloc((size_t)threads, sizeof(*ws));
+    pthread_t *tids = (pthread_t*)calloc((size_t)threads, sizeof(pthread_t));
+    if (!ws || !tids) return 1;
+
+    for (int t = 0; t < threads; t++) {
+        worker_t *w = &ws[t];
+        w->mode = mode;
+        w->nconns = per;
+        w->window = window;
+        w->conns = (uconn_t*)calloc((size_t)per, sizeof(uconn_t));
+        w->tx = (u8*)malloc((usize)DGRAMS_MAX * DBIN_DGRAM_MAX_BYTES);
+        w->rx = (u8*)malloc((usize)RX_BATCH * RX_SLOT);
+        if (!w->conns || !w->tx || !w->rx) return 1;
+        for (int i = 0; i < per; i++) {
+            uconn_t *c = &w->conns[i];
+            c->fd = connect_to(g_ip, g_port, mode);
+            if (c->fd < 0) {
+                perror("connect");
+                return 1;
+            }
+            c->user_id = (*next_user)++;
+            c->next_id = 1;
+            dbin_stream_init(&c->in, c->inbuf, (usize)sizeof(c->inbuf));
+        }
+    }
+
+    double srv0 = proc_cpu_s(pid), cli0 = self_cpu_s();
+    u64 t0 = now_ns();
+    for (int t = 0; t < threads; t++) {
+        ws[t].deadline = t0 + (u64)secs * 1000000000ull;
+        pthread_create(&tids[t], NULL, worker_main, &ws[t]);
+    }
+    for (int t = 0; t < threads; t++) pthread_join(tids[t], NULL);
+    double el = (double)(now_ns() - t0) / 1e9;
+    double srv = proc_cpu_s(pid) - srv0, cli = self_cpu_s() - cli0;
+
+    u64 acks = 0, lost = 0, sends = 0;
+    for (int t = 0; t < threads; t++) {
+        worker_t *w = &ws[t];
+        acks += w->acks;
+        lost += w->lost;
+        sends += w->sends;
+        for (int i = 0; i < per; i++) close(w->conns[i].fd);
+        free(w->conns);
+        free(w->tx);
+        free(w->rx);
+    }
+    free(ws);
+    free(tids);
+
+    printf("%-8s %12.0f %12.0f %10llu %14.0f %14.0f\n", mode_names[mode], (double)acks / el, (double)sends / el,
+           (unsigned long long)lost, acks ? srv * 1e9 / (double)acks : 0.0, acks ? cli * 1e9 / (double)acks : 0.0);
+    fflush(stdout);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 4 || argc > 8) {
+        fprintf(stderr, "usage: %s <ip> <port> <server_pid> [threads] [socks_per_thread] [window] [secs]\n",
+                argv[0]);
+        return 1;
+    }
+    g_ip = argv[1];
+    g_port = atoi(argv[2]);
+    int pid = atoi(argv[3]);
+    int threads = (argc > 4) ? atoi(argv[4]) : 2;
+    int per = (argc > 5) ? atoi(argv[5]) : 16;
+    int window = (argc > 6) ? atoi(argv[6]) : 64;
+    int secs = (argc > 7) ? atoi(argv[7]) : 3;
+    if (threads < 1) threads = 1;
+    if (per < 1) per = 1;
+    if (window < 1) window = 1;
+    if (window > WINDOW_MAX) window = WINDOW_MAX;
+    if (secs < 1) secs = 1;
+
+    printf("%d threads x %d sockets, window %d, %d-byte payloads, %d s per mode\n\n", threads, per, window, PAYLOAD,
+           secs);
+    printf("%-8s %12s %12s %10s %14s %14s\n", "mode", "msgs/s", "dgrams/s", "lost", "server_ns/msg",
+           "client_ns/msg");
+    u32 next_user = 1;
+    for (int mode = 0; mode < MODES; mode++) {
+        if (run(mode, pid, threads, per, window, secs, &next_user)) return 1;
+    }
+    return 0;
+}
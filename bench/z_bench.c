@@ -0,0 +1,327 @@
+// bench/z_bench.c
+// Payload compression (dbin/compress.h) on chat-like messages: bytes saved
+// and CPU per message for dbin_encode_z/dbin_decode_z against plain
+// dbin_encode/dbin_decode, by payload size, with the built-in dictionary
+// and without one. The corpus is generated (short chat lines, some longer
+// pastes and log excerpts); -f reads one message per line from a file.
+// Build:
+//   make z-bench
+// Run (or `make zbench`):
+//   ./z-bench [-n messages] [-m min_len] [-f corpus.txt]
+
+#include "dbin/protocol.h"
+#include "dbin/codec.h"
+#include "dbin/compress.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_MSGS   100000
+#define NBUCKETS   5
+#define MIN_NS     20000000ull // time each row for at least this long
+#define HDR_BYTES  12          // dBIN/1 header
+
+static const u16 bucket_max[NBUCKETS] = { 24, 64, 256, 1024, DBIN_MAX_MSG_LEN };
+
+typedef struct corpus {
+    u8   *text;     // all payloads back to back
+    u32  *off;
+    u16  *len;
+    u32   n;
+} corpus_t;
+
+static u64 now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+}
+
+static u32 xorshift(u32 *s) {
+    u32 x = *s;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *s = x;
+}
+
+// ---- corpus ----
+
+static const char *const words[] = {
+    "I", "you", "the", "to", "a", "it", "and", "that", "is", "of", "in", "we", "for", "this", "on",
+    "be", "have", "not", "do", "are", "with", "was", "so", "but", "just", "can", "what", "my", "me",
+    "if", "at", "get", "all", "know", "like", "think", "now", "will", "your", "they", "there", "here",
+    "going", "want", "time", "good", "yeah", "ok", "really", "some", "about", "out", "up", "one",
+    "when", "how", "need", "should", "would", "could", "today", "tomorrow", "still", "then", "back",
+    "build", "deploy", "server", "branch", "merge", "test", "fix", "bug", "ticket", "call", "meeting",
+    "lunch", "coffee", "train", "late", "sorry", "thanks", "lol", "haha", "nice", "cool", "great",
+    "weekend", "later", "soon", "again", "maybe", "probably", "anyone", "everyone", "room", "link",
+    "Alice", "Bob", "Carol", "Dave", "Erin", "Frank", "Grace", "Heidi", "Ivan", "Judy",
+};
+#define NWORDS (sizeof(words) / sizeof(words[0]))
+
+static const char *const tails[] = {
+    "?", "!", ".", "", "", " :)", " lol", " \xF0\x9F\x98\x82", " \xF0\x9F\x91\x8D", "...", "??",
+};
+#define NTAILS (sizeof(tails) / sizeof(tails[0]))
+
+static usize put(u8 *out, usize at, usize cap, const char *s) {
+    usize k = strlen(s);
+    if (at + k > cap) k = cap - at;
+    memcpy(out + at, s, k);
+    return at + k;
+}
+
+static usize gen_sentence(u8 *out, usize at, usize cap, u32 *seed) {
+    u32 nw = 2 + xorshift(seed) % 12;
+    for (u32 w = 0; w < nw && at < cap; w++) {
+        if (w) at = put(out, at, cap, " ");
+        if (xorshift(seed) % 40 == 0) {
+            char num[16];
+            snprintf(num, sizeof(num), "%u", xorshift(seed) % 10000);
+            at = put(out, at, cap, num);
+        } else {
+            at = put(out, at, cap, words[xorshift(seed) % NWORDS]);
+        }
+    }
+    return put(out, at, cap, tails[xorshift(seed) % NTAILS]);
+}
+
+static usize gen_log(u8 *out, usize at, usize cap, u32 *seed) {
+    char line[160];
+    static const char *const lvl[] = { "INFO", "WARN", "ERROR", "DEBUG" };
+    snprintf(line, sizeof(line), "2026-10-%02u %02u:%02u:%02u %s request id=%u user=%u took %ums status=%u\n",
+             1 + xorshift(seed) % 28, xorshift(seed) % 24, xorshift(seed) % 60, xorshift(seed) % 60,
+             lvl[xorshift(seed) % 4], xorshift(seed) % 1000000, xorshift(seed) % 100000,
+             xorshift(seed) % 500, xorshift(seed) % 3 ? 200 : 500);
+    return put(out, at, cap, line);
+}
+
+// Mostly one-line messages; some multi-sentence ones, pasted links, and the
+// occasional long paste or log excerpt.
+static usize gen_msg(u8 *out, u32 *seed) {
+    usize cap = DBIN_MAX_MSG_LEN, at = 0;
+    u32 r = xorshift(seed) % 100;
+    if (r < 60) {
+        at = gen_sentence(out, 0, cap, seed);
+    } else if (r < 85) {
+        u32 k = 2 + xorshift(seed) % 5;
+        for (u32 i = 0; i < k && at < cap; i++) {
+            if (i) at = put(out, at, cap, " ");
+            at = gen_sentence(out, at, cap, seed);
+        }
+    } else if (r < 92) {
+        char url[96];
+        snprintf(url, sizeof(url), "check this out https://example.com/posts/%u?ref=chat ", xorshift(seed) % 100000);
+        at = put(out, 0, cap, url);
+        at = gen_sentence(out, at, cap, seed);
+    } else if (r < 97) {
+        u32 k = 10 + xorshift(seed) % 40;
+        for (u32 i = 0; i < k && at < cap; i++) {
+            if (i) at = put(out, at, cap, " ");
+            at = gen_sentence(out, at, cap, seed);
+        }
+    } else {
+        u32 k = 3 + xorshift(seed) % 25;
+        for (u32 i = 0; i < k && at < cap; i++) at = gen_log(out, at, cap, seed);
+    }
+    return at ? at : put(out, 0, cap, "ok");
+}
+
+static int corpus_init(corpus_t *c, u32 n, const char *path) {
+    c->text = (u8*)malloc((usize)n * 256 + DBIN_MAX_MSG_LEN * 64u);
+    c->off = (u32*)malloc(n * sizeof(*c->off));
+    c->len = (u16*)malloc(n * sizeof(*c->len));
+    if (!c->text || !c->off || !c->len) return 1;
+    usize cap = (usize)n * 256 + DBIN_MAX_MSG_LEN * 64u, at = 0;
+    c->n = 0;
+
+    if (path) {
+        FILE *f = fopen(path, "r");
+        if (!f) return 1;
+        static char line[DBIN_MAX_MSG_LEN + 2];
+        while (c->n < n && fgets(line, sizeof(line), f)) {
+            usize k = strcspn(line, "\n");
+            if (k == 0 || at + k > cap) continue;
+            memcpy(c->text + at, line, k);
+            c->off[c->n] = (u32)at;
+            c->len[c->n++] = (u16)k;
+            at += k;
+        }
+        fclose(f);
+        return c->n == 0;
+    }
+
+    u32 seed = 0xC0FFEEu;
+    while (c->n < n && at + DBIN_MAX_MSG_LEN <= cap) {
+        usize k = gen_msg(c->text + at, &seed);
+        c->off[c->n] = (u32)at;
+        c->len[c->n++] = (u16)k;
+        at += k;
+    }
+    return 0;
+}
+
+// ---- measurement ----
+
+typedef struct row {
+    u32 n;
+    u64 plain;      // payload bytes
+    u64 sent;       // payload bytes on the wire
+    u32 zipped;     // messages sent compressed
+    double enc_ns;  // per message, encode_z minus plain encode
+    double dec_ns;  // per message, decode_z minus plain decode
+} row_t;
+
+static dbin_msg_t make(const corpus_t *c, u32 i) {
+    dbin_msg_t m;
+    memset(&m, 0, sizeof(m));
+    m.magic = (u16)DBIN_MAGIC;
+    m.version = (u8)DBIN_VERSION;
+    m.type = DBIN_TYPE_MSG;
+    m.valid = 1;
+    m.is_room = 1;
+    m.user_id = 7;
+    m.route = 1000;
+    m.msg_id = (u16)i;
+    m.msg_len = c->len[i];
+    m.msg = c->text + c->off[i];
+    return m;
+}
+
+// ns per message for one pass over ids[0..n), repeated for at least MIN_NS.
+static double time_pass(const corpus_t *c, const u32 *ids, u32 n, const dbin_z_dict_t *d, usize min_len,
+                        u8 *frames, const usize *flen, int op) {
+    static u8 buf[DBIN_MAX_MSG_LEN];
+    u64 reps = 0, sink = 0, t0 = now_ns(), t;
+    do {
+        for (u32 k = 0; k < n; k++) {
+            u8 *f = frames + (usize)k * DBIN_MAX_FRAME_LEN;
+            dbin_msg_t m = make(c, ids[k]), o;
+            usize len = 0;
+            switch (op) {
+                case 0: dbin_encode(&m, f, DBIN_MAX_FRAME_LEN, &len); break;
+                case 1: dbin_encode_z(&m, d, min_len, f, DBIN_MAX_FRAME_LEN, &len); break;
+                case 2: dbin_decode(f, flen[k], &o); len = o.msg_len; break;
+                default: dbin_decode_z(f, flen[k], d, &o, buf, sizeof(buf)); len = o.msg_len; break;
+            }
+            sink += len;
+        }
+        reps++;
+        t = now_ns();
+    } while (t - t0 < MIN_NS);
+    if (sink == 0) printf(" ");
+    return (double)(t - t0) / (double)(reps * n);
+}
+
+static int run_bucket(const corpus_t *c, const u32 *ids, u32 n, const dbin_z_dict_t *d, usize min_len,
+                      u8 *frames, usize *flen, row_t *row) {
+    static u8 buf[DBIN_MAX_MSG_LEN];
+    memset(row, 0, sizeof(*row));
+    row->n = n;
+    if (n == 0) return 0;
+
+    // Sizes, and a round trip of every message.
+    for (u32 k = 0; k < n; k++) {
+        dbin_msg_t m = make(c, ids[k]), o;
+        u8 *f = frames + (usize)k * DBIN_MAX_FRAME_LEN;
+        if (dbin_encode_z(&m, d, min_len, f, DBIN_MAX_FRAME_LEN, &flen[k]) != DBIN_OK ||
+            dbin_decode_z(f, flen[k], d, &o, buf, sizeof(buf)) != DBIN_OK ||
+            o.msg_len != m.msg_len || memcmp(o.msg, m.msg, m.msg_len) != 0) {
+            fprintf(stderr, "round trip failed for message %u\n", ids[k]);
+            return 1;
+        }
+        row->plain += m.msg_len;
+        row->sent += flen[k] - HDR_BYTES;
+        row->zipped += (f[2] & 0x7) != 0; // reserved bits of the header
+    }
+
+    double enc_z = time_pass(c, ids, n, d, min_len, frames, flen, 1);
+    double dec_z = time_pass(c, ids, n, d, min_len, frames, flen, 3);
+    double enc = time_pass(c, ids, n, d, min_len, frames, flen, 0);
+    // Plain frames for the plain decode baseline.
+    for (u32 k = 0; k < n; k++) flen[k] = HDR_BYTES + c->len[ids[k]];
+    double dec = time_pass(c, ids, n, d, min_len, frames, flen, 2);
+    row->enc_ns = enc_z - enc;
+    row->dec_ns = dec_z - dec;
+    return 0;
+}
+
+static void print_row(const char *name, const row_t *r) {
+    if (r->n == 0) return;
+    printf("%-10s %7u %10llu %10llu %6.1f%% %6.1f%% %10.1f %10.1f\n", name, r->n,
+           (unsigned long long)r->plain, (unsigned long long)r->sent,
+           r->plain ? 100.0 * (1.0 - (double)r->sent / (double)r->plain) : 0.0,
+           100.0 * r->zipped / r->n, r->enc_ns, r->dec_ns);
+}
+
+int main(int argc, char **argv) {
+    u32 n = 20000;
+    usize min_len = DBIN_Z_MIN_LEN;
+    const char *path = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:m:f:")) != -1) {
+        switch (opt) {
+            case 'n': n = (u32)atoi(optarg); break;
+            case 'm': min_len = (usize)atoi(optarg); break;
+            case 'f': path = optarg; break;
+            default:
+                fprintf(stderr, "usage: %s [-n messages] [-m min_len] [-f corpus.txt]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (n == 0 || n > MAX_MSGS) n = MAX_MSGS;
+
+    corpus_t c;
+    if (corpus_init(&c, n, path)) {
+        fprintf(stderr, "no corpus\n");
+        return 1;
+    }
+
+    u32 *ids = (u32*)malloc(c.n * sizeof(*ids));
+    u8 *frames = (u8*)malloc((usize)c.n * DBIN_MAX_FRAME_LEN);
+    usize *flen = (usize*)malloc(c.n * sizeof(*flen));
+    if (!ids || !frames || !flen) return 1;
+
+    dbin_z_dict_t dict;
+    dbin_z_dict_init(&dict, 0, 0);
+    printf("%u messages (%s), %zu-byte dictionary, threshold %zu bytes\n", c.n,
+           path ? path : "generated", dict.len, min_len);
+
+    for (int with_dict = 1; with_dict >= 0; with_dict--) {
+        const dbin_z_dict_t *d = with_dict ? &dict : 0;
+        printf("\n%s\n%-10s %7s %10s %10s %7s %7s %10s %10s\n",
+               with_dict ? "built-in dictionary" : "no dictionary",
+               "payload", "msgs", "plain_B", "sent_B", "saved", "zipped", "enc_ns+", "dec_ns+");
+
+        row_t all;
+        memset(&all, 0, sizeof(all));
+        double enc_total = 0, dec_total = 0;
+        for (int b = 0; b < NBUCKETS; b++) {
+            u16 lo = b ? bucket_max[b - 1] + 1 : 1;
+            u32 k = 0;
+            for (u32 i = 0; i < c.n; i++) {
+                if (c.len[i] >= lo && c.len[i] <= bucket_max[b]) ids[k++] = i;
+            }
+            row_t r;
+            if (run_bucket(&c, ids, k, d, min_len, frames, flen, &r)) return 1;
+            char name[24];
+            snprintf(name, sizeof(name), "%u-%u", lo, bucket_max[b]);
+            print_row(name, &r);
+            all.n += r.n;
+            all.plain += r.plain;
+            all.sent += r.sent;
+            all.zipped += r.zipped;
+            enc_total += r.enc_ns * r.n;
+            dec_total += r.dec_ns * r.n;
+        }
+        all.enc_ns = enc_total / all.n;
+        all.dec_ns = dec_total / all.n;
+        print_row("all", &all);
+    }
+    printf("\nsaved: payload bytes not sent; zipped: messages sent compressed;\n"
+           "enc_ns+/dec_ns+: CPU per message over plain dbin_encode/dbin_decode\n");
+    return 0;
+}
@@ -1,14 +1,21 @@
 // examples/client.c
 // Build:
-//   gcc -O2 -Wall -Wextra -Iinclude examples/00_socket/client.c src/bitio.c src/codec.c -o client
+//   gcc -O2 -Wall -Wextra -pthread -Iinclude examples/00_socket/client.c src/bitio.c src/codec.c src/batch.c src/stream.c src/ack.c src/hist.c -o client
 // Run:
 //   ./client 127.0.0.1 9000 1000
-// (last arg = number of pings)
+// (last arg = number of pings; each waits for its ACK)
+//   ./client 127.0.0.1 9000 200000 1 4 16 64 256
+// (pipelined: 200000 messages at each window size, i.e. messages in flight)
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <time.h>
 #include <sys/time.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
@@ -18,11 +25,18 @@
 #include "dbin/protocol.h"
 #include "dbin/dbin.h"
 #include "dbin/codec.h"
-
-static u64 now_us(void) {
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    return (u64)tv.tv_sec * 1000000ull + (u64)tv.tv_usec;
+#include "dbin/batch.h"
+#include "dbin/stream.h"
+#include "dbin/ack.h"
+#include "dbin/hist.h"
+
+#define HIST_SUB_BITS 10  // round trips to within 0.1%
+#define BURST_MAX     64  // messages the pipelined sender encodes per send()
+
+static u64 now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
 }
 
 static int send_all(int fd, const u8 *buf, usize len) {
@@ -38,41 +52,22 @@ static int send_all(int fd, const u8 *buf, usize len) {
     return 0;
 }
 
-static int recv_all(int fd, u8 *buf, usize len) {
-    while (len > 0) {
-        ssize_t n = recv(fd, buf, (size_t)len, 0);
-        if (n == 0) return 1;
+// Receive until the stream holds one complete frame.
+static int read_frame(int fd, dbin_stream_t *in, dbin_msg_t *out) {
+    for (;;) {
+        int rc = dbin_stream_next(in, out, 0);
+        if (rc != DBIN_ERR_AGAIN) return rc;
+
+        usize avail = 0;
+        u8 *w = dbin_stream_wbuf(in, &avail);
+        ssize_t n = recv(fd, w, (size_t)avail, 0);
+        if (n == 0) return -1;
         if (n < 0) {
             if (errno == EINTR) continue;
-            return 1;
+            return -1;
         }
-        buf += (usize)n;
-        len -= (usize)n;
+        dbin_stream_commit(in, (usize)n);
     }
-    return 0;
-}
-
-static int read_frame(int fd, u8 *payload, usize cap, usize *out_len) {
-    u8 len2[2];
-    if (recv_all(fd, len2, 2)) return 1;
-
-    u16 n = (u16)((len2[0] << 8) | len2[1]);
-    if ((usize)n > cap) return 1;
-
-    if (recv_all(fd, payload, (usize)n)) return 1;
-    *out_len = (usize)n;
-    return 0;
-}
-
-static int write_frame(int fd, const u8 *payload, usize payload_len) {
-    if (payload_len > 65535u) return 1;
-    u8 len2[2];
-    len2[0] = (u8)((payload_len >> 8) & 0xFF);
-    len2[1] = (u8)(payload_len & 0xFF);
-
-    if (send_all(fd, len2, 2)) return 1;
-    if (send_all(fd, payload, payload_len)) return 1;
-    return 0;
 }
 
 static int connect_to(const char *ip, int port) {
@@ -91,29 +86,198 @@ static int connect_to(const char *ip, int port) {
     return fd;
 }
 
-static void sort_u64(u64 *a, usize n) {
-    // simple insertion sort (no libc qsort)
-    for (usize i = 1; i < n; i++) {
-        u64 key = a[i];
-        usize j = i;
-        while (j > 0 && a[j - 1] > key) {
-            a[j] = a[j - 1];
-            j--;
+static u64 hist_counts[DBIN_HIST_BUCKETS(HIST_SUB_BITS)];
+
+static double pct_us(const dbin_hist_t *h, double pct) {
+    return (double)dbin_hist_percentile(h, pct) / 1e3;
+}
+
+// ---- pipelined mode ----
+
+// One window-size run. The sender and the receiver run on their own threads;
+// `credits` holds the free window slots.
+typedef struct pipe_run {
+    int   fd;
+    u64   count;
+    sem_t credits;
+    _Atomic int stop;
+
+    // In-flight table: send time of every outstanding msg_id, 0 = not in
+    // flight. The window never exceeds half the id space, so an id is reused
+    // only after its previous use was acknowledged.
+    _Atomic u64 *sent_ns;
+    u16   next_id;        // sender side; carries over between runs
+
+    // Receiver side.
+    dbin_stream_t in;
+    u64   acked;
+    u16   expect;         // id that would be acknowledged next in order
+    u64   out_of_order;
+    u64   tx_bytes;
+    u64   rx_bytes;
+    dbin_hist_t rtt;      // round trips, ns
+} pipe_run_t;
+
+static void *pipe_sender(void *arg) {
+    pipe_run_t *p = (pipe_run_t*)arg;
+    static const u8 payload[] = "ping";
+    u8 buf[BURST_MAX * 32];
+    dbin_arena_t out;
+    dbin_arena_init(&out, buf, (usize)sizeof(buf));
+
+    dbin_msg_t m;
+    memset(&m, 0, sizeof(m));
+    m.magic = (u16)DBIN_MAGIC;
+    m.version = (u8)DBIN_VERSION;
+    m.type = (u8)DBIN_TYPE_MSG;
+    m.valid = 1;
+    m.is_room = 1;
+    m.user_id = 123;
+    m.route = 77;
+    m.msg_len = (u16)(sizeof(payload) - 1);
+    m.msg = payload;
+
+    u64 sent = 0;
+    while (sent < p->count) {
+        // One slot is needed; take whatever else is free right now too.
+        while (sem_wait(&p->credits) != 0 && errno == EINTR) {}
+        u64 k = 1;
+        while (k < BURST_MAX && sent + k < p->count && sem_trywait(&p->credits) == 0) k++;
+        if (atomic_load(&p->stop)) break;
+
+        dbin_arena_reset(&out);
+        u64 now = now_ns();
+        for (u64 i = 0; i < k; i++) {
+            m.msg_id = p->next_id++;
+            atomic_store_explicit(&p->sent_ns[m.msg_id], now, memory_order_release);
+            usize done = 0;
+            dbin_encode_batch(&m, 1, &out, 0, &done);
+        }
+        if (send_all(p->fd, out.buf, out.len)) {
+            atomic_store(&p->stop, 1);
+            break;
+        }
+        p->tx_bytes += out.len;
+        sent += k;
+    }
+    return NULL;
+}
+
+static void ack_id(pipe_run_t *p, u16 id, u64 now) {
+    u64 t = atomic_exchange_explicit(&p->sent_ns[id], 0, memory_order_acquire);
+    if (t == 0) return; // not in flight: a repeated or stray ACK
+
+    if (id != p->expect) p->out_of_order++;
+    p->expect = (u16)(id + 1);
+    p->acked++;
+
+    dbin_hist_record(&p->rtt, now - t);
+    sem_post(&p->credits);
+}
+
+// Acknowledge every in-flight id a (range) ACK covers, oldest first.
+static void on_ack(pipe_run_t *p, const dbin_msg_t *ack) {
+    u64 now = now_ns();
+    if (ack->type == DBIN_TYPE_ACK) {
+        ack_id(p, ack->msg_id, now);
+        return;
+    }
+    for (u32 i = ack->route; i-- > 0;) ack_id(p, (u16)(ack->msg_id - i), now);
+    for (u32 i = 0; i < (u32)ack->msg_len * 8; i++) {
+        if ((ack->msg[i / 8] >> (i % 8)) & 1) ack_id(p, (u16)(ack->msg_id + 1 + i), now);
+    }
+}
+
+static int run_window(pipe_run_t *p, int window) {
+    p->acked = 0;
+    p->out_of_order = 0;
+    p->tx_bytes = p->rx_bytes = 0;
+    dbin_hist_reset(&p->rtt);
+    p->expect = p->next_id;
+    atomic_store(&p->stop, 0);
+    if (sem_init(&p->credits, 0, (unsigned)window) != 0) return 1;
+
+    u64 t0 = now_ns();
+    pthread_t tx;
+    if (pthread_create(&tx, NULL, pipe_sender, p) != 0) return 1;
+
+    int rc = 0;
+    while (p->acked < p->count) {
+        dbin_msg_t ack;
+        rc = read_frame(p->fd, &p->in, &ack);
+        if (rc < 0) break;
+        if (p->in.err != DBIN_OK) {
+            // Bad length prefix: the stream cannot resync, and the error sticks.
+            printf("[client] stream error: %d\n", p->in.err);
+            break;
         }
-        a[j] = key;
+        p->rx_bytes += DBIN_LEN_PREFIX_BYTES + p->in.frame_len;
+        if (rc != DBIN_OK) continue;
+        if (ack.type == DBIN_TYPE_ACK || ack.type == DBIN_TYPE_ACK_RANGE) on_ack(p, &ack);
+    }
+    double el = (double)(now_ns() - t0) / 1e9;
+
+    // Unblock the sender if the receiver gave up early.
+    atomic_store(&p->stop, 1);
+    for (int i = 0; i < window; i++) sem_post(&p->credits);
+    pthread_join(tx, NULL);
+    sem_destroy(&p->credits);
+
+    printf("%8d %12.0f %12.0f %12.0f %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %8llu\n", window,
+           (double)p->acked / el, (double)p->tx_bytes / el, (double)p->rx_bytes / el,
+           pct_us(&p->rtt, 50.0), pct_us(&p->rtt, 99.0), pct_us(&p->rtt, 99.9),
+           pct_us(&p->rtt, 99.99), pct_us(&p->rtt, 99.999), pct_us(&p->rtt, 100.0),
+           (unsigned long long)p->out_of_order);
+    fflush(stdout);
+
+    if (p->acked < p->count) {
+        printf("[client] %llu of %llu messages unacknowledged\n",
+               (unsigned long long)(p->count - p->acked), (unsigned long long)p->count);
+        return 1;
     }
+    return 0;
+}
+
+static int run_pipelined(int fd, u64 count, char **windows, int nwindows) {
+    // Give up on a stalled server instead of blocking forever.
+    struct timeval tv = { 5, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    static u8 inbuf[1 << 16];
+    pipe_run_t *p = (pipe_run_t*)calloc(1, sizeof(*p));
+    if (!p) return 1;
+    p->fd = fd;
+    p->count = count;
+    p->next_id = 1;
+    p->sent_ns = (_Atomic u64*)calloc(65536, sizeof(*p->sent_ns));
+    if (!p->sent_ns) return 1;
+    dbin_hist_init(&p->rtt, HIST_SUB_BITS, hist_counts, DBIN_HIST_BUCKETS(HIST_SUB_BITS));
+    dbin_stream_init(&p->in, inbuf, (usize)sizeof(inbuf));
+
+    printf("%8s %12s %12s %12s %9s %9s %9s %9s %9s %9s %8s\n", "window", "msgs/s", "tx_B/s", "rx_B/s",
+           "p50_us", "p99_us", "p99.9", "p99.99", "p99.999", "max_us", "ooo");
+    int rc = 0;
+    for (int i = 0; i < nwindows && rc == 0; i++) {
+        int window = atoi(windows[i]);
+        if (window < 1) window = 1;
+        if (window > DBIN_ACK_MAX_RUN) window = DBIN_ACK_MAX_RUN;
+        rc = run_window(p, window);
+    }
+
+    free((void*)p->sent_ns);
+    free(p);
+    return rc;
 }
 
 int main(int argc, char **argv) {
-    if (argc < 3 || argc > 4) {
-        fprintf(stderr, "usage: %s <ip> <port> [count]\n", argv[0]);
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s <ip> <port> [count] [window...]\n", argv[0]);
         return 1;
     }
     const char *ip = argv[1];
     int port = atoi(argv[2]);
-    int count = (argc == 4) ? atoi(argv[3]) : 1000;
+    int count = (argc > 3) ? atoi(argv[3]) : 1000;
     if (count <= 0) count = 1;
-    if (count > 20000) count = 20000;
 
     int fd = connect_to(ip, port);
     if (fd < 0) {
@@ -122,16 +286,22 @@ int main(int argc, char **argv) {
     }
     printf("[client] connected to %s:%d\n", ip, port);
 
+    if (argc > 4) {
+        int rc = run_pipelined(fd, (u64)count, argv + 4, argc - 4);
+        close(fd);
+        return rc;
+    }
+
     u8 outbuf[8192];
     u8 inbuf[8192];
+    dbin_arena_t out;
+    dbin_stream_t in;
+    dbin_arena_init(&out, outbuf, (usize)sizeof(outbuf));
+    dbin_stream_init(&in, inbuf, (usize)sizeof(inbuf));
 
-    // store RTTs
-    u64 *rtts = (u64*)malloc((size_t)count * sizeof(u64));
-    if (!rtts) {
-        fprintf(stderr, "malloc failed\n");
-        close(fd);
-        return 1;
-    }
+    // RTTs in ns; constant memory however many pings are sent.
+    dbin_hist_t rtt;
+    dbin_hist_init(&rtt, HIST_SUB_BITS, hist_counts, DBIN_HIST_BUCKETS(HIST_SUB_BITS));
 
     const u8 payload[] = "ping";
     u16 msg_id = 1;
@@ -151,27 +321,26 @@ int main(int argc, char **argv) {
         m.msg_len = (u16)(sizeof(payload) - 1);
         m.msg     = payload;
 
-        usize out_len = 0;
-        int rc = dbin_encode(&m, outbuf, (usize)sizeof(outbuf), &out_len);
+        usize done = 0;
+        dbin_arena_reset(&out);
+        int rc = dbin_encode_batch(&m, 1, &out, 0, &done);
         if (rc != DBIN_OK) {
             printf("[client] encode error: %d\n", rc);
             break;
         }
 
-        u64 t0 = now_us();
-        if (write_frame(fd, outbuf, out_len)) {
+        u64 t0 = now_ns();
+        if (send_all(fd, out.buf, out.len)) {
             printf("[client] send error\n");
             break;
         }
 
-        usize in_len = 0;
-        if (read_frame(fd, inbuf, (usize)sizeof(inbuf), &in_len)) {
+        dbin_msg_t ack;
+        rc = read_frame(fd, &in, &ack);
+        if (rc < 0) {
             printf("[client] recv error\n");
             break;
         }
-
-        dbin_msg_t ack;
-        rc = dbin_decode(inbuf, in_len, &ack);
         if (rc != DBIN_OK) {
             printf("[client] decode error: %d\n", rc);
             break;
@@ -183,31 +352,21 @@ int main(int argc, char **argv) {
             break;
         }
 
-        u64 t1 = now_us();
-        rtts[i] = t1 - t0;
+        dbin_hist_record(&rtt, now_ns() - t0);
     }
 
-    // stats
-    usize n = (usize)count;
-    // if loop broke early, you can track actual count; for simplicity assume full count here.
-    // If you want exact, increment a `sent_ok` counter and use it.
-    sort_u64(rtts, n);
+    // stats (over the pings that completed)
+    double avg_us = dbin_hist_mean(&rtt) / 1e3;
+    static const double pcts[] = { 50.0, 95.0, 99.0, 99.9, 99.99, 99.999 };
 
-    u64 sum = 0;
-    for (usize i = 0; i < n; i++) sum += rtts[i];
-
-    double avg_us = (n > 0) ? ((double)sum / (double)n) : 0.0;
-    u64 p50 = rtts[(n * 50) / 100];
-    u64 p95 = rtts[(n * 95) / 100];
-    u64 p99 = rtts[(n * 99) / 100];
-
-    printf("\nRTT stats (%lu samples)\n", (unsigned long)n);
+    printf("\nRTT stats (%llu samples)\n", (unsigned long long)rtt.total);
     printf(" avg: %.2f us (%.3f ms)\n", avg_us, avg_us / 1000.0);
-    printf(" p50: %llu us (%.3f ms)\n", (unsigned long long)p50, (double)p50 / 1000.0);
-    printf(" p95: %llu us (%.3f ms)\n", (unsigned long long)p95, (double)p95 / 1000.0);
-    printf(" p99: %llu us (%.3f ms)\n", (unsigned long long)p99, (double)p99 / 1000.0);
+    for (usize i = 0; i < sizeof(pcts) / sizeof(pcts[0]); i++) {
+        double v = pct_us(&rtt, pcts[i]);
+        printf(" p%g: %.1f us (%.3f ms)\n", pcts[i], v, v / 1000.0);
+    }
+    printf(" max: %.1f us (%.3f ms)\n", pct_us(&rtt, 100.0), pct_us(&rtt, 100.0) / 1000.0);
 
-    free(rtts);
     close(fd);
     return 0;
 }
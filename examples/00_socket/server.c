@@ -1,6 +1,6 @@
 // examples/server.c
 // Build:
-//   gcc -O2 -Wall -Wextra -Iinclude examples/00_socket/server.c src/bitio.c src/codec.c -o server
+//   gcc -O2 -Wall -Wextra -Iinclude examples/00_socket/server.c src/bitio.c src/codec.c src/batch.c src/stream.c src/ack.c -o server
 // Run:
 //   ./server 127.0.0.1 9000
 
@@ -16,6 +16,9 @@
 #include "dbin/protocol.h"
 #include "dbin/dbin.h"
 #include "dbin/codec.h"
+#include "dbin/batch.h"
+#include "dbin/stream.h"
+#include "dbin/ack.h"
 
 static int send_all(int fd, const u8 *buf, usize len) {
     while (len > 0) {
@@ -30,40 +33,19 @@ static int send_all(int fd, const u8 *buf, usize len) {
     return 0;
 }
 
-static int recv_all(int fd, u8 *buf, usize len) {
-    while (len > 0) {
-        ssize_t n = recv(fd, buf, (size_t)len, 0);
-        if (n == 0) return 1; // connection closed
-        if (n < 0) {
-            if (errno == EINTR) continue;
-            return 1;
-        }
-        buf += (usize)n;
-        len -= (usize)n;
+// Move the pending ACKs into `out`, sending it first when full.
+static int queue_ack(int fd, dbin_acker_t *acker, dbin_arena_t *out) {
+    dbin_msg_t ack;
+    dbin_acker_take(acker, &ack);
+
+    usize done = 0;
+    int rc = dbin_encode_batch(&ack, 1, out, 0, &done);
+    if (rc == DBIN_ERR_BUF) {
+        if (send_all(fd, out->buf, out->len)) return 1;
+        dbin_arena_reset(out);
+        rc = dbin_encode_batch(&ack, 1, out, 0, &done);
     }
-    return 0;
-}
-
-static int read_frame(int fd, u8 *payload, usize cap, usize *out_len) {
-    u8 len2[2];
-    if (recv_all(fd, len2, 2)) return 1;
-
-    u16 n = (u16)((len2[0] << 8) | len2[1]);
-    if ((usize)n > cap) return 1;
-
-    if (recv_all(fd, payload, (usize)n)) return 1;
-    *out_len = (usize)n;
-    return 0;
-}
-
-static int write_frame(int fd, const u8 *payload, usize payload_len) {
-    if (payload_len > 65535u) return 1;
-    u8 len2[2];
-    len2[0] = (u8)((payload_len >> 8) & 0xFF);
-    len2[1] = (u8)(payload_len & 0xFF);
-
-    if (send_all(fd, len2, 2)) return 1;
-    if (send_all(fd, payload, payload_len)) return 1;
+    if (rc != DBIN_OK) printf("[server] encode ack error: %d\n", rc);
     return 0;
 }
 
@@ -115,47 +97,55 @@ int main(int argc, char **argv) {
     printf("[server] client connected\n");
 
     u8 inbuf[8192];
-    u8 outbuf[256]; // ACK is tiny
+    u8 outbuf[8192]; // ACKs for one recv() worth of frames
+    dbin_stream_t in;
+    dbin_arena_t out;
+    dbin_acker_t acker;
+    dbin_stream_init(&in, inbuf, (usize)sizeof(inbuf));
+    dbin_arena_init(&out, outbuf, (usize)sizeof(outbuf));
+    dbin_acker_init(&acker);
 
     for (;;) {
-        usize in_len = 0;
-        if (read_frame(cfd, inbuf, (usize)sizeof(inbuf), &in_len)) {
-            printf("[server] connection closed / frame read error\n");
+        usize avail = 0;
+        u8 *w = dbin_stream_wbuf(&in, &avail);
+        ssize_t n = recv(cfd, w, (size_t)avail, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            printf("[server] connection closed / recv error\n");
             break;
         }
+        dbin_stream_commit(&in, (usize)n);
 
         dbin_msg_t msg;
-        int rc = dbin_decode(inbuf, in_len, &msg);
-        if (rc != DBIN_OK) {
-            printf("[server] decode error: %d\n", rc);
-            continue;
-        }
-
-        if (msg.type == DBIN_TYPE_MSG) {
-            dbin_msg_t ack;
-            ack.magic = (u16)DBIN_MAGIC;
-            ack.version = (u8)DBIN_VERSION;
-            ack.type = (u8)DBIN_TYPE_ACK;
-            ack.valid = 1;
-            ack.is_room = msg.is_room;
-            ack.reserved = 0;
-
-            ack.user_id = msg.user_id;
-            ack.route   = msg.route;
-            ack.msg_id  = msg.msg_id;
-            ack.msg_len = 0;
-            ack.msg = 0;
-
-            usize out_len = 0;
-            rc = dbin_encode(&ack, outbuf, (usize)sizeof(outbuf), &out_len);
+        int rc;
+        while ((rc = dbin_stream_next(&in, &msg, 0)) != DBIN_ERR_AGAIN) {
+            if (in.err != DBIN_OK) break;
             if (rc != DBIN_OK) {
-                printf("[server] encode ack error: %d\n", rc);
+                printf("[server] decode error: %d\n", rc);
                 continue;
             }
-            if (write_frame(cfd, outbuf, out_len)) {
+            if (msg.type != DBIN_TYPE_MSG) continue;
+
+            // Consecutive msg_ids share one range ACK; anything else
+            // closes the pending one.
+            if (!dbin_acker_add(&acker, &msg)) {
+                if (queue_ack(cfd, &acker, &out)) break;
+                dbin_acker_add(&acker, &msg);
+            }
+        }
+        if (in.err != DBIN_OK) {
+            printf("[server] bad frame length, closing\n");
+            break;
+        }
+
+        // All ACKs for this recv() go out in a single send.
+        if (dbin_acker_pending(&acker) && queue_ack(cfd, &acker, &out)) break;
+        if (out.len > 0) {
+            if (send_all(cfd, out.buf, out.len)) {
                 printf("[server] send error\n");
                 break;
             }
+            dbin_arena_reset(&out);
         }
     }
 
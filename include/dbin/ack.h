@@ -0,0 +1,43 @@
+#pragma once
+
+#include "dbin/types.h"
+#include "dbin/dbin.h"
+#include "dbin/protocol.h"
+
+// Range ACKs (DBIN_TYPE_ACK_RANGE, see SPEC.md): `msg_id` is the newest of a
+// run of `route` consecutive msg_ids, all acknowledged, and payload bit i
+// (byte i / 8, least significant bit first) acknowledges msg_id + 1 + i.
+// msg_id arithmetic is modulo 2^16.
+
+// Folds the ACKs owed to one sender during a tick into as few frames as it can.
+typedef struct dbin_acker {
+    u64 sack;      // bit i: last + 1 + i acknowledged
+    u32 user_id;
+    u32 route;     // of the first message, echoed when a plain ACK goes out
+    u16 last;      // newest msg_id of the run
+    u16 run;       // consecutive msg_ids ending at `last`; 0 = nothing pending
+    u8  is_room;
+    u8  bytes[DBIN_ACK_SACK_BYTES]; // payload of the frame built by dbin_acker_take
+} dbin_acker_t;
+
+void dbin_acker_init(dbin_acker_t *a);
+
+static inline int dbin_acker_pending(const dbin_acker_t *a) {
+    return a->run != 0;
+}
+
+// Owe an ACK for `m`. Returns 0 when it cannot share a frame with the ACKs
+// already pending (another user_id, a repeated msg_id, or too far from the
+// run): take those first, then add again.
+int   dbin_acker_add(dbin_acker_t *a, const dbin_msg_t *m);
+
+// Build the pending ACKs into *out and clear them: a plain ACK when they
+// cover a single msg_id, a range ACK otherwise. out->msg points into `a`
+// and stays valid until the next take.
+void  dbin_acker_take(dbin_acker_t *a, dbin_msg_t *out);
+
+// Nonzero when `ack` (ACK or range ACK) acknowledges `msg_id`.
+int   dbin_ack_covers(const dbin_msg_t *ack, u16 msg_id);
+
+// Number of msg_ids `ack` acknowledges.
+u32   dbin_ack_count(const dbin_msg_t *ack);
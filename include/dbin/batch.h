@@ -0,0 +1,52 @@
+#pragma once
+
+#include "dbin/types.h"
+#include "dbin/dbin.h"
+
+// Structure-of-arrays view of many decoded frames.
+// Every array is caller-provided and must have room for `n` entries.
+typedef struct dbin_batch {
+    u32 *user_id;
+    u32 *route;
+    u16 *msg_id;
+    u16 *msg_len;
+    u8  *type;
+    u8  *is_room;
+    u8  *reserved;      // optional (may be 0): DBIN_RESERVED_Z / _F bits (compressed, fragment)
+    const u8 **payload; // points inside frames[i] (zero-copy); 0 when msg_len == 0 or on error
+    u8  *err;           // per-frame DBIN_OK / DBIN_ERR_* (same codes as dbin_decode)
+} dbin_batch_t;
+
+// Decode frames[i] (lens[i] bytes each) into entry i of `soa`.
+// Headers are extracted several at a time with SIMD when the CPU supports it
+// (picked once at runtime); results match dbin_decode frame by frame.
+// Returns DBIN_ERR_PARAM on bad arguments, otherwise DBIN_OK; per-frame
+// failures are reported in soa->err[].
+int dbin_decode_batch(const u8 *const *frames, const usize *lens, usize n, dbin_batch_t *soa);
+
+// Name of the implementation dbin_decode_batch uses on this CPU ("avx2", "ssse3", "scalar").
+const char *dbin_decode_batch_impl(void);
+
+// Make dbin_decode_batch use the implementation named `impl` from now on, or
+// the best one for this CPU when `impl` is 0; for benchmarks and cross-checks.
+// Process-wide, not for use while other threads decode. DBIN_ERR_PARAM when
+// the name is unknown or this CPU cannot run it.
+int dbin_decode_batch_use(const char *impl);
+
+// Append-only send buffer for length-prefixed frames (see SPEC.md, "Stream framing").
+typedef struct dbin_arena {
+    u8    *buf;
+    usize  cap;
+    usize  len; // bytes used; buf[0..len) is ready to send
+} dbin_arena_t;
+
+void dbin_arena_init(dbin_arena_t *a, u8 *buf, usize cap);
+void dbin_arena_reset(dbin_arena_t *a);
+
+// Append msgs[0..n) to `a`, each as [2-byte big-endian length][frame].
+// offsets[i] (optional) receives the arena offset where message i starts.
+// *done returns how many messages were appended.
+// Returns DBIN_OK when all n fit, DBIN_ERR_BUF when the arena is full (send
+// a->buf[0..a->len), reset, and resume from msgs + *done), or the
+// dbin_validate error of msgs[*done]. Nothing is written for the failing message.
+int dbin_encode_batch(const dbin_msg_t *msgs, usize n, dbin_arena_t *a, usize *offsets, usize *done);
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "dbin/types.h"
+#include "dbin/dbin.h"
+
+// Capture files: an append-only log of received dBIN frames with arrival
+// times and connection ids, for replaying real traffic offline. All integers
+// are big-endian.
+//
+//   header  (24 B)  "DBCP", u16 version, u16 0, u32 source, u32 0, u64 base_ns
+//   record  (14 B + frame)  u64 ts_ns, u32 conn_id, u16 frame_len, frame
+//   ...
+//   index   (16 B each)  u64 ts_ns, u64 file offset of the first record at ts_ns
+//   trailer (24 B)  u64 index offset, u64 records, u32 index entries, "DBIX"
+//
+// ts_ns counts from the start of the capture and never decreases within a
+// file; base_ns is the wall-clock time of that start. `source` names the
+// writer (a server shard); files from one capture share the same clock, so
+// they merge by ts_ns. A file without a trailer (writer killed) still reads
+// up to its last whole record, only without the index.
+
+#define DBIN_CAP_VERSION       1
+#define DBIN_CAP_HEADER_BYTES  24
+#define DBIN_CAP_REC_BYTES     14
+#define DBIN_CAP_INDEX_BYTES   16
+#define DBIN_CAP_TRAILER_BYTES 24
+#define DBIN_CAP_INDEX_NS      10000000ull // default index spacing, 10 ms of capture time
+
+typedef struct dbin_cap_index {
+    u64 ts_ns;
+    u64 offset;
+} dbin_cap_index_t;
+
+// Builds records into caller buffers; the caller writes them out in order.
+// Index entries are kept in caller-provided storage; when it fills, every
+// other entry is dropped and the spacing doubles, so memory stays fixed.
+typedef struct dbin_cap_writer {
+    u64 offset;        // file offset of the next record
+    u64 records;
+    u64 every_ns;      // index spacing
+    u64 next_index_ns; // next record at or after this gets an entry
+    dbin_cap_index_t *index;
+    u32 nindex;
+    u32 index_cap;
+} dbin_cap_writer_t;
+
+// Start a capture: hdr[0..DBIN_CAP_HEADER_BYTES) receives the file header.
+// `index` holds index_cap >= 2 entries.
+int   dbin_cap_writer_init(dbin_cap_writer_t *w, dbin_cap_index_t *index, u32 index_cap,
+                           u32 source, u64 base_ns, u8 *hdr);
+
+// Append one record to out[0..cap); *n returns its size. DBIN_ERR_BUF when
+// it does not fit (write out what you have and retry), DBIN_ERR_RANGE for a
+// frame above DBIN_MAX_FRAME_LEN.
+int   dbin_cap_append(dbin_cap_writer_t *w, u64 ts_ns, u32 conn_id,
+                      const u8 *frame, usize len, u8 *out, usize cap, usize *n);
+
+// Bytes dbin_cap_finish will produce.
+usize dbin_cap_footer_bytes(const dbin_cap_writer_t *w);
+
+// Index and trailer, written after the last record.
+int   dbin_cap_finish(dbin_cap_writer_t *w, u8 *out, usize cap, usize *n);
+
+typedef struct dbin_cap_rec {
+    u64       ts_ns;
+    u32       conn_id;
+    u16       frame_len;
+    const u8 *frame;   // points into the capture buffer
+} dbin_cap_rec_t;
+
+// Reads a whole capture held in memory (typically mmap'd); no copies.
+typedef struct dbin_cap_reader {
+    const u8 *buf;
+    usize     len;
+    usize     end;     // records stop here (the index offset, or len)
+    usize     pos;
+    const u8 *index;   // nindex raw entries, 0 without a trailer
+    u32       nindex;
+    u64       records; // from the trailer; 0 when unknown
+    u32       source;
+    u64       base_ns;
+} dbin_cap_reader_t;
+
+// DBIN_ERR_MAGIC / DBIN_ERR_VER for a bad header, DBIN_ERR_FMT for a trailer
+// that points outside the file.
+int   dbin_cap_open(dbin_cap_reader_t *r, const u8 *buf, usize len);
+
+// Next record. DBIN_ERR_AGAIN at the end, DBIN_ERR_FMT when the file ends
+// inside a record.
+int   dbin_cap_next(dbin_cap_reader_t *r, dbin_cap_rec_t *out);
+
+// Position at the first record with ts_ns >= `ts_ns`: a binary search of
+// the index, then a scan of at most one index interval (the whole file
+// without an index). A truncated tail ends the scan; dbin_cap_next reports it.
+int   dbin_cap_seek(dbin_cap_reader_t *r, u64 ts_ns);
@@ -9,7 +9,8 @@ enum dbin_err {
     DBIN_ERR_BUF   = 3,
     DBIN_ERR_MAGIC = 4,
     DBIN_ERR_VER   = 5,
-    DBIN_ERR_FMT   = 6
+    DBIN_ERR_FMT   = 6,
+    DBIN_ERR_AGAIN = 7  // not enough input yet (stream decoding)
 };
 
 int   dbin_validate(const dbin_msg_t *m);
@@ -23,5 +24,30 @@ usize dbin_encoded_size(const dbin_msg_t *m);
 // Encode message into `out`. `out_len` returns total bytes written.
 int   dbin_encode(const dbin_msg_t *m, u8 *out, usize cap, usize *out_len);
 
+// Encode only the header of `m` (msg_len as given) into `out`; the payload is
+// left to the caller, e.g. as its own iovec (see dbin/iov.h). `out_len`
+// returns DBIN_HEADER_V1_BYTES.
+int   dbin_encode_header(const dbin_msg_t *m, u8 *out, usize cap, usize *out_len);
+
 // Decode from `in`. `out->msg` will point inside `in` (zero-copy) when applicable.
 int   dbin_decode(const u8 *in, usize in_len, dbin_msg_t *out);
+
+// Envelopes (DBIN_TYPE_ENV, see SPEC.md): several MSGs from one user_id in a
+// single frame, each header after the first coded as small deltas.
+
+// Pack a prefix of msgs[0..n) into one envelope frame: the messages that
+// share msgs[0]'s user_id, is_room and valid, up to DBIN_ENV_MAX_MSGS and as
+// many as fit one frame and `cap`. *done returns how many went in; call again
+// from msgs + *done for the rest. Fails only on msgs[0]: its dbin_validate
+// error, DBIN_ERR_FMT when it is not a plain MSG, DBIN_ERR_BUF when it does
+// not fit. A single message is smaller sent with dbin_encode.
+int   dbin_encode_env(const dbin_msg_t *msgs, usize n, u8 *out, usize cap, usize *out_len, usize *done);
+
+// Expand a decoded envelope into out[0..*n) as plain MSGs whose `msg` point
+// into env->msg (zero-copy). DBIN_ERR_BUF with *n set to the count when `cap`
+// is too small (DBIN_ENV_MAX_MSGS always suffices), DBIN_ERR_FMT for a
+// malformed body.
+int   dbin_env_split(const dbin_msg_t *env, dbin_msg_t *out, usize cap, usize *n);
+
+// dbin_decode followed by dbin_env_split.
+int   dbin_decode_env(const u8 *in, usize in_len, dbin_msg_t *out, usize cap, usize *n);
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "dbin/types.h"
+#include "dbin/dbin.h"
+
+// Optional MSG payload compression (SPEC.md, "Compressed payloads").
+//
+// A MSG with reserved bit DBIN_RESERVED_Z set carries an LZ-compressed
+// payload; msg_len is the compressed size. Matches may reach back into a
+// static dictionary of common chat text shared by both ends, so even short
+// messages find something to match. The format is a series of sequences:
+//
+//   token    u8: literal count (high 4 bits), match length - 4 (low 4 bits);
+//            15 in either means extra bytes follow, each added, until one is < 255
+//   literals
+//   offset   u16 big-endian, distance back from the current output position
+//            into dictionary + output; omitted after the last literals
+//
+// Nothing here allocates: the encoder's match table and the decoder's output
+// are caller storage. Every `d` may be NULL for no dictionary, which both
+// ends must then agree on.
+
+#define DBIN_Z_MIN_LEN    24    // payloads shorter than this are sent plain by default
+#define DBIN_Z_MIN_MATCH  4
+#define DBIN_Z_HASH_BITS  11
+#define DBIN_Z_DICT_MAX   32768 // dictionary + payload must stay within 16-bit offsets
+
+// A dictionary prepared for encoding: its bytes and where each 4-byte run
+// was last seen. The decoder only needs the bytes.
+typedef struct dbin_z_dict {
+    const u8 *bytes;
+    usize     len;
+    u16       table[1u << DBIN_Z_HASH_BITS]; // position + 1; 0 = none
+} dbin_z_dict_t;
+
+// The protocol's built-in dictionary.
+extern const u8    dbin_z_default_dict[];
+extern const usize dbin_z_default_dict_len;
+
+// Index `bytes` (the built-in dictionary when NULL). DBIN_ERR_RANGE above
+// DBIN_Z_DICT_MAX. `bytes` must outlive `d`.
+int   dbin_z_dict_init(dbin_z_dict_t *d, const u8 *bytes, usize len);
+
+// Compress src[0..n) into out[0..cap). DBIN_ERR_BUF when the result would
+// not fit, which with cap < n means "not worth it: send it plain".
+int   dbin_z_compress(const dbin_z_dict_t *d, const u8 *src, usize n, u8 *out, usize cap, usize *out_len);
+
+// Expand src[0..n) into out[0..cap). DBIN_ERR_FMT for a malformed stream or
+// an offset before the dictionary, DBIN_ERR_BUF when out is too small.
+int   dbin_z_decompress(const dbin_z_dict_t *d, const u8 *src, usize n, u8 *out, usize cap, usize *out_len);
+
+// dbin_encode, compressing the payload of a MSG with at least `min_len`
+// bytes when that makes it smaller. Either way the frame needs no more than
+// dbin_encoded_size(m) bytes; `cap` must allow that much.
+int   dbin_encode_z(const dbin_msg_t *m, const dbin_z_dict_t *d, usize min_len,
+                    u8 *out, usize cap, usize *out_len);
+
+// dbin_decode, expanding a compressed payload into buf[0..cap)
+// (DBIN_MAX_MSG_LEN bytes always suffice): out->msg then points into buf,
+// out->msg_len is the plain length and DBIN_RESERVED_Z is cleared. Plain
+// payloads stay zero-copy views into `in`.
+int   dbin_decode_z(const u8 *in, usize in_len, const dbin_z_dict_t *d,
+                    dbin_msg_t *out, u8 *buf, usize cap);
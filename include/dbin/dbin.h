@@ -9,7 +9,7 @@ typedef struct dbin_msg {
     _Bool valid;    // 1 bit on wire
     _Bool is_room;  // 1 bit on wire
 
-    u8  reserved;   // uses only 3 bits (must be 0 for v1)
+    u8  reserved;   // uses only 3 bits: DBIN_RESERVED_Z, DBIN_RESERVED_F or 0
 
     u32 user_id;    // uses only 20 bits (0..(2^20-1))
     u32 route;      // uses only 20 bits (room_id or to_user_id)
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "dbin/types.h"
+
+// Duplicate detection over one sender's msg_ids: the newest msg_id seen and
+// a bitmap of the DBIN_DEDUP_WINDOW ids ending at it, packed in one u64 so
+// a table of them can be updated with a single compare-and-swap.
+//
+//   bits 63..48  newest msg_id
+//   bits 47..0   bit i: newest - i seen (bit 0 is the newest itself)
+//
+// 0 is an empty window. msg_id arithmetic is modulo 2^16: an id up to
+// 0x7FFF ahead of the newest moves the window forward. An id more than
+// DBIN_DEDUP_WINDOW - 1 behind cannot be checked: it is reported as new and
+// leaves the window unchanged, so late frames (reordered, or from another
+// connection of the same sender) are never dropped and never move the
+// window back. Only an id whose bit is set counts as a duplicate. A sender
+// that starts a new run of ids (e.g. after a restart) needs a cleared window.
+typedef u64 dbin_dedup_t;
+
+#define DBIN_DEDUP_WINDOW 48
+
+// Window `w` after seeing `msg_id`; *dup is set to 1 when it was already
+// seen (the window is then unchanged), 0 otherwise.
+dbin_dedup_t dbin_dedup_step(dbin_dedup_t w, u16 msg_id, int *dup);
+
+// Record `msg_id` in *w. Returns 1 for a duplicate, 0 for a new id.
+static inline int dbin_dedup_add(dbin_dedup_t *w, u16 msg_id) {
+    int dup;
+    *w = dbin_dedup_step(*w, msg_id, &dup);
+    return dup;
+}
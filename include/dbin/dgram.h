@@ -0,0 +1,25 @@
+#pragma once
+
+#include "dbin/types.h"
+#include "dbin/dbin.h"
+#include "dbin/protocol.h"
+
+// Datagram framing (SPEC.md, "Datagrams"): one or more frames back to back
+// with no length prefix, each delimited by its own msg_len, optionally
+// followed by zero bytes of padding.
+
+// Frames packed into one datagram by default: a 1500-byte MTU less the IPv4
+// and UDP headers. A larger frame travels alone in a datagram of its own.
+#define DBIN_DGRAM_MAX_BYTES 1472
+
+// Decode the frame at d[*off..len) in place (m->msg points into `d`) and
+// advance *off past it; *frame and *frame_len give its bytes. Returns
+// DBIN_ERR_AGAIN at the end of the datagram or at padding. A frame that
+// fails validation but whose length is known is skipped with its error
+// code; a frame running past the end (DBIN_ERR_BUF) or a bad magic/version
+// ends the datagram, and *frame is not set.
+int   dbin_dgram_next(const u8 *d, usize len, usize *off, dbin_msg_t *m, const u8 **frame, usize *frame_len);
+
+// Append `m` to the datagram d[0..*len), at most `cap` bytes in all.
+// DBIN_ERR_BUF when it does not fit, the dbin_validate error when invalid.
+int   dbin_dgram_add(u8 *d, usize cap, usize *len, const dbin_msg_t *m);
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "dbin/types.h"
+#include "dbin/dbin.h"
+#include "dbin/protocol.h"
+
+// Fragmented payloads (SPEC.md, "Fragments"): a payload of up to 4 GiB - 1
+// bytes sent as MSG frames with DBIN_RESERVED_F set, each starting with
+//
+//   total   u32 big-endian, size of the whole payload
+//   offset  u32 big-endian, where this fragment's data goes
+//
+// Fragments of one payload travel in order on one connection and take
+// consecutive msg_ids, so ACKs cover them as usual. A payload is identified
+// by its sender, destination and is_room: each sender has at most one
+// fragmented payload in flight per destination.
+
+#define DBIN_FRAG_HDR_BYTES   8
+#define DBIN_FRAG_MAX_DATA    (DBIN_MAX_MSG_LEN - DBIN_FRAG_HDR_BYTES)
+// Frame header plus fragment header: what precedes the data of each fragment.
+#define DBIN_FRAG_HEAD_BYTES  (12 + DBIN_FRAG_HDR_BYTES)
+#define DBIN_FRAG_RX_SLOTS    4     // payloads one receiver reassembles at a time
+
+// ---- sending ----
+
+// Splits data[0..total) into fragments without copying it: each call to
+// dbin_frag_tx_next yields the fragment's frame and fragment headers plus a
+// view of its data, ready for writev (or dbin_frag_tx_encode to copy both).
+typedef struct dbin_frag_tx {
+    dbin_msg_t m;       // header of the next fragment; m.msg_id advances per fragment
+    const u8  *data;
+    u32        total;
+    u32        off;     // data sent so far
+    u32        chunk;   // data bytes per fragment
+} dbin_frag_tx_t;
+
+// `m` gives user_id, route, is_room, valid and the first msg_id. `chunk` is
+// the data per fragment, 1..DBIN_FRAG_MAX_DATA (0 for the maximum).
+// DBIN_ERR_RANGE for an empty payload or one of 4 GiB or more.
+int   dbin_frag_tx_init(dbin_frag_tx_t *t, const dbin_msg_t *m, const u8 *data, usize total, usize chunk);
+
+static inline int dbin_frag_tx_done(const dbin_frag_tx_t *t) {
+    return t->off == t->total;
+}
+
+// Next fragment: head[0..DBIN_FRAG_HEAD_BYTES) then data[0..*data_len) make
+// up its frame. DBIN_ERR_PARAM once done.
+int   dbin_frag_tx_next(dbin_frag_tx_t *t, u8 *head, const u8 **data, usize *data_len);
+
+// dbin_frag_tx_next, copied into one frame at `out`.
+int   dbin_frag_tx_encode(dbin_frag_tx_t *t, u8 *out, usize cap, usize *out_len);
+
+// ---- receiving ----
+
+// One fragment as handed back by dbin_frag_rx_push.
+typedef struct dbin_frag {
+    u32        user_id;
+    u32        route;
+    u8         is_room;
+    u8         first;   // offset 0: a new payload
+    u8         last;    // the payload is complete
+    u8         slot;    // reassembly slot, for dbin_frag_rx_set_dst / _drop
+    u32        total;
+    u32        offset;
+    const u8  *data;    // zero-copy view into the frame
+    usize      len;
+} dbin_frag_t;
+
+typedef struct dbin_frag_slot {
+    u32  user_id;
+    u32  route;
+    u8   is_room;
+    u8   busy;
+    u32  total;
+    u32  next;          // offset the next fragment must have
+    u8  *dst;           // reassembly target, total bytes; 0 = stream only
+} dbin_frag_slot_t;
+
+// Reassembly state for one connection: a fixed number of slots, so memory
+// does not grow with payload size or with how many payloads a peer starts.
+typedef struct dbin_frag_rx {
+    dbin_frag_slot_t slot[DBIN_FRAG_RX_SLOTS];
+    u32 max_total;      // larger payloads are refused with DBIN_ERR_RANGE
+} dbin_frag_rx_t;
+
+void  dbin_frag_rx_init(dbin_frag_rx_t *rx, u32 max_total);
+
+// Account for a decoded fragment `m` (F set; expand a compressed one first)
+// and describe it in *f. Fragments may be consumed straight from f->data; a
+// slot with a destination also copies them there, so f->last means the whole
+// payload is in place. DBIN_ERR_FMT for a bad fragment header or one out of
+// order (its payload is dropped), DBIN_ERR_RANGE above max_total,
+// DBIN_ERR_BUF when a new payload finds every slot busy.
+int   dbin_frag_rx_push(dbin_frag_rx_t *rx, const dbin_msg_t *m, dbin_frag_t *f);
+
+// Reassemble the payload of first fragment `f` into dst[0..f->total), this
+// fragment included.
+void  dbin_frag_rx_set_dst(dbin_frag_rx_t *rx, const dbin_frag_t *f, u8 *dst);
+
+// Abandon the payload `f` belongs to.
+void  dbin_frag_rx_drop(dbin_frag_rx_t *rx, const dbin_frag_t *f);
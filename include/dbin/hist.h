@@ -0,0 +1,54 @@
+#pragma once
+
+#include "dbin/types.h"
+#include "dbin/dbin.h"
+
+// Log-linear latency histogram in the style of HdrHistogram: fixed memory,
+// O(1) recording, percentiles to within a relative error of 2^-sub_bits
+// over the whole u64 range.
+//
+// Values below 2^sub_bits are counted exactly; every power of two above
+// that is split into 2^sub_bits equal buckets. sub_bits = 7 keeps values to
+// 0.8% in 59 KiB of counts, sub_bits = 10 to 0.1% in 440 KiB.
+
+#define DBIN_HIST_SUB_BITS_MAX 16
+
+// Counts a histogram of the given precision needs.
+#define DBIN_HIST_BUCKETS(sub_bits) ((usize)(65 - (sub_bits)) << (sub_bits))
+
+typedef struct dbin_hist {
+    u64  *counts;     // DBIN_HIST_BUCKETS(sub_bits) entries, caller-provided
+    u32   sub_bits;
+    u64   total;      // values recorded
+    u64   min;
+    u64   max;
+    u64   sum;        // for the mean; wraps only past 2^64 in total
+} dbin_hist_t;
+
+// `counts` must hold at least DBIN_HIST_BUCKETS(sub_bits) entries
+// (DBIN_ERR_BUF otherwise); sub_bits is 1..DBIN_HIST_SUB_BITS_MAX.
+int    dbin_hist_init(dbin_hist_t *h, u32 sub_bits, u64 *counts, usize n);
+void   dbin_hist_reset(dbin_hist_t *h);
+
+static inline usize dbin_hist_index(u32 sub_bits, u64 v) {
+    if (v < (1ull << sub_bits)) return (usize)v;
+    u32 shift = 63u - (u32)__builtin_clzll(v) - sub_bits;
+    return ((usize)(shift + 1) << sub_bits) | (usize)((v >> shift) & ((1ull << sub_bits) - 1));
+}
+
+static inline void dbin_hist_record(dbin_hist_t *h, u64 v) {
+    h->counts[dbin_hist_index(h->sub_bits, v)]++;
+    if (v < h->min) h->min = v;
+    if (v > h->max) h->max = v;
+    h->sum += v;
+    h->total++;
+}
+
+// Add `src` into `dst` (e.g. per-thread histograms into one). Both must
+// have the same sub_bits; DBIN_ERR_PARAM otherwise.
+int    dbin_hist_merge(dbin_hist_t *dst, const dbin_hist_t *src);
+
+// Smallest recorded value v such that `pct` percent of values are <= v,
+// reported as the top of its bucket (never above max). 0 when empty.
+u64    dbin_hist_percentile(const dbin_hist_t *h, double pct);
+double dbin_hist_mean(const dbin_hist_t *h);
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "dbin/types.h"
+#include "dbin/dbin.h"
+#include "dbin/protocol.h"
+
+#include <sys/uio.h>
+
+// Scatter-gather framing: a frame as [length prefix + header][payload] for
+// writev/sendmsg, with the payload sent straight from the caller's memory.
+
+// Length prefix and header: what precedes the payload on a stream.
+#define DBIN_FRAME_HEAD_BYTES (DBIN_LEN_PREFIX_BYTES + 12)
+
+// Write the length prefix and header of `m` into head[0..DBIN_FRAME_HEAD_BYTES)
+// and point iov[0] at them and iov[1] at m->msg. *iovcnt returns 1 or 2 (no
+// iovec for an empty payload). `head` and m->msg must stay untouched until
+// the send completes. Returns DBIN_OK or the dbin_validate error.
+int   dbin_frame_iov(const dbin_msg_t *m, u8 *head, struct iovec *iov, int *iovcnt);
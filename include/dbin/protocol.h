@@ -4,10 +4,14 @@
 #define DBIN_VERSION     1
 
 enum dbin_type {
-    DBIN_TYPE_MSG  = 0,
-    DBIN_TYPE_ACK  = 1,
-    DBIN_TYPE_PING = 2,
-    DBIN_TYPE_PONG = 3
+    DBIN_TYPE_MSG   = 0,
+    DBIN_TYPE_ACK   = 1,
+    DBIN_TYPE_PING  = 2,
+    DBIN_TYPE_PONG  = 3,
+    DBIN_TYPE_JOIN  = 4,  // join room `route`
+    DBIN_TYPE_LEAVE = 5,  // leave room `route`
+    DBIN_TYPE_ACK_RANGE = 6, // cumulative run of `route` msg_ids ending at msg_id, plus a SACK bitmap
+    DBIN_TYPE_ENV   = 7   // envelope: several MSGs from one user_id, delta-coded headers
 };
 
 enum dbin_route_type {
@@ -19,4 +23,25 @@ enum dbin_flags {
     DBIN_FLAG_VALID = 1 << 0
 };
 
+// Bits of the 3-bit `reserved` field, both only on a MSG with a payload.
+// Z marks a payload compressed with the built-in dictionary (dbin/compress.h),
+// F a fragment of a larger payload (dbin/frag.h). The third bit must be 0.
+#define DBIN_RESERVED_Z   0x1u
+#define DBIN_RESERVED_F   0x2u
+#define DBIN_RESERVED_MSG (DBIN_RESERVED_Z | DBIN_RESERVED_F)
+
 #define DBIN_MAX_MSG_LEN 4095
+
+// Range ACK limits: the run stays within half the 16-bit msg_id space, so
+// "behind" and "ahead" are unambiguous across wraparound.
+#define DBIN_ACK_MAX_RUN    0x8000
+#define DBIN_ACK_SACK_BYTES 8
+
+// Envelopes carry 1..DBIN_ENV_MAX_MSGS messages (the count is one byte).
+#define DBIN_ENV_MAX_MSGS 255
+
+// Stream transports (TCP) send each frame as [len_hi len_lo][frame bytes].
+#define DBIN_LEN_PREFIX_BYTES 2
+
+// Largest frame a length prefix may announce: 12-byte header + max payload.
+#define DBIN_MAX_FRAME_LEN (12 + DBIN_MAX_MSG_LEN)
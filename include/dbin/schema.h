@@ -0,0 +1,130 @@
+#pragma once
+
+#include "dbin/types.h"
+#include "dbin/dbin.h"
+#include "dbin/protocol.h"
+#include "dbin/codec.h"
+
+#include <string.h>
+
+// Single source of truth for the dBIN/1 header layout.
+//
+// X(field, bits, max, err):
+//   field - member of dbin_msg_t, in wire order (MSB-first)
+//   bits  - width on the wire
+//   max   - largest value dbin_validate accepts
+//   err   - code dbin_validate returns when the value is above `max`
+//
+// Everything below (sizes, masks, pack/unpack) is expanded from this table,
+// so adding a field is one line here plus the member in dbin_msg_t.
+#define DBIN_HEADER_V1_FIELDS(X)                       \
+    X(magic,    12, 0xFFFu,            DBIN_ERR_RANGE) \
+    X(version,   4, 0xFu,              DBIN_ERR_RANGE) \
+    X(type,      3, 0x7u,              DBIN_ERR_RANGE) \
+    X(valid,     1, 0x1u,              DBIN_ERR_RANGE) \
+    X(is_room,   1, 0x1u,              DBIN_ERR_RANGE) \
+    X(reserved,  3, DBIN_RESERVED_MSG, DBIN_ERR_FMT)   \
+    X(user_id,  20, 0xFFFFFu,          DBIN_ERR_RANGE) \
+    X(route,    20, 0xFFFFFu,          DBIN_ERR_RANGE) \
+    X(msg_id,   16, 0xFFFFu,           DBIN_ERR_RANGE) \
+    X(msg_len,  12, DBIN_MAX_MSG_LEN,  DBIN_ERR_RANGE)
+
+#define DBIN_HDR_X_BITS(f, bits, max, err) + (bits)
+#define DBIN_HDR_X_MASK(f, bits, max, err) DBIN_HDR_V1_MASK_##f = (1u << (bits)) - 1u,
+#define DBIN_HDR_X_MAX(f, bits, max, err)  DBIN_HDR_V1_MAX_##f = (max),
+
+enum {
+    DBIN_HEADER_V1_BITS  = 0 DBIN_HEADER_V1_FIELDS(DBIN_HDR_X_BITS),
+    DBIN_HEADER_V1_BYTES = (DBIN_HEADER_V1_BITS + 7) / 8
+};
+
+enum { DBIN_HEADER_V1_FIELDS(DBIN_HDR_X_MASK) };
+enum { DBIN_HEADER_V1_FIELDS(DBIN_HDR_X_MAX) };
+
+// The whole header fits in one 128-bit accumulator; every shift below is a
+// compile-time constant, so pack/unpack are straight-line code.
+__extension__ typedef unsigned __int128 dbin_hdr_acc_t;
+
+_Static_assert(DBIN_HEADER_V1_BITS <= 128, "header must fit the accumulator");
+_Static_assert(DBIN_HEADER_V1_BYTES == 12, "pack/unpack assume a 12-byte header");
+_Static_assert(DBIN_HEADER_V1_BYTES + DBIN_MAX_MSG_LEN == DBIN_MAX_FRAME_LEN, "DBIN_MAX_FRAME_LEN out of date");
+
+// 12 bytes = one big-endian u32 followed by one big-endian u64.
+static inline dbin_hdr_acc_t dbin_hdr_load12(const u8 *in) {
+    u32 hi;
+    u64 lo;
+    memcpy(&hi, in, sizeof(hi));
+    memcpy(&lo, in + 4, sizeof(lo));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    hi = __builtin_bswap32(hi);
+    lo = __builtin_bswap64(lo);
+#endif
+    return ((dbin_hdr_acc_t)hi << 64) | lo;
+}
+
+static inline void dbin_hdr_store12(u8 *out, dbin_hdr_acc_t acc) {
+    u32 hi = (u32)(acc >> 64);
+    u64 lo = (u64)acc;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    hi = __builtin_bswap32(hi);
+    lo = __builtin_bswap64(lo);
+#endif
+    memcpy(out, &hi, sizeof(hi));
+    memcpy(out + 4, &lo, sizeof(lo));
+}
+
+// Write the header of `m` into out[0..DBIN_HEADER_V1_BYTES). Padding bits are zero.
+// Fields are masked to their width; call dbin_validate first for range checks.
+static inline void dbin_hdr_v1_pack(const dbin_msg_t *m, u8 *out) {
+    dbin_hdr_acc_t acc = 0;
+#define DBIN_HDR_X_PACK(f, bits, max, err) \
+    acc = (acc << (bits)) | ((u32)m->f & DBIN_HDR_V1_MASK_##f);
+    DBIN_HEADER_V1_FIELDS(DBIN_HDR_X_PACK)
+#undef DBIN_HDR_X_PACK
+    acc <<= DBIN_HEADER_V1_BYTES * 8 - DBIN_HEADER_V1_BITS;
+    dbin_hdr_store12(out, acc);
+}
+
+// Read every header field from in[0..DBIN_HEADER_V1_BYTES). No checks; `msg` is untouched.
+static inline void dbin_hdr_v1_unpack(const u8 *in, dbin_msg_t *out) {
+    dbin_hdr_acc_t acc = dbin_hdr_load12(in);
+    int sh = DBIN_HEADER_V1_BYTES * 8;
+#define DBIN_HDR_X_UNPACK(f, bits, max, err) \
+    sh -= (bits);                            \
+    out->f = (u32)(acc >> sh) & DBIN_HDR_V1_MASK_##f;
+    DBIN_HEADER_V1_FIELDS(DBIN_HDR_X_UNPACK)
+#undef DBIN_HDR_X_UNPACK
+}
+
+// Range checks from the table, in wire order. Returns DBIN_OK or the field's `err`.
+static inline int dbin_hdr_v1_check(const dbin_msg_t *m) {
+#define DBIN_HDR_X_CHECK(f, bits, max, err) \
+    if ((u32)m->f > (u32)DBIN_HDR_V1_MAX_##f) return (err);
+    DBIN_HEADER_V1_FIELDS(DBIN_HDR_X_CHECK)
+#undef DBIN_HDR_X_CHECK
+    return DBIN_OK;
+}
+
+// Types whose frames carry no payload (msg_len must be 0).
+static inline int dbin_type_is_control(u32 type) {
+    return type != DBIN_TYPE_MSG && type <= DBIN_TYPE_LEAVE;
+}
+
+// Reserved bits: only Z and F, and only on a MSG with a payload.
+static inline int dbin_reserved_check(u32 type, u32 reserved, u32 msg_len) {
+    if (reserved & ~DBIN_RESERVED_MSG) return DBIN_ERR_FMT;
+    if (reserved && (type != DBIN_TYPE_MSG || msg_len == 0)) return DBIN_ERR_FMT;
+    return DBIN_OK;
+}
+
+// Per-type rules on top of the field ranges. Returns DBIN_OK or the error.
+static inline int dbin_type_check(u32 type, u32 is_room, u32 route, u32 msg_len) {
+    if (dbin_type_is_control(type) && msg_len != 0) return DBIN_ERR_FMT;
+    if (type == DBIN_TYPE_ACK_RANGE) {
+        if (is_room) return DBIN_ERR_FMT;
+        if (route == 0 || route > DBIN_ACK_MAX_RUN) return DBIN_ERR_RANGE;
+        if (msg_len > DBIN_ACK_SACK_BYTES) return DBIN_ERR_RANGE;
+    }
+    if (type == DBIN_TYPE_ENV && msg_len == 0) return DBIN_ERR_FMT;
+    return DBIN_OK;
+}
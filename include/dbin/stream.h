@@ -0,0 +1,49 @@
+#pragma once
+
+#include "dbin/types.h"
+#include "dbin/dbin.h"
+#include "dbin/protocol.h"
+
+// Smallest buffer that can hold one maximum-size prefixed frame.
+#define DBIN_STREAM_MIN_CAP (DBIN_LEN_PREFIX_BYTES + DBIN_MAX_FRAME_LEN)
+
+// Incremental decoder for length-prefixed frames (see SPEC.md, "Stream framing").
+//
+// Bytes are received straight into a caller-provided buffer and frames are
+// returned as zero-copy views into it. Data is only moved when a partial
+// frame sits at the end of the buffer and the rest would not fit behind it.
+typedef struct dbin_stream {
+    u8    *buf;
+    usize  cap;
+    usize  head;        // first unconsumed byte
+    usize  tail;        // end of received bytes
+    int    err;         // sticky framing error (bad length prefix), DBIN_OK otherwise
+
+    const u8 *frame;    // last frame returned by dbin_stream_next (without prefix)
+    usize  frame_len;
+} dbin_stream_t;
+
+// `cap` must be at least DBIN_STREAM_MIN_CAP.
+int   dbin_stream_init(dbin_stream_t *s, u8 *buf, usize cap);
+void  dbin_stream_reset(dbin_stream_t *s);
+
+// Contiguous free space to recv() into. May compact the buffer, which
+// invalidates views returned by earlier dbin_stream_next calls.
+u8   *dbin_stream_wbuf(dbin_stream_t *s, usize *avail);
+// Mark `n` bytes written at dbin_stream_wbuf() as received.
+void  dbin_stream_commit(dbin_stream_t *s, usize n);
+
+// Copy in as much of data[0..n) as fits. Returns bytes consumed.
+usize dbin_stream_feed(dbin_stream_t *s, const u8 *data, usize n);
+
+// Decode the next complete frame into `out`; `out->msg` and s->frame point
+// into the stream buffer and stay valid until the next wbuf/feed call.
+// `consumed` (optional) returns the bytes used, prefix included.
+// Returns DBIN_OK, DBIN_ERR_AGAIN when no complete frame is buffered, the
+// dbin_decode error for a well-framed but invalid frame (which is skipped),
+// or a sticky DBIN_ERR_FMT / DBIN_ERR_RANGE when the length prefix is below
+// the header size or above DBIN_MAX_FRAME_LEN (the stream cannot resync).
+int   dbin_stream_next(dbin_stream_t *s, dbin_msg_t *out, usize *consumed);
+
+// Bytes received but not yet returned as frames.
+usize dbin_stream_pending(const dbin_stream_t *s);
@@ -0,0 +1,116 @@
+#include "server.h"
+
+#include "dbin/capture.h"
+#include "dbin/codec.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// One capture file per shard, written only by that shard's thread. Records
+// collect in `buf` and go out in one write() per SERVER_CAP_BUF bytes, so the
+// per-frame cost is a copy.
+struct shard_cap {
+    int   fd;
+    int   failed;    // a write failed; capture stopped for this shard
+    u64   start_ns;  // CLOCK_MONOTONIC at capture start, same for every shard
+    u64   frames;
+    u64   bytes;
+    usize len;
+    dbin_cap_writer_t w;
+    dbin_cap_index_t index[SERVER_CAP_INDEX];
+    u8    buf[SERVER_CAP_BUF];
+};
+
+static u64 clock_ns(clockid_t id) {
+    struct timespec ts;
+    clock_gettime(id, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+}
+
+static int write_all(int fd, const u8 *p, usize n) {
+    while (n > 0) {
+        ssize_t w = write(fd, p, n);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return 1;
+        }
+        p += w;
+        n -= (usize)w;
+    }
+    return 0;
+}
+
+static void cap_write(reactor_t *r, shard_cap_t *k) {
+    if (k->len == 0 || k->failed) return;
+    if (write_all(k->fd, k->buf, k->len)) {
+        fprintf(stderr, "[server] shard %d: capture write failed, capture stopped\n", r->id);
+        k->failed = 1;
+    }
+    k->bytes += k->len;
+    k->len = 0;
+}
+
+int server_capture_start(server_t *s, const char *prefix) {
+    u64 mono = clock_ns(CLOCK_MONOTONIC);
+    u64 wall = clock_ns(CLOCK_REALTIME);
+
+    for (int i = 0; i < s->nshards; i++) {
+        reactor_t *r = &s->shards[i];
+        shard_cap_t *k = (shard_cap_t*)calloc(1, sizeof(*k));
+        if (!k) return 1;
+
+        char path[4096];
+        snprintf(path, sizeof(path), "%s.%d.dcap", prefix, i);
+        k->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (k->fd < 0) {
+            free(k);
+            return 1;
+        }
+        k->start_ns = mono;
+        dbin_cap_writer_init(&k->w, k->index, SERVER_CAP_INDEX, (u32)i, wall, k->buf);
+        k->len = DBIN_CAP_HEADER_BYTES;
+        r->cap = k;
+    }
+    return 0;
+}
+
+u64 server_capture_stop(server_t *s) {
+    u64 frames = 0;
+    for (int i = 0; i < s->nshards; i++) {
+        reactor_t *r = &s->shards[i];
+        shard_cap_t *k = r->cap;
+        if (!k) continue;
+
+        cap_write(r, k);
+        usize n = 0;
+        if (dbin_cap_footer_bytes(&k->w) <= SERVER_CAP_BUF && dbin_cap_finish(&k->w, k->buf, SERVER_CAP_BUF, &n) == DBIN_OK) {
+            k->len = n;
+            cap_write(r, k);
+        }
+        close(k->fd);
+        frames += k->frames;
+        free(k);
+        r->cap = 0;
+    }
+    return frames;
+}
+
+u64 shard_capture_clock(const reactor_t *r) {
+    return clock_ns(CLOCK_MONOTONIC) - r->cap->start_ns;
+}
+
+void shard_capture(reactor_t *r, const conn_t *c, const u8 *frame, usize len, u64 ts_ns) {
+    shard_cap_t *k = r->cap;
+    if (k->failed) return;
+
+    usize n = 0;
+    if (SERVER_CAP_BUF - k->len < DBIN_CAP_REC_BYTES + len) cap_write(r, k);
+    if (dbin_cap_append(&k->w, ts_ns, c->cap_id, frame, len, k->buf + k->len, SERVER_CAP_BUF - k->len, &n) != DBIN_OK) return;
+    k->len += n;
+    k->frames++;
+}
@@ -0,0 +1,398 @@
+#include "server.h"
+
+#include "dbin/codec.h"
+#include "dbin/batch.h"
+#include "dbin/dgram.h"
+#include "dbin/protocol.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define OQ_MIN_CAP 4
+
+static int in_borrow(reactor_t *r, conn_t *c) {
+    u8 *buf = (u8*)slab_alloc(&r->pool, SERVER_INBUF_SIZE);
+    if (!buf) return 1;
+    c->in_buf = buf;
+    dbin_stream_init(&c->in, buf, SERVER_INBUF_SIZE);
+    return 0;
+}
+
+static void in_release(reactor_t *r, conn_t *c) {
+    slab_free(&r->pool, c->in_buf, SERVER_INBUF_SIZE);
+    c->in_buf = 0;
+}
+
+static void mark_dirty(reactor_t *r, conn_t *c) {
+    if (c->dirty) return;
+    c->dirty = 1;
+    c->next_dirty = r->dirty;
+    r->dirty = c;
+}
+
+// ---- output buffers ----
+
+// Sized to the whole slab block, so a private buffer fills its class.
+static obuf_t *obuf_alloc(reactor_t *r, usize cap) {
+    usize bytes = slab_usable(sizeof(obuf_t) + cap);
+    obuf_t *b = (obuf_t*)slab_alloc(&r->pool, bytes);
+    if (!b) return 0;
+    b->refs = 1;
+    b->len = 0;
+    b->cap = (u32)(bytes - sizeof(obuf_t));
+    return b;
+}
+
+obuf_t *obuf_new_shared(reactor_t *r, usize cap) {
+    obuf_t *b = obuf_alloc(r, cap);
+    if (b) b->shared = 1;
+    return b;
+}
+
+static obuf_t *obuf_new_private(reactor_t *r, usize need) {
+    obuf_t *b = obuf_alloc(r, need > SERVER_OBUF_SIZE ? need : SERVER_OBUF_SIZE);
+    if (b) b->shared = 0;
+    return b;
+}
+
+void obuf_release(reactor_t *r, obuf_t *b) {
+    if (--b->refs > 0) return;
+    slab_free(&r->pool, b, sizeof(*b) + b->cap);
+}
+
+static int out_push(reactor_t *r, conn_t *c, obuf_t *b, u32 off, u32 len) {
+    if (c->oq_len == c->oq_cap) {
+        u32 ncap = c->oq_cap ? c->oq_cap * 2 : OQ_MIN_CAP;
+        out_seg_t *nq = (out_seg_t*)slab_alloc(&r->pool, ncap * sizeof(*nq));
+        if (!nq) return 1;
+        for (u32 i = 0; i < c->oq_len; i++) nq[i] = *conn_out_seg(c, i);
+        slab_free(&r->pool, c->oq, c->oq_cap * sizeof(*nq));
+        c->oq = nq;
+        c->oq_cap = ncap;
+        c->oq_head = 0;
+    }
+    out_seg_t *s = &c->oq[(c->oq_head + c->oq_len) & (c->oq_cap - 1)];
+    s->buf = b;
+    s->off = off;
+    s->len = len;
+    c->oq_len++;
+    c->out_bytes += len;
+    return 0;
+}
+
+// Room for `need` more private bytes at the end of the queue: the last
+// segment's private buffer when it has space, otherwise a fresh one.
+static u8 *out_priv_reserve(reactor_t *r, conn_t *c, usize need) {
+    if (c->oq_len > 0) {
+        out_seg_t *t = conn_out_seg(c, c->oq_len - 1);
+        if (!t->buf->shared && t->buf->cap - t->buf->len >= need) return t->buf->data + t->buf->len;
+    }
+
+    obuf_t *b = obuf_new_private(r, need);
+    if (!b) return 0;
+    if (out_push(r, c, b, 0, 0)) {
+        obuf_release(r, b);
+        return 0;
+    }
+    return b->data;
+}
+
+static void out_priv_commit(conn_t *c, usize n) {
+    out_seg_t *t = conn_out_seg(c, c->oq_len - 1);
+    t->buf->len += (u32)n;
+    t->len += (u32)n;
+    c->out_bytes += n;
+}
+
+void conn_out_consume(reactor_t *r, conn_t *c, usize n) {
+    c->out_bytes -= n;
+    while (n > 0) {
+        out_seg_t *s = conn_out_seg(c, 0);
+        if (n < s->len) {
+            s->off += (u32)n;
+            s->len -= (u32)n;
+            return;
+        }
+        n -= s->len;
+        // Idle connections hold no output buffer; private ones go back to the pool.
+        obuf_release(r, s->buf);
+        c->oq_head = (c->oq_head + 1) & (c->oq_cap - 1);
+        c->oq_len--;
+    }
+}
+
+static void out_free(reactor_t *r, conn_t *c) {
+    for (u32 i = 0; i < c->oq_len; i++) obuf_release(r, conn_out_seg(c, i)->buf);
+    slab_free(&r->pool, c->oq, c->oq_cap * sizeof(*c->oq));
+    c->oq = 0;
+    c->oq_len = 0;
+    c->oq_cap = 0;
+    c->out_bytes = 0;
+}
+
+// One received frame, decoded with result `rc`: counted, captured, and
+// handled unless invalid. Invalid frames are captured too, so callers pass
+// only frames whose `len` bytes all lie in their buffer. Nonzero to close
+// the connection.
+static int conn_frame(reactor_t *r, conn_t *c, int rc, const dbin_msg_t *m, const u8 *frame, usize len, u64 ts) {
+    r->frames_in++;
+    if (r->cap) shard_capture(r, c, frame, len, ts);
+    if (rc != DBIN_OK) return 0;         // well-framed but invalid: skip it
+
+    // Any frame answers a PING; the heartbeat timer is not touched here.
+    u32 now = (u32)r->tick;
+    c->rx_tick = now;
+    c->pinged = 0;
+    if (m->type != DBIN_TYPE_PING && m->type != DBIN_TYPE_PONG) c->app_tick = now;
+    return server_handle_frame(r, c, m, frame, len);
+}
+
+// Run every complete buffered frame through the handler.
+int conn_drain(reactor_t *r, conn_t *c) {
+    dbin_msg_t m;
+    int rc;
+    u64 ts = r->cap ? shard_capture_clock(r) : 0;
+
+    while ((rc = dbin_stream_next(&c->in, &m, 0)) != DBIN_ERR_AGAIN) {
+        if (c->in.err != DBIN_OK) return -1; // bad length prefix: cannot resync
+        if (conn_frame(r, c, rc, &m, c->in.frame, c->in.frame_len, ts)) return -1;
+    }
+
+    // The transport stops reading until the peer drains some output.
+    if (conn_out_pending(c) > SERVER_OUT_HIGH_WATER) c->read_paused = 1;
+    return 0;
+}
+
+int conn_datagram(reactor_t *r, conn_t *c, const u8 *data, usize len) {
+    if (c->closing) return 0;
+    dbin_msg_t m;
+    const u8 *frame;
+    usize off = 0, flen;
+    int rc;
+    u64 ts = r->cap ? shard_capture_clock(r) : 0;
+
+    // Frames are decoded where the datagram landed; nothing is copied.
+    while ((rc = dbin_dgram_next(data, len, &off, &m, &frame, &flen)) != DBIN_ERR_AGAIN) {
+        if (rc == DBIN_ERR_BUF || rc == DBIN_ERR_MAGIC || rc == DBIN_ERR_VER) break; // rest unreadable
+        if (conn_frame(r, c, rc, &m, frame, flen, ts)) return -1;
+    }
+    return 0;
+}
+
+// ---- connection arena ----
+
+static conn_t *conn_alloc(reactor_t *r) {
+    u32 slot;
+    if (r->nslot_free > 0) {
+        slot = r->slot_free[--r->nslot_free];
+    } else {
+        if (r->nslots == ROUTE_SLOT_MAX) return 0;
+        if (r->nslots == r->nchunks * SERVER_CONN_CHUNK) {
+            if (r->nchunks == r->chunks_cap) {
+                u32 ncap = r->chunks_cap ? r->chunks_cap * 2 : 4;
+                conn_t **nc = (conn_t**)realloc(r->conn_chunks, ncap * sizeof(*nc));
+                if (!nc) return 0;
+                r->conn_chunks = nc;
+                r->chunks_cap = ncap;
+            }
+            usize nslots = (usize)(r->nchunks + 1) * SERVER_CONN_CHUNK;
+            u32 *nf = (u32*)realloc(r->slot_free, nslots * sizeof(*nf));
+            if (!nf) return 0;
+            r->slot_free = nf;
+            conn_t *chunk = (conn_t*)malloc(SERVER_CONN_CHUNK * sizeof(*chunk));
+            if (!chunk) return 0;
+            r->conn_chunks[r->nchunks++] = chunk;
+        }
+        slot = r->nslots++;
+    }
+
+    conn_t *c = reactor_conn_at(r, slot);
+    memset(c, 0, sizeof(*c));
+    c->slot = slot;
+    return c;
+}
+
+static void conn_free(reactor_t *r, conn_t *c) {
+    r->slot_free[r->nslot_free++] = c->slot;
+}
+
+// ---- connections ----
+
+conn_t *conn_open(reactor_t *r, int fd) {
+    conn_t *c = conn_alloc(r);
+    if (!c) return 0;
+    c->fd = fd;
+    c->cap_id = ((u32)r->id << 26) | (r->conn_seq++ & 0x3FFFFFFu);
+    conn_heartbeat_start(r, c);
+
+    r->nconns++;
+    return c;
+}
+
+void conn_close(reactor_t *r, conn_t *c) {
+    if (c->closing) return;
+    c->closing = 1;
+
+    if (c->udp) {
+        udp_close(r, c);
+    } else {
+        transport_close(r, c);
+    }
+    conn_heartbeat_stop(r, c);
+    in_release(r, c);
+    room_leave_all(r, c);
+    server_unbind_user(r, c);
+
+    c->next_closed = r->closed;
+    r->closed = c;
+}
+
+void conn_destroy(reactor_t *r, conn_t *c) {
+    out_free(r, c);
+    free(c->rooms);
+    conn_free(r, c);
+    r->nconns--;
+}
+
+void conn_io_done(reactor_t *r, conn_t *c) {
+    if (--c->io_refs == 0 && c->closing == 2) conn_destroy(r, c);
+}
+
+int conn_in_begin(reactor_t *r, conn_t *c) {
+    if (c->in_buf) return 0;
+    return in_borrow(r, c) ? -1 : 0;
+}
+
+void conn_in_end(reactor_t *r, conn_t *c) {
+    if (c->in_buf && dbin_stream_pending(&c->in) == 0) in_release(r, c);
+}
+
+int conn_feed(reactor_t *r, conn_t *c, const u8 *data, usize n) {
+    if (c->closing) return 0;
+    if (conn_in_begin(r, c)) return -1;
+
+    while (n > 0) {
+        usize k = dbin_stream_feed(&c->in, data, n);
+        data += k;
+        n -= k;
+        if (conn_drain(r, c)) return -1;
+    }
+
+    conn_in_end(r, c);
+    return 0;
+}
+
+int conn_flush(reactor_t *r, conn_t *c) {
+    if (c->closing) return 0;
+    if (c->udp) return udp_queue(r, c);
+    if (transport_flush(r, c)) return -1;
+
+    if (c->read_paused && conn_out_pending(c) <= SERVER_OUT_HIGH_WATER / 2) {
+        c->read_paused = 0;
+        return transport_resume(r, c);
+    }
+    return 0;
+}
+
+int conn_queue_msg(reactor_t *r, conn_t *c, const dbin_msg_t *m) {
+    usize need = DBIN_LEN_PREFIX_BYTES + dbin_encoded_size(m);
+    u8 *w = out_priv_reserve(r, c, need);
+    if (!w) return DBIN_ERR_BUF;
+
+    dbin_arena_t a;
+    usize done = 0;
+    dbin_arena_init(&a, w, need);
+
+    int rc = dbin_encode_batch(m, 1, &a, 0, &done);
+    if (rc != DBIN_OK) return rc;
+
+    out_priv_commit(c, a.len);
+    r->frames_out++;
+    mark_dirty(r, c);
+    return DBIN_OK;
+}
+
+int conn_queue_frame(reactor_t *r, conn_t *c, const u8 *frame, usize len) {
+    if (len > DBIN_MAX_FRAME_LEN) return DBIN_ERR_RANGE;
+    u8 *w = out_priv_reserve(r, c, DBIN_LEN_PREFIX_BYTES + len);
+    if (!w) return DBIN_ERR_BUF;
+
+    w[0] = (u8)(len >> 8);
+    w[1] = (u8)len;
+    memcpy(w + DBIN_LEN_PREFIX_BYTES, frame, len);
+
+    out_priv_commit(c, DBIN_LEN_PREFIX_BYTES + len);
+    r->frames_out++;
+    mark_dirty(r, c);
+    return DBIN_OK;
+}
+
+static int ack_emit(reactor_t *r, conn_t *c) {
+    dbin_msg_t ack;
+    dbin_acker_take(&c->ack, &ack);
+    return conn_queue_msg(r, c, &ack);
+}
+
+int conn_queue_ack(reactor_t *r, conn_t *c, const dbin_msg_t *m) {
+    if (!dbin_acker_add(&c->ack, m)) {
+        int rc = ack_emit(r, c);
+        if (rc != DBIN_OK) return rc;
+        dbin_acker_add(&c->ack, m);
+    }
+    mark_dirty(r, c);
+    return DBIN_OK;
+}
+
+int conn_queue_buf(reactor_t *r, conn_t *c, obuf_t *b) {
+    if (out_push(r, c, b, 0, b->len)) return DBIN_ERR_BUF;
+    b->refs++;
+    r->frames_out++;
+    mark_dirty(r, c);
+    return DBIN_OK;
+}
+
+void reactor_end_tick(reactor_t *r) {
+    // One send per connection per tick, however many frames were queued.
+    while (r->dirty) {
+        conn_t *c = r->dirty;
+        r->dirty = c->next_dirty;
+
+        // The tick's ACKs join the queue just before it is flushed.
+        int err = dbin_acker_pending(&c->ack) && !c->closing && ack_emit(r, c) != DBIN_OK;
+        c->dirty = 0;
+        c->next_dirty = 0;
+
+        if (err || conn_flush(r, c)) conn_close(r, c);
+    }
+    // Datagrams packed above go out together.
+    if (r->udp) udp_send(r);
+
+    // Connections with transport operations still in flight are freed by
+    // the backend once the last one completes.
+    while (r->closed) {
+        conn_t *c = r->closed;
+        r->closed = c->next_closed;
+
+        if (c->io_refs == 0) {
+            conn_destroy(r, c);
+        } else {
+            c->closing = 2;
+        }
+    }
+
+    slab_flush_remote(&r->pool);
+}
+
+void reactor_free_buffers(reactor_t *r) {
+    // Buffers of connections still open at shutdown go with the pool, the
+    // connections with their arena.
+    slab_pool_destroy(&r->pool);
+
+    for (u32 i = 0; i < r->nchunks; i++) free(r->conn_chunks[i]);
+    free(r->conn_chunks);
+    free(r->slot_free);
+    r->conn_chunks = 0;
+    r->slot_free = 0;
+    r->nchunks = r->chunks_cap = 0;
+    r->nslots = r->nslot_free = 0;
+}
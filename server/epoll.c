@@ -0,0 +1,336 @@
+#define _GNU_SOURCE
+
+#include "server.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <linux/errqueue.h>
+
+const char *const transport_name = "epoll";
+
+#define FLUSH_IOV_MAX 64 // queued segments handed to one sendmsg
+
+// epoll data.ptr tags for the non-connection descriptors.
+static char listener_tag;
+static char wake_tag;
+static char udp_tag;
+
+// Returns nonzero when accept stopped for a reason other than an empty queue
+// (e.g. out of descriptors); the caller retries after the tick.
+static int accept_all(reactor_t *r) {
+    for (;;) {
+        int fd = accept4(r->lfd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+            return 1;
+        }
+
+        r->syscalls++;
+
+        conn_t *c = conn_open(r, fd);
+        if (!c) {
+            close(fd);
+            continue;
+        }
+        int one = 1;
+        if (r->srv->zerocopy && setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0) c->zc = 1;
+
+        struct epoll_event ev;
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.ptr = c;
+        if (epoll_ctl(r->epfd, EPOLL_CTL_ADD, fd, &ev) < 0) conn_close(r, c);
+    }
+}
+
+static int on_readable(reactor_t *r, conn_t *c) {
+    if (c->closing || c->read_paused) return 0;
+    if (conn_in_begin(r, c)) return -1;
+
+    // Edge-triggered: read until the socket is empty (or output backs up).
+    while (!c->read_paused) {
+        usize avail = 0;
+        u8 *w = dbin_stream_wbuf(&c->in, &avail);
+
+        ssize_t n = recv(c->fd, w, (size_t)avail, 0);
+        r->syscalls++;
+        if (n > 0) {
+            dbin_stream_commit(&c->in, (usize)n);
+            if (conn_drain(r, c)) return -1;
+            continue;
+        }
+        if (n == 0) return -1;
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+        return -1;
+    }
+
+    conn_in_end(r, c);
+    return 0;
+}
+
+// ---- MSG_ZEROCOPY ----
+
+static int zc_push(reactor_t *r, conn_t *c, u32 seq, obuf_t *b) {
+    if (c->zc_len == c->zc_cap) {
+        u32 ncap = c->zc_cap ? c->zc_cap * 2 : 16;
+        zc_pin_t *np = (zc_pin_t*)slab_alloc(&r->pool, ncap * sizeof(*np));
+        if (!np) return 1;
+        for (u32 i = 0; i < c->zc_len; i++) np[i] = c->zc_pins[(c->zc_head + i) & (c->zc_cap - 1)];
+        slab_free(&r->pool, c->zc_pins, c->zc_cap * sizeof(*np));
+        c->zc_pins = np;
+        c->zc_cap = ncap;
+        c->zc_head = 0;
+    }
+    zc_pin_t *p = &c->zc_pins[(c->zc_head + c->zc_len) & (c->zc_cap - 1)];
+    p->seq = seq;
+    p->buf = b;
+    b->refs++;
+    c->zc_len++;
+    return 0;
+}
+
+// A zerocopy send took the first `k` queued bytes: keep their buffers alive
+// past conn_out_consume until the kernel reports it is done with them.
+static int zc_pin_sent(reactor_t *r, conn_t *c, usize k) {
+    u32 seq = c->zc_seq++;
+    r->zc_sends++;
+    for (u32 i = 0; i < c->oq_len && k > 0; i++) {
+        out_seg_t *seg = conn_out_seg(c, i);
+        if (seg->len == 0) continue;
+        if (zc_push(r, c, seq, seg->buf)) return -1;
+        k -= k < seg->len ? k : seg->len;
+    }
+    return 0;
+}
+
+static void zc_release(reactor_t *r, conn_t *c, u32 lo, u32 hi) {
+    for (u32 i = 0; i < c->zc_len; i++) {
+        zc_pin_t *p = &c->zc_pins[(c->zc_head + i) & (c->zc_cap - 1)];
+        if (p->buf && p->seq - lo <= hi - lo) {
+            obuf_release(r, p->buf);
+            p->buf = 0;
+        }
+    }
+    while (c->zc_len > 0 && !c->zc_pins[c->zc_head].buf) {
+        c->zc_head = (c->zc_head + 1) & (c->zc_cap - 1);
+        c->zc_len--;
+    }
+}
+
+static void zc_release_all(reactor_t *r, conn_t *c) {
+    zc_release(r, c, 0, 0xFFFFFFFFu);
+    slab_free(&r->pool, c->zc_pins, c->zc_cap * sizeof(*c->zc_pins));
+    c->zc_pins = 0;
+    c->zc_cap = 0;
+    c->zc_head = 0;
+}
+
+// Read completions off the socket's error queue. Returns nonzero if any
+// arrived (the EPOLLERR that woke us was theirs, not a socket error).
+static int zc_reap(reactor_t *r, conn_t *c) {
+    int got = 0;
+    for (;;) {
+        char ctl[CMSG_SPACE(sizeof(struct sock_extended_err)) + 64];
+        struct msghdr mh;
+        memset(&mh, 0, sizeof(mh));
+        mh.msg_control = ctl;
+        mh.msg_controllen = sizeof(ctl);
+        ssize_t k = recvmsg(c->fd, &mh, MSG_ERRQUEUE);
+        r->syscalls++;
+        if (k < 0) break;
+
+        for (struct cmsghdr *cm = CMSG_FIRSTHDR(&mh); cm; cm = CMSG_NXTHDR(&mh, cm)) {
+            if (!((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) ||
+                  (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR))) {
+                continue;
+            }
+            struct sock_extended_err ee;
+            memcpy(&ee, CMSG_DATA(cm), sizeof(ee));
+            if (ee.ee_errno != 0 || ee.ee_origin != SO_EE_ORIGIN_ZEROCOPY) continue;
+            // [ee_info, ee_data]: the sends now complete.
+            if (ee.ee_code & SO_EE_CODE_ZEROCOPY_COPIED) r->zc_copied += ee.ee_data - ee.ee_info + 1;
+            zc_release(r, c, ee.ee_info, ee.ee_data);
+            got = 1;
+        }
+    }
+    return got;
+}
+
+int transport_flush(reactor_t *r, conn_t *c) {
+    int zc_ok = c->zc;
+    while (conn_out_pending(c) > 0) {
+        struct iovec iov[FLUSH_IOV_MAX];
+        usize bytes = 0;
+        int n = 0;
+        for (u32 i = 0; i < c->oq_len && n < FLUSH_IOV_MAX; i++) {
+            out_seg_t *seg = conn_out_seg(c, i);
+            if (seg->len == 0) continue;
+            iov[n].iov_base = seg->buf->data + seg->off;
+            iov[n].iov_len = seg->len;
+            bytes += seg->len;
+            n++;
+        }
+
+        struct msghdr mh;
+        memset(&mh, 0, sizeof(mh));
+        mh.msg_iov = iov;
+        mh.msg_iovlen = (size_t)n;
+
+        // Only large sends: below this, pinning and completions cost more
+        // than the copy they save.
+        int zc = zc_ok && bytes >= SERVER_ZC_MIN_BYTES;
+        ssize_t k = sendmsg(c->fd, &mh, MSG_NOSIGNAL | (zc ? MSG_ZEROCOPY : 0));
+        r->syscalls++;
+        if (k > 0) {
+            if (zc && zc_pin_sent(r, c, (usize)k)) return -1;
+            conn_out_consume(r, c, (usize)k);
+            continue;
+        }
+        if (k < 0 && errno == EINTR) continue;
+        if (k < 0 && errno == ENOBUFS && zc) {
+            zc_ok = 0; // out of pinned-page budget (optmem): copy this time
+            continue;
+        }
+        if (k < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 0; // EPOLLOUT resumes
+        return -1;
+    }
+    return 0;
+}
+
+int transport_resume(reactor_t *r, conn_t *c) {
+    return on_readable(r, c);
+}
+
+void transport_close(reactor_t *r, conn_t *c) {
+    // Data still queued from zerocopy sends would outlive the buffers
+    // released below: reset the connection instead of draining it.
+    if (c->zc_len > 0) {
+        struct linger lg = { 1, 0 };
+        setsockopt(c->fd, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+    }
+    close(c->fd); // also removes it from the epoll set
+    c->fd = -1;
+    if (c->zc_pins) zc_release_all(r, c);
+}
+
+static int epoll_add(int epfd, int fd, void *tag) {
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.ptr = tag;
+    return epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+int reactor_init(reactor_t *r, const char *ip, int port) {
+    memset(r, 0, sizeof(*r));
+    r->epfd = -1;
+    r->evfd = -1;
+    r->cpu = -1;
+
+    r->lfd = server_listen(ip, port);
+    if (r->lfd < 0) return 1;
+
+    r->epfd = epoll_create1(EPOLL_CLOEXEC);
+    r->evfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (r->epfd < 0 || r->evfd < 0) return 1;
+
+    if (epoll_add(r->epfd, r->lfd, &listener_tag) < 0) return 1;
+    if (epoll_add(r->epfd, r->evfd, &wake_tag) < 0) return 1;
+    return 0;
+}
+
+int reactor_run(reactor_t *r) {
+    struct epoll_event evs[SERVER_MAX_EVENTS];
+    int accept_blocked = 0;
+
+    // Level-triggered: udp_recv reads a bounded number of batches per pass.
+    if (r->udp) {
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.ptr = &udp_tag;
+        if (epoll_ctl(r->epfd, EPOLL_CTL_ADD, udp_fd(r), &ev) < 0) return 1;
+    }
+
+    while (!r->stop) {
+        // Announce the nap, then look at the inbound queues once more: a
+        // producer either sees `asleep` and writes evfd, or its frames are
+        // picked up here.
+        atomic_store(&r->asleep, 1);
+        atomic_thread_fence(memory_order_seq_cst);
+        usize early = shard_drain_inbound(r);
+
+        // Sleep no later than the next heartbeat timer.
+        int timeout = (early > 0) ? 0 : reactor_timer_wait_ms(r, accept_blocked ? 10 : 1000);
+        int n = epoll_wait(r->epfd, evs, SERVER_MAX_EVENTS, timeout);
+        atomic_store(&r->asleep, 0);
+        r->syscalls++;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
+            return 1;
+        }
+        reactor_clock(r);
+
+        for (int i = 0; i < n; i++) {
+            void *tag = evs[i].data.ptr;
+            u32 e = evs[i].events;
+
+            if (tag == &listener_tag) {
+                accept_blocked = accept_all(r);
+                continue;
+            }
+            if (tag == &udp_tag) {
+                udp_recv(r);
+                continue;
+            }
+            if (tag == &wake_tag) {
+                u64 cnt;
+                ssize_t rd = read(r->evfd, &cnt, sizeof(cnt));
+                (void)rd;
+                continue;
+            }
+
+            conn_t *c = (conn_t*)tag;
+            if ((e & EPOLLERR) && c->zc && zc_reap(r, c)) e &= ~(u32)EPOLLERR;
+            if (e & (EPOLLERR | EPOLLHUP)) {
+                conn_close(r, c);
+                continue;
+            }
+            if ((e & (EPOLLIN | EPOLLRDHUP)) && on_readable(r, c)) {
+                conn_close(r, c);
+                continue;
+            }
+            if ((e & EPOLLOUT) && conn_flush(r, c)) {
+                conn_close(r, c);
+            }
+        }
+
+        shard_drain_inbound(r);
+        reactor_run_timers(r);
+        reactor_end_tick(r);
+        shard_notify(r);
+
+        // Edge-triggered listener: connections left queued after EMFILE do
+        // not raise a new event, so keep retrying while blocked.
+        if (accept_blocked) accept_blocked = accept_all(r);
+    }
+    return 0;
+}
+
+void reactor_destroy(reactor_t *r) {
+    reactor_free_buffers(r);
+
+    if (r->evfd >= 0) close(r->evfd);
+    if (r->epfd >= 0) close(r->epfd);
+    if (r->lfd >= 0) close(r->lfd);
+    r->evfd = r->epfd = r->lfd = -1;
+}
@@ -0,0 +1,91 @@
+#include "server.h"
+
+#include "dbin/codec.h"
+#include "dbin/protocol.h"
+
+#include <string.h>
+
+static int send_ack(reactor_t *r, conn_t *c, const dbin_msg_t *msg) {
+    return conn_queue_ack(r, c, msg) == DBIN_OK ? 0 : -1;
+}
+
+static void route_msg(reactor_t *r, conn_t *c, const dbin_msg_t *m, const u8 *frame, usize frame_len) {
+    if (m->is_room) {
+        server_route_room(r, c, m->route, frame, frame_len);
+    } else {
+        server_route_user(r, m->route, frame, frame_len);
+    }
+}
+
+// Each message in an envelope is acknowledged like a MSG. An envelope bound
+// for one destination, with nothing in it seen before, goes out whole;
+// otherwise each new message is re-framed.
+static int handle_env(reactor_t *r, conn_t *c, const dbin_msg_t *env, const u8 *frame, usize frame_len) {
+    dbin_msg_t msgs[DBIN_ENV_MAX_MSGS];
+    u8 dup[DBIN_ENV_MAX_MSGS];
+    usize n = 0;
+    if (dbin_env_split(env, msgs, DBIN_ENV_MAX_MSGS, &n) != DBIN_OK) return 0;
+
+    usize same = 0, dups = 0;
+    for (usize i = 0; i < n; i++) {
+        dup[i] = (u8)server_seen(r, msgs[i].user_id, msgs[i].msg_id);
+        dups += dup[i];
+        if (msgs[i].route == env->route && same == i) same++;
+    }
+    if (same == n && dups == 0) {
+        route_msg(r, c, env, frame, frame_len);
+    } else {
+        u8 one[DBIN_MAX_FRAME_LEN];
+        for (usize i = 0; i < n; i++) {
+            usize len;
+            if (dup[i]) continue;
+            if (dbin_encode(&msgs[i], one, sizeof(one), &len) == DBIN_OK) route_msg(r, c, &msgs[i], one, len);
+        }
+    }
+    for (usize i = 0; i < n; i++) {
+        if (send_ack(r, c, &msgs[i])) return -1;
+    }
+    return 0;
+}
+
+// A PING is answered with a PONG carrying its msg_id; the server speaks as
+// user_id 0.
+static int send_pong(reactor_t *r, conn_t *c, const dbin_msg_t *ping) {
+    dbin_msg_t m;
+    memset(&m, 0, sizeof(m));
+    m.magic = DBIN_MAGIC;
+    m.version = DBIN_VERSION;
+    m.type = DBIN_TYPE_PONG;
+    m.valid = 1;
+    m.route = ping->user_id;
+    m.msg_id = ping->msg_id;
+    return conn_queue_msg(r, c, &m) == DBIN_OK ? 0 : -1;
+}
+
+int server_handle_frame(reactor_t *r, conn_t *c, const dbin_msg_t *m,
+                        const u8 *frame, usize frame_len) {
+    // A connection speaks for the user_id of its first frame.
+    if (!c->bound) server_bind_user(r, c, m->user_id);
+
+    switch (m->type) {
+        case DBIN_TYPE_MSG:
+            // Frames go out as received: to every room member, or to the
+            // direct recipient wherever it is connected. A retransmit whose
+            // ACK was lost is only acknowledged again.
+            if (!server_seen(r, m->user_id, m->msg_id)) route_msg(r, c, m, frame, frame_len);
+            return send_ack(r, c, m);
+        case DBIN_TYPE_ENV:
+            return handle_env(r, c, m, frame, frame_len);
+        case DBIN_TYPE_JOIN:
+            // No ACK when the join did not happen.
+            if (!m->is_room || room_join(r, c, m->route)) return 0;
+            return send_ack(r, c, m);
+        case DBIN_TYPE_LEAVE:
+            if (m->is_room) room_leave(r, c, m->route);
+            return send_ack(r, c, m);
+        case DBIN_TYPE_PING:
+            return send_pong(r, c, m);
+        default:
+            return 0;
+    }
+}
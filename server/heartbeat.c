@@ -0,0 +1,119 @@
+#define _GNU_SOURCE
+
+#include "server.h"
+
+#include "dbin/codec.h"
+#include "dbin/protocol.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+
+// Heartbeats and idle expiry. Each connection has one timer on its
+// reactor's wheel, armed for the next moment anything can be due: when its
+// silence reaches ping_ms, when a PING goes unanswered for pong_ms, or when
+// idle_ms pass without a frame other than PING/PONG. Received frames only
+// stamp the connection; a timer that finds it was active since it was armed
+// is moved to the new deadline instead.
+
+static u32 ms_ticks(u32 ms) {
+    return (ms + SERVER_TICK_MS - 1) / SERVER_TICK_MS;
+}
+
+u64 server_ticks(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return ((u64)ts.tv_sec * 1000u + (u64)ts.tv_nsec / 1000000u) / SERVER_TICK_MS;
+}
+
+static int send_ping(reactor_t *r, conn_t *c) {
+    dbin_msg_t m;
+    memset(&m, 0, sizeof(m));
+    m.magic = DBIN_MAGIC;
+    m.version = DBIN_VERSION;
+    m.type = DBIN_TYPE_PING;
+    m.valid = 1;
+    m.route = c->bound ? c->user_id : 0;
+    m.msg_id = (u16)c->ping_tick;
+    r->pings++;
+    return conn_queue_msg(r, c, &m) == DBIN_OK ? 0 : -1;
+}
+
+// Arm `c`'s timer for the earliest of its deadlines, or leave it off when
+// heartbeats and idle expiry are both disabled.
+static void hb_arm(reactor_t *r, conn_t *c) {
+    const server_t *s = r->srv;
+    u32 now = (u32)r->tick;
+    u32 ping = ms_ticks(s->ping_ms), pong = ms_ticks(s->pong_ms), idle = ms_ticks(s->idle_ms);
+    u32 wait = 0xFFFFFFFFu;
+
+    if (c->pinged && pong) {
+        wait = c->ping_tick + pong - now;
+    } else if (c->pinged && ping) {
+        wait = c->ping_tick + ping - now; // no PONG deadline: just the next PING
+    } else if (ping) {
+        wait = c->rx_tick + ping - now;
+    }
+    if (idle) {
+        u32 w = c->app_tick + idle - now;
+        if (w < wait) wait = w;
+    }
+    if (wait != 0xFFFFFFFFu) wheel_arm(&r->wheel, &c->hb, r->tick + wait);
+}
+
+static void hb_fire(wheel_t *w, wheel_timer_t *t, void *arg) {
+    (void)w;
+    reactor_t *r = (reactor_t*)arg;
+    conn_t *c = (conn_t*)((u8*)t - offsetof(conn_t, hb));
+    const server_t *s = r->srv;
+    u32 now = (u32)r->tick;
+    u32 ping = ms_ticks(s->ping_ms), pong = ms_ticks(s->pong_ms), idle = ms_ticks(s->idle_ms);
+
+    if (c->closing) return;
+    if (idle && now - c->app_tick >= idle) {
+        r->idle_closed++;
+        conn_close(r, c);
+        return;
+    }
+    if (c->pinged && pong && now - c->ping_tick >= pong) {
+        r->hb_closed++;
+        conn_close(r, c);
+        return;
+    }
+    // A PING after `ping` ticks of silence; with the PONG deadline off,
+    // another every `ping` ticks until the peer answers.
+    u32 since = c->pinged ? (pong ? 0 : now - c->ping_tick) : now - c->rx_tick;
+    if (ping && since >= ping) {
+        c->pinged = 1;
+        c->ping_tick = now;
+        if (send_ping(r, c)) {
+            conn_close(r, c);
+            return;
+        }
+    }
+    hb_arm(r, c);
+}
+
+void conn_heartbeat_start(reactor_t *r, conn_t *c) {
+    c->rx_tick = c->app_tick = (u32)r->tick;
+    c->pinged = 0;
+    hb_arm(r, c);
+}
+
+void conn_heartbeat_stop(reactor_t *r, conn_t *c) {
+    wheel_cancel(&r->wheel, &c->hb);
+}
+
+void reactor_clock(reactor_t *r) {
+    r->tick = server_ticks();
+}
+
+void reactor_run_timers(reactor_t *r) {
+    wheel_advance(&r->wheel, r->tick, hb_fire, r);
+}
+
+int reactor_timer_wait_ms(reactor_t *r, int max_ms) {
+    u64 ticks = wheel_next(&r->wheel, r->tick, (u64)max_ms / SERVER_TICK_MS + 1);
+    u64 ms = ticks * SERVER_TICK_MS;
+    return ms < (u64)max_ms ? (int)ms : max_ms;
+}
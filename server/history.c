@@ -0,0 +1,448 @@
+#include "history.h"
+
+#include "dbin/codec.h"
+#include "dbin/protocol.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define SEG_MAGIC   0x53484244u // "DBHS"
+#define SEG_VERSION 1
+
+typedef struct seg_hdr {
+    u32 magic;
+    u32 version;
+    u32 segno;
+    u32 reserved;
+    u64 seg_bytes;
+    u64 created_ns;
+    u8  pad[HISTORY_SEG_HEADER - 32];
+} seg_hdr_t;
+
+#define POS(segno, off) (((u64)(segno) << 32) | (u64)(off))
+#define POS_SEG(p)      ((u32)((p) >> 32))
+#define POS_OFF(p)      ((usize)(u32)(p))
+
+static usize rec_size(usize len) {
+    return sizeof(hist_rec_t) + ((len + 7) & ~(usize)7);
+}
+
+static hist_seg_t *seg_of(const history_t *h, u32 segno) {
+    if (h->nsegs == 0 || segno < h->segs[0].segno) return 0;
+    u32 i = segno - h->segs[0].segno;
+    return i < h->nsegs ? &h->segs[i] : 0;
+}
+
+static hist_rec_t *rec_at(const history_t *h, u64 pos) {
+    hist_seg_t *s = seg_of(h, POS_SEG(pos));
+    return s ? (hist_rec_t*)(s->base + POS_OFF(pos)) : 0;
+}
+
+static void seg_path(const history_t *h, u32 segno, char *out, usize cap) {
+    snprintf(out, cap, "%s/%010u.seg", h->dir, segno);
+}
+
+// ---- room map ----
+
+static usize hr_slot(u32 key, usize cap) {
+    return (usize)(key * 0x9E3779B1u) & (cap - 1);
+}
+
+static hist_room_t *hr_get(const history_t *h, u32 room_id) {
+    if (h->cap == 0) return 0;
+    u32 key = room_id + 1;
+    for (usize i = hr_slot(key, h->cap);; i = (i + 1) & (h->cap - 1)) {
+        if (h->keys[i] == key) return &h->rooms[i];
+        if (h->keys[i] == 0) return 0;
+    }
+}
+
+static int hr_grow(history_t *h) {
+    usize ncap = h->cap ? h->cap * 2 : 64;
+    u32 *nk = (u32*)calloc(ncap, sizeof(*nk));
+    hist_room_t *nv = (hist_room_t*)calloc(ncap, sizeof(*nv));
+    if (!nk || !nv) {
+        free(nk);
+        free(nv);
+        return 1;
+    }
+    for (usize i = 0; i < h->cap; i++) {
+        u32 key = h->keys[i];
+        if (!key) continue;
+        usize j = hr_slot(key, ncap);
+        while (nk[j]) j = (j + 1) & (ncap - 1);
+        nk[j] = key;
+        nv[j] = h->rooms[i];
+    }
+    free(h->keys);
+    free(h->rooms);
+    h->keys = nk;
+    h->rooms = nv;
+    h->cap = ncap;
+    return 0;
+}
+
+static hist_room_t *hr_add(history_t *h, u32 room_id) {
+    hist_room_t *rm = hr_get(h, room_id);
+    if (rm) return rm;
+    if ((h->nrooms + 1) * 2 > h->cap && hr_grow(h)) return 0;
+
+    u32 key = room_id + 1;
+    usize i = hr_slot(key, h->cap);
+    while (h->keys[i]) i = (i + 1) & (h->cap - 1);
+    h->keys[i] = key;
+    memset(&h->rooms[i], 0, sizeof(h->rooms[i]));
+    h->rooms[i].room_id = room_id;
+    h->rooms[i].next_seq = 1;
+    h->nrooms++;
+    return &h->rooms[i];
+}
+
+// Chain a new record onto its room and index it when due: every
+// HISTORY_INDEX_EVERY messages, and the room's first record in a segment so
+// that dropping older segments never strands live records.
+static int room_note(history_t *h, hist_room_t *rm, u64 seq, u64 pos) {
+    int new_seg = !rm->tail || POS_SEG(rm->tail) != POS_SEG(pos);
+    if (rm->tail) {
+        hist_rec_t *prev = rec_at(h, rm->tail);
+        if (prev) prev->next = pos;
+    }
+    if (rm->nidx == 0 || new_seg || seq - rm->indexed >= HISTORY_INDEX_EVERY) {
+        if (rm->nidx == rm->idx_cap) {
+            u32 ncap = rm->idx_cap ? rm->idx_cap * 2 : 4;
+            hist_ent_t *ni = (hist_ent_t*)realloc(rm->idx, ncap * sizeof(*ni));
+            if (!ni) return 1;
+            rm->idx = ni;
+            rm->idx_cap = ncap;
+        }
+        rm->idx[rm->nidx].seq = seq;
+        rm->idx[rm->nidx].pos = pos;
+        rm->nidx++;
+        rm->indexed = seq;
+    }
+    rm->tail = pos;
+    rm->tail_seq = seq;
+    rm->next_seq = seq + 1;
+    return 0;
+}
+
+// ---- segments ----
+
+static int seg_push(history_t *h, const hist_seg_t *s) {
+    if (h->nsegs == h->segs_cap) {
+        u32 ncap = h->segs_cap ? h->segs_cap * 2 : 8;
+        hist_seg_t *ns = (hist_seg_t*)realloc(h->segs, ncap * sizeof(*ns));
+        if (!ns) return 1;
+        h->segs = ns;
+        h->segs_cap = ncap;
+    }
+    h->segs[h->nsegs++] = *s;
+    return 0;
+}
+
+static int seg_map(history_t *h, hist_seg_t *s, int fd) {
+    void *p = mmap(NULL, h->cfg.seg_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) return 1;
+    s->fd = fd;
+    s->base = (u8*)p;
+    return 0;
+}
+
+static int seg_create(history_t *h, u32 segno, u64 now_ns) {
+    char path[4200];
+    seg_path(h, segno, path, sizeof(path));
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return 1;
+
+    hist_seg_t s;
+    memset(&s, 0, sizeof(s));
+    s.segno = segno;
+    s.used = HISTORY_SEG_HEADER;
+    s.last_ts = now_ns;
+    if (ftruncate(fd, (off_t)h->cfg.seg_bytes) != 0 || seg_map(h, &s, fd) || seg_push(h, &s)) {
+        if (s.base) munmap(s.base, h->cfg.seg_bytes);
+        close(fd);
+        unlink(path);
+        return 1;
+    }
+
+    seg_hdr_t *hdr = (seg_hdr_t*)s.base;
+    hdr->magic = SEG_MAGIC;
+    hdr->version = SEG_VERSION;
+    hdr->segno = segno;
+    hdr->seg_bytes = h->cfg.seg_bytes;
+    hdr->created_ns = now_ns;
+    h->synced = 0;
+    return 0;
+}
+
+static int msync_range(history_t *h, const hist_seg_t *s, usize from, usize to) {
+    if (to <= from) return 0;
+    usize page = (usize)sysconf(_SC_PAGESIZE);
+    usize start = from & ~(page - 1);
+    h->syncs++;
+    return msync(s->base + start, to - start, MS_SYNC) != 0;
+}
+
+static void drop_oldest(history_t *h) {
+    hist_seg_t *s = &h->segs[0];
+    u32 segno = s->segno;
+    char path[4200];
+    seg_path(h, segno, path, sizeof(path));
+    munmap(s->base, h->cfg.seg_bytes);
+    close(s->fd);
+    unlink(path);
+    memmove(h->segs, h->segs + 1, (h->nsegs - 1) * sizeof(*h->segs));
+    h->nsegs--;
+    h->segs_dropped++;
+
+    // Index entries and tails into the dropped segment go with it.
+    for (usize i = 0; i < h->cap; i++) {
+        if (!h->keys[i]) continue;
+        hist_room_t *rm = &h->rooms[i];
+        u32 k = 0;
+        while (k < rm->nidx && POS_SEG(rm->idx[k].pos) <= segno) k++;
+        if (k) {
+            memmove(rm->idx, rm->idx + k, (rm->nidx - k) * sizeof(*rm->idx));
+            rm->nidx -= k;
+        }
+        if (rm->tail && POS_SEG(rm->tail) <= segno) rm->tail = 0;
+    }
+}
+
+// Drop old segments by size and age; the segment being appended to stays.
+static void retain(history_t *h, u64 now_ns) {
+    while (h->nsegs > 1) {
+        int over = h->cfg.max_bytes && history_bytes(h) > h->cfg.max_bytes;
+        int old = h->cfg.max_age_ns && h->segs[0].last_ts + h->cfg.max_age_ns < now_ns;
+        if (!over && !old) break;
+        drop_oldest(h);
+    }
+}
+
+static int rotate(history_t *h, u64 now_ns) {
+    if (h->nsegs > 0) {
+        hist_seg_t *cur = &h->segs[h->nsegs - 1];
+        if (h->cfg.sync != HISTORY_SYNC_NONE) msync_range(h, cur, h->synced, cur->used);
+        if (seg_create(h, cur->segno + 1, now_ns)) return 1;
+    } else if (seg_create(h, 1, now_ns)) {
+        return 1;
+    }
+    retain(h, now_ns);
+    return 0;
+}
+
+// Rebuild room chains and indexes from one segment's records.
+static int seg_recover(history_t *h, hist_seg_t *s) {
+    usize off = HISTORY_SEG_HEADER;
+    while (off + sizeof(hist_rec_t) <= h->cfg.seg_bytes) {
+        hist_rec_t *r = (hist_rec_t*)(s->base + off);
+        if (r->len == 0 || r->len > DBIN_MAX_FRAME_LEN || off + rec_size(r->len) > h->cfg.seg_bytes) break;
+        hist_room_t *rm = hr_add(h, r->room_id);
+        if (!rm || room_note(h, rm, r->seq, POS(s->segno, off))) return 1;
+        s->last_ts = r->ts_ns;
+        off += rec_size(r->len);
+    }
+    s->used = off;
+    return 0;
+}
+
+static int cmp_u32(const void *a, const void *b) {
+    u32 x = *(const u32*)a, y = *(const u32*)b;
+    return (x > y) - (x < y);
+}
+
+static u64 wall_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+}
+
+int history_open(history_t *h, const char *dir, const history_cfg_t *cfg) {
+    memset(h, 0, sizeof(*h));
+    h->cfg = *cfg;
+    if (h->cfg.seg_bytes == 0) h->cfg.seg_bytes = HISTORY_SEG_BYTES;
+    usize page = (usize)sysconf(_SC_PAGESIZE);
+    if (h->cfg.seg_bytes % page || h->cfg.seg_bytes < HISTORY_SEG_HEADER + rec_size(DBIN_MAX_FRAME_LEN) ||
+        strlen(dir) >= sizeof(h->dir)) {
+        errno = EINVAL;
+        return 1;
+    }
+    strcpy(h->dir, dir);
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) return 1;
+
+    // Existing segments: the newest run of consecutive numbers.
+    DIR *d = opendir(dir);
+    if (!d) return 1;
+    u32 *nums = 0;
+    usize n = 0, ncap = 0;
+    struct dirent *e;
+    while ((e = readdir(d)) != 0) {
+        unsigned segno = 0;
+        char tail[8];
+        if (sscanf(e->d_name, "%10u.%4s", &segno, tail) != 2 || strcmp(tail, "seg") || segno == 0) continue;
+        if (n == ncap) {
+            ncap = ncap ? ncap * 2 : 16;
+            u32 *nn = (u32*)realloc(nums, ncap * sizeof(*nn));
+            if (!nn) {
+                free(nums);
+                closedir(d);
+                return 1;
+            }
+            nums = nn;
+        }
+        nums[n++] = segno;
+    }
+    closedir(d);
+    qsort(nums, n, sizeof(*nums), cmp_u32);
+    usize first = n;
+    while (first > 0 && (first == n || nums[first - 1] + 1 == nums[first])) first--;
+
+    for (usize i = first; i < n; i++) {
+        char path[4200];
+        seg_path(h, nums[i], path, sizeof(path));
+        int fd = open(path, O_RDWR);
+        struct stat st;
+        hist_seg_t s;
+        memset(&s, 0, sizeof(s));
+        s.segno = nums[i];
+        if (fd < 0 || fstat(fd, &st) != 0 || (usize)st.st_size != h->cfg.seg_bytes || seg_map(h, &s, fd)) {
+            if (fd >= 0) close(fd);
+            free(nums);
+            errno = EINVAL; // segment size changed, or unreadable
+            return 1;
+        }
+        const seg_hdr_t *hdr = (const seg_hdr_t*)s.base;
+        if (hdr->magic != SEG_MAGIC || hdr->version != SEG_VERSION || hdr->segno != nums[i] ||
+            seg_push(h, &s) || seg_recover(h, &h->segs[h->nsegs - 1])) {
+            munmap(s.base, h->cfg.seg_bytes);
+            close(fd);
+            free(nums);
+            errno = EINVAL;
+            return 1;
+        }
+    }
+    free(nums);
+
+    u64 now = wall_ns();
+    if (h->nsegs == 0 && rotate(h, now)) return 1;
+    h->synced = h->segs[h->nsegs - 1].used;
+    h->last_sync_ns = now;
+    retain(h, now);
+    return 0;
+}
+
+void history_close(history_t *h) {
+    if (h->cfg.sync != HISTORY_SYNC_NONE) history_sync(h);
+    for (u32 i = 0; i < h->nsegs; i++) {
+        munmap(h->segs[i].base, h->cfg.seg_bytes);
+        close(h->segs[i].fd);
+    }
+    for (usize i = 0; i < h->cap; i++) {
+        if (h->keys[i]) free(h->rooms[i].idx);
+    }
+    free(h->segs);
+    free(h->keys);
+    free(h->rooms);
+    memset(h, 0, sizeof(*h));
+}
+
+int history_append(history_t *h, u32 room_id, const u8 *frame, usize len, u64 now_ns, u64 *seq) {
+    if (len == 0 || len > DBIN_MAX_FRAME_LEN) return 1;
+    usize need = rec_size(len);
+    hist_seg_t *cur = &h->segs[h->nsegs - 1];
+    if (cur->used + need > h->cfg.seg_bytes) {
+        if (rotate(h, now_ns)) return 1;
+        cur = &h->segs[h->nsegs - 1];
+    }
+    hist_room_t *rm = hr_add(h, room_id);
+    if (!rm) return 1;
+
+    // The frame first and `len` last: a record cut short by a crash reads
+    // as the end of the segment.
+    usize off = cur->used;
+    hist_rec_t *r = (hist_rec_t*)(cur->base + off);
+    memcpy(r + 1, frame, len);
+    r->room_id = room_id;
+    r->seq = rm->next_seq;
+    r->ts_ns = now_ns;
+    r->next = 0;
+    r->len = (u32)len;
+    cur->used += need;
+    cur->last_ts = now_ns;
+
+    u64 s = rm->next_seq;
+    if (room_note(h, rm, s, POS(cur->segno, off))) return 1;
+    if (seq) *seq = s;
+    h->appends++;
+
+    switch (h->cfg.sync) {
+        case HISTORY_SYNC_EVERY:
+            if (msync_range(h, cur, h->synced, cur->used)) return 1;
+            h->synced = cur->used;
+            break;
+        case HISTORY_SYNC_BYTES:
+            if (cur->used - h->synced >= h->cfg.sync_arg) {
+                if (msync_range(h, cur, h->synced, cur->used)) return 1;
+                h->synced = cur->used;
+            }
+            break;
+        default:
+            break;
+    }
+    return 0;
+}
+
+usize history_read(history_t *h, u32 room_id, u64 from_seq, dbin_msg_t *out, u64 *seqs, usize n) {
+    hist_room_t *rm = hr_get(h, room_id);
+    if (!rm || rm->nidx == 0 || n == 0) return 0;
+
+    // Last index entry at or before from_seq (the oldest when from_seq is
+    // older than anything kept), then along the chain.
+    u32 lo = 0, hi = rm->nidx - 1;
+    while (lo < hi) {
+        u32 mid = lo + (hi - lo + 1) / 2;
+        if (rm->idx[mid].seq <= from_seq) lo = mid;
+        else hi = mid - 1;
+    }
+
+    usize got = 0;
+    for (u64 pos = rm->idx[lo].pos; pos && got < n;) {
+        const hist_rec_t *r = rec_at(h, pos);
+        if (!r) break;
+        if (r->seq >= from_seq && dbin_decode((const u8*)(r + 1), r->len, &out[got]) == DBIN_OK) {
+            if (seqs) seqs[got] = r->seq;
+            got++;
+        }
+        pos = r->next;
+    }
+    return got;
+}
+
+u64 history_next_seq(const history_t *h, u32 room_id) {
+    const hist_room_t *rm = hr_get(h, room_id);
+    return rm ? rm->next_seq : 1;
+}
+
+void history_tick(history_t *h, u64 now_ns) {
+    if (h->cfg.sync == HISTORY_SYNC_INTERVAL && now_ns - h->last_sync_ns >= h->cfg.sync_arg) {
+        history_sync(h);
+        h->last_sync_ns = now_ns;
+    }
+    if (h->cfg.max_age_ns) retain(h, now_ns);
+}
+
+int history_sync(history_t *h) {
+    hist_seg_t *cur = &h->segs[h->nsegs - 1];
+    if (msync_range(h, cur, h->synced, cur->used)) return 1;
+    h->synced = cur->used;
+    return 0;
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "dbin/types.h"
+#include "dbin/dbin.h"
+
+// Per-room message history for catch-up after a reconnect.
+//
+// Encoded room MSG frames are appended as received (never re-encoded) to
+// fixed-size segment files, each mapped whole with mmap. A record is
+// [hist_rec_t][frame, padded to 8]; records of one room are chained oldest
+// to newest through `next`, and every room keeps a sparse index from its
+// per-room sequence numbers to record positions: every HISTORY_INDEX_EVERY
+// messages, plus the room's first record in each segment. A catch-up read
+// binary-searches the index and follows the chain, decoding frames straight
+// from the mapped pages.
+//
+// Retention drops whole segments, oldest first, by total size and by age.
+// Files are in host byte order: a local store, not an interchange format.
+// One thread owns a history_t; nothing here locks.
+
+#define HISTORY_INDEX_EVERY 64          // messages between a room's index entries
+#define HISTORY_SEG_BYTES   (64u << 20) // default segment size
+#define HISTORY_SEG_HEADER  64
+
+enum {
+    HISTORY_SYNC_NONE,     // the kernel writes pages back when it likes
+    HISTORY_SYNC_EVERY,    // msync each append before returning
+    HISTORY_SYNC_BYTES,    // msync once sync_arg bytes are unsynced
+    HISTORY_SYNC_INTERVAL, // msync from history_tick every sync_arg ns
+};
+
+typedef struct history_cfg {
+    usize seg_bytes;  // segment size, a multiple of the page size
+    u64   max_bytes;  // keep at most this many segment bytes (0 = no limit)
+    u64   max_age_ns; // drop segments whose newest record is older (0 = keep)
+    int   sync;       // HISTORY_SYNC_*
+    u64   sync_arg;
+} history_cfg_t;
+
+// On disk, at 8-byte aligned offsets; len == 0 ends a segment's records.
+typedef struct hist_rec {
+    u32 room_id;
+    u32 len;     // frame bytes
+    u64 seq;     // per-room, from 1
+    u64 ts_ns;
+    u64 next;    // position of the room's next record, 0 = none yet
+} hist_rec_t;
+
+typedef struct hist_seg {
+    u32   segno;
+    int   fd;
+    u8   *base;
+    usize used;     // bytes of header and records
+    u64   last_ts;  // newest record, for age retention
+} hist_seg_t;
+
+typedef struct hist_ent {
+    u64 seq;
+    u64 pos;        // (segno << 32) | offset
+} hist_ent_t;
+
+typedef struct hist_room {
+    u32   room_id;
+    u32   nidx;
+    u32   idx_cap;
+    u64   next_seq;
+    u64   tail;     // position of the newest record, 0 = none live
+    u64   tail_seq;
+    u64   indexed;  // seq of the newest index entry
+    hist_ent_t *idx;
+} hist_room_t;
+
+typedef struct history {
+    history_cfg_t cfg;
+    char  dir[4096];
+
+    hist_seg_t *segs;   // live segments, oldest first, consecutive segnos
+    u32   nsegs;
+    u32   segs_cap;
+
+    // room_id -> room (open addressing, linear probing, rooms inline)
+    u32  *keys;         // room_id + 1; 0 = empty
+    hist_room_t *rooms;
+    usize cap;
+    usize nrooms;
+
+    usize synced;       // bytes of the newest segment already msync'd
+    u64   last_sync_ns;
+
+    u64   appends;
+    u64   syncs;
+    u64   segs_dropped;
+} history_t;
+
+// Open (creating `dir` if needed) and recover the segments already there.
+// Nonzero on failure, with errno set.
+int   history_open(history_t *h, const char *dir, const history_cfg_t *cfg);
+void  history_close(history_t *h);
+
+// Append the encoded room frame `frame` for `room_id`. *seq (optional)
+// returns its per-room sequence number. May rotate segments and apply
+// retention, which invalidates views from earlier reads.
+int   history_append(history_t *h, u32 room_id, const u8 *frame, usize len, u64 now_ns, u64 *seq);
+
+// Up to `n` messages of `room_id` with seq >= from_seq, oldest first.
+// out[i] views the mapped frame (msg points into it) and stays valid until
+// the next append or tick; seqs (optional) receives their sequence numbers.
+// Returns the number of messages.
+usize history_read(history_t *h, u32 room_id, u64 from_seq, dbin_msg_t *out, u64 *seqs, usize n);
+
+// Next sequence number `room_id` will get (1 for an unknown room).
+u64   history_next_seq(const history_t *h, u32 room_id);
+
+// Time-driven policy: interval syncs and age retention.
+void  history_tick(history_t *h, u64 now_ns);
+
+// Flush everything appended so far.
+int   history_sync(history_t *h);
+
+// Bytes of live segments on disk.
+static inline u64 history_bytes(const history_t *h) {
+    return (u64)h->nsegs * h->cfg.seg_bytes;
+}
@@ -0,0 +1,189 @@
+// dbin-server: sharded server for dBIN frames, one reactor per core.
+// Build:
+//   make server                  (epoll)
+//   make server BACKEND=uring    (io_uring)
+// Run:
+//   ./dbin-server [-z] [-u|-U] [-k ping_ms[:pong_ms[:idle_ms]]] 127.0.0.1 9000 [threads] [capture_prefix]
+// (threads defaults to the number of online CPUs; 0 = same, without pinning.
+// With a capture prefix, every received frame is recorded to
+// <prefix>.<shard>.dcap for replay with cap-replay. -z sends large output
+// batches with MSG_ZEROCOPY, epoll backend only. -u also serves dBIN
+// datagrams on the same UDP port, with GRO/GSO when the kernel has them; -U
+// does so without offloads; epoll backend only. -k sets the heartbeat: a
+// PING after ping_ms of silence, a close after pong_ms more, and a close
+// after idle_ms without a MSG-level frame; 0 turns one off (with pong_ms 0,
+// an unanswered PING is repeated every ping_ms instead).)
+
+#include "server.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+static void raise_limit(int resource) {
+    struct rlimit rl;
+    if (getrlimit(resource, &rl) != 0) return;
+    rl.rlim_cur = rl.rlim_max;
+    setrlimit(resource, &rl);
+}
+
+int main(int argc, char **argv) {
+    int zerocopy = 0, udp = 0; // udp: 1 = plain, 2 = with offloads
+    u32 ping_ms = SERVER_PING_MS, pong_ms = SERVER_PONG_MS, idle_ms = SERVER_IDLE_MS;
+    int opt = 1;
+    while (opt < argc && argv[opt][0] == '-') {
+        if (strcmp(argv[opt], "-z") == 0) {
+            zerocopy = 1;
+            opt++;
+        } else if (strcmp(argv[opt], "-u") == 0 || strcmp(argv[opt], "-U") == 0) {
+            udp = argv[opt][1] == 'u' ? 2 : 1;
+            opt++;
+        } else if (strcmp(argv[opt], "-k") == 0 && opt + 1 < argc &&
+                   sscanf(argv[opt + 1], "%u:%u:%u", &ping_ms, &pong_ms, &idle_ms) >= 1) {
+            opt += 2;
+        } else {
+            argc = 0;
+            break;
+        }
+    }
+    argv += opt - 1;
+    argc -= opt - 1;
+    if (argc < 3 || argc > 5) {
+        fprintf(stderr, "usage: %s [-z] [-u|-U] [-k ping_ms[:pong_ms[:idle_ms]]] <ip> <port> [threads]"
+                        " [capture_prefix]\n", argv[0]);
+        return 1;
+    }
+    const char *ip = argv[1];
+    int port = atoi(argv[2]);
+    int ncpu = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = (argc >= 4) ? atoi(argv[3]) : ncpu;
+    const char *capture = (argc == 5) ? argv[4] : 0;
+    int pin = threads > 0;
+    if (threads <= 0) threads = ncpu;
+
+    // Idle-heavy deployments need far more descriptors than the usual soft
+    // limit; io_uring's registered send buffers count as locked memory.
+    raise_limit(RLIMIT_NOFILE);
+    raise_limit(RLIMIT_MEMLOCK);
+
+    // Reactor threads inherit this mask; only the main thread takes signals.
+    sigset_t sigs;
+    sigemptyset(&sigs);
+    sigaddset(&sigs, SIGINT);
+    sigaddset(&sigs, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &sigs, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    server_t srv;
+    if (server_init(&srv, ip, port, threads, pin)) {
+        perror("server init");
+        server_destroy(&srv);
+        return 1;
+    }
+    srv.zerocopy = zerocopy;
+    srv.ping_ms = ping_ms;
+    srv.pong_ms = pong_ms;
+    srv.idle_ms = idle_ms;
+    int udp_on = udp && strcmp(transport_name, "epoll") == 0;
+    if (udp_on && server_udp_start(&srv, ip, port, udp == 2)) {
+        perror("udp");
+        server_destroy(&srv);
+        return 1;
+    }
+    if (capture && server_capture_start(&srv, capture)) {
+        perror("capture");
+        server_destroy(&srv);
+        return 1;
+    }
+    if (server_start(&srv)) {
+        perror("pthread_create");
+        return 1;
+    }
+
+    printf("[server] listening on %s:%d with %d %s shard(s)\n", ip, port, srv.nshards, transport_name);
+    if (zerocopy && strcmp(transport_name, "epoll") != 0) printf("[server] -z ignored: epoll backend only\n");
+    if (udp && !udp_on) printf("[server] -u ignored: epoll backend only\n");
+    if (udp_on) {
+        int off = udp_offload(&srv.shards[0]);
+        printf("[server] udp on %s:%d, GRO %s, GSO %s\n", ip, port, off & 1 ? "on" : "off", off & 2 ? "on" : "off");
+    }
+    fflush(stdout);
+
+    int sig = 0;
+    sigwait(&sigs, &sig);
+    server_stop(&srv);
+    u64 captured = capture ? server_capture_stop(&srv) : 0;
+
+    u64 in = 0, out = 0, fwd = 0, drops = 0, room_drops = 0, calls = 0, zc = 0, zc_copied = 0;
+    u64 pings = 0, hb_closed = 0, idle_closed = 0, dups = 0, dg_in = 0, dg_out = 0, dg_drops = 0;
+    for (int i = 0; i < srv.nshards; i++) {
+        reactor_t *r = &srv.shards[i];
+        printf("[server] shard %d (cpu %d): frames in %llu, out %llu, forwarded %llu\n",
+               i, r->cpu, (unsigned long long)r->frames_in, (unsigned long long)r->frames_out,
+               (unsigned long long)r->forwarded);
+        in += r->frames_in;
+        out += r->frames_out;
+        fwd += r->forwarded;
+        drops += r->xq_drops;
+        room_drops += r->room_drops;
+        calls += r->syscalls;
+        zc += r->zc_sends;
+        zc_copied += r->zc_copied;
+        pings += r->pings;
+        hb_closed += r->hb_closed;
+        idle_closed += r->idle_closed;
+        dups += r->dups;
+        dg_in += r->dgrams_in;
+        dg_out += r->dgrams_out;
+        dg_drops += r->dgram_drops;
+    }
+    printf("[server] total: frames in %llu, out %llu, forwarded %llu, queue drops %llu, room drops %llu\n",
+           (unsigned long long)in, (unsigned long long)out,
+           (unsigned long long)fwd, (unsigned long long)drops, (unsigned long long)room_drops);
+    printf("[server] %s syscalls %llu, %.3f per frame in\n", transport_name,
+           (unsigned long long)calls, in ? (double)calls / (double)in : 0.0);
+
+    if (zerocopy) {
+        printf("[server] zerocopy: %llu sends, %llu completed by copying\n", (unsigned long long)zc,
+               (unsigned long long)zc_copied);
+    }
+
+    if (udp_on) {
+        printf("[server] udp: %llu datagrams in, %llu out, %llu sends dropped\n", (unsigned long long)dg_in,
+               (unsigned long long)dg_out, (unsigned long long)dg_drops);
+    }
+
+    printf("[server] heartbeat: %llu pings, %llu closed unanswered, %llu closed idle\n", (unsigned long long)pings,
+           (unsigned long long)hb_closed, (unsigned long long)idle_closed);
+
+    printf("[server] dedup: %llu repeated msg_ids dropped, window table %u users x %zu B\n",
+           (unsigned long long)dups, SERVER_USER_SPACE, sizeof(dbin_dedup_t));
+
+    usize table = (usize)SERVER_USER_SPACE * sizeof(route_t);
+    printf("[server] routing: %u users x %zu B = %.1f MiB table, %.1f KiB arena index\n",
+           SERVER_USER_SPACE, sizeof(route_t), (double)table / (1 << 20),
+           (double)(server_route_footprint(&srv) - table) / 1024.0);
+
+    // Buffer pools: slab memory, and blocks at the busiest moment per class.
+    static const u32 sizes[SLAB_CLASSES] = SLAB_CLASS_SIZES;
+    u64 slab_bytes = 0, peak[SLAB_CLASSES] = { 0 }, large = 0;
+    for (int i = 0; i < srv.nshards; i++) {
+        const slab_pool_t *p = &srv.shards[i].pool;
+        slab_bytes += slab_pool_bytes(p);
+        for (int k = 0; k < SLAB_CLASSES; k++) peak[k] += p->cls[k].peak;
+        large += p->large_allocs;
+    }
+    printf("[server] buffers: %.1f MiB of slabs, peak blocks", (double)slab_bytes / (1 << 20));
+    for (int k = 0; k < SLAB_CLASSES; k++) printf(" %u:%llu", sizes[k], (unsigned long long)peak[k]);
+    printf(", %llu large\n", (unsigned long long)large);
+
+    if (capture) {
+        printf("[server] capture: %llu frames to %s.<shard>.dcap\n", (unsigned long long)captured, capture);
+    }
+
+    server_destroy(&srv);
+    return 0;
+}
@@ -0,0 +1,207 @@
+#include "server.h"
+
+#include "dbin/codec.h"
+#include "dbin/protocol.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define FANOUT_PREFETCH 8 // members ahead whose connection is pulled into cache
+
+// ---- per-shard room map ----
+
+static usize rm_slot(u32 key, usize cap) {
+    return (usize)(key * 0x9E3779B1u) & (cap - 1);
+}
+
+static room_t *rm_get(const room_map_t *m, u32 room_id) {
+    if (m->cap == 0) return 0;
+    u32 key = room_id + 1;
+    for (usize i = rm_slot(key, m->cap);; i = (i + 1) & (m->cap - 1)) {
+        if (m->keys[i] == key) return &m->vals[i];
+        if (m->keys[i] == 0) return 0;
+    }
+}
+
+static int rm_grow(room_map_t *m) {
+    usize ncap = m->cap ? m->cap * 2 : 64;
+    u32 *nk = (u32*)calloc(ncap, sizeof(*nk));
+    room_t *nv = (room_t*)calloc(ncap, sizeof(*nv));
+    if (!nk || !nv) {
+        free(nk);
+        free(nv);
+        return 1;
+    }
+
+    for (usize i = 0; i < m->cap; i++) {
+        u32 key = m->keys[i];
+        if (!key) continue;
+        usize j = rm_slot(key, ncap);
+        while (nk[j]) j = (j + 1) & (ncap - 1);
+        nk[j] = key;
+        nv[j] = m->vals[i];
+    }
+    free(m->keys);
+    free(m->vals);
+    m->keys = nk;
+    m->vals = nv;
+    m->cap = ncap;
+    return 0;
+}
+
+// Existing room, or a new empty one.
+static room_t *rm_add(room_map_t *m, u32 room_id) {
+    room_t *rm = rm_get(m, room_id);
+    if (rm) return rm;
+    if ((m->len + 1) * 2 > m->cap && rm_grow(m)) return 0;
+
+    u32 key = room_id + 1;
+    usize i = rm_slot(key, m->cap);
+    while (m->keys[i]) i = (i + 1) & (m->cap - 1);
+    m->keys[i] = key;
+    memset(&m->vals[i], 0, sizeof(m->vals[i]));
+    m->vals[i].id = room_id;
+    m->len++;
+    return &m->vals[i];
+}
+
+static void rm_del(room_map_t *m, u32 room_id) {
+    if (m->cap == 0) return;
+    u32 key = room_id + 1;
+    usize mask = m->cap - 1;
+    usize i = rm_slot(key, m->cap);
+    while (m->keys[i] != key) {
+        if (!m->keys[i]) return;
+        i = (i + 1) & mask;
+    }
+    free(m->vals[i].members);
+
+    // Backward-shift deletion keeps probe chains intact without tombstones.
+    for (usize j = (i + 1) & mask; m->keys[j]; j = (j + 1) & mask) {
+        usize home = rm_slot(m->keys[j], m->cap);
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            m->keys[i] = m->keys[j];
+            m->vals[i] = m->vals[j];
+            i = j;
+        }
+    }
+    m->keys[i] = 0;
+    memset(&m->vals[i], 0, sizeof(m->vals[i]));
+    m->len--;
+}
+
+void room_map_free(room_map_t *m) {
+    for (usize i = 0; i < m->cap; i++) {
+        if (m->keys[i]) free(m->vals[i].members);
+    }
+    free(m->keys);
+    free(m->vals);
+    memset(m, 0, sizeof(*m));
+}
+
+// ---- membership ----
+
+int room_join(reactor_t *r, conn_t *c, u32 room_id) {
+    for (u32 k = 0; k < c->nrooms; k++) {
+        if (c->rooms[k].room_id == room_id) return 0;
+    }
+
+    if (c->nrooms == c->rooms_cap) {
+        u32 ncap = c->rooms_cap ? c->rooms_cap * 2 : 4;
+        conn_room_t *nr = (conn_room_t*)realloc(c->rooms, ncap * sizeof(*nr));
+        if (!nr) return -1;
+        c->rooms = nr;
+        c->rooms_cap = ncap;
+    }
+
+    room_t *rm = rm_add(&r->rooms, room_id);
+    if (!rm) return -1;
+    if (rm->n == rm->cap) {
+        u32 ncap = rm->cap ? rm->cap * 2 : 4;
+        conn_t **nm = (conn_t**)realloc(rm->members, ncap * sizeof(*nm));
+        if (!nm) {
+            if (rm->n == 0) rm_del(&r->rooms, room_id);
+            return -1;
+        }
+        rm->members = nm;
+        rm->cap = ncap;
+    }
+
+    c->rooms[c->nrooms].room_id = room_id;
+    c->rooms[c->nrooms].idx = rm->n;
+    c->nrooms++;
+    rm->members[rm->n++] = c;
+
+    if (rm->n == 1) server_room_occupied(r, room_id, 1);
+    return 0;
+}
+
+static void leave_at(reactor_t *r, conn_t *c, u32 k) {
+    conn_room_t cr = c->rooms[k];
+    c->rooms[k] = c->rooms[--c->nrooms];
+
+    room_t *rm = rm_get(&r->rooms, cr.room_id);
+    if (!rm) return;
+
+    // Swap-remove; the member moved into the hole learns its new slot.
+    conn_t *last = rm->members[--rm->n];
+    if (cr.idx != rm->n) {
+        rm->members[cr.idx] = last;
+        for (u32 j = 0; j < last->nrooms; j++) {
+            if (last->rooms[j].room_id == cr.room_id) {
+                last->rooms[j].idx = cr.idx;
+                break;
+            }
+        }
+    }
+
+    if (rm->n == 0) {
+        rm_del(&r->rooms, cr.room_id);
+        server_room_occupied(r, cr.room_id, 0);
+    }
+}
+
+void room_leave(reactor_t *r, conn_t *c, u32 room_id) {
+    for (u32 k = 0; k < c->nrooms; k++) {
+        if (c->rooms[k].room_id == room_id) {
+            leave_at(r, c, k);
+            return;
+        }
+    }
+}
+
+void room_leave_all(reactor_t *r, conn_t *c) {
+    while (c->nrooms > 0) leave_at(r, c, c->nrooms - 1);
+}
+
+// ---- fan-out ----
+
+usize room_fanout(reactor_t *r, u32 room_id, const u8 *frame, usize len, const conn_t *except) {
+    room_t *rm = rm_get(&r->rooms, room_id);
+    if (!rm || len > DBIN_MAX_FRAME_LEN) return 0;
+
+    // Encoded once, with its length prefix; every member's queue takes a reference.
+    obuf_t *b = obuf_new_shared(r, DBIN_LEN_PREFIX_BYTES + len);
+    if (!b) return 0;
+    b->data[0] = (u8)(len >> 8);
+    b->data[1] = (u8)len;
+    memcpy(b->data + DBIN_LEN_PREFIX_BYTES, frame, len);
+    b->len = (u32)(DBIN_LEN_PREFIX_BYTES + len);
+
+    usize n = 0;
+    for (u32 i = 0; i < rm->n; i++) {
+        if (i + FANOUT_PREFETCH < rm->n) __builtin_prefetch(rm->members[i + FANOUT_PREFETCH]);
+
+        conn_t *m = rm->members[i];
+        if (m == except) continue;
+        // A member this far behind would only pin buffers; it misses the frame.
+        if (conn_out_pending(m) > SERVER_ROOM_DROP_WATER) {
+            r->room_drops++;
+            continue;
+        }
+        if (conn_queue_buf(r, m, b) == DBIN_OK) n++;
+    }
+
+    obuf_release(r, b);
+    return n;
+}
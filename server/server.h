@@ -0,0 +1,375 @@
+#pragma once
+
+#include "dbin/types.h"
+#include "dbin/dbin.h"
+#include "dbin/stream.h"
+#include "dbin/ack.h"
+#include "dbin/dedup.h"
+
+#include "spsc.h"
+#include "slab.h"
+#include "wheel.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define SERVER_MAX_EVENTS     256
+#define SERVER_MAX_SHARDS     64
+#define SERVER_INBUF_SIZE     16384      // per-connection receive buffer while a frame is partial
+#define SERVER_OUT_HIGH_WATER (1u << 20) // stop reading a connection whose peer is not draining
+#define SERVER_XQ_BYTES       (256u * 1024u) // per shard-pair queue of forwarded frames
+#define SERVER_ROOM_DROP_WATER (4u << 20) // room frames to a member this far behind are dropped
+#define SERVER_OBUF_SIZE      2048       // smallest private output buffer (a tick of ACKs)
+#define SERVER_USER_SPACE     (1u << 20) // 20-bit user_id
+#define SERVER_CAP_BUF        (1u << 20) // capture records buffered per shard between writes
+#define SERVER_CAP_INDEX      32768      // capture index entries per shard (footer fits SERVER_CAP_BUF)
+#define SERVER_ZC_MIN_BYTES   16384      // smallest send worth MSG_ZEROCOPY (when enabled)
+#define SERVER_TICK_MS        10         // timer wheel resolution
+#define SERVER_PING_MS        30000      // silence after which a connection is sent a PING
+#define SERVER_PONG_MS        10000      // further silence after a PING before it is closed
+#define SERVER_IDLE_MS        0          // close after this long without a MSG-level frame; 0 = never
+
+// Routing table entry: (shard + 1) in the top bits, the connection's slot in
+// that shard below; 0 = user not connected. 4 bytes per user_id.
+typedef u32 route_t;
+#define ROUTE_SLOT_BITS   25
+#define ROUTE_SLOT_MAX    (1u << ROUTE_SLOT_BITS) // connections per shard
+#define ROUTE_MAKE(shard, slot) ((((route_t)(shard) + 1) << ROUTE_SLOT_BITS) | (route_t)(slot))
+#define ROUTE_SHARD(e)    ((int)((e) >> ROUTE_SLOT_BITS) - 1)
+#define ROUTE_SLOT(e)     ((e) & (ROUTE_SLOT_MAX - 1))
+#define SERVER_CONN_CHUNK 1024 // connections per arena chunk
+
+typedef struct conn conn_t;
+typedef struct reactor reactor_t;
+typedef struct server server_t;
+typedef struct shard_cap shard_cap_t;
+typedef struct udp udp_t;
+
+// Output bytes shared by reference. A room frame is encoded once into a
+// shared buffer and queued to every member; a connection's own frames are
+// appended to a private one. Buffers come from the reactor's slab pool,
+// whose size classes fit header-only, chat-sized and maximum frames.
+typedef struct obuf {
+    u32 refs;
+    u32 len;
+    u32 cap;
+    u8  shared;
+    u8  data[];
+} obuf_t;
+
+typedef struct out_seg {
+    obuf_t *buf;
+    u32     off;
+    u32     len;
+} out_seg_t;
+
+// An output buffer the kernel may still read from: pinned by a reference
+// until the completion of zerocopy send `seq` arrives.
+typedef struct zc_pin {
+    u32     seq;
+    obuf_t *buf;  // 0 once released
+} zc_pin_t;
+
+// A room this connection joined, and its slot in the room's member array.
+typedef struct conn_room {
+    u32 room_id;
+    u32 idx;
+} conn_room_t;
+
+struct conn {
+    int    fd;
+    u8     closing;      // closed this tick, freed at reactor_end_tick (2: once io_refs drops to 0)
+    u8     dirty;        // on the reactor's flush list
+    u8     read_paused;  // output above high water; resume reading after flush
+    u8     bound;        // user_id below is registered with the server
+    u16    io_refs;      // transport operations in flight (io_uring backend)
+    u8     rx_armed;     // multishot recv posted (2: cancel requested)
+    u8     tx_ops;       // linked writes in flight
+    u8     tx_waiting;   // queued for a free send buffer
+    u8     udp;          // a UDP peer (udp.c): no descriptor, output goes out as datagrams
+
+    u32    user_id;      // sender id of this connection's first frame
+    u32    slot;         // position in the reactor's connection arena, named by route entries
+    u32    cap_id;       // connection id in capture files: shard in the top 6 bits, then a sequence
+    u32    peer_ip;      // UDP peer address, network byte order
+    u16    peer_port;
+
+    // Input: a receive buffer is borrowed from the reactor only while bytes
+    // are pending, so idle connections hold no buffer at all.
+    dbin_stream_t in;
+    u8    *in_buf;
+
+    // Output: byte ranges not yet accepted by the kernel, oldest first
+    // (a ring; oq_cap is a power of two).
+    out_seg_t *oq;
+    u32    oq_head;
+    u32    oq_len;
+    u32    oq_cap;
+    usize  out_bytes;
+
+    // MSG_ZEROCOPY sends not yet completed (epoll backend, a ring like oq).
+    u8     zc;           // SO_ZEROCOPY is on for this socket
+    u32    zc_seq;       // sequence number the kernel gives the next zerocopy send
+    zc_pin_t *zc_pins;
+    u32    zc_head;
+    u32    zc_len;
+    u32    zc_cap;
+
+    // ACKs owed this tick, sent as one frame per run at reactor_end_tick.
+    dbin_acker_t ack;
+
+    // Heartbeat (heartbeat.c): frames only stamp the ticks below; the timer
+    // catches up with them when it fires.
+    wheel_timer_t hb;
+    u32    rx_tick;      // last frame received
+    u32    app_tick;     // last frame other than PING/PONG
+    u32    ping_tick;    // when the outstanding PING was sent
+    u8     pinged;       // a PING is outstanding
+
+    conn_room_t *rooms;
+    u32    nrooms;
+    u32    rooms_cap;
+
+    conn_t *next_dirty;
+    conn_t *next_closed;
+    conn_t *next_tx;     // send buffer wait list (io_uring backend)
+};
+
+// Local members of one room; `members` is dense so fan-out is a linear scan.
+typedef struct room {
+    u32      id;
+    u32      n;
+    u32      cap;
+    conn_t **members;
+} room_t;
+
+// Local room_id -> room (open addressing, linear probing, rooms stored inline).
+typedef struct room_map {
+    u32    *keys;  // room_id + 1; 0 = empty
+    room_t *vals;
+    usize   cap;   // power of two
+    usize   len;
+} room_map_t;
+
+// One event loop per core. Everything on the hot path is owned by the
+// reactor's thread; other shards reach it only through `inq`.
+struct reactor {
+    int    id;
+    int    cpu;          // pinned CPU, -1 when not pinned
+    int    epfd;         // epoll backend only
+    int    lfd;          // SO_REUSEPORT listener of this shard
+    int    evfd;         // wakes the loop when other shards queue frames
+    server_t *srv;
+    void  *backend;      // transport-private state
+    udp_t *udp;          // UDP socket of this shard and its peers, 0 when off
+    pthread_t thread;
+
+    // Receive and output buffers, output queues.
+    slab_pool_t pool;
+
+    conn_t *dirty;   // connections with output queued this tick
+    conn_t *closed;  // connections closed this tick
+
+    // Connection arena: fixed chunks of SERVER_CONN_CHUNK, never moved, so a
+    // route entry's slot resolves to its connection by arithmetic alone.
+    conn_t **conn_chunks;
+    u32    nchunks;
+    u32    chunks_cap;
+    u32   *slot_free;    // released slots, reused first
+    u32    nslot_free;
+    u32    nslots;       // slots handed out so far
+
+    room_map_t rooms;
+
+    wheel_t wheel;       // one timer per connection
+    u64    tick;         // reactor_clock, once per pass of the event loop
+
+    shard_cap_t *cap;    // frame capture, 0 when off
+    u32    conn_seq;     // connections opened, for cap_id
+
+    spsc_t *inq[SERVER_MAX_SHARDS];  // frames from shard i to this shard
+    u64    notify_mask;              // shards we pushed to this tick
+    _Atomic int asleep;              // set while blocked waiting for events
+
+    usize  nconns;
+    u64    frames_in;
+    u64    frames_out;
+    u64    forwarded;
+    u64    xq_drops;
+    u64    room_drops;   // room frames dropped for members too far behind
+    u64    syscalls;     // transport syscalls (epoll_wait/recv/send or io_uring_enter)
+    u64    zc_sends;     // sends made with MSG_ZEROCOPY
+    u64    zc_copied;    // of those, completed by the kernel copying after all
+    u64    pings;        // heartbeat PINGs sent
+    u64    hb_closed;    // connections closed for not answering one
+    u64    idle_closed;  // connections closed after idle_ms
+    u64    dups;         // repeated msg_ids dropped
+    u64    dgrams_in;    // UDP datagrams received
+    u64    dgrams_out;   // and sent
+    u64    dgram_drops;  // send entries the socket refused
+
+    volatile int stop;
+};
+
+struct server {
+    int        nshards;
+    reactor_t *shards;
+
+    // user_id -> route entry, SERVER_USER_SPACE of them, preallocated.
+    // Written only by the shard that owns the connection, read by all.
+    _Atomic route_t *routes;
+    // room_id -> bitmask of shards with at least one member.
+    _Atomic u64 *room_shards;
+    // user_id -> window of recent msg_ids (dbin/dedup.h), 8 bytes per user,
+    // cleared when a connection binds the user. Pages of users never seen
+    // are never touched.
+    _Atomic dbin_dedup_t *seen;
+
+    int        dedup;     // drop repeated msg_ids (still ACKed); on unless cleared before server_start
+    int        zerocopy;  // large sends use MSG_ZEROCOPY (epoll backend); set before server_start
+    // Heartbeat and idle expiry, SERVER_PING_MS etc. unless changed before
+    // server_start; 0 turns one off.
+    u32        ping_ms;
+    u32        pong_ms;
+    u32        idle_ms;
+};
+
+// conn.c (transport-neutral connection state)
+conn_t *conn_open(reactor_t *r, int fd);
+void    conn_close(reactor_t *r, conn_t *c);
+void    conn_destroy(reactor_t *r, conn_t *c);
+// Drop one io_ref; frees a closed connection once nothing references it.
+void    conn_io_done(reactor_t *r, conn_t *c);
+// Borrow/return the receive buffer around a burst of reads into c->in.
+int     conn_in_begin(reactor_t *r, conn_t *c);
+void    conn_in_end(reactor_t *r, conn_t *c);
+// Run every complete frame buffered in c->in through the handler.
+int     conn_drain(reactor_t *r, conn_t *c);
+// Run the frames of one received datagram through the handler, in place.
+int     conn_datagram(reactor_t *r, conn_t *c, const u8 *data, usize len);
+// Copy received bytes into c->in and drain (for transports that own the receive buffers).
+int     conn_feed(reactor_t *r, conn_t *c, const u8 *data, usize n);
+int     conn_flush(reactor_t *r, conn_t *c);
+int     conn_queue_msg(reactor_t *r, conn_t *c, const dbin_msg_t *m);
+int     conn_queue_frame(reactor_t *r, conn_t *c, const u8 *frame, usize len);
+// Owe an ACK for `m`; the tick's ACKs go out coalesced (see dbin_acker_t).
+int     conn_queue_ack(reactor_t *r, conn_t *c, const dbin_msg_t *m);
+// Queue a reference to `b` (all of it); no bytes are copied.
+int     conn_queue_buf(reactor_t *r, conn_t *c, obuf_t *b);
+// Drop `n` bytes from the front of the output queue once the kernel took them.
+void    conn_out_consume(reactor_t *r, conn_t *c, usize n);
+void    reactor_end_tick(reactor_t *r);
+void    reactor_free_buffers(reactor_t *r);
+
+obuf_t *obuf_new_shared(reactor_t *r, usize cap);
+void    obuf_release(reactor_t *r, obuf_t *b);
+
+static inline conn_t *reactor_conn_at(const reactor_t *r, u32 slot) {
+    return &r->conn_chunks[slot / SERVER_CONN_CHUNK][slot % SERVER_CONN_CHUNK];
+}
+
+static inline usize conn_out_pending(const conn_t *c) {
+    return c->out_bytes;
+}
+
+// i-th queued segment, 0 = oldest.
+static inline out_seg_t *conn_out_seg(const conn_t *c, u32 i) {
+    return &c->oq[(c->oq_head + i) & (c->oq_cap - 1)];
+}
+
+// handler.c
+// Called once per decoded frame; `frame` is the raw frame `m` was decoded
+// from. Returns nonzero to close the connection.
+int     server_handle_frame(reactor_t *r, conn_t *c, const dbin_msg_t *m,
+                            const u8 *frame, usize frame_len);
+
+// heartbeat.c
+// Monotonic time in SERVER_TICK_MS ticks.
+u64     server_ticks(void);
+// Watch a new connection for silence; stop when it closes.
+void    conn_heartbeat_start(reactor_t *r, conn_t *c);
+void    conn_heartbeat_stop(reactor_t *r, conn_t *c);
+// Once per pass of the event loop: read the clock before handling events,
+// run the timers that are due after.
+void    reactor_clock(reactor_t *r);
+void    reactor_run_timers(reactor_t *r);
+// How long the event loop may block before a timer is due, at most max_ms.
+int     reactor_timer_wait_ms(reactor_t *r, int max_ms);
+
+// room.c
+int     room_join(reactor_t *r, conn_t *c, u32 room_id);
+void    room_leave(reactor_t *r, conn_t *c, u32 room_id);
+void    room_leave_all(reactor_t *r, conn_t *c);
+// Queue `frame` once, by reference, to every local member but `except`.
+// Returns the number of members it was queued to.
+usize   room_fanout(reactor_t *r, u32 room_id, const u8 *frame, usize len, const conn_t *except);
+void    room_map_free(room_map_t *m);
+
+// capture.c
+// Record every received frame into <prefix>.<shard>.dcap (see dbin/capture.h).
+// Call between server_init and server_start; nonzero if a file cannot be created.
+int     server_capture_start(server_t *s, const char *prefix);
+// Write out buffered records and each file's index; call after server_stop.
+// Returns the frames captured.
+u64     server_capture_stop(server_t *s);
+// Monotonic time on the capture clock, read once per burst of frames.
+u64     shard_capture_clock(const reactor_t *r);
+void    shard_capture(reactor_t *r, const conn_t *c, const u8 *frame, usize len, u64 ts_ns);
+
+// udp.c
+// Bind a UDP socket per shard on ip:port next to the TCP listeners; with
+// `offload`, use GRO and GSO where the kernel has them. Call between
+// server_init and server_start, epoll backend only.
+int     server_udp_start(server_t *s, const char *ip, int port, int offload);
+void    udp_destroy(reactor_t *r);
+// The shard's UDP socket, -1 when off; which offloads it got (1 GRO, 2 GSO).
+int     udp_fd(const reactor_t *r);
+int     udp_offload(const reactor_t *r);
+// Read queued datagrams (a bounded number of batches per call).
+void    udp_recv(reactor_t *r);
+// Pack a UDP peer's queued output into datagrams; udp_send hands the
+// tick's datagrams to the kernel.
+int     udp_queue(reactor_t *r, conn_t *c);
+void    udp_send(reactor_t *r);
+void    udp_close(reactor_t *r, conn_t *c);
+
+// shard.c
+// Nonblocking SO_REUSEPORT listener with TCP_NODELAY for accepted sockets.
+int     server_listen(const char *ip, int port);
+int     server_init(server_t *s, const char *ip, int port, int nshards, int pin);
+int     server_start(server_t *s);
+void    server_stop(server_t *s);
+void    server_destroy(server_t *s);
+void    server_bind_user(reactor_t *r, conn_t *c, u32 user_id);
+void    server_unbind_user(reactor_t *r, conn_t *c);
+// The live connection of `user_id` on this shard, or NULL. One table load, no hashing.
+conn_t *server_lookup_user(reactor_t *r, u32 user_id);
+// 1 when `msg_id` repeats one `user_id` sent recently: the message was
+// already handled and only needs its ACK again.
+int     server_seen(reactor_t *r, u32 user_id, u16 msg_id);
+// Bytes held by the routing table and every shard's arena index.
+usize   server_route_footprint(const server_t *s);
+// Deliver an encoded frame to the connection of `user_id`, on whichever shard it lives.
+int     server_route_user(reactor_t *r, u32 user_id, const u8 *frame, usize len);
+// Deliver a room frame to the members on this shard and forward it once to
+// every other shard that has members.
+void    server_route_room(reactor_t *r, conn_t *from, u32 room_id, const u8 *frame, usize len);
+// Keep room_shards in step with this shard's local membership.
+void    server_room_occupied(reactor_t *r, u32 room_id, int occupied);
+// Deliver frames other shards queued for this one. Returns the number delivered.
+usize   shard_drain_inbound(reactor_t *r);
+// Wake the shards this one queued frames for during the tick.
+void    shard_notify(reactor_t *r);
+
+// Transport backend: epoll.c or uring.c, picked by the Makefile's BACKEND.
+extern const char *const transport_name;
+int     reactor_init(reactor_t *r, const char *ip, int port);
+int     reactor_run(reactor_t *r);
+void    reactor_destroy(reactor_t *r);
+// Hand queued output (the segments in c->oq, oldest first) to the kernel;
+// the transport calls conn_out_consume for the bytes it accepts. Nonzero on error.
+int     transport_flush(reactor_t *r, conn_t *c);
+// Resume reading a connection after its output drained below high water.
+int     transport_resume(reactor_t *r, conn_t *c);
+// Release the socket; called once from conn_close.
+void    transport_close(reactor_t *r, conn_t *c);
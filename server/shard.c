@@ -0,0 +1,315 @@
+#define _GNU_SOURCE
+
+#include "server.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#define ROOM_SPACE (1u << 20)
+#define XQ_TAG_ROOM (1u << 31) // queued frame is for a room, not a user
+
+// ---- routing table and cross-shard delivery ----
+
+void server_bind_user(reactor_t *r, conn_t *c, u32 user_id) {
+    if (user_id >= SERVER_USER_SPACE) return;
+
+    c->user_id = user_id;
+    c->bound = 1;
+    // A new connection starts a new run of msg_ids: a restarted client may
+    // send ids its previous connection already used.
+    atomic_store_explicit(&r->srv->seen[user_id], 0, memory_order_relaxed);
+    // The newest connection of a user wins, on whichever shard it lives.
+    atomic_store_explicit(&r->srv->routes[user_id], ROUTE_MAKE(r->id, c->slot), memory_order_release);
+}
+
+void server_unbind_user(reactor_t *r, conn_t *c) {
+    if (!c->bound) return;
+    c->bound = 0;
+
+    // A newer connection of the same user may already have replaced this one.
+    route_t mine = ROUTE_MAKE(r->id, c->slot);
+    atomic_compare_exchange_strong(&r->srv->routes[c->user_id], &mine, 0);
+}
+
+conn_t *server_lookup_user(reactor_t *r, u32 user_id) {
+    if (user_id >= SERVER_USER_SPACE) return 0;
+    route_t e = atomic_load_explicit(&r->srv->routes[user_id], memory_order_acquire);
+    if (ROUTE_SHARD(e) != r->id) return 0;
+
+    // Entries naming this shard are written only by this thread and cleared
+    // before a connection is freed, so the slot always holds a live one.
+    return reactor_conn_at(r, ROUTE_SLOT(e));
+}
+
+int server_seen(reactor_t *r, u32 user_id, u16 msg_id) {
+    server_t *s = r->srv;
+    if (!s->dedup || user_id >= SERVER_USER_SPACE) return 0;
+
+    // A user's frames may arrive on two shards at once while a reconnect
+    // replaces its connection, so the window is updated with a CAS.
+    _Atomic dbin_dedup_t *e = &s->seen[user_id];
+    dbin_dedup_t w = atomic_load_explicit(e, memory_order_relaxed), next;
+    int dup;
+    do {
+        next = dbin_dedup_step(w, msg_id, &dup);
+        if (dup) {
+            r->dups++;
+            return 1;
+        }
+    } while (!atomic_compare_exchange_weak_explicit(e, &w, next, memory_order_relaxed, memory_order_relaxed));
+    return 0;
+}
+
+usize server_route_footprint(const server_t *s) {
+    usize n = (usize)SERVER_USER_SPACE * sizeof(*s->routes);
+    for (int i = 0; i < s->nshards; i++) {
+        const reactor_t *r = &s->shards[i];
+        n += (usize)r->chunks_cap * sizeof(*r->conn_chunks);
+        n += (usize)r->nchunks * SERVER_CONN_CHUNK * sizeof(*r->slot_free);
+    }
+    return n;
+}
+
+static void deliver_local(reactor_t *r, u32 user_id, const u8 *frame, usize len) {
+    conn_t *dst = server_lookup_user(r, user_id);
+    if (dst) conn_queue_frame(r, dst, frame, len);
+}
+
+int server_route_user(reactor_t *r, u32 user_id, const u8 *frame, usize len) {
+    if (user_id >= SERVER_USER_SPACE) return 1;
+
+    route_t e = atomic_load_explicit(&r->srv->routes[user_id], memory_order_acquire);
+    if (e == 0) return 1; // not connected
+
+    int target = ROUTE_SHARD(e);
+    if (target == r->id) {
+        deliver_local(r, user_id, frame, len);
+        return 0;
+    }
+
+    reactor_t *t = &r->srv->shards[target];
+    if (spsc_push(t->inq[r->id], user_id, frame, len)) {
+        r->xq_drops++;
+        return 1;
+    }
+    r->forwarded++;
+    r->notify_mask |= 1ull << target;
+    return 0;
+}
+
+void server_route_room(reactor_t *r, conn_t *from, u32 room_id, const u8 *frame, usize len) {
+    if (room_id >= ROOM_SPACE) return;
+    room_fanout(r, room_id, frame, len, from);
+
+    // Each other shard with members gets the frame once and fans it out itself.
+    u64 mask = atomic_load_explicit(&r->srv->room_shards[room_id], memory_order_acquire);
+    mask &= ~(1ull << r->id);
+    while (mask) {
+        int i = __builtin_ctzll(mask);
+        mask &= mask - 1;
+
+        reactor_t *t = &r->srv->shards[i];
+        if (spsc_push(t->inq[r->id], XQ_TAG_ROOM | room_id, frame, len)) {
+            r->xq_drops++;
+            continue;
+        }
+        r->forwarded++;
+        r->notify_mask |= 1ull << i;
+    }
+}
+
+void server_room_occupied(reactor_t *r, u32 room_id, int occupied) {
+    if (room_id >= ROOM_SPACE) return;
+    u64 bit = 1ull << r->id;
+    if (occupied) {
+        atomic_fetch_or_explicit(&r->srv->room_shards[room_id], bit, memory_order_release);
+    } else {
+        atomic_fetch_and_explicit(&r->srv->room_shards[room_id], ~bit, memory_order_release);
+    }
+}
+
+usize shard_drain_inbound(reactor_t *r) {
+    usize n = 0;
+    for (int i = 0; i < r->srv->nshards; i++) {
+        spsc_t *q = r->inq[i];
+        if (!q) continue;
+
+        u32 tag;
+        const u8 *frame;
+        usize len;
+        while (spsc_peek(q, &tag, &frame, &len)) {
+            if (tag & XQ_TAG_ROOM) {
+                room_fanout(r, tag & ~XQ_TAG_ROOM, frame, len, 0);
+            } else {
+                deliver_local(r, tag, frame, len);
+            }
+            spsc_pop(q);
+            n++;
+        }
+    }
+    return n;
+}
+
+void shard_notify(reactor_t *r) {
+    u64 mask = r->notify_mask;
+    r->notify_mask = 0;
+
+    while (mask) {
+        int i = __builtin_ctzll(mask);
+        mask &= mask - 1;
+
+        // Only pay for the eventfd write when the target is actually asleep.
+        reactor_t *t = &r->srv->shards[i];
+        if (atomic_exchange(&t->asleep, 0)) {
+            u64 one = 1;
+            ssize_t w = write(t->evfd, &one, sizeof(one));
+            (void)w;
+        }
+    }
+}
+
+// ---- lifecycle ----
+
+int server_listen(const char *ip, int port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+
+    // Every shard binds its own listener; the kernel spreads connections across them.
+    int yes = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+    setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &yes, sizeof(yes));
+    // Accepted sockets inherit TCP_NODELAY, which saves a setsockopt per connection.
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    addr.sin_addr.s_addr = inet_addr(ip);
+
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    if (listen(fd, SOMAXCONN) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+
+static void *shard_main(void *arg) {
+    reactor_t *r = (reactor_t*)arg;
+
+    if (r->cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(r->cpu, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+
+    reactor_run(r);
+    return NULL;
+}
+
+int server_init(server_t *s, const char *ip, int port, int nshards, int pin) {
+    memset(s, 0, sizeof(*s));
+    if (nshards < 1) nshards = 1;
+    if (nshards > SERVER_MAX_SHARDS) nshards = SERVER_MAX_SHARDS;
+
+    s->routes = (_Atomic route_t*)calloc(SERVER_USER_SPACE, sizeof(*s->routes));
+    s->seen = (_Atomic dbin_dedup_t*)calloc(SERVER_USER_SPACE, sizeof(*s->seen));
+    s->room_shards = (_Atomic u64*)calloc(ROOM_SPACE, sizeof(*s->room_shards));
+    s->shards = (reactor_t*)calloc((usize)nshards, sizeof(*s->shards));
+    if (!s->routes || !s->seen || !s->room_shards || !s->shards) return 1;
+    s->dedup = 1;
+    s->ping_ms = SERVER_PING_MS;
+    s->pong_ms = SERVER_PONG_MS;
+    s->idle_ms = SERVER_IDLE_MS;
+
+    // CPUs this process may run on, in order; shard i gets the i-th one.
+    int cpus[CPU_SETSIZE];
+    int ncpus = 0;
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+        for (int c = 0; c < CPU_SETSIZE; c++) {
+            if (CPU_ISSET(c, &allowed)) cpus[ncpus++] = c;
+        }
+    }
+
+    for (int i = 0; i < nshards; i++) {
+        reactor_t *r = &s->shards[i];
+        if (reactor_init(r, ip, port)) return 1;
+        slab_pool_init(&r->pool);
+        reactor_clock(r);
+        wheel_init(&r->wheel, r->tick);
+        r->id = i;
+        r->srv = s;
+        r->cpu = (pin && ncpus > 0) ? cpus[i % ncpus] : -1;
+        s->nshards = i + 1;
+    }
+
+    // One queue per ordered pair of shards: each has exactly one producer and one consumer.
+    for (int dst = 0; dst < nshards; dst++) {
+        for (int src = 0; src < nshards; src++) {
+            if (src == dst) continue;
+            spsc_t *q = (spsc_t*)malloc(sizeof(*q));
+            if (!q || spsc_init(q, SERVER_XQ_BYTES)) {
+                free(q);
+                return 1;
+            }
+            s->shards[dst].inq[src] = q;
+        }
+    }
+    return 0;
+}
+
+int server_start(server_t *s) {
+    for (int i = 0; i < s->nshards; i++) {
+        reactor_t *r = &s->shards[i];
+        if (pthread_create(&r->thread, NULL, shard_main, r) != 0) return 1;
+    }
+    return 0;
+}
+
+void server_stop(server_t *s) {
+    for (int i = 0; i < s->nshards; i++) {
+        reactor_t *r = &s->shards[i];
+        r->stop = 1;
+        u64 one = 1;
+        ssize_t w = write(r->evfd, &one, sizeof(one));
+        (void)w;
+    }
+    for (int i = 0; i < s->nshards; i++) pthread_join(s->shards[i].thread, NULL);
+}
+
+void server_destroy(server_t *s) {
+    for (int i = 0; s->shards && i < s->nshards; i++) {
+        reactor_t *r = &s->shards[i];
+        for (int j = 0; j < s->nshards; j++) {
+            if (!r->inq[j]) continue;
+            spsc_destroy(r->inq[j]);
+            free(r->inq[j]);
+        }
+        room_map_free(&r->rooms);
+        udp_destroy(r);
+        reactor_destroy(r);
+    }
+    free(s->shards);
+    free((void*)s->routes);
+    free((void*)s->seen);
+    free((void*)s->room_shards);
+    s->shards = 0;
+    s->routes = 0;
+    s->seen = 0;
+    s->room_shards = 0;
+}
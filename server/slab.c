@@ -0,0 +1,178 @@
+#include "slab.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const u32 class_size[SLAB_CLASSES] = SLAB_CLASS_SIZES;
+
+typedef struct slab_hdr {
+    slab_pool_t *owner;
+    void *next;      // next slab of the owner
+    u32   cls;
+} slab_hdr_t;
+
+_Static_assert(sizeof(slab_hdr_t) <= SLAB_HEADER, "slab header too big");
+
+static int class_of(usize size) {
+    for (int i = 0; i < SLAB_CLASSES; i++) {
+        if (size <= class_size[i]) return i;
+    }
+    return -1;
+}
+
+static slab_hdr_t *slab_of(const void *b) {
+    return (slab_hdr_t*)((uintptr_t)b & ~(uintptr_t)(SLAB_BYTES - 1));
+}
+
+static inline void *next_of(void *b) {
+    return *(void**)b;
+}
+
+static inline void set_next(void *b, void *next) {
+    *(void**)b = next;
+}
+
+void slab_pool_init(slab_pool_t *p) {
+    memset(p, 0, sizeof(*p));
+    atomic_init(&p->remote, NULL);
+}
+
+void slab_pool_destroy(slab_pool_t *p) {
+    void *s = p->slabs;
+    while (s) {
+        void *next = ((slab_hdr_t*)s)->next;
+        free(s);
+        s = next;
+    }
+    slab_pool_init(p);
+}
+
+usize slab_usable(usize size) {
+    int c = class_of(size);
+    return c < 0 ? size : class_size[c];
+}
+
+// Take back every block other threads freed to this pool.
+static void collect_remote(slab_pool_t *p) {
+    void *b = atomic_exchange_explicit(&p->remote, NULL, memory_order_acquire);
+    while (b) {
+        void *next = next_of(b);
+        slab_class_t *k = &p->cls[slab_of(b)->cls];
+        set_next(b, k->free);
+        k->free = b;
+        k->remote_in++;
+        k->in_use--;
+        b = next;
+    }
+}
+
+static int new_slab(slab_pool_t *p, int c) {
+    slab_hdr_t *s = (slab_hdr_t*)aligned_alloc(SLAB_BYTES, SLAB_BYTES);
+    if (!s) return 1;
+    s->owner = p;
+    s->cls = (u32)c;
+    s->next = p->slabs;
+    p->slabs = s;
+
+    slab_class_t *k = &p->cls[c];
+    k->bump = (u8*)s + SLAB_HEADER;
+    k->bump_end = k->bump + (SLAB_BYTES - SLAB_HEADER) / class_size[c] * class_size[c];
+    k->slabs++;
+    return 0;
+}
+
+void *slab_alloc(slab_pool_t *p, usize size) {
+    int c = class_of(size);
+    if (c < 0) {
+        void *b = malloc(size);
+        if (b) {
+            p->large_allocs++;
+            p->large_in_use++;
+        }
+        return b;
+    }
+
+    slab_class_t *k = &p->cls[c];
+    if (!k->free && atomic_load_explicit(&p->remote, memory_order_relaxed)) collect_remote(p);
+
+    void *b = k->free;
+    if (b) {
+        k->free = next_of(b);
+    } else {
+        if (k->bump == k->bump_end && new_slab(p, c)) return 0;
+        b = k->bump;
+        k->bump += class_size[c];
+    }
+    k->allocs++;
+    if (++k->in_use > k->peak) k->peak = k->in_use;
+    return b;
+}
+
+// Push a batch onto its owner's remote stack.
+static void hand_over(slab_batch_t *o) {
+    void *head = atomic_load_explicit(&o->owner->remote, memory_order_relaxed);
+    do {
+        set_next(o->tail, head);
+    } while (!atomic_compare_exchange_weak_explicit(&o->owner->remote, &head, o->head,
+                                                    memory_order_release, memory_order_relaxed));
+    o->owner = 0;
+    o->head = o->tail = 0;
+    o->n = 0;
+}
+
+void slab_free(slab_pool_t *p, void *b, usize size) {
+    if (!b) return;
+    if (size > SLAB_MAX_BLOCK) {
+        free(b);
+        p->large_in_use--;
+        return;
+    }
+
+    slab_hdr_t *s = slab_of(b);
+    if (s->owner == p) {
+        slab_class_t *k = &p->cls[s->cls];
+        set_next(b, k->free);
+        k->free = b;
+        k->in_use--;
+        return;
+    }
+
+    // Another thread's block: add it to that owner's batch, opening one
+    // (handing over the fullest when all are taken) if needed.
+    slab_batch_t *o = 0, *full = &p->out[0];
+    for (int i = 0; i < SLAB_REMOTE_OWNERS; i++) {
+        if (p->out[i].owner == s->owner) {
+            o = &p->out[i];
+            break;
+        }
+        if (!o && !p->out[i].owner) o = &p->out[i];
+        if (p->out[i].n > full->n) full = &p->out[i];
+    }
+    if (!o) {
+        hand_over(full);
+        o = full;
+    }
+    if (!o->owner) {
+        o->owner = s->owner;
+        o->tail = b;
+        set_next(b, 0);
+    } else {
+        set_next(b, o->head);
+    }
+    o->head = b;
+    p->remote_out++;
+    if (++o->n == SLAB_REMOTE_BATCH) hand_over(o);
+}
+
+void slab_flush_remote(slab_pool_t *p) {
+    for (int i = 0; i < SLAB_REMOTE_OWNERS; i++) {
+        if (p->out[i].owner) hand_over(&p->out[i]);
+    }
+}
+
+u64 slab_pool_bytes(const slab_pool_t *p) {
+    u64 n = 0;
+    for (int i = 0; i < SLAB_CLASSES; i++) n += p->cls[i].slabs;
+    return n * SLAB_BYTES;
+}
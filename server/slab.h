@@ -0,0 +1,81 @@
+#pragma once
+
+#include "dbin/types.h"
+
+#include <stdatomic.h>
+
+// Size-class pool for frame and connection buffers, one per reactor thread.
+//
+// Blocks are carved from SLAB_BYTES slabs aligned to their size, so the
+// owning pool and class of any block are found from its address alone. The
+// owner allocates and frees without atomics. A block freed by another
+// thread is batched per owner and handed over with one CAS per
+// SLAB_REMOTE_BATCH blocks (or at slab_flush_remote); the owner takes the
+// whole handed-over list back with one exchange when a class runs dry.
+// Slabs are kept until the pool is destroyed.
+//
+// Classes follow dBIN frame sizes; SLAB_CLASS_SIZES lists them. Larger
+// requests go to malloc.
+
+#define SLAB_BYTES         (256u << 10)
+#define SLAB_HEADER        64
+#define SLAB_CLASSES       5
+#define SLAB_CLASS_SIZES   { 64, 256, 1024, 4160, 16384 } // control frames, chat, 1 KiB, max frame + obuf header, receive buffer
+#define SLAB_MAX_BLOCK     16384
+#define SLAB_REMOTE_BATCH  64
+#define SLAB_REMOTE_OWNERS 8 // owners with a batch open at once
+
+typedef struct slab_pool slab_pool_t;
+
+typedef struct slab_class {
+    void *free;       // local free list, linked through each block's first word
+    u8   *bump;       // uncarved part of the newest slab
+    u8   *bump_end;
+
+    // Statistics
+    u64   slabs;
+    u64   allocs;
+    u64   remote_in;  // blocks other threads freed back to this class
+    u64   in_use;
+    u64   peak;
+} slab_class_t;
+
+typedef struct slab_batch {
+    slab_pool_t *owner;
+    void *head;
+    void *tail;
+    u32   n;
+} slab_batch_t;
+
+struct slab_pool {
+    slab_class_t cls[SLAB_CLASSES];
+    void *slabs;                    // every slab of this pool, for destroy
+
+    // Blocks of other pools freed on this thread, not yet handed over.
+    slab_batch_t out[SLAB_REMOTE_OWNERS];
+
+    // Blocks of this pool freed on other threads (a stack of batches).
+    _Alignas(64) _Atomic(void*) remote;
+
+    _Alignas(64) u64 large_allocs;  // requests above SLAB_MAX_BLOCK, from malloc
+    u64   large_in_use;
+    u64   remote_out;               // blocks this thread freed to other pools
+};
+
+void  slab_pool_init(slab_pool_t *p);
+// Frees every slab; blocks still out (on any thread) become invalid.
+void  slab_pool_destroy(slab_pool_t *p);
+
+// `p` is the calling thread's pool. NULL when out of memory.
+void *slab_alloc(slab_pool_t *p, usize size);
+// `size` as passed to slab_alloc (or anything up to slab_usable of it).
+void  slab_free(slab_pool_t *p, void *b, usize size);
+// Bytes actually available in a block for a request of `size`.
+usize slab_usable(usize size);
+
+// Hand this thread's pending remote frees to their owners; call once per
+// event-loop tick.
+void  slab_flush_remote(slab_pool_t *p);
+
+// Bytes held in slabs.
+u64   slab_pool_bytes(const slab_pool_t *p);
@@ -0,0 +1,96 @@
+#include "spsc.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define REC_HDR   8
+#define REC_SKIP  1u // rest of the ring up to the end is padding
+
+typedef struct {
+    u32 tag;
+    u16 len;
+    u16 flags;
+} rec_hdr_t;
+
+static usize rec_size(usize len) {
+    return (REC_HDR + len + 7u) & ~(usize)7u;
+}
+
+int spsc_init(spsc_t *q, usize cap) {
+    if (cap < 64 || (cap & (cap - 1)) != 0) return 1;
+
+    memset(q, 0, sizeof(*q));
+    q->buf = (u8*)aligned_alloc(64, cap);
+    if (!q->buf) return 1;
+    q->cap = cap;
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+    return 0;
+}
+
+void spsc_destroy(spsc_t *q) {
+    free(q->buf);
+    q->buf = 0;
+}
+
+int spsc_push(spsc_t *q, u32 tag, const u8 *data, usize len) {
+    if (len > 0xFFFFu) return 1;
+
+    usize tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    usize idx = tail & (q->cap - 1);
+    usize need = rec_size(len);
+    usize to_end = q->cap - idx;
+    usize total = (need > to_end) ? to_end + need : need;
+
+    if (total > q->cap - (tail - q->head_cache)) {
+        q->head_cache = atomic_load_explicit(&q->head, memory_order_acquire);
+        if (total > q->cap - (tail - q->head_cache)) return 1;
+    }
+
+    if (need > to_end) {
+        rec_hdr_t skip = { 0, 0, REC_SKIP };
+        memcpy(q->buf + idx, &skip, sizeof(skip));
+        tail += to_end;
+        idx = 0;
+    }
+
+    rec_hdr_t h = { tag, (u16)len, 0 };
+    memcpy(q->buf + idx, &h, sizeof(h));
+    memcpy(q->buf + idx + REC_HDR, data, len);
+
+    atomic_store_explicit(&q->tail, tail + need, memory_order_release);
+    return 0;
+}
+
+int spsc_peek(spsc_t *q, u32 *tag, const u8 **data, usize *len) {
+    usize head = atomic_load_explicit(&q->head, memory_order_relaxed);
+
+    for (;;) {
+        if (head == q->tail_cache) {
+            q->tail_cache = atomic_load_explicit(&q->tail, memory_order_acquire);
+            if (head == q->tail_cache) return 0;
+        }
+
+        usize idx = head & (q->cap - 1);
+        rec_hdr_t h;
+        memcpy(&h, q->buf + idx, sizeof(h));
+
+        if (h.flags & REC_SKIP) {
+            head += q->cap - idx;
+            atomic_store_explicit(&q->head, head, memory_order_release);
+            continue;
+        }
+
+        *tag = h.tag;
+        *data = q->buf + idx + REC_HDR;
+        *len = h.len;
+        return 1;
+    }
+}
+
+void spsc_pop(spsc_t *q) {
+    usize head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    rec_hdr_t h;
+    memcpy(&h, q->buf + (head & (q->cap - 1)), sizeof(h));
+    atomic_store_explicit(&q->head, head + rec_size(h.len), memory_order_release);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "dbin/types.h"
+
+#include <stdatomic.h>
+
+// Lock-free single-producer/single-consumer byte ring carrying
+// variable-length records: [u32 tag][u16 len][u16 flags][len bytes, padded to 8].
+// Positions only grow; the ring index is pos & (cap - 1).
+typedef struct spsc {
+    _Alignas(64) _Atomic usize tail; // written by the producer
+    usize head_cache;                // producer's last view of head
+
+    _Alignas(64) _Atomic usize head; // written by the consumer
+    usize tail_cache;                // consumer's last view of tail
+
+    _Alignas(64) u8 *buf;
+    usize cap;                       // power of two, multiple of 8
+} spsc_t;
+
+int  spsc_init(spsc_t *q, usize cap);
+void spsc_destroy(spsc_t *q);
+
+// Producer side. Returns nonzero when the record does not fit right now.
+int  spsc_push(spsc_t *q, u32 tag, const u8 *data, usize len);
+
+// Consumer side. Returns 0 when empty; otherwise the record stays valid until spsc_pop.
+int  spsc_peek(spsc_t *q, u32 *tag, const u8 **data, usize *len);
+void spsc_pop(spsc_t *q);
@@ -0,0 +1,413 @@
+#define _GNU_SOURCE
+
+#include "server.h"
+
+#include "dbin/codec.h"
+#include "dbin/dgram.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+// UDP transport (SPEC.md, "Datagrams"). Each shard binds its own
+// SO_REUSEPORT socket, so the kernel keeps every peer on one shard. A peer
+// is an ordinary connection without a descriptor: frames are decoded where
+// recvmmsg put them and go through the same handler, and its output queue
+// is packed into datagrams and sent with sendmmsg at the end of the tick.
+// Peers that fall silent expire through the heartbeat like TCP connections.
+
+#define UDP_BATCH      64         // datagrams per recvmmsg/sendmmsg
+#define UDP_RX_ROUNDS  8          // recvmmsg calls per wakeup; the socket is level-triggered
+#define UDP_RX_SLOT    16384      // receive buffer per datagram without GRO
+#define UDP_GRO_SLOT   65536      // and with it: one buffer holds a coalesced train
+#define UDP_GSO_SEGS   32         // datagrams per GSO send
+#define UDP_TX_BYTES   (256u * 1024u)
+#define UDP_SOCK_BUF   (4 << 20)
+
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+
+typedef struct udp_peer_map {
+    u64     *keys;   // (ip << 16 | port) + 1; 0 = empty
+    conn_t **vals;
+    usize    cap;    // power of two
+    usize    len;
+} udp_peer_map_t;
+
+struct udp {
+    int    fd;
+    u8     gro;      // receive coalesced trains (UDP_GRO)
+    u8     gso;      // send trains of equal-sized datagrams (UDP_SEGMENT)
+    udp_peer_map_t peers;
+
+    struct mmsghdr     rx[UDP_BATCH];
+    struct iovec       rx_iov[UDP_BATCH];
+    struct sockaddr_in rx_addr[UDP_BATCH];
+    char               rx_ctl[UDP_BATCH][CMSG_SPACE(sizeof(int))];
+    u8    *rx_buf;
+    usize  rx_slot;
+
+    // Datagrams packed this tick, not yet handed to sendmmsg.
+    struct mmsghdr     tx[UDP_BATCH];
+    struct iovec       tx_iov[UDP_BATCH];
+    struct sockaddr_in tx_addr[UDP_BATCH];
+    char               tx_ctl[UDP_BATCH][CMSG_SPACE(sizeof(u16))];
+    u32    ntx;
+    u8    *tx_buf;
+    usize  tx_len;
+};
+
+// ---- peer map (open addressing, as room.c) ----
+
+static u64 peer_key(u32 ip, u16 port) {
+    return ((u64)ip << 16 | port) + 1;
+}
+
+static usize pm_slot(u64 key, usize cap) {
+    return (usize)((key * 0x9E3779B97F4A7C15ull) >> 32) & (cap - 1);
+}
+
+static conn_t *pm_get(const udp_peer_map_t *m, u64 key) {
+    if (m->cap == 0) return 0;
+    for (usize i = pm_slot(key, m->cap);; i = (i + 1) & (m->cap - 1)) {
+        if (m->keys[i] == key) return m->vals[i];
+        if (m->keys[i] == 0) return 0;
+    }
+}
+
+static int pm_grow(udp_peer_map_t *m) {
+    usize ncap = m->cap ? m->cap * 2 : 64;
+    u64 *nk = (u64*)calloc(ncap, sizeof(*nk));
+    conn_t **nv = (conn_t**)calloc(ncap, sizeof(*nv));
+    if (!nk || !nv) {
+        free(nk);
+        free(nv);
+        return 1;
+    }
+
+    for (usize i = 0; i < m->cap; i++) {
+        u64 key = m->keys[i];
+        if (!key) continue;
+        usize j = pm_slot(key, ncap);
+        while (nk[j]) j = (j + 1) & (ncap - 1);
+        nk[j] = key;
+        nv[j] = m->vals[i];
+    }
+    free(m->keys);
+    free(m->vals);
+    m->keys = nk;
+    m->vals = nv;
+    m->cap = ncap;
+    return 0;
+}
+
+static int pm_add(udp_peer_map_t *m, u64 key, conn_t *c) {
+    if ((m->len + 1) * 2 > m->cap && pm_grow(m)) return 1;
+    usize i = pm_slot(key, m->cap);
+    while (m->keys[i]) i = (i + 1) & (m->cap - 1);
+    m->keys[i] = key;
+    m->vals[i] = c;
+    m->len++;
+    return 0;
+}
+
+static void pm_del(udp_peer_map_t *m, u64 key) {
+    if (m->cap == 0) return;
+    usize mask = m->cap - 1;
+    usize i = pm_slot(key, m->cap);
+    while (m->keys[i] != key) {
+        if (!m->keys[i]) return;
+        i = (i + 1) & mask;
+    }
+
+    // Backward-shift deletion keeps probe chains intact without tombstones.
+    for (usize j = (i + 1) & mask; m->keys[j]; j = (j + 1) & mask) {
+        usize home = pm_slot(m->keys[j], m->cap);
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            m->keys[i] = m->keys[j];
+            m->vals[i] = m->vals[j];
+            i = j;
+        }
+    }
+    m->keys[i] = 0;
+    m->vals[i] = 0;
+    m->len--;
+}
+
+// ---- lifecycle ----
+
+static int udp_socket(const char *ip, int port) {
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+
+    int yes = 1, buf = UDP_SOCK_BUF;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+    setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &yes, sizeof(yes));
+    // Bursts arrive faster than one pass of the loop drains them.
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &buf, sizeof(buf));
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &buf, sizeof(buf));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    addr.sin_addr.s_addr = inet_addr(ip);
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int server_udp_start(server_t *s, const char *ip, int port, int offload) {
+    for (int i = 0; i < s->nshards; i++) {
+        reactor_t *r = &s->shards[i];
+        udp_t *u = (udp_t*)calloc(1, sizeof(*u));
+        if (!u) return 1;
+        r->udp = u;
+        u->fd = udp_socket(ip, port);
+        if (u->fd < 0) return 1;
+
+        // Both are optional: a kernel without them gets one datagram per
+        // buffer and one per send entry.
+        int on = 1, off = 0;
+        if (offload) {
+            u->gro = setsockopt(u->fd, SOL_UDP, UDP_GRO, &on, sizeof(on)) == 0;
+            u->gso = setsockopt(u->fd, SOL_UDP, UDP_SEGMENT, &off, sizeof(off)) == 0;
+        }
+
+        u->rx_slot = u->gro ? UDP_GRO_SLOT : UDP_RX_SLOT;
+        u->rx_buf = (u8*)malloc(UDP_BATCH * u->rx_slot);
+        u->tx_buf = (u8*)malloc(UDP_TX_BYTES);
+        if (!u->rx_buf || !u->tx_buf) return 1;
+    }
+    return 0;
+}
+
+void udp_destroy(reactor_t *r) {
+    udp_t *u = r->udp;
+    if (!u) return;
+    if (u->fd >= 0) close(u->fd);
+    free(u->peers.keys);
+    free(u->peers.vals);
+    free(u->rx_buf);
+    free(u->tx_buf);
+    free(u);
+    r->udp = 0;
+}
+
+int udp_fd(const reactor_t *r) {
+    return r->udp ? r->udp->fd : -1;
+}
+
+int udp_offload(const reactor_t *r) {
+    return r->udp ? (r->udp->gro ? 1 : 0) | (r->udp->gso ? 2 : 0) : 0;
+}
+
+void udp_close(reactor_t *r, conn_t *c) {
+    pm_del(&r->udp->peers, peer_key(c->peer_ip, c->peer_port));
+}
+
+// ---- receive ----
+
+// One datagram from `a`. A new peer becomes a connection only once its
+// first frame decodes, so stray packets cost no state.
+static void udp_datagram(reactor_t *r, udp_t *u, const struct sockaddr_in *a, const u8 *d, usize len) {
+    u64 key = peer_key(a->sin_addr.s_addr, a->sin_port);
+    conn_t *c = pm_get(&u->peers, key);
+    if (!c) {
+        dbin_msg_t m;
+        if (dbin_decode(d, len, &m) != DBIN_OK) return;
+        c = conn_open(r, -1);
+        if (!c) return;
+        c->udp = 1;
+        c->peer_ip = a->sin_addr.s_addr;
+        c->peer_port = a->sin_port;
+        if (pm_add(&u->peers, key, c)) {
+            conn_close(r, c);
+            return;
+        }
+    }
+    if (conn_datagram(r, c, d, len)) conn_close(r, c);
+}
+
+static int gro_size(struct msghdr *mh) {
+    for (struct cmsghdr *cm = CMSG_FIRSTHDR(mh); cm; cm = CMSG_NXTHDR(mh, cm)) {
+        if (cm->cmsg_level == SOL_UDP && cm->cmsg_type == UDP_GRO) {
+            int sz;
+            memcpy(&sz, CMSG_DATA(cm), sizeof(sz));
+            return sz;
+        }
+    }
+    return 0;
+}
+
+void udp_recv(reactor_t *r) {
+    udp_t *u = r->udp;
+    for (int round = 0; round < UDP_RX_ROUNDS; round++) {
+        for (int i = 0; i < UDP_BATCH; i++) {
+            struct msghdr *mh = &u->rx[i].msg_hdr;
+            u->rx_iov[i].iov_base = u->rx_buf + (usize)i * u->rx_slot;
+            u->rx_iov[i].iov_len = u->rx_slot;
+            mh->msg_name = &u->rx_addr[i];
+            mh->msg_namelen = sizeof(u->rx_addr[i]);
+            mh->msg_iov = &u->rx_iov[i];
+            mh->msg_iovlen = 1;
+            mh->msg_control = u->gro ? u->rx_ctl[i] : 0;
+            mh->msg_controllen = u->gro ? sizeof(u->rx_ctl[i]) : 0;
+            mh->msg_flags = 0;
+        }
+
+        int n = recvmmsg(u->fd, u->rx, UDP_BATCH, MSG_DONTWAIT, 0);
+        r->syscalls++;
+        if (n <= 0) return;
+
+        for (int i = 0; i < n; i++) {
+            const u8 *d = (const u8*)u->rx_iov[i].iov_base;
+            usize len = u->rx[i].msg_len;
+            // A GRO train is datagrams of gso_size bytes back to back, the
+            // last one possibly shorter.
+            usize seg = u->gro ? (usize)gro_size(&u->rx[i].msg_hdr) : 0;
+            if (seg == 0) seg = len;
+            for (usize off = 0; off < len; off += seg) {
+                usize k = len - off < seg ? len - off : seg;
+                r->dgrams_in++;
+                udp_datagram(r, u, &u->rx_addr[i], d + off, k);
+            }
+        }
+        if (n < UDP_BATCH) return;
+    }
+}
+
+// ---- send ----
+
+void udp_send(reactor_t *r) {
+    udp_t *u = r->udp;
+    u32 done = 0;
+    while (done < u->ntx) {
+        int k = sendmmsg(u->fd, u->tx + done, u->ntx - done, 0);
+        r->syscalls++;
+        if (k > 0) {
+            done += (u32)k;
+            continue;
+        }
+        if (errno == EINTR) continue;
+        // Datagrams may be lost anyway: drop what the socket refuses (a full
+        // buffer, or one the route cannot carry) and let the peer retransmit.
+        r->dgram_drops++;
+        done++;
+    }
+    u->ntx = 0;
+    u->tx_len = 0;
+}
+
+// One send entry being filled: datagrams at tx_buf[start..), the one still
+// open beginning at `seg`, `full` closed ones before it.
+typedef struct udp_pack {
+    usize start;
+    usize seg;
+    u32   full;
+} udp_pack_t;
+
+static void pack_close(reactor_t *r, udp_t *u, const conn_t *c, udp_pack_t *p) {
+    usize len = u->tx_len - p->start;
+    if (len == 0) return;
+
+    u32 i = u->ntx++;
+    struct sockaddr_in *a = &u->tx_addr[i];
+    memset(a, 0, sizeof(*a));
+    a->sin_family = AF_INET;
+    a->sin_addr.s_addr = c->peer_ip;
+    a->sin_port = c->peer_port;
+
+    struct msghdr *mh = &u->tx[i].msg_hdr;
+    memset(mh, 0, sizeof(*mh));
+    u->tx_iov[i].iov_base = u->tx_buf + p->start;
+    u->tx_iov[i].iov_len = len;
+    mh->msg_name = a;
+    mh->msg_namelen = sizeof(*a);
+    mh->msg_iov = &u->tx_iov[i];
+    mh->msg_iovlen = 1;
+    if (p->full > 0) {
+        // Every datagram but the last is padded to the segment size.
+        mh->msg_control = u->tx_ctl[i];
+        mh->msg_controllen = CMSG_SPACE(sizeof(u16));
+        struct cmsghdr *cm = CMSG_FIRSTHDR(mh);
+        cm->cmsg_level = SOL_UDP;
+        cm->cmsg_type = UDP_SEGMENT;
+        cm->cmsg_len = CMSG_LEN(sizeof(u16));
+        u16 gso = DBIN_DGRAM_MAX_BYTES;
+        memcpy(CMSG_DATA(cm), &gso, sizeof(gso));
+    }
+    r->dgrams_out += p->full + 1;
+
+    if (u->ntx == UDP_BATCH) udp_send(r);
+    p->start = p->seg = u->tx_len;
+    p->full = 0;
+}
+
+static void pack_frame(reactor_t *r, udp_t *u, const conn_t *c, udp_pack_t *p, const u8 *f, usize n) {
+    // A frame too large to share a datagram travels alone.
+    if (n > DBIN_DGRAM_MAX_BYTES) {
+        pack_close(r, u, c, p);
+        if (u->tx_len + n > UDP_TX_BYTES) {
+            udp_send(r);
+            p->start = p->seg = 0;
+        }
+        memcpy(u->tx_buf + u->tx_len, f, n);
+        u->tx_len += n;
+        pack_close(r, u, c, p);
+        return;
+    }
+
+    if (u->tx_len - p->seg + n > DBIN_DGRAM_MAX_BYTES) {
+        // The open datagram is full: pad it and start the next segment of
+        // the same send, or close the send.
+        if (u->gso && p->full + 2 <= UDP_GSO_SEGS && p->seg + 2 * DBIN_DGRAM_MAX_BYTES <= UDP_TX_BYTES) {
+            usize pad = DBIN_DGRAM_MAX_BYTES - (u->tx_len - p->seg);
+            memset(u->tx_buf + u->tx_len, 0, pad);
+            u->tx_len += pad;
+            p->seg = u->tx_len;
+            p->full++;
+        } else {
+            pack_close(r, u, c, p);
+        }
+    }
+    if (u->tx_len + n > UDP_TX_BYTES) {
+        pack_close(r, u, c, p);
+        udp_send(r);
+        p->start = p->seg = 0;
+    }
+    memcpy(u->tx_buf + u->tx_len, f, n);
+    u->tx_len += n;
+}
+
+int udp_queue(reactor_t *r, conn_t *c) {
+    udp_t *u = r->udp;
+    udp_pack_t p = { u->tx_len, u->tx_len, 0 };
+
+    // Queued output is stream-framed: drop each length prefix and pack the
+    // frames themselves.
+    for (u32 i = 0; i < c->oq_len; i++) {
+        const out_seg_t *s = conn_out_seg(c, i);
+        const u8 *d = s->buf->data + s->off;
+        usize off = 0;
+        while (off + DBIN_LEN_PREFIX_BYTES <= s->len) {
+            usize n = (usize)d[off] << 8 | d[off + 1];
+            off += DBIN_LEN_PREFIX_BYTES;
+            if (off + n > s->len) break;
+            pack_frame(r, u, c, &p, d + off, n);
+            off += n;
+        }
+    }
+    pack_close(r, u, c, &p);
+    conn_out_consume(r, c, conn_out_pending(c));
+    return 0;
+}
@@ -0,0 +1,547 @@
+#define _GNU_SOURCE
+
+#include "server.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+// io_uring transport on raw syscalls. Each tick submits everything queued
+// by the previous one and waits for completions in a single io_uring_enter:
+//   - multishot accept on the shard's listener,
+//   - multishot recv per connection, filling buffers the kernel picks from a
+//     provided buffer ring,
+//   - outbound bytes sent as a chain of linked operations, one chain in
+//     flight per connection: WRITE_FIXED from registered buffers for the
+//     connection's own frames, SEND straight from shared room buffers.
+
+const char *const transport_name = "io_uring";
+
+#define URING_SQ_ENTRIES 4096
+#define URING_CQ_ENTRIES 16384
+#define RX_BUFS          1024   // provided receive buffers (power of two)
+#define RX_BUF_SIZE      4096
+#define RX_GROUP         0
+#define TX_SLOTS         512    // registered send buffers (pinned memory)
+#define TX_SLOT_SIZE     4096
+#define TX_CHAIN_MAX     16     // linked writes per flush
+
+// user_data: conn pointer | op in the low 3 bits | send slot in the top 16.
+enum { OP_ACCEPT = 1, OP_WAKE, OP_RECV, OP_WRITE, OP_SEND, OP_CANCEL };
+
+#define UD_OP(ud)   ((int)((ud) & 7))
+#define UD_CONN(ud) ((conn_t*)(uintptr_t)((ud) & 0x0000FFFFFFFFFFF8ull))
+#define UD_SLOT(ud) ((u32)((ud) >> 48))
+
+typedef struct uring {
+    int fd;
+
+    // Submission queue; sq_local runs ahead of the shared tail until the next enter.
+    u32 *sq_head;
+    u32 *sq_tail;
+    u32  sq_mask;
+    u32  sq_entries;
+    u32  sq_local;
+    struct io_uring_sqe *sqes;
+
+    // Completion queue.
+    u32 *cq_head;
+    u32 *cq_tail;
+    u32  cq_mask;
+    struct io_uring_cqe *cqes;
+
+    void  *ring_mem;
+    usize  ring_size;
+    usize  sqes_size;
+
+    // Provided receive buffers: the kernel picks one per recv completion.
+    struct io_uring_buf_ring *rx_ring;
+    u8    *rx_mem;
+    u16    rx_tail;
+
+    // Registered send buffers, handed out by slot.
+    u8    *tx_mem;
+    u16   *tx_free;
+    u32    tx_nfree;
+    conn_t *tx_wait;       // connections waiting for a free slot (FIFO)
+    conn_t *tx_wait_tail;
+
+    u64    wake_cnt;
+    u8     accept_armed;
+    u8     accept_backoff; // multishot accept ended on an error: re-arm after a short wait
+} uring_t;
+
+static int sys_setup(u32 entries, struct io_uring_params *p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_enter(int fd, u32 submit, u32 min_complete, u32 flags, void *arg, usize argsz) {
+    return (int)syscall(__NR_io_uring_enter, fd, submit, min_complete, flags, arg, argsz);
+}
+
+static int sys_register(int fd, u32 op, void *arg, u32 nargs) {
+    return (int)syscall(__NR_io_uring_register, fd, op, arg, nargs);
+}
+
+// ---- submission ----
+
+// Submit queued SQEs; with `ts`, also wait for `min_complete` completions or the timeout.
+static int uring_enter(reactor_t *r, uring_t *u, u32 min_complete, struct __kernel_timespec *ts) {
+    __atomic_store_n(u->sq_tail, u->sq_local, __ATOMIC_RELEASE);
+    u32 pending = u->sq_local - __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE);
+
+    struct io_uring_getevents_arg arg;
+    u32 flags = 0;
+    if (ts) {
+        memset(&arg, 0, sizeof(arg));
+        arg.ts = (u64)(uintptr_t)ts;
+        flags = IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+    }
+
+    r->syscalls++;
+    return sys_enter(u->fd, pending, min_complete, flags, ts ? &arg : 0, ts ? sizeof(arg) : 0);
+}
+
+// Make room for `n` SQEs, submitting early if the queue is full.
+static void sq_reserve(reactor_t *r, uring_t *u, u32 n) {
+    u32 used = u->sq_local - __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE);
+    if (u->sq_entries - used < n) uring_enter(r, u, 0, 0);
+}
+
+static struct io_uring_sqe *sqe_get(reactor_t *r, uring_t *u) {
+    sq_reserve(r, u, 1);
+    struct io_uring_sqe *e = &u->sqes[u->sq_local++ & u->sq_mask];
+    memset(e, 0, sizeof(*e));
+    return e;
+}
+
+static void arm_accept(reactor_t *r, uring_t *u) {
+    struct io_uring_sqe *e = sqe_get(r, u);
+    e->opcode = IORING_OP_ACCEPT;
+    e->fd = r->lfd;
+    e->ioprio = IORING_ACCEPT_MULTISHOT;
+    // Blocking sockets: the ring polls them for us, whereas O_NONBLOCK would
+    // make writes complete with -EAGAIN instead of waiting for buffer space.
+    e->accept_flags = SOCK_CLOEXEC;
+    e->user_data = OP_ACCEPT;
+    u->accept_armed = 1;
+    u->accept_backoff = 0;
+}
+
+static void arm_wake(reactor_t *r, uring_t *u) {
+    struct io_uring_sqe *e = sqe_get(r, u);
+    e->opcode = IORING_OP_READ;
+    e->fd = r->evfd;
+    e->addr = (u64)(uintptr_t)&u->wake_cnt;
+    e->len = sizeof(u->wake_cnt);
+    e->user_data = OP_WAKE;
+}
+
+static void arm_recv(reactor_t *r, uring_t *u, conn_t *c) {
+    struct io_uring_sqe *e = sqe_get(r, u);
+    e->opcode = IORING_OP_RECV;
+    e->fd = c->fd;
+    e->ioprio = IORING_RECV_MULTISHOT;
+    e->flags = IOSQE_BUFFER_SELECT;
+    e->buf_group = RX_GROUP;
+    e->user_data = (u64)(uintptr_t)c | OP_RECV;
+    c->rx_armed = 1;
+    c->io_refs++;
+}
+
+static void cancel_recv(reactor_t *r, uring_t *u, conn_t *c) {
+    if (c->rx_armed != 1) return;
+    struct io_uring_sqe *e = sqe_get(r, u);
+    e->opcode = IORING_OP_ASYNC_CANCEL;
+    e->addr = (u64)(uintptr_t)c | OP_RECV;
+    e->user_data = OP_CANCEL;
+    c->rx_armed = 2;
+}
+
+// ---- buffers ----
+
+static void rx_recycle(uring_t *u, u16 bid) {
+    struct io_uring_buf *b = &u->rx_ring->bufs[u->rx_tail & (RX_BUFS - 1)];
+    b->addr = (u64)(uintptr_t)(u->rx_mem + (usize)bid * RX_BUF_SIZE);
+    b->len = RX_BUF_SIZE;
+    b->bid = bid;
+    u->rx_tail++;
+    __atomic_store_n(&u->rx_ring->tail, u->rx_tail, __ATOMIC_RELEASE);
+}
+
+static void tx_wait_push(uring_t *u, conn_t *c) {
+    if (c->tx_waiting) return;
+    c->tx_waiting = 1;
+    c->io_refs++;
+    c->next_tx = 0;
+    if (u->tx_wait_tail) {
+        u->tx_wait_tail->next_tx = c;
+    } else {
+        u->tx_wait = c;
+    }
+    u->tx_wait_tail = c;
+}
+
+// Retry connections that found no free send slot, oldest first.
+static void tx_wait_run(reactor_t *r, uring_t *u) {
+    while (u->tx_wait && u->tx_nfree > 0) {
+        conn_t *c = u->tx_wait;
+        u->tx_wait = c->next_tx;
+        if (!u->tx_wait) u->tx_wait_tail = 0;
+        c->next_tx = 0;
+        c->tx_waiting = 0;
+
+        if (!c->closing && conn_flush(r, c)) conn_close(r, c);
+        conn_io_done(r, c);
+    }
+}
+
+// ---- transport API ----
+
+int transport_flush(reactor_t *r, conn_t *c) {
+    uring_t *u = (uring_t*)r->backend;
+
+    // One chain per connection keeps the byte order; its completion flushes the rest.
+    if (c->tx_ops > 0 || c->tx_waiting) return 0;
+    if (conn_out_pending(c) == 0) return 0;
+    sq_reserve(r, u, TX_CHAIN_MAX);
+
+    // Bytes stay queued until their write completes; a short write cancels
+    // the rest of the chain and the next flush resends from there.
+    struct io_uring_sqe *prev = 0;
+    u32 i = 0;
+    usize skip = 0; // bytes of segment i already in the chain
+    while (c->tx_ops < TX_CHAIN_MAX && i < c->oq_len) {
+        out_seg_t *seg = conn_out_seg(c, i);
+        if (seg->len == 0) {
+            i++;
+            continue;
+        }
+
+        struct io_uring_sqe *e;
+        if (seg->buf->shared) {
+            // Room frames go out straight from the shared buffer.
+            e = sqe_get(r, u);
+            e->opcode = IORING_OP_SEND;
+            e->fd = c->fd;
+            e->addr = (u64)(uintptr_t)(seg->buf->data + seg->off);
+            e->len = seg->len;
+            e->msg_flags = MSG_NOSIGNAL;
+            e->user_data = (u64)(uintptr_t)c | OP_SEND;
+            i++;
+        } else {
+            // The connection's own frames are gathered into a registered buffer.
+            if (u->tx_nfree == 0) break;
+            u16 slot = u->tx_free[--u->tx_nfree];
+            u8 *dst = u->tx_mem + (usize)slot * TX_SLOT_SIZE;
+
+            usize k = 0;
+            while (i < c->oq_len && k < TX_SLOT_SIZE) {
+                out_seg_t *p = conn_out_seg(c, i);
+                if (p->buf->shared) break;
+                usize take = p->len - skip;
+                if (take > TX_SLOT_SIZE - k) take = TX_SLOT_SIZE - k;
+                memcpy(dst + k, p->buf->data + p->off + skip, take);
+                k += take;
+                skip += take;
+                if (skip == p->len) {
+                    i++;
+                    skip = 0;
+                }
+            }
+
+            e = sqe_get(r, u);
+            e->opcode = IORING_OP_WRITE_FIXED;
+            e->fd = c->fd;
+            e->addr = (u64)(uintptr_t)dst;
+            e->len = (u32)k;
+            e->buf_index = 0;
+            e->user_data = (u64)(uintptr_t)c | OP_WRITE | ((u64)slot << 48);
+        }
+
+        if (prev) prev->flags |= IOSQE_IO_LINK;
+        prev = e;
+        c->tx_ops++;
+        c->io_refs++;
+    }
+
+    // Nothing went out: every registered buffer is in use.
+    if (c->tx_ops == 0) tx_wait_push(u, c);
+    return 0;
+}
+
+int transport_resume(reactor_t *r, conn_t *c) {
+    // A recv still being cancelled is re-armed when its final completion arrives.
+    if (!c->closing && !c->rx_armed) arm_recv(r, (uring_t*)r->backend, c);
+    return 0;
+}
+
+void transport_close(reactor_t *r, conn_t *c) {
+    (void)r;
+    // Pending recv and writes hold their own reference to the socket;
+    // shutdown completes them so the connection's io_refs can drain.
+    shutdown(c->fd, SHUT_RDWR);
+    close(c->fd);
+    c->fd = -1;
+}
+
+// ---- completions ----
+
+static void on_accept(reactor_t *r, uring_t *u, int res, u32 flags) {
+    if (res >= 0) {
+        conn_t *c = conn_open(r, res);
+        if (c) {
+            arm_recv(r, u, c);
+        } else {
+            close(res);
+        }
+    }
+    if (!(flags & IORING_CQE_F_MORE)) {
+        // Re-armed after the tick; on errors (e.g. EMFILE) after a short wait.
+        u->accept_armed = 0;
+        u->accept_backoff = res < 0;
+    }
+}
+
+static void on_recv(reactor_t *r, uring_t *u, conn_t *c, int res, u32 flags) {
+    if (flags & IORING_CQE_F_BUFFER) {
+        u16 bid = (u16)(flags >> IORING_CQE_BUFFER_SHIFT);
+        if (res > 0 && !c->closing && conn_feed(r, c, u->rx_mem + (usize)bid * RX_BUF_SIZE, (usize)res)) {
+            conn_close(r, c);
+        }
+        rx_recycle(u, bid);
+    }
+
+    if (flags & IORING_CQE_F_MORE) {
+        // Output backed up: stop receiving until conn_flush resumes us.
+        if (c->read_paused && !c->closing) cancel_recv(r, u, c);
+        return;
+    }
+
+    // The multishot recv ended: EOF, an error, a cancel, or the buffer ring ran dry.
+    c->rx_armed = 0;
+    if (!c->closing) {
+        if (res == 0 || (res < 0 && res != -ECANCELED && res != -ENOBUFS)) {
+            conn_close(r, c);
+        } else if (!c->read_paused) {
+            arm_recv(r, u, c);
+        }
+    }
+    conn_io_done(r, c);
+}
+
+static void on_sent(reactor_t *r, conn_t *c, int res) {
+    c->tx_ops--;
+
+    if (res > 0) {
+        conn_out_consume(r, c, (usize)res);
+    } else if (res < 0 && res != -ECANCELED && !c->closing) {
+        conn_close(r, c);
+    }
+    if (c->tx_ops == 0 && !c->closing && conn_flush(r, c)) conn_close(r, c);
+    conn_io_done(r, c);
+}
+
+static void reap(reactor_t *r, uring_t *u) {
+    u32 head = *u->cq_head;
+
+    for (;;) {
+        u32 tail = __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE);
+        if (head == tail) break;
+
+        while (head != tail) {
+            struct io_uring_cqe *cqe = &u->cqes[head & u->cq_mask];
+            u64 ud = cqe->user_data;
+            int res = cqe->res;
+            u32 flags = cqe->flags;
+            __atomic_store_n(u->cq_head, ++head, __ATOMIC_RELEASE);
+
+            switch (UD_OP(ud)) {
+                case OP_ACCEPT: on_accept(r, u, res, flags); break;
+                case OP_WAKE:   if (!r->stop) arm_wake(r, u); break;
+                case OP_RECV:   on_recv(r, u, UD_CONN(ud), res, flags); break;
+                case OP_WRITE:
+                    u->tx_free[u->tx_nfree++] = (u16)UD_SLOT(ud);
+                    on_sent(r, UD_CONN(ud), res);
+                    break;
+                case OP_SEND:   on_sent(r, UD_CONN(ud), res); break;
+                default:        break;
+            }
+        }
+    }
+}
+
+// ---- lifecycle ----
+
+static void *map_anon(usize len) {
+    void *p = mmap(0, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return p == MAP_FAILED ? 0 : p;
+}
+
+static int uring_setup(uring_t *u) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+
+    // Only the shard's thread touches the ring, and completions are
+    // processed when it asks for them. SINGLE_ISSUER binds the ring to the
+    // thread that enables it, so it starts disabled (see reactor_run).
+    p.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SINGLE_ISSUER |
+              IORING_SETUP_DEFER_TASKRUN | IORING_SETUP_R_DISABLED;
+    p.cq_entries = URING_CQ_ENTRIES;
+
+    u->fd = sys_setup(URING_SQ_ENTRIES, &p);
+    if (u->fd < 0) return 1;
+    if (!(p.features & IORING_FEAT_SINGLE_MMAP) || !(p.features & IORING_FEAT_EXT_ARG)) {
+        errno = ENOSYS;
+        return 1;
+    }
+
+    usize sq_size = p.sq_off.array + p.sq_entries * sizeof(u32);
+    usize cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    u->ring_size = sq_size > cq_size ? sq_size : cq_size;
+    u->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+
+    void *ring = mmap(0, u->ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQ_RING);
+    if (ring == MAP_FAILED) return 1;
+    u->ring_mem = ring;
+
+    void *sqes = mmap(0, u->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) return 1;
+    u->sqes = (struct io_uring_sqe*)sqes;
+
+    u8 *m = (u8*)ring;
+    u->sq_head    = (u32*)(m + p.sq_off.head);
+    u->sq_tail    = (u32*)(m + p.sq_off.tail);
+    u->sq_mask    = *(u32*)(m + p.sq_off.ring_mask);
+    u->sq_entries = p.sq_entries;
+    u->sq_local   = *u->sq_tail;
+    u->cq_head    = (u32*)(m + p.cq_off.head);
+    u->cq_tail    = (u32*)(m + p.cq_off.tail);
+    u->cq_mask    = *(u32*)(m + p.cq_off.ring_mask);
+    u->cqes       = (struct io_uring_cqe*)(m + p.cq_off.cqes);
+
+    // SQ slot i always carries SQE i, so the index array is written once.
+    u32 *array = (u32*)(m + p.sq_off.array);
+    for (u32 i = 0; i < p.sq_entries; i++) array[i] = i;
+
+    // Provided receive buffers.
+    u->rx_ring = (struct io_uring_buf_ring*)map_anon(RX_BUFS * sizeof(struct io_uring_buf));
+    u->rx_mem = (u8*)malloc((usize)RX_BUFS * RX_BUF_SIZE);
+    if (!u->rx_ring || !u->rx_mem) return 1;
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (u64)(uintptr_t)u->rx_ring;
+    reg.ring_entries = RX_BUFS;
+    reg.bgid = RX_GROUP;
+    if (sys_register(u->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) return 1;
+    for (u32 i = 0; i < RX_BUFS; i++) rx_recycle(u, (u16)i);
+
+    // Registered send buffers: one pinned region, addressed by slot.
+    u->tx_mem = (u8*)map_anon((usize)TX_SLOTS * TX_SLOT_SIZE);
+    u->tx_free = (u16*)malloc(TX_SLOTS * sizeof(*u->tx_free));
+    if (!u->tx_mem || !u->tx_free) return 1;
+
+    struct iovec iov;
+    iov.iov_base = u->tx_mem;
+    iov.iov_len = (usize)TX_SLOTS * TX_SLOT_SIZE;
+    if (sys_register(u->fd, IORING_REGISTER_BUFFERS, &iov, 1) < 0) return 1;
+    for (u32 i = 0; i < TX_SLOTS; i++) u->tx_free[i] = (u16)(TX_SLOTS - 1 - i);
+    u->tx_nfree = TX_SLOTS;
+    return 0;
+}
+
+int reactor_init(reactor_t *r, const char *ip, int port) {
+    memset(r, 0, sizeof(*r));
+    r->epfd = -1;
+    r->evfd = -1;
+    r->cpu = -1;
+
+    r->lfd = server_listen(ip, port);
+    if (r->lfd < 0) return 1;
+
+    // Blocking, so the ring's READ waits for a wakeup instead of failing with EAGAIN.
+    r->evfd = eventfd(0, EFD_CLOEXEC);
+    if (r->evfd < 0) return 1;
+
+    uring_t *u = (uring_t*)calloc(1, sizeof(*u));
+    if (!u) return 1;
+    u->fd = -1;
+    r->backend = u;
+    return uring_setup(u);
+}
+
+int reactor_run(reactor_t *r) {
+    uring_t *u = (uring_t*)r->backend;
+
+    if (sys_register(u->fd, IORING_REGISTER_ENABLE_RINGS, 0, 0) < 0) {
+        perror("io_uring enable");
+        return 1;
+    }
+    arm_accept(r, u);
+    arm_wake(r, u);
+
+    while (!r->stop) {
+        // Same handshake with producers as the epoll loop.
+        atomic_store(&r->asleep, 1);
+        atomic_thread_fence(memory_order_seq_cst);
+        usize early = shard_drain_inbound(r);
+
+        // Submit last tick's work and wait for completions in one syscall.
+        // The wait ends no later than the next heartbeat timer.
+        struct __kernel_timespec ts;
+        int wait_ms = early > 0 ? 0 : reactor_timer_wait_ms(r, u->accept_backoff ? 10 : 1000);
+        ts.tv_sec = wait_ms / 1000;
+        ts.tv_nsec = (long long)(wait_ms % 1000) * 1000000;
+        int rc = uring_enter(r, u, early > 0 ? 0 : 1, &ts);
+        atomic_store(&r->asleep, 0);
+        if (rc < 0 && errno != ETIME && errno != EINTR && errno != EBUSY) {
+            perror("io_uring_enter");
+            return 1;
+        }
+        reactor_clock(r);
+        // The short wait after an accept error is over.
+        if (!u->accept_armed && u->accept_backoff) arm_accept(r, u);
+
+        reap(r, u);
+        tx_wait_run(r, u);
+
+        shard_drain_inbound(r);
+        reactor_run_timers(r);
+        reactor_end_tick(r);
+        shard_notify(r);
+
+        if (!u->accept_armed && !u->accept_backoff) arm_accept(r, u);
+    }
+    return 0;
+}
+
+void reactor_destroy(reactor_t *r) {
+    reactor_free_buffers(r);
+
+    uring_t *u = (uring_t*)r->backend;
+    if (u) {
+        // Closing the ring cancels whatever is still in flight.
+        if (u->fd >= 0) close(u->fd);
+        if (u->sqes) munmap(u->sqes, u->sqes_size);
+        if (u->ring_mem) munmap(u->ring_mem, u->ring_size);
+        if (u->rx_ring) munmap(u->rx_ring, RX_BUFS * sizeof(struct io_uring_buf));
+        if (u->tx_mem) munmap(u->tx_mem, (usize)TX_SLOTS * TX_SLOT_SIZE);
+        free(u->rx_mem);
+        free(u->tx_free);
+        free(u);
+        r->backend = 0;
+    }
+
+    if (r->evfd >= 0) close(r->evfd);
+    if (r->lfd >= 0) close(r->lfd);
+    r->evfd = r->lfd = -1;
+}
@@ -0,0 +1,128 @@
+#include "wheel.h"
+
+#include <string.h>
+
+#define SLOT_MASK  (WHEEL_SLOTS - 1)
+#define WHEEL_SPAN (1ull << (WHEEL_SLOT_BITS * WHEEL_LEVELS)) // ticks the wheel reaches ahead
+
+void wheel_init(wheel_t *w, u64 now) {
+    memset(w, 0, sizeof(*w));
+    w->now = now;
+}
+
+// Link `t` into the slot for its deadline, relative to w->now.
+static void place(wheel_t *w, wheel_timer_t *t) {
+    u64 e = t->expires < w->now ? w->now : t->expires;
+    u64 d = e - w->now;
+    if (d >= WHEEL_SPAN) {
+        // Beyond the last level: park as far out as it reaches, and place
+        // again from there.
+        d = WHEEL_SPAN - 1;
+        e = w->now + d;
+    }
+
+    u32 lvl = d < WHEEL_SLOTS ? 0 : (u32)(63 - __builtin_clzll(d)) / WHEEL_SLOT_BITS;
+    u32 idx = (u32)(e >> (lvl * WHEEL_SLOT_BITS)) & SLOT_MASK;
+
+    wheel_timer_t **head = &w->slot[lvl][idx];
+    t->next = *head;
+    if (t->next) t->next->pprev = &t->next;
+    t->pprev = head;
+    *head = t;
+    t->where = (u16)(lvl * WHEEL_SLOTS + idx);
+    w->busy[lvl] |= 1ull << idx;
+}
+
+static void unlink_timer(wheel_t *w, wheel_timer_t *t) {
+    *t->pprev = t->next;
+    if (t->next) t->next->pprev = t->pprev;
+    t->next = 0;
+    t->pprev = 0;
+
+    u32 lvl = t->where / WHEEL_SLOTS, idx = t->where & SLOT_MASK;
+    if (!w->slot[lvl][idx]) w->busy[lvl] &= ~(1ull << idx);
+}
+
+void wheel_arm(wheel_t *w, wheel_timer_t *t, u64 expires) {
+    if (t->pprev) {
+        unlink_timer(w, t);
+    } else {
+        w->count++;
+    }
+    t->expires = expires;
+    place(w, t);
+}
+
+void wheel_cancel(wheel_t *w, wheel_timer_t *t) {
+    if (!t->pprev) return;
+    unlink_timer(w, t);
+    w->count--;
+}
+
+// Empty one slot of a higher level into the levels below.
+static void cascade(wheel_t *w, u32 lvl, u32 idx) {
+    wheel_timer_t *t = w->slot[lvl][idx];
+    w->slot[lvl][idx] = 0;
+    w->busy[lvl] &= ~(1ull << idx);
+    while (t) {
+        wheel_timer_t *next = t->next;
+        place(w, t);
+        t = next;
+    }
+}
+
+u64 wheel_advance(wheel_t *w, u64 now, wheel_fire_fn fire, void *arg) {
+    u64 fired = 0;
+    while (w->now <= now) {
+        if (w->count == 0) {
+            w->now = now + 1;
+            break;
+        }
+
+        u64 tick = w->now;
+        for (u32 lvl = 1; lvl < WHEEL_LEVELS && (tick & ((1ull << (lvl * WHEEL_SLOT_BITS)) - 1)) == 0; lvl++) {
+            cascade(w, lvl, (u32)(tick >> (lvl * WHEEL_SLOT_BITS)) & SLOT_MASK);
+        }
+
+        if (!w->busy[0]) {
+            // Nothing in level 0: skip to where the next level comes down.
+            u64 next = (tick | SLOT_MASK) + 1;
+            w->now = next <= now ? next : now + 1;
+            continue;
+        }
+
+        u32 idx = (u32)tick & SLOT_MASK;
+        wheel_timer_t *list = w->slot[0][idx];
+        w->slot[0][idx] = 0;
+        w->busy[0] &= ~(1ull << idx);
+        if (list) list->pprev = &list;
+        w->now = tick + 1;
+
+        // Detached first, so a callback may arm or cancel any timer,
+        // including ones further down this list.
+        wheel_timer_t *t;
+        while ((t = list) != 0) {
+            list = t->next;
+            if (list) list->pprev = &list;
+            t->next = 0;
+            t->pprev = 0;
+            w->count--;
+            fired++;
+            fire(w, t, arg);
+        }
+    }
+    return fired;
+}
+
+u64 wheel_next(const wheel_t *w, u64 now, u64 max) {
+    if (w->count == 0) return max;
+
+    // At a multiple of WHEEL_SLOTS higher levels come down first, and may
+    // bring anything due from then on.
+    u64 base = w->now;
+    u64 pending = w->busy[0] >> (base & SLOT_MASK);
+    u64 at = base;
+    if (base & SLOT_MASK) at = pending ? base + (u64)__builtin_ctzll(pending) : (base | SLOT_MASK) + 1;
+    if (at <= now) return 0;
+    return at - now < max ? at - now : max;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "dbin/types.h"
+
+// Hierarchical hashed timer wheel, one per reactor thread.
+//
+// Time is counted in ticks. Level 0 has a slot per tick for the next
+// WHEEL_SLOTS ticks; each level above covers WHEEL_SLOTS times the span of
+// the one below, so WHEEL_LEVELS levels reach 2^24 ticks ahead (later
+// deadlines wait in the last level and are placed again as it turns). A
+// timer sits in the slot of its deadline at the lowest level that can hold
+// it and moves down a level whenever the slot above it comes due, at most
+// WHEEL_LEVELS - 1 times in its life.
+//
+// Timers are intrusive and linked both ways, so arm, re-arm and cancel are
+// O(1) with no allocation and no search.
+
+#define WHEEL_SLOT_BITS 6
+#define WHEEL_SLOTS     (1u << WHEEL_SLOT_BITS)
+#define WHEEL_LEVELS    4
+
+typedef struct wheel_timer wheel_timer_t;
+
+struct wheel_timer {
+    wheel_timer_t  *next;
+    wheel_timer_t **pprev;   // the pointer that points here; 0 when not armed
+    u64             expires; // tick
+    u16             where;   // level * WHEEL_SLOTS + slot
+};
+
+typedef struct wheel wheel_t;
+
+// Called for each expired timer, already disarmed: it may be armed again.
+typedef void (*wheel_fire_fn)(wheel_t *w, wheel_timer_t *t, void *arg);
+
+struct wheel {
+    u64            now;      // next tick to run; earlier deadlines are due
+    u64            count;    // armed timers
+    u64            busy[WHEEL_LEVELS]; // non-empty slots, one bit each
+    wheel_timer_t *slot[WHEEL_LEVELS][WHEEL_SLOTS];
+};
+
+void  wheel_init(wheel_t *w, u64 now);
+
+// Arm `t` to fire at tick `expires` (at the next wheel_advance when already
+// past); an armed timer is moved.
+void  wheel_arm(wheel_t *w, wheel_timer_t *t, u64 expires);
+void  wheel_cancel(wheel_t *w, wheel_timer_t *t);
+
+static inline int wheel_armed(const wheel_timer_t *t) {
+    return t->pprev != 0;
+}
+
+// Run every tick up to and including `now`, calling `fire` for each timer
+// that expires. Returns the number fired.
+u64   wheel_advance(wheel_t *w, u64 now, wheel_fire_fn fire, void *arg);
+
+// Ticks from `now` until the wheel next has work, at most `max`: the
+// nearest level-0 deadline, or the next time a higher level comes down.
+// May be early, never late.
+u64   wheel_next(const wheel_t *w, u64 now, u64 max);
@@ -0,0 +1,80 @@
+#include "dbin/ack.h"
+
+#include <string.h>
+
+void dbin_acker_init(dbin_acker_t *a) {
+    memset(a, 0, sizeof(*a));
+}
+
+int dbin_acker_add(dbin_acker_t *a, const dbin_msg_t *m) {
+    if (a->run == 0) {
+        a->sack = 0;
+        a->user_id = m->user_id;
+        a->route = m->route;
+        a->is_room = m->is_room;
+        a->last = m->msg_id;
+        a->run = 1;
+        return 1;
+    }
+    if (m->user_id != a->user_id) return 0;
+
+    // Distance past the run, modulo 2^16: ids at or behind `last` wrap to
+    // large values and start a new frame, as do repeats.
+    u16 d = (u16)(m->msg_id - a->last);
+    if (d == 0 || d > DBIN_ACK_SACK_BYTES * 8) return 0;
+    u64 bit = 1ull << (d - 1);
+    if (a->sack & bit) return 0;
+    a->sack |= bit;
+
+    // Selective acks that now touch the run extend it.
+    while ((a->sack & 1) && a->run < DBIN_ACK_MAX_RUN) {
+        a->sack >>= 1;
+        a->last++;
+        a->run++;
+    }
+    return 1;
+}
+
+void dbin_acker_take(dbin_acker_t *a, dbin_msg_t *out) {
+    memset(out, 0, sizeof(*out));
+    out->magic = (u16)DBIN_MAGIC;
+    out->version = (u8)DBIN_VERSION;
+    out->valid = 1;
+    out->user_id = a->user_id;
+    out->msg_id = a->last;
+
+    if (a->run == 1 && a->sack == 0) {
+        out->type = (u8)DBIN_TYPE_ACK;
+        out->is_room = a->is_room;
+        out->route = a->route;
+    } else {
+        out->type = (u8)DBIN_TYPE_ACK_RANGE;
+        out->route = a->run;
+
+        u16 n = 0;
+        for (u64 s = a->sack; s; s >>= 8) a->bytes[n++] = (u8)s;
+        out->msg_len = n;
+        out->msg = n ? a->bytes : 0;
+    }
+    a->run = 0;
+    a->sack = 0;
+}
+
+int dbin_ack_covers(const dbin_msg_t *ack, u16 msg_id) {
+    if (ack->type == DBIN_TYPE_ACK) return ack->msg_id == msg_id;
+    if (ack->type != DBIN_TYPE_ACK_RANGE) return 0;
+
+    if ((u16)(ack->msg_id - msg_id) < ack->route) return 1;
+    u16 d = (u16)(msg_id - ack->msg_id);
+    if (d == 0 || d > (u32)ack->msg_len * 8) return 0;
+    return (ack->msg[(d - 1) / 8] >> ((d - 1) % 8)) & 1;
+}
+
+u32 dbin_ack_count(const dbin_msg_t *ack) {
+    if (ack->type == DBIN_TYPE_ACK) return 1;
+    if (ack->type != DBIN_TYPE_ACK_RANGE) return 0;
+
+    u32 n = ack->route;
+    for (u16 i = 0; i < ack->msg_len; i++) n += (u32)__builtin_popcount(ack->msg[i]);
+    return n;
+}
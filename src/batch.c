@@ -0,0 +1,339 @@
+#include "dbin/batch.h"
+#include "dbin/codec.h"
+#include "dbin/protocol.h"
+#include "dbin/schema.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define DBIN_BATCH_X86 1
+#include <immintrin.h>
+#endif
+
+typedef void (*decode_batch_fn)(const u8 *const *frames, const usize *lens, usize n, dbin_batch_t *soa);
+
+// Stand-in header for frames too short to hold one, so SIMD loads stay in bounds.
+static const u8 zero_hdr[DBIN_HEADER_V1_BYTES];
+
+static void decode_one(const u8 *const *frames, const usize *lens, usize i, dbin_batch_t *soa) {
+    dbin_msg_t m;
+    memset(&m, 0, sizeof(m));
+
+    int rc = (frames[i] != 0) ? dbin_decode(frames[i], lens[i], &m) : DBIN_ERR_PARAM;
+
+    soa->user_id[i] = m.user_id;
+    soa->route[i]   = m.route;
+    soa->msg_id[i]  = m.msg_id;
+    soa->msg_len[i] = m.msg_len;
+    soa->type[i]    = m.type;
+    soa->is_room[i] = (u8)m.is_room;
+    if (soa->reserved) soa->reserved[i] = m.reserved;
+    soa->payload[i] = (rc == DBIN_OK) ? m.msg : 0;
+    soa->err[i]     = (u8)rc;
+}
+
+static void decode_scalar(const u8 *const *frames, const usize *lens, usize n, dbin_batch_t *soa) {
+    for (usize i = 0; i < n; i++) decode_one(frames, lens, i, soa);
+}
+
+#ifdef DBIN_BATCH_X86
+
+// The SIMD paths turn each 12-byte header into four 32-bit lanes holding
+// big-endian bytes [0..3], [3..6], [5..8] and [8..11]. Every field then sits
+// at a fixed shift inside one lane:
+//   lane0: magic >> 20, version >> 16, type >> 13, is_room >> 11, reserved >> 8
+//   lane1: user_id >> 12
+//   lane2: route >> 8 (20 bits)
+//   lane3: msg_id >> 16, msg_len >> 4 (12 bits)
+#define LANE_SHUFFLE 3, 2, 1, 0, 6, 5, 4, 3, 8, 7, 6, 5, 11, 10, 9, 8
+
+static const u8 *header_ptr(const u8 *const *frames, const usize *lens, usize i) {
+    if (!frames[i] || lens[i] < DBIN_HEADER_V1_BYTES) return zero_hdr;
+    return frames[i];
+}
+
+// Errors that need the frame length, resolved per frame after the vector part.
+// Priority matches dbin_decode: BUF (short), MAGIC, VER, FMT (reserved bits), BUF (payload), type rules.
+static void finish_frames(const u8 *const *frames, const usize *lens, usize base, usize cnt,
+                          unsigned bad_magic, unsigned bad_ver, unsigned bad_res,
+                          dbin_batch_t *soa) {
+    for (usize k = 0; k < cnt; k++) {
+        usize i = base + k;
+        u8 e = DBIN_OK;
+
+        if (!frames[i]) e = DBIN_ERR_PARAM;
+        else if (lens[i] < DBIN_HEADER_V1_BYTES) e = DBIN_ERR_BUF;
+        else if ((bad_magic >> k) & 1u) e = DBIN_ERR_MAGIC;
+        else if ((bad_ver >> k) & 1u) e = DBIN_ERR_VER;
+        else if ((bad_res >> k) & 1u) e = DBIN_ERR_FMT;
+        else if ((usize)soa->msg_len[i] > lens[i] - DBIN_HEADER_V1_BYTES) e = DBIN_ERR_BUF;
+        else e = (u8)dbin_type_check(soa->type[i], soa->is_room[i], soa->route[i], soa->msg_len[i]);
+
+        soa->err[i] = e;
+        soa->payload[i] = (e == DBIN_OK && soa->msg_len[i] > 0) ? frames[i] + DBIN_HEADER_V1_BYTES : 0;
+    }
+}
+
+__attribute__((target("ssse3")))
+static __m128i load_hdr_128(const u8 *p) {
+    // Exactly 12 bytes: 8 + 4, never past the header.
+    u32 tail;
+    memcpy(&tail, p + 8, sizeof(tail));
+    __m128i lo = _mm_loadl_epi64((const __m128i*)p);
+    return _mm_unpacklo_epi64(lo, _mm_cvtsi32_si128((int)tail));
+}
+
+__attribute__((target("ssse3")))
+static void decode4_ssse3(const u8 *const *frames, const usize *lens, usize base, dbin_batch_t *soa) {
+    const __m128i shuf = _mm_setr_epi8(LANE_SHUFFLE);
+
+    __m128i v0 = _mm_shuffle_epi8(load_hdr_128(header_ptr(frames, lens, base + 0)), shuf);
+    __m128i v1 = _mm_shuffle_epi8(load_hdr_128(header_ptr(frames, lens, base + 1)), shuf);
+    __m128i v2 = _mm_shuffle_epi8(load_hdr_128(header_ptr(frames, lens, base + 2)), shuf);
+    __m128i v3 = _mm_shuffle_epi8(load_hdr_128(header_ptr(frames, lens, base + 3)), shuf);
+
+    // 4x4 transpose: Lk holds lane k of frames base..base+3.
+    __m128i t0 = _mm_unpacklo_epi32(v0, v1);
+    __m128i t1 = _mm_unpacklo_epi32(v2, v3);
+    __m128i t2 = _mm_unpackhi_epi32(v0, v1);
+    __m128i t3 = _mm_unpackhi_epi32(v2, v3);
+    __m128i l0 = _mm_unpacklo_epi64(t0, t1);
+    __m128i l1 = _mm_unpackhi_epi64(t0, t1);
+    __m128i l2 = _mm_unpacklo_epi64(t2, t3);
+    __m128i l3 = _mm_unpackhi_epi64(t2, t3);
+
+    __m128i magic    = _mm_srli_epi32(l0, 20);
+    __m128i version  = _mm_and_si128(_mm_srli_epi32(l0, 16), _mm_set1_epi32(0xF));
+    __m128i type     = _mm_and_si128(_mm_srli_epi32(l0, 13), _mm_set1_epi32(0x7));
+    __m128i is_room  = _mm_and_si128(_mm_srli_epi32(l0, 11), _mm_set1_epi32(0x1));
+    __m128i reserved = _mm_and_si128(_mm_srli_epi32(l0, 8),  _mm_set1_epi32(0x7));
+    __m128i user_id  = _mm_srli_epi32(l1, 12);
+    __m128i route    = _mm_and_si128(_mm_srli_epi32(l2, 8),  _mm_set1_epi32(0xFFFFF));
+    __m128i msg_len  = _mm_and_si128(_mm_srli_epi32(l3, 4),  _mm_set1_epi32(0xFFF));
+
+    unsigned ok_magic = (unsigned)_mm_movemask_ps(_mm_castsi128_ps(
+        _mm_cmpeq_epi32(magic, _mm_set1_epi32(DBIN_MAGIC))));
+    unsigned ok_ver = (unsigned)_mm_movemask_ps(_mm_castsi128_ps(
+        _mm_cmpeq_epi32(version, _mm_set1_epi32(DBIN_VERSION))));
+    // Reserved: 0, or Z/F on a MSG with a payload (dbin_reserved_check).
+    __m128i z_ok = _mm_andnot_si128(_mm_cmpeq_epi32(msg_len, _mm_setzero_si128()),
+        _mm_and_si128(_mm_cmpeq_epi32(_mm_and_si128(reserved, _mm_set1_epi32(0x7 & ~DBIN_RESERVED_MSG)),
+                                      _mm_setzero_si128()),
+                      _mm_cmpeq_epi32(type, _mm_set1_epi32(DBIN_TYPE_MSG))));
+    unsigned ok_res = (unsigned)_mm_movemask_ps(_mm_castsi128_ps(
+        _mm_or_si128(_mm_cmpeq_epi32(reserved, _mm_setzero_si128()), z_ok)));
+
+    // Narrow to the SoA element widths: u16 = low/high halves, u8 = low bytes.
+    const __m128i lo16 = _mm_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i hi16 = _mm_setr_epi8(2, 3, 6, 7, 10, 11, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i lo8  = _mm_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+
+    _mm_storeu_si128((__m128i*)(soa->user_id + base), user_id);
+    _mm_storeu_si128((__m128i*)(soa->route + base), route);
+    _mm_storel_epi64((__m128i*)(soa->msg_id + base), _mm_shuffle_epi8(l3, hi16));
+    _mm_storel_epi64((__m128i*)(soa->msg_len + base), _mm_shuffle_epi8(msg_len, lo16));
+
+    u32 b4 = (u32)_mm_cvtsi128_si32(_mm_shuffle_epi8(type, lo8));
+    memcpy(soa->type + base, &b4, sizeof(b4));
+    b4 = (u32)_mm_cvtsi128_si32(_mm_shuffle_epi8(is_room, lo8));
+    memcpy(soa->is_room + base, &b4, sizeof(b4));
+    if (soa->reserved) {
+        b4 = (u32)_mm_cvtsi128_si32(_mm_shuffle_epi8(reserved, lo8));
+        memcpy(soa->reserved + base, &b4, sizeof(b4));
+    }
+
+    finish_frames(frames, lens, base, 4, ~ok_magic & 0xFu, ~ok_ver & 0xFu, ~ok_res & 0xFu, soa);
+}
+
+__attribute__((target("ssse3")))
+static void decode_ssse3(const u8 *const *frames, const usize *lens, usize n, dbin_batch_t *soa) {
+    usize i = 0;
+    for (; i + 4 <= n; i += 4) decode4_ssse3(frames, lens, i, soa);
+    for (; i < n; i++) decode_one(frames, lens, i, soa);
+}
+
+__attribute__((target("avx2")))
+static __m256i load_hdr_pair(const u8 *a, const u8 *b) {
+    u32 ta, tb;
+    memcpy(&ta, a + 8, sizeof(ta));
+    memcpy(&tb, b + 8, sizeof(tb));
+    __m128i va = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)a), _mm_cvtsi32_si128((int)ta));
+    __m128i vb = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)b), _mm_cvtsi32_si128((int)tb));
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(va), vb, 1);
+}
+
+__attribute__((target("avx2")))
+static void decode8_avx2(const u8 *const *frames, const usize *lens, usize base, dbin_batch_t *soa) {
+    const __m256i shuf = _mm256_setr_epi8(LANE_SHUFFLE, LANE_SHUFFLE);
+
+    // vk = [frame k | frame k+4]; the in-lane transpose below then yields
+    // frames base..base+7 in order.
+    __m256i v[4];
+    for (int k = 0; k < 4; k++) {
+        v[k] = _mm256_shuffle_epi8(load_hdr_pair(header_ptr(frames, lens, base + (usize)k),
+                                                 header_ptr(frames, lens, base + (usize)k + 4)), shuf);
+    }
+
+    __m256i t0 = _mm256_unpacklo_epi32(v[0], v[1]);
+    __m256i t1 = _mm256_unpacklo_epi32(v[2], v[3]);
+    __m256i t2 = _mm256_unpackhi_epi32(v[0], v[1]);
+    __m256i t3 = _mm256_unpackhi_epi32(v[2], v[3]);
+    __m256i l0 = _mm256_unpacklo_epi64(t0, t1);
+    __m256i l1 = _mm256_unpackhi_epi64(t0, t1);
+    __m256i l2 = _mm256_unpacklo_epi64(t2, t3);
+    __m256i l3 = _mm256_unpackhi_epi64(t2, t3);
+
+    __m256i magic    = _mm256_srli_epi32(l0, 20);
+    __m256i version  = _mm256_and_si256(_mm256_srli_epi32(l0, 16), _mm256_set1_epi32(0xF));
+    __m256i type     = _mm256_and_si256(_mm256_srli_epi32(l0, 13), _mm256_set1_epi32(0x7));
+    __m256i is_room  = _mm256_and_si256(_mm256_srli_epi32(l0, 11), _mm256_set1_epi32(0x1));
+    __m256i reserved = _mm256_and_si256(_mm256_srli_epi32(l0, 8),  _mm256_set1_epi32(0x7));
+    __m256i user_id  = _mm256_srli_epi32(l1, 12);
+    __m256i route    = _mm256_and_si256(_mm256_srli_epi32(l2, 8),  _mm256_set1_epi32(0xFFFFF));
+    __m256i msg_len  = _mm256_and_si256(_mm256_srli_epi32(l3, 4),  _mm256_set1_epi32(0xFFF));
+
+    unsigned ok_magic = (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(
+        _mm256_cmpeq_epi32(magic, _mm256_set1_epi32(DBIN_MAGIC))));
+    unsigned ok_ver = (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(
+        _mm256_cmpeq_epi32(version, _mm256_set1_epi32(DBIN_VERSION))));
+    __m256i z_ok = _mm256_andnot_si256(_mm256_cmpeq_epi32(msg_len, _mm256_setzero_si256()),
+        _mm256_and_si256(_mm256_cmpeq_epi32(_mm256_and_si256(reserved, _mm256_set1_epi32(0x7 & ~DBIN_RESERVED_MSG)),
+                                            _mm256_setzero_si256()),
+                         _mm256_cmpeq_epi32(type, _mm256_set1_epi32(DBIN_TYPE_MSG))));
+    unsigned ok_res = (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(
+        _mm256_or_si256(_mm256_cmpeq_epi32(reserved, _mm256_setzero_si256()), z_ok)));
+
+    // Shuffles narrow within each 128-bit half; the permutes join the halves.
+    const __m256i lo16 = _mm256_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1,
+                                          0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m256i hi16 = _mm256_setr_epi8(2, 3, 6, 7, 10, 11, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1,
+                                          2, 3, 6, 7, 10, 11, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m256i lo8  = _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                          0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m256i join32 = _mm256_setr_epi32(0, 4, 1, 1, 1, 1, 1, 1);
+
+    _mm256_storeu_si256((__m256i*)(soa->user_id + base), user_id);
+    _mm256_storeu_si256((__m256i*)(soa->route + base), route);
+    _mm_storeu_si128((__m128i*)(soa->msg_id + base), _mm256_castsi256_si128(
+        _mm256_permute4x64_epi64(_mm256_shuffle_epi8(l3, hi16), 0xD8)));
+    _mm_storeu_si128((__m128i*)(soa->msg_len + base), _mm256_castsi256_si128(
+        _mm256_permute4x64_epi64(_mm256_shuffle_epi8(msg_len, lo16), 0xD8)));
+    _mm_storel_epi64((__m128i*)(soa->type + base), _mm256_castsi256_si128(
+        _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(type, lo8), join32)));
+    _mm_storel_epi64((__m128i*)(soa->is_room + base), _mm256_castsi256_si128(
+        _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(is_room, lo8), join32)));
+    if (soa->reserved) {
+        _mm_storel_epi64((__m128i*)(soa->reserved + base), _mm256_castsi256_si128(
+            _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(reserved, lo8), join32)));
+    }
+
+    finish_frames(frames, lens, base, 8, ~ok_magic & 0xFFu, ~ok_ver & 0xFFu, ~ok_res & 0xFFu, soa);
+}
+
+__attribute__((target("avx2")))
+static void decode_avx2(const u8 *const *frames, const usize *lens, usize n, dbin_batch_t *soa) {
+    usize i = 0;
+    for (; i + 8 <= n; i += 8) decode8_avx2(frames, lens, i, soa);
+    for (; i + 4 <= n; i += 4) decode4_ssse3(frames, lens, i, soa);
+    for (; i < n; i++) decode_one(frames, lens, i, soa);
+}
+
+#endif // DBIN_BATCH_X86
+
+static decode_batch_fn batch_impl;
+static const char *batch_impl_name;
+
+static void pick_impl(void) {
+    decode_batch_fn fn = decode_scalar;
+    const char *name = "scalar";
+
+#ifdef DBIN_BATCH_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        fn = decode_avx2;
+        name = "avx2";
+    } else if (__builtin_cpu_supports("ssse3")) {
+        fn = decode_ssse3;
+        name = "ssse3";
+    }
+#endif
+
+    // Racing first calls all pick the same values, so plain stores are fine.
+    batch_impl_name = name;
+    batch_impl = fn;
+}
+
+int dbin_decode_batch(const u8 *const *frames, const usize *lens, usize n, dbin_batch_t *soa) {
+    if (!frames || !lens || !soa) return DBIN_ERR_PARAM;
+    if (!soa->user_id || !soa->route || !soa->msg_id || !soa->msg_len ||
+        !soa->type || !soa->is_room || !soa->payload || !soa->err) return DBIN_ERR_PARAM;
+
+    if (!batch_impl) pick_impl();
+    batch_impl(frames, lens, n, soa);
+    return DBIN_OK;
+}
+
+const char *dbin_decode_batch_impl(void) {
+    if (!batch_impl) pick_impl();
+    return batch_impl_name;
+}
+
+int dbin_decode_batch_use(const char *impl) {
+    if (!impl) {
+        pick_impl();
+        return DBIN_OK;
+    }
+    if (strcmp(impl, "scalar") == 0) {
+        batch_impl_name = "scalar";
+        batch_impl = decode_scalar;
+        return DBIN_OK;
+    }
+#ifdef DBIN_BATCH_X86
+    __builtin_cpu_init();
+    if (strcmp(impl, "ssse3") == 0 && __builtin_cpu_supports("ssse3")) {
+        batch_impl_name = "ssse3";
+        batch_impl = decode_ssse3;
+        return DBIN_OK;
+    }
+    if (strcmp(impl, "avx2") == 0 && __builtin_cpu_supports("avx2")) {
+        batch_impl_name = "avx2";
+        batch_impl = decode_avx2;
+        return DBIN_OK;
+    }
+#endif
+    return DBIN_ERR_PARAM;
+}
+
+void dbin_arena_init(dbin_arena_t *a, u8 *buf, usize cap) {
+    a->buf = buf;
+    a->cap = cap;
+    a->len = 0;
+}
+
+void dbin_arena_reset(dbin_arena_t *a) {
+    a->len = 0;
+}
+
+int dbin_encode_batch(const dbin_msg_t *msgs, usize n, dbin_arena_t *a, usize *offsets, usize *done) {
+    if (!msgs || !a || !a->buf || !done) return DBIN_ERR_PARAM;
+    *done = 0;
+
+    for (usize i = 0; i < n; i++) {
+        usize off = a->len;
+        usize frame_len = 0;
+
+        if (a->cap - off < DBIN_LEN_PREFIX_BYTES) return DBIN_ERR_BUF;
+
+        int rc = dbin_encode(&msgs[i], a->buf + off + DBIN_LEN_PREFIX_BYTES,
+                             a->cap - off - DBIN_LEN_PREFIX_BYTES, &frame_len);
+        if (rc != DBIN_OK) return rc;
+
+        a->buf[off]     = (u8)(frame_len >> 8);
+        a->buf[off + 1] = (u8)frame_len;
+        a->len = off + DBIN_LEN_PREFIX_BYTES + frame_len;
+
+        if (offsets) offsets[i] = off;
+        *done = i + 1;
+    }
+    return DBIN_OK;
+}
@@ -1,5 +1,11 @@
 #include "dbin/bitio.h"
 
+#include <string.h>
+
+// Bits are handled a word at a time: the bytes covering the field are loaded
+// into a 64-bit big-endian accumulator, merged/extracted with one shift and
+// mask, and stored back. A field is at most 32 bits and starts at most 7 bits
+// into its first byte, so it always spans <= 5 bytes of the accumulator.
 
 static int valid_bit_pos(bitio_t *b, int nbits) {
     if (!b || !b->buf || nbits < 0) return 0;
@@ -9,6 +15,45 @@ static int valid_bit_pos(bitio_t *b, int nbits) {
     return b->bitpos + (usize)nbits <= total_bits;
 }
 
+static u64 load_be64(const u8 *p) {
+    u64 w;
+    memcpy(&w, p, sizeof(w));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    w = __builtin_bswap64(w);
+#endif
+    return w;
+}
+
+static void store_be64(u8 *p, u64 w) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    w = __builtin_bswap64(w);
+#endif
+    memcpy(p, &w, sizeof(w));
+}
+
+// Load up to 8 bytes at `byte` into the top of the accumulator.
+// Near the end of the buffer only the bytes that exist are touched.
+static u64 load_word(const bitio_t *b, usize byte, usize nbytes) {
+    if (byte + 8 <= b->cap_bytes) return load_be64(b->buf + byte);
+
+    u64 w = 0;
+    for (usize i = 0; i < nbytes; i++) {
+        w |= (u64)b->buf[byte + i] << (56 - 8 * i);
+    }
+    return w;
+}
+
+static void store_word(bitio_t *b, usize byte, usize nbytes, u64 w) {
+    if (byte + 8 <= b->cap_bytes) {
+        store_be64(b->buf + byte, w);
+        return;
+    }
+
+    for (usize i = 0; i < nbytes; i++) {
+        b->buf[byte + i] = (u8)(w >> (56 - 8 * i));
+    }
+}
+
 
 void bitio_init(bitio_t *b, u8 *buf, usize cap_bytes) {
     b->buf = buf;
@@ -18,20 +63,19 @@ void bitio_init(bitio_t *b, u8 *buf, usize cap_bytes) {
 
 int bitio_write_bits(bitio_t *b, u32 value, int nbits) {
     if (!valid_bit_pos(b, nbits)) return 1;
+    if (nbits == 0) return 0;
 
-    for (int i = 0; i < nbits; i++) {
-        u8 bit = (value >> (nbits - 1 - i)) & 1u;
-
-        usize byte = b->bitpos / 8;
-        u8 bit_in_byte = (u8)(7 - (b->bitpos % 8));
+    usize byte = b->bitpos / 8;
+    usize off = b->bitpos % 8;
+    usize nbytes = (off + (usize)nbits + 7) / 8;
+    int shift = 64 - (int)off - nbits;
 
-        if (bit)
-            b->buf[byte] |=  (u8)(1u << bit_in_byte);
-        else
-            b->buf[byte] &= (u8)~(1u << bit_in_byte);
+    u64 mask = ((((u64)1) << nbits) - 1) << shift;
+    u64 w = load_word(b, byte, nbytes);
+    w = (w & ~mask) | (((u64)value << shift) & mask);
+    store_word(b, byte, nbytes, w);
 
-        b->bitpos++;
-    }
+    b->bitpos += (usize)nbits;
     return 0;
 }
 
@@ -40,15 +84,16 @@ int bitio_read_bits(bitio_t *b, int nbits, u32 *out_value) {
     *out_value = 0;
 
     if (!valid_bit_pos(b, nbits)) return 1;
+    if (nbits == 0) return 0;
 
-    for (int i = 0; i < nbits; i++) {
-        usize byte = b->bitpos / 8;
-        u8 bit_in_byte = (u8)(7 - (b->bitpos % 8));
-        u8 bit = (b->buf[byte] >> bit_in_byte) & 1u;
+    usize byte = b->bitpos / 8;
+    usize off = b->bitpos % 8;
+    usize nbytes = (off + (usize)nbits + 7) / 8;
 
-        *out_value = (*out_value << 1) | (u32)bit;
-        b->bitpos++;
-    }
+    u64 w = load_word(b, byte, nbytes);
+    *out_value = (u32)((w << off) >> (64 - nbits));
+
+    b->bitpos += (usize)nbits;
     return 0;
 }
 
@@ -73,9 +118,7 @@ int bitio_write_bytes(bitio_t *b, const u8 *src, usize n) {
     usize byte_pos = b->bitpos / 8;
     if (byte_pos + n > b->cap_bytes) return 1;
 
-    for (usize i = 0; i < n; i++) {
-        b->buf[byte_pos + i] = src[i];
-    }
+    memcpy(b->buf + byte_pos, src, n);
 
     b->bitpos += n * 8;
     return 0;
@@ -88,9 +131,7 @@ int bitio_read_bytes(bitio_t *b, u8 *dst, usize n) {
     usize byte_pos = b->bitpos / 8;
     if (byte_pos + n > b->cap_bytes) return 1;
 
-    for (usize i = 0; i < n; i++) {
-        dst[i] = b->buf[byte_pos + i];
-    }
+    memcpy(dst, b->buf + byte_pos, n);
 
     b->bitpos += n * 8;
     return 0;
@@ -0,0 +1,178 @@
+#include "dbin/capture.h"
+#include "dbin/codec.h"
+#include "dbin/protocol.h"
+
+#include <string.h>
+
+static const u8 cap_magic[4] = { 'D', 'B', 'C', 'P' };
+static const u8 idx_magic[4] = { 'D', 'B', 'I', 'X' };
+
+static void put16(u8 *p, u16 v) {
+    p[0] = (u8)(v >> 8);
+    p[1] = (u8)v;
+}
+
+static void put32(u8 *p, u32 v) {
+    for (int i = 0; i < 4; i++) p[i] = (u8)(v >> (24 - 8 * i));
+}
+
+static void put64(u8 *p, u64 v) {
+    for (int i = 0; i < 8; i++) p[i] = (u8)(v >> (56 - 8 * i));
+}
+
+static u16 get16(const u8 *p) {
+    return (u16)((p[0] << 8) | p[1]);
+}
+
+static u32 get32(const u8 *p) {
+    return ((u32)p[0] << 24) | ((u32)p[1] << 16) | ((u32)p[2] << 8) | p[3];
+}
+
+static u64 get64(const u8 *p) {
+    return ((u64)get32(p) << 32) | get32(p + 4);
+}
+
+// ---- writer ----
+
+int dbin_cap_writer_init(dbin_cap_writer_t *w, dbin_cap_index_t *index, u32 index_cap,
+                         u32 source, u64 base_ns, u8 *hdr) {
+    if (!w || !index || index_cap < 2 || !hdr) return DBIN_ERR_PARAM;
+    memset(w, 0, sizeof(*w));
+    w->offset = DBIN_CAP_HEADER_BYTES;
+    w->every_ns = DBIN_CAP_INDEX_NS;
+    w->index = index;
+    w->index_cap = index_cap;
+
+    memset(hdr, 0, DBIN_CAP_HEADER_BYTES);
+    memcpy(hdr, cap_magic, 4);
+    put16(hdr + 4, DBIN_CAP_VERSION);
+    put32(hdr + 8, source);
+    put64(hdr + 16, base_ns);
+    return DBIN_OK;
+}
+
+int dbin_cap_append(dbin_cap_writer_t *w, u64 ts_ns, u32 conn_id,
+                    const u8 *frame, usize len, u8 *out, usize cap, usize *n) {
+    if (len > DBIN_MAX_FRAME_LEN) return DBIN_ERR_RANGE;
+    usize need = DBIN_CAP_REC_BYTES + len;
+    if (cap < need) return DBIN_ERR_BUF;
+
+    if (ts_ns >= w->next_index_ns) {
+        if (w->nindex == w->index_cap) {
+            for (u32 i = 0; i < w->nindex / 2; i++) w->index[i] = w->index[2 * i];
+            w->nindex /= 2;
+            w->every_ns *= 2;
+        }
+        w->index[w->nindex].ts_ns = ts_ns;
+        w->index[w->nindex].offset = w->offset;
+        w->nindex++;
+        w->next_index_ns = ts_ns + w->every_ns;
+    }
+
+    put64(out, ts_ns);
+    put32(out + 8, conn_id);
+    put16(out + 12, (u16)len);
+    memcpy(out + DBIN_CAP_REC_BYTES, frame, len);
+    w->offset += need;
+    w->records++;
+    *n = need;
+    return DBIN_OK;
+}
+
+usize dbin_cap_footer_bytes(const dbin_cap_writer_t *w) {
+    return (usize)w->nindex * DBIN_CAP_INDEX_BYTES + DBIN_CAP_TRAILER_BYTES;
+}
+
+int dbin_cap_finish(dbin_cap_writer_t *w, u8 *out, usize cap, usize *n) {
+    usize need = dbin_cap_footer_bytes(w);
+    if (cap < need) return DBIN_ERR_BUF;
+
+    u8 *p = out;
+    for (u32 i = 0; i < w->nindex; i++, p += DBIN_CAP_INDEX_BYTES) {
+        put64(p, w->index[i].ts_ns);
+        put64(p + 8, w->index[i].offset);
+    }
+    put64(p, w->offset);
+    put64(p + 8, w->records);
+    put32(p + 16, w->nindex);
+    memcpy(p + 20, idx_magic, 4);
+    *n = need;
+    return DBIN_OK;
+}
+
+// ---- reader ----
+
+int dbin_cap_open(dbin_cap_reader_t *r, const u8 *buf, usize len) {
+    if (!r || !buf) return DBIN_ERR_PARAM;
+    memset(r, 0, sizeof(*r));
+    if (len < DBIN_CAP_HEADER_BYTES || memcmp(buf, cap_magic, 4) != 0) return DBIN_ERR_MAGIC;
+    if (get16(buf + 4) != DBIN_CAP_VERSION) return DBIN_ERR_VER;
+
+    r->buf = buf;
+    r->len = len;
+    r->end = len;
+    r->pos = DBIN_CAP_HEADER_BYTES;
+    r->source = get32(buf + 8);
+    r->base_ns = get64(buf + 16);
+
+    if (len >= DBIN_CAP_HEADER_BYTES + DBIN_CAP_TRAILER_BYTES &&
+        memcmp(buf + len - 4, idx_magic, 4) == 0) {
+        const u8 *t = buf + len - DBIN_CAP_TRAILER_BYTES;
+        u64 off = get64(t);
+        u32 nindex = get32(t + 16);
+        u64 tail = (u64)(len - DBIN_CAP_TRAILER_BYTES);
+        // Bounded one term at a time: the sum could wrap.
+        if (off < DBIN_CAP_HEADER_BYTES || off > tail || nindex > (tail - off) / DBIN_CAP_INDEX_BYTES ||
+            off + (u64)nindex * DBIN_CAP_INDEX_BYTES != tail) {
+            return DBIN_ERR_FMT;
+        }
+        r->end = (usize)off;
+        r->index = buf + off;
+        r->nindex = nindex;
+        r->records = get64(t + 8);
+    }
+    return DBIN_OK;
+}
+
+int dbin_cap_next(dbin_cap_reader_t *r, dbin_cap_rec_t *out) {
+    if (r->pos == r->end) return DBIN_ERR_AGAIN;
+    if (r->end - r->pos < DBIN_CAP_REC_BYTES) return DBIN_ERR_FMT;
+
+    const u8 *p = r->buf + r->pos;
+    u16 flen = get16(p + 12);
+    if (r->end - r->pos - DBIN_CAP_REC_BYTES < flen) return DBIN_ERR_FMT;
+
+    out->ts_ns = get64(p);
+    out->conn_id = get32(p + 8);
+    out->frame_len = flen;
+    out->frame = p + DBIN_CAP_REC_BYTES;
+    r->pos += DBIN_CAP_REC_BYTES + flen;
+    return DBIN_OK;
+}
+
+int dbin_cap_seek(dbin_cap_reader_t *r, u64 ts_ns) {
+    r->pos = DBIN_CAP_HEADER_BYTES;
+
+    // Last entry at or before ts_ns; records between entries are in order.
+    if (r->nindex > 0 && get64(r->index) <= ts_ns) {
+        u32 lo = 0, hi = r->nindex - 1;
+        while (lo < hi) {
+            u32 mid = lo + (hi - lo + 1) / 2;
+            if (get64(r->index + (usize)mid * DBIN_CAP_INDEX_BYTES) <= ts_ns) lo = mid;
+            else hi = mid - 1;
+        }
+        u64 off = get64(r->index + (usize)lo * DBIN_CAP_INDEX_BYTES + 8);
+        if (off < DBIN_CAP_HEADER_BYTES || off > r->end) return DBIN_ERR_FMT;
+        r->pos = (usize)off;
+    }
+
+    for (;;) {
+        usize at = r->pos;
+        dbin_cap_rec_t rec;
+        // The end, or a truncated tail that the next dbin_cap_next reports.
+        if (dbin_cap_next(r, &rec) != DBIN_OK || rec.ts_ns >= ts_ns) {
+            r->pos = at;
+            return DBIN_OK;
+        }
+    }
+}
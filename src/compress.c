@@ -0,0 +1,275 @@
+#include "dbin/compress.h"
+#include "dbin/codec.h"
+#include "dbin/protocol.h"
+#include "dbin/schema.h"
+
+#include <string.h>
+
+static inline u32 read32(const u8 *p) {
+    u32 v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline u32 zhash(u32 v) {
+    return (v * 2654435761u) >> (32 - DBIN_Z_HASH_BITS);
+}
+
+// Length of the common prefix of a and b, at most `max`.
+static usize common(const u8 *a, const u8 *b, usize max) {
+    usize n = 0;
+    while (n + 8 <= max) {
+        u64 x, y;
+        memcpy(&x, a + n, sizeof(x));
+        memcpy(&y, b + n, sizeof(y));
+        if (x != y) break;
+        n += 8;
+    }
+    while (n < max && a[n] == b[n]) n++;
+    return n;
+}
+
+int dbin_z_dict_init(dbin_z_dict_t *d, const u8 *bytes, usize len) {
+    if (!d) return DBIN_ERR_PARAM;
+    if (!bytes) {
+        bytes = dbin_z_default_dict;
+        len = dbin_z_default_dict_len;
+    }
+    if (len > DBIN_Z_DICT_MAX) return DBIN_ERR_RANGE;
+
+    d->bytes = bytes;
+    d->len = len;
+    memset(d->table, 0, sizeof(d->table));
+    for (usize i = 0; i + DBIN_Z_MIN_MATCH <= len; i++) d->table[zhash(read32(bytes + i))] = (u16)(i + 1);
+    return DBIN_OK;
+}
+
+// ---- compress ----
+
+static void put_ext(u8 **o, usize v) {
+    while (v >= 255) {
+        *(*o)++ = 255;
+        v -= 255;
+    }
+    *(*o)++ = (u8)v;
+}
+
+// One sequence: literals, then a match (mlen == 0: the final literals).
+static int emit(u8 **op, const u8 *end, const u8 *lit, usize nlit, usize dist, usize mlen) {
+    usize need = 1 + nlit + (nlit >= 15 ? (nlit - 15) / 255 + 1 : 0);
+    if (mlen) need += 2 + (mlen - DBIN_Z_MIN_MATCH >= 15 ? (mlen - DBIN_Z_MIN_MATCH - 15) / 255 + 1 : 0);
+    if ((usize)(end - *op) < need) return DBIN_ERR_BUF;
+
+    u8 *tok = (*op)++;
+    u8 t;
+    if (nlit >= 15) {
+        t = 0xF0;
+        put_ext(op, nlit - 15);
+    } else {
+        t = (u8)(nlit << 4);
+    }
+    memcpy(*op, lit, nlit);
+    *op += nlit;
+
+    if (mlen) {
+        *(*op)++ = (u8)(dist >> 8);
+        *(*op)++ = (u8)dist;
+        usize ml = mlen - DBIN_Z_MIN_MATCH;
+        if (ml >= 15) {
+            t |= 15;
+            put_ext(op, ml - 15);
+        } else {
+            t |= (u8)ml;
+        }
+    }
+    *tok = t;
+    return DBIN_OK;
+}
+
+int dbin_z_compress(const dbin_z_dict_t *d, const u8 *src, usize n, u8 *out, usize cap, usize *out_len) {
+    if ((!src && n) || !out || !out_len) return DBIN_ERR_PARAM;
+    const u8 *dict = d ? d->bytes : 0;
+    usize dlen = d ? d->len : 0;
+    if (dlen + n > 0xFFFF) return DBIN_ERR_RANGE;
+
+    // Greedy: at each position the longer of the last payload match and the
+    // dictionary's match for the same hash.
+    u16 tab[1u << (DBIN_Z_HASH_BITS - 1)];
+    memset(tab, 0, sizeof(tab));
+
+    u8 *o = out;
+    const u8 *end = out + cap;
+    usize anchor = 0, i = 0;
+    while (i + DBIN_Z_MIN_MATCH <= n) {
+        u32 seq = read32(src + i);
+        u32 h = zhash(seq);
+        usize best = 0, dist = 0;
+        const u8 *ref = 0, *lo = 0; // match source and the start of its buffer
+
+        usize s = tab[h >> 1];
+        tab[h >> 1] = (u16)(i + 1);
+        if (s && read32(src + s - 1) == seq) {
+            best = DBIN_Z_MIN_MATCH + common(src + s - 1 + DBIN_Z_MIN_MATCH, src + i + DBIN_Z_MIN_MATCH,
+                                             n - i - DBIN_Z_MIN_MATCH);
+            dist = i - (s - 1);
+            ref = src + s - 1;
+            lo = src;
+        }
+        if (d && d->table[h]) {
+            usize j = d->table[h] - 1u;
+            if (read32(dict + j) == seq) {
+                usize max = dlen - j - DBIN_Z_MIN_MATCH;
+                if (max > n - i - DBIN_Z_MIN_MATCH) max = n - i - DBIN_Z_MIN_MATCH;
+                usize l = DBIN_Z_MIN_MATCH + common(dict + j + DBIN_Z_MIN_MATCH, src + i + DBIN_Z_MIN_MATCH, max);
+                if (l > best) {
+                    best = l;
+                    dist = i + dlen - j;
+                    ref = dict + j;
+                    lo = dict;
+                }
+            }
+        }
+        if (!best) {
+            i++;
+            continue;
+        }
+        // Grow the match backwards into the pending literals.
+        while (i > anchor && ref > lo && src[i - 1] == ref[-1]) {
+            i--;
+            ref--;
+            best++;
+        }
+
+        if (emit(&o, end, src + anchor, i - anchor, dist, best) != DBIN_OK) return DBIN_ERR_BUF;
+        usize e = i + best;
+        for (usize p = i + 1; p < e && p + DBIN_Z_MIN_MATCH <= n; p++) tab[zhash(read32(src + p)) >> 1] = (u16)(p + 1);
+        i = anchor = e;
+    }
+    if (anchor < n && emit(&o, end, src + anchor, n - anchor, 0, 0) != DBIN_OK) return DBIN_ERR_BUF;
+
+    *out_len = (usize)(o - out);
+    return DBIN_OK;
+}
+
+// ---- decompress ----
+
+static int get_ext(const u8 **ip, const u8 *iend, usize *v) {
+    u8 b;
+    do {
+        if (*ip == iend || *v > 0xFFFF) return DBIN_ERR_FMT;
+        b = *(*ip)++;
+        *v += b;
+    } while (b == 255);
+    return DBIN_OK;
+}
+
+int dbin_z_decompress(const dbin_z_dict_t *d, const u8 *src, usize n, u8 *out, usize cap, usize *out_len) {
+    if ((!src && n) || !out || !out_len) return DBIN_ERR_PARAM;
+    const u8 *dict = d ? d->bytes : 0;
+    usize dlen = d ? d->len : 0;
+
+    const u8 *ip = src, *iend = src + n;
+    u8 *op = out, *oend = out + cap;
+    while (ip < iend) {
+        u8 t = *ip++;
+        usize nlit = t >> 4;
+        if (nlit == 15 && get_ext(&ip, iend, &nlit)) return DBIN_ERR_FMT;
+        if (nlit > (usize)(iend - ip)) return DBIN_ERR_FMT;
+        if (nlit > (usize)(oend - op)) return DBIN_ERR_BUF;
+        // Short runs are copied 16 bytes at a time where both sides have room.
+        if (nlit <= 16 && iend - ip >= 16 && oend - op >= 16) memcpy(op, ip, 16);
+        else memcpy(op, ip, nlit);
+        op += nlit;
+        ip += nlit;
+        if (ip == iend) break;
+
+        if (iend - ip < 2) return DBIN_ERR_FMT;
+        usize dist = ((usize)ip[0] << 8) | ip[1];
+        ip += 2;
+        usize mlen = t & 15u;
+        if (mlen == 15 && get_ext(&ip, iend, &mlen)) return DBIN_ERR_FMT;
+        mlen += DBIN_Z_MIN_MATCH;
+
+        usize pos = (usize)(op - out);
+        if (dist == 0 || dist > pos + dlen) return DBIN_ERR_FMT;
+        if (mlen > (usize)(oend - op)) return DBIN_ERR_BUF;
+
+        const u8 *m, *mend;
+        if (dist > pos) {
+            // Starts in the dictionary, may run on into the output.
+            usize from = dlen - (dist - pos);
+            usize k = dlen - from < mlen ? dlen - from : mlen;
+            if (k <= 16 && dlen - from >= 16 && oend - op >= 16) memcpy(op, dict + from, 16);
+            else memcpy(op, dict + from, k);
+            op += k;
+            mlen -= k;
+            m = out;
+        } else {
+            m = op - dist;
+        }
+        mend = op + mlen;
+        if (op - m >= 16 && oend - mend >= 16) {
+            while (op < mend) {
+                memcpy(op, m, 16);
+                op += 16;
+                m += 16;
+            }
+            op = (u8*)mend;
+        } else if ((usize)(op - m) >= mlen) {
+            memcpy(op, m, mlen);
+            op += mlen;
+        } else {
+            while (mlen--) *op++ = *m++; // overlapping run
+        }
+    }
+
+    *out_len = (usize)(op - out);
+    return DBIN_OK;
+}
+
+// ---- frames ----
+
+int dbin_encode_z(const dbin_msg_t *m, const dbin_z_dict_t *d, usize min_len,
+                  u8 *out, usize cap, usize *out_len) {
+    if (!m || !out || !out_len) return DBIN_ERR_PARAM;
+    if (m->type != DBIN_TYPE_MSG || m->reserved != 0 || m->msg_len == 0 || m->msg_len < min_len) {
+        return dbin_encode(m, out, cap, out_len);
+    }
+
+    int vr = dbin_validate(m);
+    if (vr != DBIN_OK) return vr;
+    if (cap < dbin_encoded_size(m)) return DBIN_ERR_BUF;
+
+    // Only worth sending if strictly smaller than the plain payload.
+    usize zlen = 0;
+    if (dbin_z_compress(d, m->msg, m->msg_len, out + DBIN_HEADER_V1_BYTES, (usize)m->msg_len - 1, &zlen) != DBIN_OK) {
+        return dbin_encode(m, out, cap, out_len);
+    }
+
+    dbin_msg_t z = *m;
+    z.reserved = DBIN_RESERVED_Z;
+    z.msg_len = (u16)zlen;
+    dbin_hdr_v1_pack(&z, out);
+    *out_len = DBIN_HEADER_V1_BYTES + zlen;
+    return DBIN_OK;
+}
+
+int dbin_decode_z(const u8 *in, usize in_len, const dbin_z_dict_t *d,
+                  dbin_msg_t *out, u8 *buf, usize cap) {
+    int rc = dbin_decode(in, in_len, out);
+    if (rc != DBIN_OK || !(out->reserved & DBIN_RESERVED_Z)) return rc;
+    if (!buf) return DBIN_ERR_PARAM;
+
+    // Expanding past DBIN_MAX_MSG_LEN is a bad frame, not a small buffer.
+    usize lim = cap < DBIN_MAX_MSG_LEN ? cap : DBIN_MAX_MSG_LEN;
+    usize n = 0;
+    rc = dbin_z_decompress(d, out->msg, out->msg_len, buf, lim, &n);
+    if (rc == DBIN_ERR_BUF && lim == DBIN_MAX_MSG_LEN) return DBIN_ERR_RANGE;
+    if (rc != DBIN_OK) return rc;
+    if (n == 0) return DBIN_ERR_FMT;
+
+    out->msg = buf;
+    out->msg_len = (u16)n;
+    out->reserved &= (u8)~DBIN_RESERVED_Z;
+    return DBIN_OK;
+}
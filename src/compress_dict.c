@@ -0,0 +1,45 @@
+#include "dbin/compress.h"
+
+// The built-in dictionary (SPEC.md, "Compressed payloads"). Both ends must
+// hold exactly these bytes: changing them changes the protocol.
+//
+// Common words, phrases and fragments of English chat, rarer first; a
+// 4-byte run seen twice is matched at its later position, so the most
+// common text sits at the end, where it also wins hash collisions.
+#define DICT                                                                              \
+    "https://www.youtube.com/watch?v=https://github.com/https://twitter.com/"             \
+    "https://docs.google.com/document/d/.pdf.png.jpg.gif.zip.html "                       \
+    "Monday Tuesday Wednesday Thursday Friday Saturday Sunday weekend tomorrow "         \
+    "yesterday tonight this morning this afternoon this evening next week last week "     \
+    "January February March April May June July August September October November "      \
+    "December o'clock minutes hours seconds a.m. p.m. birthday congratulations "          \
+    "appreciate definitely probably actually basically literally seriously honestly "     \
+    "anyway whatever something everything anything nothing someone everyone anyone "      \
+    "because though although however unfortunately hopefully especially already "        \
+    "meeting project deadline update review release version issue problem question "     \
+    "people person friend family mother father brother sister kids school work home "     \
+    "office coffee lunch dinner breakfast party game movie music phone email message "    \
+    "picture video link file document check this out take a look let me know "           \
+    "as soon as possible on my way be right back talk to you later see you soon "         \
+    "good morning good night good luck have a nice day happy birthday thank you so much " \
+    "no problem no worries sounds good makes sense of course for sure my bad "            \
+    "I don't know I'm not sure I think so I don't think I was going to I'm going to "      \
+    "do you want to are you going to can you please could you would you will you "        \
+    "what do you think how are you doing what's up how's it going where are you "          \
+    "when are you why did you did you see have you seen I have been I've been "           \
+    "I'll be there I'm here I'm on it give me a minute just a sec hold on wait "          \
+    "lol lmao haha hahaha omg wtf btw idk tbh imo brb ttyl np thx ty pls plz ok okay "     \
+    "yeah yes yep nope sure cool nice great awesome perfect exactly agreed right "        \
+    "\xF0\x9F\x98\x82\xF0\x9F\x91\x8D\xE2\x9D\xA4\xEF\xB8\x8F\xF0\x9F\x98\x8A"             \
+    "\xF0\x9F\x99\x8F\xF0\x9F\x98\x85\xF0\x9F\x8E\x89\xF0\x9F\x98\x8D\xF0\x9F\x94\xA5 "    \
+    ":) :( :D ;) :P <3 ... !! ?? ?! "                                                     \
+    "that is what it was there was this is it's not that's the I'm just "                 \
+    "you know what I mean and then but I if you have to with the for the "               \
+    "to be in the on the at the of the and the it is is the to the of a in a "            \
+    "that you what you thank you are you do you you are I am I have I will "              \
+    "the and that this with have just like what your from they will would "              \
+    "about there their when been were could should really know think going "             \
+    "want need time good back here today "
+
+const u8    dbin_z_default_dict[] = DICT;
+const usize dbin_z_default_dict_len = sizeof(DICT) - 1;
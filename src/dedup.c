@@ -0,0 +1,30 @@
+#include "dbin/dedup.h"
+
+#define MASK_BITS 48
+#define MASK      ((1ull << MASK_BITS) - 1)
+
+static dbin_dedup_t pack(u16 newest, u64 mask) {
+    return ((u64)newest << MASK_BITS) | mask;
+}
+
+dbin_dedup_t dbin_dedup_step(dbin_dedup_t w, u16 msg_id, int *dup) {
+    *dup = 0;
+    u64 mask = w & MASK;
+    u16 newest = (u16)(w >> MASK_BITS);
+    if (mask == 0) return pack(msg_id, 1);
+
+    u16 behind = (u16)(newest - msg_id);
+    if (behind < DBIN_DEDUP_WINDOW) {
+        u64 bit = 1ull << behind;
+        if (mask & bit) {
+            *dup = 1;
+            return w;
+        }
+        return w | bit;
+    }
+
+    u16 ahead = (u16)(msg_id - newest);
+    if (ahead >= 0x8000) return w; // behind the window: unknown, so let it through
+    mask = ahead >= DBIN_DEDUP_WINDOW ? 0 : (mask << ahead) & MASK;
+    return pack(msg_id, mask | 1);
+}
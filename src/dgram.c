@@ -0,0 +1,42 @@
+#include "dbin/dgram.h"
+#include "dbin/codec.h"
+#include "dbin/schema.h"
+
+int dbin_dgram_next(const u8 *d, usize len, usize *off, dbin_msg_t *m, const u8 **frame, usize *frame_len) {
+    if (!d || !off || !m || !frame || !frame_len) return DBIN_ERR_PARAM;
+
+    // No header starts with a zero byte (the magic is 0xDB1): the rest is padding.
+    usize o = *off;
+    if (len < o + DBIN_HEADER_V1_BYTES || d[o] == 0) {
+        *off = len;
+        return DBIN_ERR_AGAIN;
+    }
+
+    int rc = dbin_decode(d + o, len - o, m);
+    if (rc == DBIN_ERR_BUF || rc == DBIN_ERR_MAGIC || rc == DBIN_ERR_VER) {
+        *off = len;
+        return rc;
+    }
+    // Invalid frames are skipped by their msg_len, which dbin_decode has
+    // not checked against the datagram on every error path.
+    usize n = DBIN_HEADER_V1_BYTES + (usize)m->msg_len;
+    if (n > len - o) {
+        *off = len;
+        return DBIN_ERR_BUF;
+    }
+    *frame = d + o;
+    *frame_len = n;
+    *off = o + n;
+    return rc;
+}
+
+int dbin_dgram_add(u8 *d, usize cap, usize *len, const dbin_msg_t *m) {
+    if (!d || !len || !m) return DBIN_ERR_PARAM;
+    if (*len > cap) return DBIN_ERR_BUF;
+
+    usize n;
+    int rc = dbin_encode(m, d + *len, cap - *len, &n);
+    if (rc != DBIN_OK) return rc;
+    *len += n;
+    return DBIN_OK;
+}
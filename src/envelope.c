@@ -0,0 +1,167 @@
+#include "dbin/codec.h"
+#include "dbin/protocol.h"
+#include "dbin/schema.h"
+
+#include <string.h>
+
+// Body of an envelope (SPEC.md, "Envelopes"):
+//   count     u8, 1..DBIN_ENV_MAX_MSGS
+//   msg_len   varint, of the first message (its msg_id and route are the header's)
+//   count - 1 times, against the message before:
+//     step      varint, (msg_id delta - 1) << 1 | 1 if the route changes
+//     route     varint, zigzag route delta; only when the route changes
+//     msg_len   varint
+//   payloads, back to back
+// Varints are LEB128, at most 3 bytes (21 bits). A run of consecutive
+// msg_ids to one destination costs two bytes per message plus its payload.
+
+#define VARINT_MAX_BYTES 3
+
+static usize varint_len(u32 v) {
+    return v < (1u << 7) ? 1 : v < (1u << 14) ? 2 : 3;
+}
+
+static u8 *put_varint(u8 *p, u32 v) {
+    while (v >= 0x80) {
+        *p++ = (u8)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (u8)v;
+    return p;
+}
+
+static int get_varint(const u8 **p, const u8 *end, u32 *v) {
+    u32 x = 0;
+    for (int i = 0; i < VARINT_MAX_BYTES; i++) {
+        if (*p == end) return DBIN_ERR_FMT;
+        u8 b = *(*p)++;
+        x |= (u32)(b & 0x7F) << (7 * i);
+        if (!(b & 0x80)) {
+            *v = x;
+            return DBIN_OK;
+        }
+    }
+    return DBIN_ERR_FMT;
+}
+
+static u32 zigzag(u32 from, u32 to) {
+    int d = (int)(to - from);
+    return ((u32)d << 1) ^ (u32)(d >> 31);
+}
+
+static u32 unzigzag(u32 z) {
+    return (z >> 1) ^ (0u - (z & 1));
+}
+
+static u32 step(const dbin_msg_t *prev, const dbin_msg_t *m) {
+    return (u32)(u16)(m->msg_id - prev->msg_id - 1) << 1 | (m->route != prev->route);
+}
+
+// Entry bytes for m given the message before it (none for the first).
+static usize entry_len(const dbin_msg_t *prev, const dbin_msg_t *m) {
+    if (!prev) return varint_len(m->msg_len);
+    usize n = varint_len(step(prev, m)) + varint_len(m->msg_len);
+    if (m->route != prev->route) n += varint_len(zigzag(prev->route, m->route));
+    return n;
+}
+
+static int env_member(const dbin_msg_t *first, const dbin_msg_t *m) {
+    return m->type == DBIN_TYPE_MSG && m->reserved == 0 && m->user_id == first->user_id &&
+           m->is_room == first->is_room && m->valid == first->valid && dbin_validate(m) == DBIN_OK;
+}
+
+int dbin_encode_env(const dbin_msg_t *msgs, usize n, u8 *out, usize cap, usize *out_len, usize *done) {
+    if (!msgs || n == 0 || !out || !out_len || !done) return DBIN_ERR_PARAM;
+
+    int vr = dbin_validate(&msgs[0]);
+    if (vr != DBIN_OK) return vr;
+    if (msgs[0].type != DBIN_TYPE_MSG || msgs[0].reserved != 0) return DBIN_ERR_FMT;
+
+    // Size the prefix that fits before writing anything.
+    usize room = cap < DBIN_MAX_FRAME_LEN ? cap : DBIN_MAX_FRAME_LEN;
+    usize heads = 1, pay = 0, k = 0;
+    while (k < n && k < DBIN_ENV_MAX_MSGS) {
+        const dbin_msg_t *m = &msgs[k];
+        if (k > 0 && !env_member(&msgs[0], m)) break;
+        usize e = entry_len(k ? &msgs[k - 1] : 0, m);
+        if (DBIN_HEADER_V1_BYTES + heads + e + pay + m->msg_len > room) break;
+        heads += e;
+        pay += m->msg_len;
+        k++;
+    }
+    if (k == 0) return DBIN_ERR_BUF;
+
+    dbin_msg_t env = msgs[0];
+    env.type = DBIN_TYPE_ENV;
+    env.msg_len = (u16)(heads + pay);
+    dbin_hdr_v1_pack(&env, out);
+
+    u8 *p = out + DBIN_HEADER_V1_BYTES;
+    *p++ = (u8)k;
+    p = put_varint(p, msgs[0].msg_len);
+    for (usize i = 1; i < k; i++) {
+        u32 st = step(&msgs[i - 1], &msgs[i]);
+        p = put_varint(p, st);
+        if (st & 1) p = put_varint(p, zigzag(msgs[i - 1].route, msgs[i].route));
+        p = put_varint(p, msgs[i].msg_len);
+    }
+    for (usize i = 0; i < k; i++) {
+        if (msgs[i].msg_len) memcpy(p, msgs[i].msg, msgs[i].msg_len);
+        p += msgs[i].msg_len;
+    }
+
+    *out_len = (usize)(p - out);
+    *done = k;
+    return DBIN_OK;
+}
+
+int dbin_env_split(const dbin_msg_t *env, dbin_msg_t *out, usize cap, usize *n) {
+    if (!env || !out || !n) return DBIN_ERR_PARAM;
+    if (env->type != DBIN_TYPE_ENV || env->msg_len == 0 || !env->msg) return DBIN_ERR_FMT;
+
+    const u8 *p = env->msg, *end = env->msg + env->msg_len;
+    usize k = *p++;
+    if (k == 0) return DBIN_ERR_FMT;
+    *n = k;
+    if (cap < k) return DBIN_ERR_BUF;
+
+    u32 msg_id = env->msg_id, route = env->route, pay = 0;
+    for (usize i = 0; i < k; i++) {
+        u32 len, st, z_route;
+        if (i > 0) {
+            if (get_varint(&p, end, &st) || st > 0x1FFFFu) return DBIN_ERR_FMT;
+            msg_id = (msg_id + 1 + (st >> 1)) & 0xFFFFu;
+            if (st & 1) {
+                if (get_varint(&p, end, &z_route) || z_route == 0) return DBIN_ERR_FMT;
+                route += unzigzag(z_route);
+                if (route > DBIN_HDR_V1_MAX_route) return DBIN_ERR_FMT;
+            }
+        }
+        if (get_varint(&p, end, &len) || len > DBIN_MAX_MSG_LEN) return DBIN_ERR_FMT;
+
+        dbin_msg_t *m = &out[i];
+        *m = *env;
+        m->type = DBIN_TYPE_MSG;
+        m->reserved = 0;
+        m->route = route;
+        m->msg_id = (u16)msg_id;
+        m->msg_len = (u16)len;
+        pay += len;
+    }
+    // The payloads fill the rest of the body exactly.
+    if (pay != (u32)(end - p)) return DBIN_ERR_FMT;
+
+    for (usize i = 0; i < k; i++) {
+        out[i].msg = out[i].msg_len ? p : 0;
+        p += out[i].msg_len;
+    }
+    return DBIN_OK;
+}
+
+int dbin_decode_env(const u8 *in, usize in_len, dbin_msg_t *out, usize cap, usize *n) {
+    if (!out || !n) return DBIN_ERR_PARAM;
+    dbin_msg_t env;
+    int rc = dbin_decode(in, in_len, &env);
+    if (rc != DBIN_OK) return rc;
+    return dbin_env_split(&env, out, cap, n);
+}
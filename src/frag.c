@@ -0,0 +1,152 @@
+#include "dbin/frag.h"
+#include "dbin/codec.h"
+#include "dbin/schema.h"
+
+#include <string.h>
+
+static void put32(u8 *p, u32 v) {
+    p[0] = (u8)(v >> 24);
+    p[1] = (u8)(v >> 16);
+    p[2] = (u8)(v >> 8);
+    p[3] = (u8)v;
+}
+
+static u32 get32(const u8 *p) {
+    return ((u32)p[0] << 24) | ((u32)p[1] << 16) | ((u32)p[2] << 8) | (u32)p[3];
+}
+
+// ---- sending ----
+
+int dbin_frag_tx_init(dbin_frag_tx_t *t, const dbin_msg_t *m, const u8 *data, usize total, usize chunk) {
+    if (!t || !m || !data) return DBIN_ERR_PARAM;
+    if (total == 0 || total > 0xFFFFFFFFu) return DBIN_ERR_RANGE;
+    if (chunk == 0) chunk = DBIN_FRAG_MAX_DATA;
+    if (chunk > DBIN_FRAG_MAX_DATA) return DBIN_ERR_RANGE;
+
+    t->m = *m;
+    t->m.type = DBIN_TYPE_MSG;
+    t->m.reserved = DBIN_RESERVED_F;
+    t->m.msg = data;
+    t->m.msg_len = DBIN_FRAG_HDR_BYTES + 1;
+    int vr = dbin_validate(&t->m);
+    if (vr != DBIN_OK) return vr;
+
+    t->data = data;
+    t->total = (u32)total;
+    t->off = 0;
+    t->chunk = (u32)chunk;
+    return DBIN_OK;
+}
+
+int dbin_frag_tx_next(dbin_frag_tx_t *t, u8 *head, const u8 **data, usize *data_len) {
+    if (!t || !head || !data || !data_len || dbin_frag_tx_done(t)) return DBIN_ERR_PARAM;
+
+    u32 n = t->total - t->off;
+    if (n > t->chunk) n = t->chunk;
+    t->m.msg_len = (u16)(DBIN_FRAG_HDR_BYTES + n);
+    dbin_hdr_v1_pack(&t->m, head);
+    put32(head + DBIN_HEADER_V1_BYTES, t->total);
+    put32(head + DBIN_HEADER_V1_BYTES + 4, t->off);
+
+    *data = t->data + t->off;
+    *data_len = n;
+    t->off += n;
+    t->m.msg_id++;
+    return DBIN_OK;
+}
+
+int dbin_frag_tx_encode(dbin_frag_tx_t *t, u8 *out, usize cap, usize *out_len) {
+    if (!t || !out || !out_len || dbin_frag_tx_done(t)) return DBIN_ERR_PARAM;
+    u32 n = t->total - t->off;
+    if (n > t->chunk) n = t->chunk;
+    if (cap < DBIN_FRAG_HEAD_BYTES + n) return DBIN_ERR_BUF;
+
+    const u8 *data;
+    usize len;
+    dbin_frag_tx_next(t, out, &data, &len);
+    memcpy(out + DBIN_FRAG_HEAD_BYTES, data, len);
+    *out_len = DBIN_FRAG_HEAD_BYTES + len;
+    return DBIN_OK;
+}
+
+// ---- receiving ----
+
+void dbin_frag_rx_init(dbin_frag_rx_t *rx, u32 max_total) {
+    memset(rx, 0, sizeof(*rx));
+    rx->max_total = max_total;
+}
+
+static dbin_frag_slot_t *find(dbin_frag_rx_t *rx, u32 user_id, u32 route, u8 is_room) {
+    for (int i = 0; i < DBIN_FRAG_RX_SLOTS; i++) {
+        dbin_frag_slot_t *s = &rx->slot[i];
+        if (s->busy && s->user_id == user_id && s->route == route && s->is_room == is_room) return s;
+    }
+    return 0;
+}
+
+int dbin_frag_rx_push(dbin_frag_rx_t *rx, const dbin_msg_t *m, dbin_frag_t *f) {
+    if (!rx || !m || !f) return DBIN_ERR_PARAM;
+    if (m->type != DBIN_TYPE_MSG || (m->reserved & DBIN_RESERVED_MSG) != DBIN_RESERVED_F) return DBIN_ERR_PARAM;
+    if (m->msg_len <= DBIN_FRAG_HDR_BYTES || !m->msg) return DBIN_ERR_FMT;
+
+    u32 total = get32(m->msg);
+    u32 off = get32(m->msg + 4);
+    u32 len = (u32)m->msg_len - DBIN_FRAG_HDR_BYTES;
+    u8 is_room = (u8)m->is_room;
+    dbin_frag_slot_t *s = find(rx, m->user_id, m->route, is_room);
+
+    if (total == 0 || off >= total || len > total - off) {
+        if (s) s->busy = 0;
+        return DBIN_ERR_FMT;
+    }
+    if (off == 0) {
+        // A new payload; one still open for the same sender and destination
+        // is abandoned.
+        if (total > rx->max_total) {
+            if (s) s->busy = 0;
+            return DBIN_ERR_RANGE;
+        }
+        if (!s) {
+            for (int i = 0; i < DBIN_FRAG_RX_SLOTS && !s; i++) {
+                if (!rx->slot[i].busy) s = &rx->slot[i];
+            }
+            if (!s) return DBIN_ERR_BUF;
+        }
+        s->user_id = m->user_id;
+        s->route = m->route;
+        s->is_room = is_room;
+        s->busy = 1;
+        s->total = total;
+        s->next = 0;
+        s->dst = 0;
+    } else if (!s || s->total != total || s->next != off) {
+        if (s) s->busy = 0;
+        return DBIN_ERR_FMT;
+    }
+
+    f->user_id = m->user_id;
+    f->route = m->route;
+    f->is_room = is_room;
+    f->first = off == 0;
+    f->slot = (u8)(s - rx->slot);
+    f->total = total;
+    f->offset = off;
+    f->data = m->msg + DBIN_FRAG_HDR_BYTES;
+    f->len = len;
+
+    if (s->dst) memcpy(s->dst + off, f->data, len);
+    s->next = off + len;
+    f->last = s->next == total;
+    if (f->last) s->busy = 0;
+    return DBIN_OK;
+}
+
+void dbin_frag_rx_set_dst(dbin_frag_rx_t *rx, const dbin_frag_t *f, u8 *dst) {
+    memcpy(dst + f->offset, f->data, f->len);
+    if (!f->last) rx->slot[f->slot].dst = dst;
+}
+
+void dbin_frag_rx_drop(dbin_frag_rx_t *rx, const dbin_frag_t *f) {
+    dbin_frag_slot_t *s = &rx->slot[f->slot];
+    if (s->busy && s->user_id == f->user_id && s->route == f->route && s->is_room == f->is_room) s->busy = 0;
+}
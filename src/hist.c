@@ -0,0 +1,73 @@
+#include "dbin/hist.h"
+#include "dbin/codec.h"
+
+#include <string.h>
+
+int dbin_hist_init(dbin_hist_t *h, u32 sub_bits, u64 *counts, usize n) {
+    if (!h || !counts) return DBIN_ERR_PARAM;
+    if (sub_bits < 1 || sub_bits > DBIN_HIST_SUB_BITS_MAX) return DBIN_ERR_RANGE;
+    if (n < DBIN_HIST_BUCKETS(sub_bits)) return DBIN_ERR_BUF;
+
+    h->counts = counts;
+    h->sub_bits = sub_bits;
+    dbin_hist_reset(h);
+    return DBIN_OK;
+}
+
+void dbin_hist_reset(dbin_hist_t *h) {
+    memset(h->counts, 0, DBIN_HIST_BUCKETS(h->sub_bits) * sizeof(*h->counts));
+    h->total = 0;
+    h->min = ~0ull;
+    h->max = 0;
+    h->sum = 0;
+}
+
+int dbin_hist_merge(dbin_hist_t *dst, const dbin_hist_t *src) {
+    if (!dst || !src || dst->sub_bits != src->sub_bits) return DBIN_ERR_PARAM;
+
+    usize n = DBIN_HIST_BUCKETS(src->sub_bits);
+    for (usize i = 0; i < n; i++) dst->counts[i] += src->counts[i];
+    if (src->min < dst->min) dst->min = src->min;
+    if (src->max > dst->max) dst->max = src->max;
+    dst->sum += src->sum;
+    dst->total += src->total;
+    return DBIN_OK;
+}
+
+// Largest value that lands in bucket `i`.
+static u64 bucket_top(u32 sub_bits, usize i) {
+    usize group = i >> sub_bits;
+    u64 sub = (u64)(i & (((usize)1 << sub_bits) - 1));
+    if (group == 0) return sub;
+
+    u32 shift = (u32)group - 1;
+    u64 base = ((1ull << sub_bits) | sub) << shift;
+    return base + ((1ull << shift) - 1);
+}
+
+u64 dbin_hist_percentile(const dbin_hist_t *h, double pct) {
+    if (h->total == 0) return 0;
+    if (pct >= 100.0) return h->max;
+    if (pct < 0.0) pct = 0.0;
+
+    // Rank of the value asked for, 1-based: ceil(pct% of total).
+    double want = pct / 100.0 * (double)h->total;
+    u64 rank = (u64)want;
+    if ((double)rank < want) rank++;
+    if (rank == 0) rank = 1;
+
+    usize n = DBIN_HIST_BUCKETS(h->sub_bits);
+    u64 seen = 0;
+    for (usize i = 0; i < n; i++) {
+        seen += h->counts[i];
+        if (seen >= rank) {
+            u64 v = bucket_top(h->sub_bits, i);
+            return v < h->max ? v : h->max;
+        }
+    }
+    return h->max;
+}
+
+double dbin_hist_mean(const dbin_hist_t *h) {
+    return h->total ? (double)h->sum / (double)h->total : 0.0;
+}
@@ -0,0 +1,27 @@
+#include "dbin/iov.h"
+#include "dbin/codec.h"
+#include "dbin/schema.h"
+
+_Static_assert(DBIN_FRAME_HEAD_BYTES == DBIN_LEN_PREFIX_BYTES + DBIN_HEADER_V1_BYTES, "DBIN_FRAME_HEAD_BYTES out of date");
+
+int dbin_frame_iov(const dbin_msg_t *m, u8 *head, struct iovec *iov, int *iovcnt) {
+    if (!m || !head || !iov || !iovcnt) return DBIN_ERR_PARAM;
+
+    usize hlen;
+    int rc = dbin_encode_header(m, head + DBIN_LEN_PREFIX_BYTES, DBIN_HEADER_V1_BYTES, &hlen);
+    if (rc != DBIN_OK) return rc;
+
+    usize len = hlen + (usize)m->msg_len;
+    head[0] = (u8)(len >> 8);
+    head[1] = (u8)len;
+
+    iov[0].iov_base = head;
+    iov[0].iov_len = DBIN_FRAME_HEAD_BYTES;
+    *iovcnt = 1;
+    if (m->msg_len > 0) {
+        iov[1].iov_base = (void*)m->msg;
+        iov[1].iov_len = m->msg_len;
+        *iovcnt = 2;
+    }
+    return DBIN_OK;
+}
@@ -21,6 +21,7 @@ static const char* err_str(int rc) {
         case DBIN_ERR_MAGIC: return "DBIN_ERR_MAGIC";
         case DBIN_ERR_VER:   return "DBIN_ERR_VER";
         case DBIN_ERR_FMT:   return "DBIN_ERR_FMT";
+        case DBIN_ERR_AGAIN: return "DBIN_ERR_AGAIN";
         default:             return "DBIN_ERR_UNKNOWN";
     }
 }
@@ -0,0 +1,93 @@
+#include "dbin/stream.h"
+#include "dbin/codec.h"
+#include "dbin/schema.h"
+
+#include <string.h>
+
+static usize read_prefix(const u8 *p) {
+    return ((usize)p[0] << 8) | (usize)p[1];
+}
+
+// Total bytes (prefix included) the frame at `head` needs, or the largest
+// possible frame while its prefix is still incomplete.
+static usize pending_frame_need(const dbin_stream_t *s) {
+    if (s->tail - s->head < DBIN_LEN_PREFIX_BYTES) return DBIN_STREAM_MIN_CAP;
+    return DBIN_LEN_PREFIX_BYTES + read_prefix(s->buf + s->head);
+}
+
+int dbin_stream_init(dbin_stream_t *s, u8 *buf, usize cap) {
+    if (!s || !buf) return DBIN_ERR_PARAM;
+    if (cap < DBIN_STREAM_MIN_CAP) return DBIN_ERR_BUF;
+
+    s->buf = buf;
+    s->cap = cap;
+    dbin_stream_reset(s);
+    return DBIN_OK;
+}
+
+void dbin_stream_reset(dbin_stream_t *s) {
+    s->head = 0;
+    s->tail = 0;
+    s->err = DBIN_OK;
+    s->frame = 0;
+    s->frame_len = 0;
+}
+
+u8 *dbin_stream_wbuf(dbin_stream_t *s, usize *avail) {
+    if (s->head == s->tail) {
+        // Everything consumed: rewind for free.
+        s->head = 0;
+        s->tail = 0;
+    } else if (s->head > 0 && s->cap - s->head < pending_frame_need(s)) {
+        // The partial frame would wrap past the end: move it to the front.
+        usize n = s->tail - s->head;
+        memmove(s->buf, s->buf + s->head, n);
+        s->head = 0;
+        s->tail = n;
+    }
+
+    *avail = s->cap - s->tail;
+    return s->buf + s->tail;
+}
+
+void dbin_stream_commit(dbin_stream_t *s, usize n) {
+    if (n > s->cap - s->tail) n = s->cap - s->tail;
+    s->tail += n;
+}
+
+usize dbin_stream_feed(dbin_stream_t *s, const u8 *data, usize n) {
+    usize avail = 0;
+    u8 *w = dbin_stream_wbuf(s, &avail);
+    if (n > avail) n = avail;
+
+    memcpy(w, data, n);
+    s->tail += n;
+    return n;
+}
+
+int dbin_stream_next(dbin_stream_t *s, dbin_msg_t *out, usize *consumed) {
+    if (!s || !out) return DBIN_ERR_PARAM;
+    if (consumed) *consumed = 0;
+    if (s->err != DBIN_OK) return s->err;
+
+    usize have = s->tail - s->head;
+    if (have < DBIN_LEN_PREFIX_BYTES) return DBIN_ERR_AGAIN;
+
+    usize n = read_prefix(s->buf + s->head);
+    if (n < DBIN_HEADER_V1_BYTES) return s->err = DBIN_ERR_FMT;
+    if (n > DBIN_MAX_FRAME_LEN)   return s->err = DBIN_ERR_RANGE;
+
+    if (have < DBIN_LEN_PREFIX_BYTES + n) return DBIN_ERR_AGAIN;
+
+    const u8 *frame = s->buf + s->head + DBIN_LEN_PREFIX_BYTES;
+    s->head += DBIN_LEN_PREFIX_BYTES + n;
+    s->frame = frame;
+    s->frame_len = n;
+    if (consumed) *consumed = DBIN_LEN_PREFIX_BYTES + n;
+
+    return dbin_decode(frame, n, out);
+}
+
+usize dbin_stream_pending(const dbin_stream_t *s) {
+    return s->tail - s->head;
+}